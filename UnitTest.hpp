@@ -0,0 +1,95 @@
+/*! \file
+ *
+ * \brief A small harness for the C++ unit tests of the core library
+ */
+
+
+#ifndef PULSAR_GUARD_TESTING__UNITTEST_HPP_
+#define PULSAR_GUARD_TESTING__UNITTEST_HPP_
+
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace pulsar{
+
+/*! \brief Runs the checks of one test program and reports the failures
+ *
+ * Each check prints a line only if it fails.  Result() prints a summary
+ * and is what main() returns, so CTest sees a failed check as a failed
+ * test.
+ *
+ * \code
+ * int main()
+ * {
+ *     UnitTest Tester("Pivoted Cholesky");
+ *     Tester.Test("Rank of a rank-3 matrix", L.NCols() == 3);
+ *     Tester.TestClose("Reconstruction error", Err, 0.0, 1e-12);
+ *     Tester.TestThrows("BatchQuality above 1", [&]{ PivotedCholesky(A, 1e-8, 2.0); });
+ *     return Tester.Result();
+ * }
+ * \endcode
+ */
+class UnitTest
+{
+    public:
+        /// \p Desc names the test program in the summary
+        explicit UnitTest(const std::string & Desc)
+            : desc_(Desc), ntests_(0), nfailed_(0) { }
+
+        /// Passes if \p Passed is true
+        bool Test(const std::string & Desc, bool Passed)
+        {
+            ntests_++;
+            if(!Passed)
+            {
+                nfailed_++;
+                std::cout << "FAILED: " << Desc << std::endl;
+            }
+            return Passed;
+        }
+
+        /// Passes if \p Value is within \p Tol of \p Ref (never if either is NaN)
+        bool TestClose(const std::string & Desc, double Value, double Ref, double Tol)
+        {
+            const bool Passed = std::fabs(Value - Ref) <= Tol;
+            if(!Passed)
+                std::cout << Desc << ": got " << Value << ", expected "
+                          << Ref << " +/- " << Tol << std::endl;
+            return Test(Desc, Passed);
+        }
+
+        /// Passes if \p Fxn() throws something derived from std::exception
+        template<typename Fxn_t>
+        bool TestThrows(const std::string & Desc, Fxn_t && Fxn)
+        {
+            bool Threw = false;
+            try
+            {
+                Fxn();
+            }
+            catch(const std::exception &)
+            {
+                Threw = true;
+            }
+            return Test(Desc, Threw);
+        }
+
+        /// Prints the summary; 0 if every check passed, 1 otherwise
+        int Result(void) const
+        {
+            std::cout << desc_ << ": " << ntests_ - nfailed_ << " of "
+                      << ntests_ << " checks passed" << std::endl;
+            return nfailed_ ? 1 : 0;
+        }
+
+    private:
+        std::string desc_;   //!< What is being tested
+        size_t ntests_;      //!< Checks made so far
+        size_t nfailed_;     //!< Checks that failed
+};
+
+} // close namespace pulsar
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef PULSAR_GUARD_GRAPH__ADJACENCY_HPP_
+#define PULSAR_GUARD_GRAPH__ADJACENCY_HPP_
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <boost/graph/graph_traits.hpp>
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+namespace detail{
+
+/** \brief An undirected graph on the nodes 0 to N-1, in compressed sparse
+ *         row form
+ *
+ *  The neighbors of node i are Adj[Ptr[i]] to Adj[Ptr[i+1]-1], sorted and
+ *  without duplicates or self-loops.  This is what the combinatorial
+ *  algorithms (coloring, cliques, ...) actually run on: contiguous
+ *  integers instead of BGL descriptors and user objects.
+ */
+struct CSRGraph{
+   std::vector<size_t> Ptr{0};  ///<Where each node's neighbors start
+   std::vector<size_t> Adj;     ///<The neighbors
+
+   ///Number of nodes
+   size_t NNodes()const{return Ptr.size()-1;}
+   ///Number of neighbors of node i
+   size_t Degree(size_t i)const{return Ptr[i+1]-Ptr[i];}
+   ///First neighbor of node i
+   const size_t* Begin(size_t i)const{return Adj.data()+Ptr[i];}
+   ///Just past the last neighbor of node i
+   const size_t* End(size_t i)const{return Adj.data()+Ptr[i+1];}
+   ///Are i and j neighbors
+   bool AreConn(size_t i,size_t j)const{
+      return std::binary_search(Begin(i),End(i),j);
+   }
+
+   ///Builds the graph from a list of (possibly repeated) pairs
+   static CSRGraph FromPairs(size_t N,
+                             const std::vector<std::pair<size_t,size_t>>& Pairs){
+      std::vector<std::vector<size_t>> temp(N);
+      for(const auto& p:Pairs){
+         if(p.first==p.second)continue;
+         temp[p.first].push_back(p.second);
+         temp[p.second].push_back(p.first);
+      }
+      CSRGraph G;
+      G.Ptr.assign(N+1,0);
+      for(size_t i=0;i<N;++i){
+         std::sort(temp[i].begin(),temp[i].end());
+         temp[i].erase(std::unique(temp[i].begin(),temp[i].end()),temp[i].end());
+         G.Adj.insert(G.Adj.end(),temp[i].begin(),temp[i].end());
+         G.Ptr[i+1]=G.Adj.size();
+      }
+      return G;
+   }
+};
+
+/** \brief Smallest-last (degeneracy) ordering
+ *
+ *  Repeatedly removes a node of smallest remaining degree, with a bucket
+ *  queue so the whole thing is \f$O(N+E)\f$.  The removal order reversed
+ *  is returned: every node has at most \p Degeneracy neighbors before it,
+ *  where the degeneracy is the largest degree seen at removal.
+ */
+inline std::vector<size_t> DegeneracyOrder(const CSRGraph& G,
+                                           size_t* Degeneracy=nullptr){
+   const size_t n=G.NNodes();
+   size_t MaxDeg=0;
+   std::vector<size_t> Deg(n);
+   for(size_t i=0;i<n;++i)MaxDeg=std::max(MaxDeg,Deg[i]=G.Degree(i));
+
+   //Nodes sorted by degree, with where each degree starts
+   std::vector<size_t> Start(MaxDeg+2,0),Order(n),Pos(n);
+   for(size_t i=0;i<n;++i)++Start[Deg[i]+1];
+   for(size_t d=0;d<=MaxDeg;++d)Start[d+1]+=Start[d];
+   {
+      std::vector<size_t> Fill(Start.begin(),Start.end()-1);
+      for(size_t i=0;i<n;++i){Pos[i]=Fill[Deg[i]]++;Order[Pos[i]]=i;}
+   }
+
+   size_t Max=0;
+   for(size_t k=0;k<n;++k){
+      //Order[k] has the smallest degree of those left
+      const size_t v=Order[k];
+      Max=std::max(Max,Deg[v]);
+      for(const size_t* w=G.Begin(v);w!=G.End(v);++w){
+         if(Pos[*w]<=k || Deg[*w]<=Deg[v])continue;
+         //Swap w to the front of its bucket, then shrink the bucket
+         const size_t d=Deg[*w],First=std::max(Start[d],k+1),u=Order[First];
+         std::swap(Order[First],Order[Pos[*w]]);
+         std::swap(Pos[u],Pos[*w]);
+         ++Start[d];
+         --Deg[*w];
+      }
+   }
+   if(Degeneracy)*Degeneracy=Max;
+   std::reverse(Order.begin(),Order.end());
+   return Order;
+}
+
+}//End namespace detail
+
+/** \brief The nodes and edges of a graph numbered 0 to N-1 (and 0 to E-1)
+ *
+ *  BGL's descriptors aren't necessarily contiguous and the user's nodes
+ *  aren't necessarily cheap to compare, neither of which the
+ *  combinatorial algorithms want.  This numbers the nodes in the order
+ *  the graph stores them, the edges likewise, and makes the undirected
+ *  node graph (edge direction is ignored) and, on request, the line graph
+ *  (one node per edge, two of which are connected if the edges share an
+ *  end) in CSRGraph form.  The algorithms then map their results back
+ *  with Node() and Edge().
+ */
+template<typename Graph_t>
+class Adjacency{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///The type of the edges
+      typedef typename Graph_t::EdgeType Edge_t;
+
+      ///Numbers the nodes and edges of \p Graph
+      Adjacency(const Graph_t& Graph):Graph_(Graph){
+         auto Its=boost::vertices(Graph_.Base_);
+         for(;Its.first!=Its.second;++Its.first){
+            Index_[*Its.first]=Vertices_.size();
+            Vertices_.push_back(*Its.first);
+         }
+         auto EIts=boost::edges(Graph_.Base_);
+         for(;EIts.first!=EIts.second;++EIts.first){
+            Arcs_.push_back(*EIts.first);
+            Ends_.push_back(std::make_pair(
+                  Index_.at(boost::source(*EIts.first,Graph_.Base_)),
+                  Index_.at(boost::target(*EIts.first,Graph_.Base_))));
+         }
+         Nodes_=detail::CSRGraph::FromPairs(Vertices_.size(),Ends_);
+      }
+
+      ///The graph this numbers
+      const Graph_t& Graph()const{return Graph_;}
+
+      ///Number of nodes
+      size_t NNodes()const{return Vertices_.size();}
+
+      ///Number of edges (as the graph stores them)
+      size_t NEdges()const{return Arcs_.size();}
+
+      ///The i-th node
+      const Node_t& Node(size_t i)const{return Graph_[Vertices_[i]];}
+
+      ///The number of a node
+      size_t Index(const Node_t& NodeI)const{
+         return Index_.at(Graph_.NodeLookUp_.at(NodeI));
+      }
+
+      ///The e-th edge
+      const Edge_t& Edge(size_t e)const{return Graph_[Arcs_[e]];}
+
+      ///The numbers of the source and sink of the e-th edge
+      const std::pair<size_t,size_t>& Ends(size_t e)const{return Ends_[e];}
+
+      ///The nodes, connected if there is an edge either way
+      const detail::CSRGraph& Nodes()const{return Nodes_;}
+
+      ///One node per edge, connected if the edges share an end
+      detail::CSRGraph LineGraph()const{
+         std::vector<std::vector<size_t>> Incident(NNodes());
+         for(size_t e=0;e<Ends_.size();++e){
+            Incident[Ends_[e].first].push_back(e);
+            if(Ends_[e].second!=Ends_[e].first)
+               Incident[Ends_[e].second].push_back(e);
+         }
+         std::vector<std::pair<size_t,size_t>> Pairs;
+         for(const auto& Es:Incident)
+            for(size_t a=0;a<Es.size();++a)
+               for(size_t b=a+1;b<Es.size();++b)
+                  Pairs.push_back(std::make_pair(Es[a],Es[b]));
+         return detail::CSRGraph::FromPairs(Ends_.size(),Pairs);
+      }
+
+   private:
+      ///What BGL uses for nodes
+      typedef typename Graph_t::Vertex_t Vertex_t;
+      ///What BGL uses for edges
+      typedef typename Graph_t::Arc_t Arc_t;
+
+      ///The graph
+      const Graph_t& Graph_;
+
+      ///The nodes, by number
+      std::vector<Vertex_t> Vertices_;
+
+      ///The number of each node
+      std::map<Vertex_t,size_t> Index_;
+
+      ///The edges, by number
+      std::vector<Arc_t> Arcs_;
+
+      ///The ends of each edge
+      std::vector<std::pair<size_t,size_t>> Ends_;
+
+      ///The undirected node graph
+      detail::CSRGraph Nodes_;
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_ADJACENCY_HPP_ */
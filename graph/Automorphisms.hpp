@@ -0,0 +1,553 @@
+#ifndef PULSAR_GUARD_GRAPH__AUTOMORPHISMS_HPP_
+#define PULSAR_GUARD_GRAPH__AUTOMORPHISMS_HPP_
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <numeric>
+#include <functional>
+#include <algorithm>
+
+#include "pulsar/datastore/graph/Adjacency.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+namespace detail{
+
+///Disjoint sets of 0 to N-1, with path halving and union by size
+class UnionFind{
+   public:
+      UnionFind(size_t N=0):Parent_(N),Size_(N,1){
+         std::iota(Parent_.begin(),Parent_.end(),0);
+      }
+
+      ///The representative of i's set
+      size_t Find(size_t i){
+         while(Parent_[i]!=i)i=Parent_[i]=Parent_[Parent_[i]];
+         return i;
+      }
+
+      ///Merges the sets of i and j, returns false if they were the same set
+      bool Union(size_t i,size_t j){
+         i=Find(i);j=Find(j);
+         if(i==j)return false;
+         if(Size_[i]<Size_[j])std::swap(i,j);
+         Parent_[j]=i;
+         Size_[i]+=Size_[j];
+         return true;
+      }
+
+      ///Number of elements in i's set
+      size_t Size(size_t i){return Size_[Find(i)];}
+
+   private:
+      std::vector<size_t> Parent_,Size_;
+};
+
+/** \brief Individualization-refinement search for the automorphisms of a
+ *         colored graph
+ *
+ *  A partition of the nodes is stored as the cell each node is in, cells
+ *  numbered 0 to k-1.  Everything that decides a cell number looks only at
+ *  cell numbers and labels, never at node numbers, so an automorphism
+ *  maps a partition to one with the same cell numbers.  When every cell
+ *  has one node (the partition is discrete) its cell numbers are an
+ *  ordering of the nodes, and two such leaves give a candidate
+ *  automorphism: the node at position p in one goes to the node at
+ *  position p in the other.
+ */
+class AutomorphismSearch{
+   public:
+      typedef std::vector<size_t> Perm_t;
+
+      /** \param[in] G The graph
+       *  \param[in] NodeColor The color of each node
+       *  \param[in] EdgeColor The color of each entry of G.Adj
+       */
+      AutomorphismSearch(const CSRGraph& G,const std::vector<size_t>& NodeColor,
+                         const std::vector<size_t>& EdgeColor):
+         G_(G),EColor_(EdgeColor),Orbits_(G.NNodes()){
+         const size_t n=G.NNodes();
+         if(n==0)return;
+         std::vector<size_t> Colors(NodeColor);
+         std::sort(Colors.begin(),Colors.end());
+         Colors.erase(std::unique(Colors.begin(),Colors.end()),Colors.end());
+         std::vector<size_t> Cell(n);
+         for(size_t v=0;v<n;++v)
+            Cell[v]=std::lower_bound(Colors.begin(),Colors.end(),NodeColor[v])-
+                    Colors.begin();
+         Refine(Cell);
+         Search(Cell);
+      }
+
+      ///Permutations generating the group, Gens[g][v] is where v goes
+      const std::vector<Perm_t>& Generators()const{return Gens_;}
+
+      ///The orbits as disjoint sets
+      UnionFind& Orbits(){return Orbits_;}
+
+      ///The order of the group (a double, it gets big quickly)
+      double GroupSize()const{return Size_;}
+
+   private:
+      const CSRGraph& G_;
+      const std::vector<size_t>& EColor_;
+      UnionFind Orbits_;
+      std::vector<Perm_t> Gens_;
+      double Size_=1.0;
+
+      ///The first path: the partition at each depth and the node picked
+      std::vector<std::vector<size_t>> Path_;
+      std::vector<size_t> Picked_;
+
+      ///Number of cells and their sizes, compared before descending
+      std::vector<std::vector<size_t>> Shape_;
+
+      ///Refine()'s colors of each node's edges into the splitter, kept
+      ///between calls so that they aren't reallocated each time
+      mutable std::vector<std::vector<size_t>> Key_;
+
+      static size_t NCells(const std::vector<size_t>& Cell){
+         return Cell.empty()?0:*std::max_element(Cell.begin(),Cell.end())+1;
+      }
+
+      static std::vector<size_t> Shape(const std::vector<size_t>& Cell){
+         std::vector<size_t> temp(NCells(Cell),0);
+         for(size_t c:Cell)++temp[c];
+         return temp;
+      }
+
+      ///Refine everything, not just after individualizing one cell
+      static const size_t All=static_cast<size_t>(-1);
+
+      /** Splits cells until every node in a cell has the same number of
+       *  edges of each color into each cell (the coarsest equitable
+       *  partition, what 1-dimensional Weisfeiler-Lehman gives).  A cell's
+       *  pieces keep its place in the order, sorted by what split them.
+       *
+       *  As in nauty, this works from a queue of splitter cells and only
+       *  looks at the neighbors of each splitter, not every node.  When a
+       *  cell splits, its pieces join the queue, except the largest if the
+       *  cell wasn't queued already (Hopcroft's trick: the cell was already
+       *  used or implied, and it and the other pieces imply the largest).
+       *  The queue starts with every cell, or with just \p Splitter if the
+       *  partition was equitable before that cell was split off (as after
+       *  Individualize()), since the cell it came from and \p Splitter
+       *  imply the rest.  Cells are named by where they start in Lab, so
+       *  nothing depends on node numbers.
+       */
+      void Refine(std::vector<size_t>& Cell,size_t Splitter=All)const{
+         const size_t n=Cell.size();
+         const std::vector<size_t> Sizes=Shape(Cell);
+         size_t NCell=Sizes.size();
+         if(NCell==n)return;
+
+         //Lab lists the nodes cell by cell, Pos is where each node is in
+         //Lab, First where its cell starts, and Len[s] the length of the
+         //cell starting at s
+         std::vector<size_t> Start(NCell,0),Lab(n),Pos(n),First(n),Len(n,0);
+         for(size_t c=1;c<NCell;++c)Start[c]=Start[c-1]+Sizes[c-1];
+         for(size_t c=0;c<NCell;++c)Len[Start[c]]=Sizes[c];
+         std::vector<size_t> Next(Start);
+         for(size_t v=0;v<n;++v){
+            Pos[v]=Next[Cell[v]]++;
+            Lab[Pos[v]]=v;
+            First[v]=Start[Cell[v]];
+         }
+
+         std::deque<size_t> Queue;
+         std::vector<char> Queued(n,0);
+         if(Splitter==All)Queue.assign(Start.begin(),Start.end());
+         else Queue.push_back(Start[Splitter]);
+         for(size_t s:Queue)Queued[s]=1;
+
+         std::vector<std::vector<size_t>>& Key=Key_;
+         Key.resize(n);
+         std::vector<size_t> Touched,Piece;
+         while(!Queue.empty() && NCell<n){
+            const size_t s=Queue.front();
+            Queue.pop_front();
+            Queued[s]=0;
+            //Copied, as the splitter itself may split
+            const std::vector<size_t> S(Lab.begin()+s,Lab.begin()+s+Len[s]);
+            for(size_t u:S)
+               for(size_t k=G_.Ptr[u];k<G_.Ptr[u+1];++k){
+                  const size_t w=G_.Adj[k];
+                  if(Key[w].empty())Touched.push_back(w);
+                  Key[w].push_back(EColor_[k]);
+               }
+            for(size_t w:Touched)std::sort(Key[w].begin(),Key[w].end());
+            std::sort(Touched.begin(),Touched.end(),[&](size_t a,size_t b){
+               return First[a]!=First[b]?First[a]<First[b]:Key[a]<Key[b];});
+
+            for(size_t a=0,b=0;a<Touched.size();a=b){
+               const size_t c=First[Touched[a]],End=c+Len[c];
+               while(b<Touched.size() && First[Touched[b]]==c)++b;
+               if(b-a==Len[c] && Key[Touched[a]]==Key[Touched[b-1]])continue;
+
+               //Move the touched nodes to the back of the cell, in order
+               for(size_t i=b,Back=End;i-->a;){
+                  const size_t w=Touched[i],x=Lab[--Back],p=Pos[w];
+                  Lab[p]=x;Pos[x]=p;
+                  Lab[Back]=w;Pos[w]=Back;
+               }
+               Piece.assign(1,c);
+               if(b-a<Len[c])Piece.push_back(End-(b-a));
+               for(size_t i=a+1;i<b;++i)
+                  if(Key[Touched[i-1]]<Key[Touched[i]])
+                     Piece.push_back(Pos[Touched[i]]);
+               Piece.push_back(End);
+               for(size_t i=1;i+1<Piece.size();++i){
+                  Len[Piece[i]]=Piece[i+1]-Piece[i];
+                  for(size_t p=Piece[i];p<Piece[i+1];++p)First[Lab[p]]=Piece[i];
+               }
+               Len[c]=Piece[1]-c;
+               Piece.pop_back();
+               NCell+=Piece.size()-1;
+
+               size_t Largest=Piece.size();
+               if(!Queued[c]){
+                  Largest=0;
+                  for(size_t i=1;i<Piece.size();++i)
+                     if(Len[Piece[i]]>Len[Piece[Largest]])Largest=i;
+               }
+               for(size_t i=0;i<Piece.size();++i)
+                  if(i!=Largest && !Queued[Piece[i]]){
+                     Queued[Piece[i]]=1;
+                     Queue.push_back(Piece[i]);
+                  }
+            }
+            for(size_t w:Touched)Key[w].clear();
+            Touched.clear();
+         }
+
+         for(size_t p=0,c=0;p<n;++p){
+            if(p>0 && First[Lab[p]]==p)++c;
+            Cell[Lab[p]]=c;
+         }
+      }
+
+      ///Gives v a cell of its own, just in front of the rest of its cell
+      static std::vector<size_t> Individualize(const std::vector<size_t>& Cell,
+                                               size_t v){
+         std::vector<size_t> temp(Cell);
+         for(size_t u=0;u<temp.size();++u)
+            if(temp[u]>Cell[v] || (temp[u]==Cell[v] && u!=v))++temp[u];
+         return temp;
+      }
+
+      ///The nodes of the smallest non-singleton cell (the first if tied)
+      static std::vector<size_t> Target(const std::vector<size_t>& Cell){
+         const std::vector<size_t> Sizes=Shape(Cell);
+         size_t Best=Sizes.size();
+         for(size_t c=0;c<Sizes.size();++c)
+            if(Sizes[c]>1 && (Best==Sizes.size() || Sizes[c]<Sizes[Best]))Best=c;
+         std::vector<size_t> temp;
+         for(size_t v=0;v<Cell.size();++v)if(Cell[v]==Best)temp.push_back(v);
+         return temp;
+      }
+
+      ///Is the map between the first leaf and \p Leaf an automorphism
+      bool Automorphism(const std::vector<size_t>& Leaf,Perm_t& Gamma)const{
+         const std::vector<size_t>& First=Path_.back();
+         const size_t n=Leaf.size();
+         std::vector<size_t> At(n);
+         for(size_t v=0;v<n;++v)At[Leaf[v]]=v;
+         Gamma.resize(n);
+         for(size_t v=0;v<n;++v)Gamma[v]=At[First[v]];
+         for(size_t v=0;v<n;++v){
+            const size_t gv=Gamma[v];
+            if(G_.Degree(v)!=G_.Degree(gv))return false;
+            for(size_t k=G_.Ptr[v];k<G_.Ptr[v+1];++k){
+               const size_t gw=Gamma[G_.Adj[k]];
+               const size_t* It=std::lower_bound(G_.Begin(gv),G_.End(gv),gw);
+               if(It==G_.End(gv) || *It!=gw ||
+                  EColor_[It-G_.Adj.data()]!=EColor_[k])return false;
+            }
+         }
+         return true;
+      }
+
+      ///Looks below \p Cell, at \p Depth, for a leaf giving an automorphism
+      bool Find(const std::vector<size_t>& Cell,size_t Depth,Perm_t& Gamma)const{
+         if(Depth+1==Path_.size())return Automorphism(Cell,Gamma);
+         for(size_t u:Target(Cell)){
+            std::vector<size_t> Child=Individualize(Cell,u);
+            Refine(Child,Child[u]);
+            if(Shape(Child)==Shape_[Depth+1] && Find(Child,Depth+1,Gamma))
+               return true;
+         }
+         return false;
+      }
+
+      /** Follows the first node of each target cell down to a leaf, then,
+       *  deepest level first, tries each other node of the target cell.
+       *  Automorphisms found at depth k fix the nodes picked above k, so
+       *  the ones found so far generate the stabilizer of those nodes and
+       *  the nodes already in the picked node's orbit (or in the orbit of
+       *  one that failed) can be skipped.
+       */
+      void Search(const std::vector<size_t>& Root){
+         Path_.push_back(Root);
+         Shape_.push_back(Shape(Root));
+         std::vector<std::vector<size_t>> Targets;
+         while(NCells(Path_.back())<Path_.back().size()){
+            Targets.push_back(Target(Path_.back()));
+            Picked_.push_back(Targets.back().front());
+            std::vector<size_t> Child=Individualize(Path_.back(),Picked_.back());
+            Refine(Child,Child[Picked_.back()]);
+            Path_.push_back(Child);
+            Shape_.push_back(Shape(Child));
+         }
+
+         for(size_t k=Targets.size();k-->0;){
+            const size_t v=Picked_[k];
+            std::vector<size_t> Failed;
+            for(size_t w:Targets[k]){
+               if(Orbits_.Find(w)==Orbits_.Find(v))continue;
+               bool Skip=false;
+               for(size_t f:Failed)Skip=Skip || Orbits_.Find(f)==Orbits_.Find(w);
+               if(Skip)continue;
+               std::vector<size_t> Child=Individualize(Path_[k],w);
+               Refine(Child,Child[w]);
+               Perm_t Gamma;
+               if(Shape(Child)==Shape_[k+1] && Find(Child,k+1,Gamma)){
+                  for(size_t u=0;u<Gamma.size();++u)Orbits_.Union(u,Gamma[u]);
+                  Gens_.push_back(std::move(Gamma));
+               }
+               else Failed.push_back(w);
+            }
+            Size_*=Orbits_.Size(v);
+         }
+      }
+};
+
+}//End namespace detail
+
+/** \brief The symmetries of a graph: the automorphism group's generators
+ *         and the orbits of the nodes
+ *
+ *  An automorphism is a relabeling of the nodes that maps edges to edges
+ *  (and, if colors are given, nodes and edges to ones of the same color).
+ *  Two nodes are in the same orbit if an automorphism maps one to the
+ *  other, in which case anything computed from the graph's topology is the
+ *  same for both.  Work on symmetric fragments can then be done once per
+ *  orbit and copied:
+ *
+ *  \code
+ *  Automorphisms<MyGraph_t> Sym(Molecule,
+ *                               [](const Atom& a){return a.Z;});
+ *  for(const Atom& Rep:Sym.Representatives())Results[Rep]=Compute(Rep);
+ *  for(const Atom& a:Molecule)
+ *     Results[a]=Results[Sym.Representative(a)];//Possibly rotated by
+ *                                               //Sym.FromRepresentative(a)
+ *  \endcode
+ *
+ *  The group is found by individualization-refinement, as in nauty
+ *  (McKay and Piperno, J. Symb. Comput. 60, 94 (2014)), but without
+ *  canonical labeling: nodes are split into cells by color refinement,
+ *  then one node of a cell is fixed at a time and the refinement repeated,
+ *  which is a search tree whose leaves are orderings of the nodes.  Leaves
+ *  that give automorphisms of the first leaf are collected as generators,
+ *  and known automorphisms prune the branches they would repeat.
+ *
+ *  Each node of the tree costs one refinement, which only looks at the
+ *  neighbors of the cells that split, plus O(N) to copy the partition.
+ *  Finding a generator walks from its level down to a leaf, so the cost
+ *  grows as the number of generators times the depth of the tree.  Most
+ *  molecules have few generators and finish in about one refinement.
+ *  Many independent local symmetries cost more, e.g. the hydrogens of
+ *  every CH2 in a long alkane, or many identical separate molecules.
+ *  There the search is quadratic in their number.
+ *
+ *  Edge direction is ignored.
+ */
+template<typename Graph_t>
+class Automorphisms{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///The type of the edges
+      typedef typename Graph_t::EdgeType Edge_t;
+      ///A function giving the color of a node
+      typedef std::function<size_t(const Node_t&)> NodeColor_t;
+      ///A function giving the color of an edge
+      typedef std::function<size_t(const Edge_t&)> EdgeColor_t;
+      ///An automorphism, where each node goes
+      typedef std::map<Node_t,Node_t> Perm_t;
+
+      /** \brief Finds the automorphisms of \p Graph
+       *
+       *  \param[in] NodeColor If given, only nodes of the same color are
+       *                       mapped to each other (e.g. the element)
+       *  \param[in] EdgeColor If given, likewise for edges (e.g. the bond
+       *                       order)
+       */
+      Automorphisms(const Graph_t& Graph,const NodeColor_t& NodeColor=nullptr,
+                    const EdgeColor_t& EdgeColor=nullptr):Adj_(Graph){
+         const detail::CSRGraph& G=Adj_.Nodes();
+         const size_t n=Adj_.NNodes();
+         std::vector<size_t> NColor(n,0);
+         if(NodeColor)
+            for(size_t v=0;v<n;++v)NColor[v]=NodeColor(Adj_.Node(v));
+         const std::vector<size_t> EColor=EdgeColors(EdgeColor);
+         detail::AutomorphismSearch Search(G,NColor,EColor);
+         Gens_=Search.Generators();
+         Size_=Search.GroupSize();
+
+         std::vector<size_t> Root(n);
+         for(size_t v=0;v<n;++v)Root[v]=Search.Orbits().Find(v);
+         std::map<size_t,size_t> Number;
+         Orbit_.resize(n);
+         for(size_t v=0;v<n;++v){
+            auto It=Number.emplace(Root[v],Orbits_.size()).first;
+            if(It->second==Orbits_.size())Orbits_.emplace_back();
+            Orbit_[v]=It->second;
+            Orbits_[It->second].push_back(v);
+         }
+         SchreierTrees();
+      }
+
+      ///The order of the automorphism group (1 if there is no symmetry)
+      double GroupSize()const{return Size_;}
+
+      ///Automorphisms that, composed, give all of them
+      std::vector<Perm_t> Generators()const{
+         std::vector<Perm_t> temp;
+         for(const auto& g:Gens_)temp.push_back(ToNodes(g));
+         return temp;
+      }
+
+      ///The orbits, each in the order the graph stores its nodes
+      std::vector<std::vector<Node_t>> Orbits()const{
+         std::vector<std::vector<Node_t>> temp;
+         for(const auto& o:Orbits_){
+            temp.emplace_back();
+            for(size_t v:o)temp.back().push_back(Adj_.Node(v));
+         }
+         return temp;
+      }
+
+      ///Number of orbits
+      size_t NOrbits()const{return Orbits_.size();}
+
+      ///Which orbit \p NodeI is in, an index into Orbits()
+      size_t Orbit(const Node_t& NodeI)const{return Orbit_[Adj_.Index(NodeI)];}
+
+      ///The first node of each orbit
+      std::vector<Node_t> Representatives()const{
+         std::vector<Node_t> temp;
+         for(const auto& o:Orbits_)temp.push_back(Adj_.Node(o.front()));
+         return temp;
+      }
+
+      ///The first node of \p NodeI's orbit
+      const Node_t& Representative(const Node_t& NodeI)const{
+         return Adj_.Node(Orbits_[Orbit(NodeI)].front());
+      }
+
+      ///Are \p NodeI and \p NodeJ equivalent
+      bool AreEquivalent(const Node_t& NodeI,const Node_t& NodeJ)const{
+         return Orbit(NodeI)==Orbit(NodeJ);
+      }
+
+      /** \brief An automorphism mapping Representative(NodeI) to \p NodeI
+       *
+       *  This is what a result computed for the representative has to be
+       *  permuted by to become the result for \p NodeI.
+       */
+      Perm_t FromRepresentative(const Node_t& NodeI)const{
+         const size_t None=static_cast<size_t>(-1);
+         std::vector<size_t> temp(Adj_.NNodes());
+         std::iota(temp.begin(),temp.end(),0);
+         //Walk up the tree, composing generators on the right
+         for(size_t v=Adj_.Index(NodeI);Via_[v]!=None;v=Parent_[v]){
+            const std::vector<size_t>& g=Gens_[Via_[v]];
+            std::vector<size_t> Composed(temp.size());
+            for(size_t u=0;u<temp.size();++u)Composed[u]=temp[g[u]];
+            temp.swap(Composed);
+         }
+         return ToNodes(temp);
+      }
+
+   private:
+      ///The numbered graph
+      Adjacency<Graph_t> Adj_;
+
+      ///The generators, on node numbers
+      std::vector<std::vector<size_t>> Gens_;
+
+      ///The group order
+      double Size_=1.0;
+
+      ///The orbits, and which orbit each node is in
+      std::vector<std::vector<size_t>> Orbits_;
+      std::vector<size_t> Orbit_;
+
+      ///Each node's parent in its orbit's Schreier tree and the generator
+      ///taking the parent to it
+      std::vector<size_t> Parent_,Via_;
+
+      Perm_t ToNodes(const std::vector<size_t>& g)const{
+         Perm_t temp;
+         for(size_t v=0;v<g.size();++v)temp[Adj_.Node(v)]=Adj_.Node(g[v]);
+         return temp;
+      }
+
+      ///The color of each entry of the node graph's adjacency list
+      std::vector<size_t> EdgeColors(const EdgeColor_t& EdgeColor)const{
+         const detail::CSRGraph& G=Adj_.Nodes();
+         std::vector<size_t> temp(G.Adj.size(),0);
+         if(!EdgeColor)return temp;
+         //u-->v and v-->u are one undirected edge, which gets both colors
+         std::map<std::pair<size_t,size_t>,std::vector<size_t>> Colors;
+         for(size_t e=0;e<Adj_.NEdges();++e){
+            std::pair<size_t,size_t> Ends=Adj_.Ends(e);
+            if(Ends.first>Ends.second)std::swap(Ends.first,Ends.second);
+            Colors[Ends].push_back(EdgeColor(Adj_.Edge(e)));
+         }
+         std::map<std::vector<size_t>,size_t> Number;
+         for(auto& c:Colors){
+            std::sort(c.second.begin(),c.second.end());
+            Number.emplace(c.second,0);
+         }
+         size_t i=0;
+         for(auto& c:Number)c.second=i++;
+         for(size_t v=0;v<G.NNodes();++v)
+            for(size_t k=G.Ptr[v];k<G.Ptr[v+1];++k){
+               const size_t w=G.Adj[k];
+               auto It=Colors.find(std::make_pair(std::min(v,w),std::max(v,w)));
+               if(It!=Colors.end())temp[k]=Number.at(It->second);
+            }
+         return temp;
+      }
+
+      ///Breadth-first from each representative along the generators
+      void SchreierTrees(){
+         const size_t n=Adj_.NNodes(),None=static_cast<size_t>(-1);
+         Parent_.assign(n,None);
+         Via_.assign(n,None);
+         std::vector<char> Seen(n,0);
+         for(const auto& o:Orbits_){
+            std::vector<size_t> Queue(1,o.front());
+            Seen[o.front()]=1;
+            for(size_t q=0;q<Queue.size();++q)
+               for(size_t g=0;g<Gens_.size();++g){
+                  const size_t w=Gens_[g][Queue[q]];
+                  if(Seen[w])continue;
+                  Seen[w]=1;
+                  Parent_[w]=Queue[q];
+                  Via_[w]=g;
+                  Queue.push_back(w);
+               }
+         }
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_AUTOMORPHISMS_HPP_ */
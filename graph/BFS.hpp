@@ -97,7 +97,7 @@ class BFS: private BFSBase<BFS<Graph_t>,Graph_t>{
        *   happen because Y is already marked as finished.
        *
        */
-      void Run(const Node_t& Node, bool Clean=true){RunImpl(Node,Clean);}
+      void Run(const Node_t& Node, bool Clean=true){Base_t::RunImpl(Node,Clean);}
 
       /** Given a node, returns the distance from the input node to it.
        *  A value of 0 indicates either the node is not connected to the
@@ -105,7 +105,7 @@ class BFS: private BFSBase<BFS<Graph_t>,Graph_t>{
        *  the user knows what node they gave us and can tell the
        *  difference.
        */
-      size_t Distance(const Node_t& Node)const{return Distance_.at(Node);}
+      size_t Distance(const Node_t& Node)const{return Base_t::Distance_->at(Node);}
 
       ///Returns true if the node was visited during the BFS
       bool WasSeen(const Node_t& Node)const{
@@ -130,47 +130,48 @@ class BFSBase:public boost::default_bfs_visitor{
    public:
       typedef typename Graph_t::Vertex_t Vertex_t;
       typedef typename Graph_t::Arc_t Arc_t;
+      typedef typename Graph_t::Base_t BGL_t;
       typedef typename Graph_t::NodeType Node_t;
       typedef typename Graph_t::EdgeType Edge_t;
       typedef std::map<Node_t,size_t> Map_t;
       typedef typename
             boost::vector_property_map<boost::default_color_type> Color_t;
 
-      void discover_vertex(const Vertex_t& Node,const Graph_t&){
+      void discover_vertex(const Vertex_t& Node,const BGL_t&){
          Parent_.FoundNode(Graph_[Node]);
       }
 
-      void examine_vertex(const Vertex_t& Node,const Graph_t&){
+      void examine_vertex(const Vertex_t& Node,const BGL_t&){
          Parent_.LookAtNode(Graph_[Node]);
       }
 
-      void examine_edge(const Arc_t& Edge,const Graph_t&){
+      void examine_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.LookAtEdge(Graph_[Edge]);
       }
 
-      void tree_edge(const Arc_t& Edge,const Graph_t&){
-         (*Distance_)[Graph_[boost::target(Edge,Graph_)]]=
-              (*Distance_)[Graph_[boost::source(Edge,Graph_)]]+1;
+      void tree_edge(const Arc_t& Edge,const BGL_t& BGL){
+         (*Distance_)[Graph_[boost::target(Edge,BGL)]]=
+              (*Distance_)[Graph_[boost::source(Edge,BGL)]]+1;
          Parent_.TreeEdge(Graph_[Edge]);
       }
 
-      void non_tree_edge(const Arc_t& Edge,const Graph_t&){
+      void non_tree_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.OtherEdge(Graph_[Edge]);
       }
 
       /*//These calls seem superflous
       virtual void KnownEdge(Edge_t&)=0;
-      void gray_target(const Arc_t& Edge,const Graph_t&){
+      void gray_target(const Arc_t& Edge,const BGL_t&){
           KnownEdge(Graph_[Edge]);
       }
 
       virtual void DeadEdge(Edge_t&)=0;
-      void black_target(const Arc_t& Edge,const Graph_t&){
+      void black_target(const Arc_t& Edge,const BGL_t&){
          DeadEdge(Graph_[Edge]);
       }
       */
 
-      void finish_vertex(const Vertex_t& Node,const Graph_t&){
+      void finish_vertex(const Vertex_t& Node,const BGL_t&){
          Parent_.NodeDone(Graph_[Node]);
       }
 
@@ -186,7 +187,7 @@ class BFSBase:public boost::default_bfs_visitor{
          Parent_(P){Reset();}
 
       bool WasSeen(const Node_t& Node)const{
-         return Colors_[Graph_.NodeLookUp_.at(Node)]==
+         return Colors_[Graph_.NodeLookUp_.at(Node)]!=
                boost::color_traits<boost::default_color_type>::white();
       }
 
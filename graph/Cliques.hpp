@@ -0,0 +1,293 @@
+#ifndef PULSAR_GUARD_GRAPH__CLIQUES_HPP_
+#define PULSAR_GUARD_GRAPH__CLIQUES_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "pulsar/datastore/graph/Adjacency.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+namespace detail{
+
+/** \brief The subgraph induced by a node's neighbors, with bitset rows
+ *
+ *  Nodes are numbered 0 to M-1 locally and row i has bit j set if i and j
+ *  are neighbors.  Intersecting candidate sets is then a loop of ANDs over
+ *  M/64 words, which is what makes Bron-Kerbosch fast.
+ */
+class BitGraph{
+   public:
+      typedef uint64_t Word_t;
+      typedef std::vector<Word_t> Set_t;
+
+      ///The subgraph of \p G induced by \p Nodes, Nodes[i] becomes node i
+      BitGraph(const CSRGraph& G,const std::vector<size_t>& Nodes):
+         M_(Nodes.size()),W_((M_+63)/64),Rows_(M_*W_,0){
+         std::vector<std::pair<size_t,size_t>> Sorted(M_);
+         for(size_t i=0;i<M_;++i)Sorted[i]=std::make_pair(Nodes[i],i);
+         std::sort(Sorted.begin(),Sorted.end());
+         //Neighbor lists are sorted too, so merge instead of searching
+         for(size_t i=0;i<M_;++i){
+            const size_t* w=G.Begin(Nodes[i]);
+            for(auto j=Sorted.begin();j!=Sorted.end() && w!=G.End(Nodes[i]);){
+               if(*w<j->first)++w;
+               else if(j->first<*w)++j;
+               else{Add(Rows_.data()+i*W_,j->second);++w;++j;}
+            }
+         }
+      }
+
+      ///Number of nodes
+      size_t Size()const{return M_;}
+      ///The empty set
+      Set_t Empty()const{return Set_t(W_,0);}
+      ///The neighbors of i
+      const Word_t* Row(size_t i)const{return Rows_.data()+i*W_;}
+
+      static void Add(Set_t& S,size_t i){Add(S.data(),i);}
+      static void Add(Word_t* S,size_t i){S[i/64]|=Word_t(1)<<(i%64);}
+      static void Remove(Set_t& S,size_t i){S[i/64]&=~(Word_t(1)<<(i%64));}
+      static bool None(const Set_t& S){
+         for(Word_t w:S)if(w)return false;
+         return true;
+      }
+      static size_t PopCount(Word_t w){return __builtin_popcountll(w);}
+
+      ///S intersected with the neighbors of i
+      Set_t And(const Set_t& S,size_t i)const{
+         Set_t temp(W_);
+         const Word_t* r=Row(i);
+         for(size_t k=0;k<W_;++k)temp[k]=S[k]&r[k];
+         return temp;
+      }
+
+      ///Size of S intersected with the neighbors of i
+      size_t CountAnd(const Set_t& S,size_t i)const{
+         size_t temp=0;
+         const Word_t* r=Row(i);
+         for(size_t k=0;k<W_;++k)temp+=PopCount(S[k]&r[k]);
+         return temp;
+      }
+
+      ///Calls f on each member of S in increasing order
+      template<typename Fxn_t>
+      static void ForEach(const Set_t& S,Fxn_t&& f){
+         for(size_t k=0;k<S.size();++k)
+            for(Word_t w=S[k];w;w&=w-1)f(k*64+__builtin_ctzll(w));
+      }
+
+   private:
+      size_t M_,W_;
+      std::vector<Word_t> Rows_;
+};
+
+/** \brief Bron-Kerbosch with Tomita pivoting on one node's neighborhood
+ *
+ *  R is the clique so far (local numbers), P the nodes that could extend
+ *  it and X those that could but whose cliques were already reported.
+ *  Only the nodes of P not adjacent to the pivot, the node of P and X with
+ *  the most neighbors in P, need their own branch: any maximal clique
+ *  missing all of them contains the pivot or one of its neighbors instead.
+ */
+template<typename Report_t>
+void BronKerbosch(const BitGraph& B,std::vector<size_t>& R,BitGraph::Set_t P,
+                  BitGraph::Set_t X,size_t MaxSize,Report_t& Report){
+   if(BitGraph::None(P)){
+      if(BitGraph::None(X))Report(R);
+      return;
+   }
+   //Everything in this branch is bigger than allowed
+   if(MaxSize && R.size()+1>=MaxSize)return;
+   size_t Pivot=0,Most=0;
+   bool First=true;
+   auto Try=[&](size_t u){
+      const size_t n=B.CountAnd(P,u);
+      if(First || n>Most){Pivot=u;Most=n;First=false;}
+   };
+   BitGraph::ForEach(P,Try);
+   BitGraph::ForEach(X,Try);
+   BitGraph::Set_t Branch(P);
+   const BitGraph::Word_t* NPivot=B.Row(Pivot);
+   for(size_t k=0;k<Branch.size();++k)Branch[k]&=~NPivot[k];
+   BitGraph::ForEach(Branch,[&](size_t w){
+      R.push_back(w);
+      BronKerbosch(B,R,B.And(P,w),B.And(X,w),MaxSize,Report);
+      R.pop_back();
+      BitGraph::Remove(P,w);
+      BitGraph::Add(X,w);
+   });
+}
+
+///Every clique of R plus nodes of P (above R's last node) up to MaxSize nodes
+template<typename Report_t>
+void ExtendCliques(const BitGraph& B,std::vector<size_t>& R,
+                   const BitGraph::Set_t& P,size_t MaxSize,Report_t& Report){
+   Report(R);
+   if(R.size()+1>=MaxSize)return;
+   BitGraph::ForEach(P,[&](size_t w){
+      BitGraph::Set_t Next=B.And(P,w);
+      for(size_t k=0;k<=w/64;++k)
+         Next[k]&=k<w/64?0:~((BitGraph::Word_t(2)<<(w%64))-1);
+      R.push_back(w);
+      ExtendCliques(B,R,Next,MaxSize,Report);
+      R.pop_back();
+   });
+}
+
+}//End namespace detail
+
+/** \brief Enumerates the cliques (sets of mutually connected nodes) of a
+ *         graph
+ *
+ *  Written for overlap graphs, where nodes are fragments and edges join
+ *  fragments that overlap: the inclusion-exclusion terms of a many-body
+ *  expansion are the cliques of that graph.  Two enumerations are offered:
+ *
+ *  - MaximalCliques(): the cliques no node can be added to, by
+ *    Bron-Kerbosch with pivoting (Tomita et al., Theor. Comput. Sci. 363,
+ *    28 (2006)), and
+ *  - AllCliques(): every clique up to a given size, each once.
+ *
+ *  Both start one branch per node, in degeneracy order, and a node's
+ *  branch only looks at its neighbors later in that order (Eppstein et
+ *  al., ACM J. Exp. Algorithmics 18, 3.1 (2013)).  Each branch is small
+ *  (at most the degeneracy of the graph, which is low for overlap graphs,
+ *  candidate nodes) so it is stored as bitsets, and the branches are
+ *  independent so they run in parallel.  Results come back in the same
+ *  order regardless of the number of threads.
+ *
+ *  Edge direction is ignored.
+ *
+ *  \code
+ *  CliqueFinder<OverlapGraph_t> Finder(Overlaps);
+ *  for(const auto& Term: Finder.AllCliques(3))//Monomers, dimers, trimers
+ *     AddTerm(Term);
+ *  \endcode
+ */
+template<typename Graph_t>
+class CliqueFinder{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///A clique
+      typedef std::vector<Node_t> Clique_t;
+
+      ///Prepares to search \p Graph, running on \p Pool
+      CliqueFinder(const Graph_t& Graph,
+                   parallel::ThreadPool& Pool=parallel::DefaultPool()):
+         Adj_(Graph),Pool_(Pool){
+         Order_=detail::DegeneracyOrder(Adj_.Nodes(),&Degeneracy_);
+         //DegeneracyOrder puts at most Degeneracy_ neighbors before each
+         //node, branches want at most that many after it
+         std::reverse(Order_.begin(),Order_.end());
+         Rank_.resize(Order_.size());
+         for(size_t i=0;i<Order_.size();++i)Rank_[Order_[i]]=i;
+      }
+
+      ///The degeneracy, the most candidates any branch starts with
+      size_t Degeneracy()const{return Degeneracy_;}
+
+      /** \brief The maximal cliques
+       *
+       *  \param[in] MaxSize If not 0, only maximal cliques with at most
+       *             this many nodes are returned (and the search doesn't go
+       *             beyond that size)
+       */
+      std::vector<Clique_t> MaximalCliques(size_t MaxSize=0)const{
+         return Search([&](const detail::BitGraph& B,
+                           const std::vector<size_t>& Local,
+                           size_t NLater,Branch_t& Report){
+            detail::BitGraph::Set_t P=B.Empty(),X=B.Empty();
+            for(size_t i=0;i<Local.size();++i)
+               detail::BitGraph::Add(i<NLater?P:X,i);
+            std::vector<size_t> R;
+            detail::BronKerbosch(B,R,P,X,MaxSize,Report);
+         },true);
+      }
+
+      /** \brief Every clique with 1 to \p MaxSize nodes
+       *
+       *  The nodes of each clique are in degeneracy order (the order the
+       *  branches are started in, so the node whose branch found it comes
+       *  first), and each clique appears once.
+       */
+      std::vector<Clique_t> AllCliques(size_t MaxSize)const{
+         if(MaxSize==0)return std::vector<Clique_t>();
+         return Search([&](const detail::BitGraph& B,
+                           const std::vector<size_t>&,
+                           size_t NLater,Branch_t& Report){
+            detail::BitGraph::Set_t P=B.Empty();
+            for(size_t i=0;i<NLater;++i)detail::BitGraph::Add(P,i);
+            std::vector<size_t> R;
+            detail::ExtendCliques(B,R,P,MaxSize,Report);
+         },false);
+      }
+
+   private:
+      ///The numbered graph
+      Adjacency<Graph_t> Adj_;
+
+      ///Where the branches run
+      parallel::ThreadPool& Pool_;
+
+      ///The nodes, each with at most Degeneracy_ neighbors after it
+      std::vector<size_t> Order_;
+
+      ///Where each node is in Order_
+      std::vector<size_t> Rank_;
+
+      size_t Degeneracy_=0;
+
+      ///Collects a branch's cliques, adding the branch's own node
+      struct Branch_t{
+         const Adjacency<Graph_t>* Adj;
+         size_t Root;
+         const std::vector<size_t>* Local;
+         std::vector<Clique_t> Found;
+         void operator()(const std::vector<size_t>& R){
+            Found.emplace_back(1,Adj->Node(Root));
+            for(size_t i:R)Found.back().push_back(Adj->Node((*Local)[i]));
+         }
+      };
+
+      /** Runs \p Fxn on each node's branch: a BitGraph of its neighbors,
+       *  the later ones first, and how many are later.  If \p WithEarlier
+       *  is false the earlier ones are left out.
+       */
+      template<typename Fxn_t>
+      std::vector<Clique_t> Search(Fxn_t Fxn,bool WithEarlier)const{
+         const detail::CSRGraph& G=Adj_.Nodes();
+         std::vector<std::vector<Clique_t>> Found(Order_.size());
+         Pool_.ParallelFor(0,Order_.size(),[&](size_t i){
+            const size_t v=Order_[i];
+            std::vector<size_t> Later,Earlier;
+            for(const size_t* w=G.Begin(v);w!=G.End(v);++w)
+               (Rank_[*w]>i?Later:Earlier).push_back(*w);
+            //Cliques are built in increasing local index, so this puts
+            //their nodes in degeneracy order
+            std::sort(Later.begin(),Later.end(),
+                      [&](size_t a,size_t b){return Rank_[a]<Rank_[b];});
+            if(!WithEarlier)Earlier.clear();
+            std::vector<size_t> Local(Later);
+            Local.insert(Local.end(),Earlier.begin(),Earlier.end());
+            detail::BitGraph B(G,Local);
+            Branch_t Report{&Adj_,v,&Local,std::vector<Clique_t>()};
+            Fxn(B,Local,Later.size(),Report);
+            Found[i].swap(Report.Found);
+         },1);
+         std::vector<Clique_t> temp;
+         for(auto& f:Found)
+            for(auto& c:f)temp.push_back(std::move(c));
+         return temp;
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_CLIQUES_HPP_ */
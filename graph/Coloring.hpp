@@ -0,0 +1,239 @@
+#ifndef PULSAR_GUARD_GRAPH__COLORING_HPP_
+#define PULSAR_GUARD_GRAPH__COLORING_HPP_
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "pulsar/datastore/graph/Adjacency.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+///How GraphColoring picks colors
+enum class ColorMethod{
+   Greedy,         ///<Serial, smallest-last order; usually the fewest colors
+   JonesPlassmann  ///<Parallel, in rounds of independent sets
+};
+
+/** \brief Items (nodes or edges) grouped by color
+ *
+ *  No two items of the same color conflict, so each class is a batch that
+ *  can be run in parallel without locks or atomics, one batch after the
+ *  other.
+ */
+template<typename Item_t>
+struct ColorClasses{
+   ///The color of each item
+   std::map<Item_t,size_t> Color;
+   ///The items of each color
+   std::vector<std::vector<Item_t>> Classes;
+   ///The number of colors used
+   size_t NColors()const{return Classes.size();}
+};
+
+namespace detail{
+
+///Smallest color not used by any colored neighbor of v (Colors of -1 are uncolored)
+inline size_t FirstFreeColor(const CSRGraph& G,size_t v,
+                             const std::vector<size_t>& Colors,
+                             std::vector<char>& Used){
+   const size_t None=static_cast<size_t>(-1);
+   Used.assign(G.Degree(v)+1,0);
+   for(const size_t* w=G.Begin(v);w!=G.End(v);++w)
+      if(Colors[*w]!=None && Colors[*w]<Used.size())Used[Colors[*w]]=1;
+   return std::find(Used.begin(),Used.end(),0)-Used.begin();
+}
+
+///Greedy coloring in smallest-last order, uses at most degeneracy+1 colors
+inline std::vector<size_t> GreedyColor(const CSRGraph& G){
+   std::vector<size_t> Colors(G.NNodes(),static_cast<size_t>(-1));
+   std::vector<char> Used;
+   for(size_t v:DegeneracyOrder(G))
+      Colors[v]=FirstFreeColor(G,v,Colors,Used);
+   return Colors;
+}
+
+///A reproducible pseudo-random priority for node v (splitmix64)
+inline uint64_t Priority(size_t v,uint64_t Seed){
+   uint64_t z=static_cast<uint64_t>(v)+Seed+0x9e3779b97f4a7c15ULL;
+   z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+   z=(z^(z>>27))*0x94d049bb133111ebULL;
+   return z^(z>>31);
+}
+
+/** \brief Jones-Plassmann coloring
+ *
+ *  Each round, every uncolored node whose priority beats all of its
+ *  uncolored neighbors takes the smallest color its neighbors don't have.
+ *  Those nodes form an independent set, so they never see each other's
+ *  writes.  Selecting and coloring are separate passes so nothing reads a
+ *  color while it is being written.  Priorities are random (for a given
+ *  \p Seed), which gives \f$O(\log N/\log\log N)\f$ rounds on bounded
+ *  degree graphs.
+ */
+inline std::vector<size_t> JonesPlassmannColor(const CSRGraph& G,uint64_t Seed,
+                                               parallel::ThreadPool& Pool){
+   const size_t n=G.NNodes(),None=static_cast<size_t>(-1);
+   std::vector<size_t> Colors(n,None);
+   std::vector<uint64_t> P(n);
+   for(size_t v=0;v<n;++v)P[v]=Priority(v,Seed);
+   auto Beats=[&](size_t v,size_t w){
+      return P[v]>P[w] || (P[v]==P[w] && v>w);
+   };
+
+   std::vector<size_t> Left(n);
+   for(size_t v=0;v<n;++v)Left[v]=v;
+   std::vector<char> Selected(n,0);
+   while(!Left.empty()){
+      Pool.ParallelFor(0,Left.size(),[&](size_t k){
+         const size_t v=Left[k];
+         bool Max=true;
+         for(const size_t* w=G.Begin(v);w!=G.End(v) && Max;++w)
+            if(Colors[*w]==None && Beats(*w,v))Max=false;
+         Selected[k]=Max;
+      },256);
+      Pool.ParallelFor(0,Left.size(),[&](size_t k){
+         if(!Selected[k])return;
+         std::vector<char> Used;
+         Colors[Left[k]]=FirstFreeColor(G,Left[k],Colors,Used);
+      },256);
+      size_t Kept=0;
+      for(size_t k=0;k<Left.size();++k)
+         if(!Selected[k])Left[Kept++]=Left[k];
+      Left.resize(Kept);
+   }
+   return Colors;
+}
+
+/** \brief Evens out the sizes of the color classes
+ *
+ *  Greedy methods favor the low colors, so the first batches are large
+ *  and the last ones nearly empty, which leaves threads idle.  Nodes are
+ *  moved out of classes larger than N/k into the smallest class with room
+ *  that none of their neighbors is in (Lu et al., IEEE TPDS 28, 1240
+ *  (2017)).  The number of colors doesn't change.
+ */
+inline void BalanceColors(const CSRGraph& G,std::vector<size_t>& Colors){
+   const size_t n=G.NNodes();
+   if(n==0)return;
+   const size_t k=*std::max_element(Colors.begin(),Colors.end())+1;
+   const size_t Target=(n+k-1)/k;
+   std::vector<size_t> Size(k,0);
+   for(size_t c:Colors)++Size[c];
+
+   std::vector<char> Used(k);
+   for(size_t v=0;v<n;++v){
+      if(Size[Colors[v]]<=Target)continue;
+      std::fill(Used.begin(),Used.end(),0);
+      for(const size_t* w=G.Begin(v);w!=G.End(v);++w)Used[Colors[*w]]=1;
+      size_t Best=k;
+      for(size_t c=0;c<k;++c)
+         if(!Used[c] && Size[c]<Target && (Best==k || Size[c]<Size[Best]))
+            Best=c;
+      if(Best==k)continue;
+      --Size[Colors[v]];
+      ++Size[Best];
+      Colors[v]=Best;
+   }
+}
+
+///Colors G with the requested method
+inline std::vector<size_t> Color(const CSRGraph& G,ColorMethod Method,
+                                 bool Balance,uint64_t Seed,
+                                 parallel::ThreadPool& Pool){
+   std::vector<size_t> Colors=Method==ColorMethod::Greedy?GreedyColor(G):
+                              JonesPlassmannColor(G,Seed,Pool);
+   if(Balance)BalanceColors(G,Colors);
+   return Colors;
+}
+
+}//End namespace detail
+
+/** \brief Colors the nodes or the edges of a graph so that no two
+ *         neighbors share a color
+ *
+ *  The typical use is a parallel loop over items that write to shared
+ *  data, e.g. bonds that update the forces on their atoms.  Two bonds that
+ *  share an atom conflict; color the edges of the molecular graph (i.e.
+ *  the nodes of its line graph) and each color class is a set of bonds
+ *  that can be processed at the same time without atomics:
+ *
+ *  \code
+ *  GraphColoring<MyGraph_t> Coloring(Molecule);
+ *  auto Batches=Coloring.ColorEdges();
+ *  for(const auto& Batch:Batches.Classes)
+ *     parallel::ParallelFor(0,Batch.size(),[&](size_t i){
+ *        AddForce(Batch[i]);
+ *     });
+ *  \endcode
+ *
+ *  Edge direction is ignored: u and v conflict if there is an edge either
+ *  way.  By default the color classes are balanced afterwards so that the
+ *  batches have similar sizes.
+ */
+template<typename Graph_t>
+class GraphColoring{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///The type of the edges
+      typedef typename Graph_t::EdgeType Edge_t;
+
+      ///Colors the nodes or edges of \p Graph, running on \p Pool
+      GraphColoring(const Graph_t& Graph,
+                    parallel::ThreadPool& Pool=parallel::DefaultPool()):
+         Adj_(Graph),Pool_(Pool){}
+
+      /** \brief Colors the nodes, neighbors get different colors
+       *
+       *  \param[in] Method Greedy or Jones-Plassmann
+       *  \param[in] Balance Whether to even out the class sizes
+       *  \param[in] Seed Seed of the Jones-Plassmann priorities
+       */
+      ColorClasses<Node_t> ColorNodes(ColorMethod Method=ColorMethod::Greedy,
+                                      bool Balance=true,uint64_t Seed=0)const{
+         const std::vector<size_t> Colors=
+               detail::Color(Adj_.Nodes(),Method,Balance,Seed,Pool_);
+         ColorClasses<Node_t> temp;
+         for(size_t v=0;v<Colors.size();++v)Add(temp,Adj_.Node(v),Colors[v]);
+         return temp;
+      }
+
+      /** \brief Colors the edges, edges sharing a node get different colors
+       *
+       *  This is coloring the nodes of the line graph.  See ColorNodes()
+       *  for the parameters.
+       */
+      ColorClasses<Edge_t> ColorEdges(ColorMethod Method=ColorMethod::Greedy,
+                                      bool Balance=true,uint64_t Seed=0)const{
+         const std::vector<size_t> Colors=
+               detail::Color(Adj_.LineGraph(),Method,Balance,Seed,Pool_);
+         ColorClasses<Edge_t> temp;
+         for(size_t e=0;e<Colors.size();++e)Add(temp,Adj_.Edge(e),Colors[e]);
+         return temp;
+      }
+
+   private:
+      ///The numbered graph
+      Adjacency<Graph_t> Adj_;
+
+      ///Where Jones-Plassmann runs
+      parallel::ThreadPool& Pool_;
+
+      template<typename Item_t>
+      static void Add(ColorClasses<Item_t>& Classes,const Item_t& Item,size_t c){
+         Classes.Color[Item]=c;
+         if(Classes.Classes.size()<=c)Classes.Classes.resize(c+1);
+         Classes.Classes[c].push_back(Item);
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_COLORING_HPP_ */
@@ -0,0 +1,357 @@
+#ifndef PULSAR_GUARD_GRAPH__COMMONSUBGRAPH_HPP_
+#define PULSAR_GUARD_GRAPH__COMMONSUBGRAPH_HPP_
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+
+#include "pulsar/datastore/graph/Adjacency.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+namespace detail{
+
+///A labeled graph as McSplit wants it: node labels and a dense edge matrix
+struct LabeledGraph{
+   size_t N=0;
+   std::vector<size_t> Label;   ///<The label of each node
+   std::vector<size_t> Edge;    ///<N by N, 0 if not connected, else label+1
+   std::vector<size_t> Degree;  ///<Number of neighbors of each node
+
+   size_t operator()(size_t i,size_t j)const{return Edge[i*N+j];}
+};
+
+/** \brief McSplit: branch and bound for the maximum common induced
+ *         subgraph (McCreesh, Prosser and Trimble, IJCAI 2017, 1.5)
+ *
+ *  A partial mapping splits the unmatched nodes of both graphs into
+ *  bidomains: a set of left nodes and a set of right nodes that have the
+ *  same label and the same edge label to each mapped node (no edge being
+ *  one of the labels).  Only nodes in the same bidomain can still be
+ *  matched, so the mapping can grow by at most the sum over bidomains of
+ *  the smaller side, which is the bound.  Branching takes a left node v
+ *  from the smallest bidomain and tries each right node of that bidomain,
+ *  then tries leaving v unmatched.
+ *
+ *  The branches for the first matched node are independent, so they are
+ *  run on the pool; they share the best size found so far, which is all
+ *  the bound needs.
+ */
+class McSplit{
+   public:
+      typedef std::vector<std::pair<size_t,size_t>> Map_t;
+
+      /** \param[in] Connected Only grow the mapping by nodes adjacent to it
+       *  \param[in] MaxNodes Give up after this many search nodes (0: never)
+       *  \param[in] MaxSeconds Give up after this long (0: never)
+       */
+      McSplit(const LabeledGraph& G,const LabeledGraph& H,bool Connected,
+              size_t MaxNodes,double MaxSeconds):
+         G_(G),H_(H),Connected_(Connected),MaxNodes_(MaxNodes),
+         MaxSeconds_(MaxSeconds){}
+
+      ///Finds the biggest mapping it can in the budget
+      Map_t Run(parallel::ThreadPool& Pool){
+         Start_=Clock_t::now();
+         std::vector<Bidomain> Root;
+         std::map<size_t,size_t> Where;
+         for(size_t v=0;v<G_.N;++v){
+            auto It=Where.emplace(G_.Label[v],Root.size()).first;
+            if(It->second==Root.size())Root.push_back(Bidomain());
+            Root[It->second].L.push_back(v);
+         }
+         for(size_t w=0;w<H_.N;++w){
+            auto It=Where.find(H_.Label[w]);
+            if(It!=Where.end())Root[It->second].R.push_back(w);
+         }
+         Root.erase(std::remove_if(Root.begin(),Root.end(),
+                    [](const Bidomain& d){return d.R.empty();}),Root.end());
+
+         //Left nodes most constrained first, then most connected
+         std::vector<std::pair<size_t,size_t>> Order;
+         for(size_t d=0;d<Root.size();++d)
+            for(size_t v:Root[d].L)Order.push_back(std::make_pair(d,v));
+         auto Key=[&](const std::pair<size_t,size_t>& x){
+            return std::make_tuple(std::max(Root[x.first].L.size(),
+                                            Root[x.first].R.size()),
+                                   G_.N-G_.Degree[x.second],x.second);
+         };
+         std::sort(Order.begin(),Order.end(),
+                   [&](const std::pair<size_t,size_t>& a,
+                       const std::pair<size_t,size_t>& b){return Key(a)<Key(b);});
+
+         //Branch (i,w): Order[0..i-1] unmatched, Order[i] goes to w
+         std::vector<std::pair<size_t,size_t>> Tasks;
+         for(size_t i=0;i<Order.size();++i)
+            for(size_t w:Root[Order[i].first].R)Tasks.push_back(std::make_pair(i,w));
+
+         Pool.ParallelFor(0,Tasks.size(),[&](size_t t){
+            if(Stop_)return;
+            const size_t i=Tasks[t].first,v=Order[i].second;
+            std::vector<Bidomain> Domains(Root);
+            for(size_t k=0;k<i;++k){
+               std::vector<size_t>& L=Domains[Order[k].first].L;
+               L.erase(std::find(L.begin(),L.end(),Order[k].second));
+            }
+            if(1+Bound(Domains)<=BestSize_)return;
+            Map_t M(1,std::make_pair(v,Tasks[t].second));
+            Search(Split(Domains,v,Tasks[t].second),M);
+         },1);
+         return Best_;
+      }
+
+      ///Whether the whole tree was searched
+      bool Optimal()const{return !Stop_;}
+
+      ///Number of search nodes visited
+      size_t NNodes()const{return NNodes_;}
+
+   private:
+      typedef std::chrono::steady_clock Clock_t;
+
+      struct Bidomain{
+         std::vector<size_t> L,R;
+         bool Adjacent=false;///<Is it connected to the mapping
+      };
+
+      const LabeledGraph& G_;
+      const LabeledGraph& H_;
+      bool Connected_;
+      size_t MaxNodes_;
+      double MaxSeconds_;
+      Clock_t::time_point Start_;
+
+      std::atomic<size_t> NNodes_{0},BestSize_{0};
+      std::atomic<bool> Stop_{false};
+      std::mutex Mutex_;
+      Map_t Best_;
+
+      static size_t Bound(const std::vector<Bidomain>& Domains){
+         size_t temp=0;
+         for(const Bidomain& d:Domains)temp+=std::min(d.L.size(),d.R.size());
+         return temp;
+      }
+
+      ///The bidomains after matching v to w
+      std::vector<Bidomain> Split(const std::vector<Bidomain>& Domains,
+                                  size_t v,size_t w)const{
+         std::vector<Bidomain> temp;
+         std::vector<std::pair<size_t,size_t>> Ls,Rs;
+         for(const Bidomain& d:Domains){
+            Ls.clear();Rs.clear();
+            for(size_t u:d.L)if(u!=v)Ls.push_back(std::make_pair(G_(v,u),u));
+            for(size_t x:d.R)if(x!=w)Rs.push_back(std::make_pair(H_(w,x),x));
+            std::sort(Ls.begin(),Ls.end());
+            std::sort(Rs.begin(),Rs.end());
+            auto l=Ls.begin(),r=Rs.begin();
+            while(l!=Ls.end() && r!=Rs.end()){
+               if(l->first<r->first){++l;continue;}
+               if(r->first<l->first){++r;continue;}
+               const size_t e=l->first;
+               Bidomain New;
+               New.Adjacent=d.Adjacent || e!=0;
+               for(;l!=Ls.end() && l->first==e;++l)New.L.push_back(l->second);
+               for(;r!=Rs.end() && r->first==e;++r)New.R.push_back(r->second);
+               temp.push_back(std::move(New));
+            }
+         }
+         return temp;
+      }
+
+      ///Counts a search node, returns false if the budget is spent
+      bool Charge(){
+         const size_t n=++NNodes_;
+         if(MaxNodes_ && n>MaxNodes_)Stop_=true;
+         if(MaxSeconds_>0.0 && n%1024==0 &&
+            std::chrono::duration<double>(Clock_t::now()-Start_).count()>MaxSeconds_)
+            Stop_=true;
+         return !Stop_;
+      }
+
+      void Search(std::vector<Bidomain> Domains,Map_t& M){
+         if(!Charge())return;
+         if(M.size()>BestSize_){
+            std::lock_guard<std::mutex> Lock(Mutex_);
+            if(M.size()>Best_.size()){
+               Best_=M;
+               BestSize_=M.size();
+            }
+         }
+         if(M.size()+Bound(Domains)<=BestSize_)return;
+
+         size_t Which=Domains.size();
+         for(size_t d=0;d<Domains.size();++d){
+            if(Connected_ && !Domains[d].Adjacent)continue;
+            if(Which==Domains.size() ||
+               std::max(Domains[d].L.size(),Domains[d].R.size())<
+               std::max(Domains[Which].L.size(),Domains[Which].R.size()))
+               Which=d;
+         }
+         if(Which==Domains.size())return;
+
+         std::vector<size_t>& L=Domains[Which].L;
+         const size_t v=*std::max_element(L.begin(),L.end(),
+               [&](size_t a,size_t b){return G_.Degree[a]<G_.Degree[b];});
+         std::vector<size_t> Rs(Domains[Which].R);
+         std::stable_sort(Rs.begin(),Rs.end(),
+               [&](size_t a,size_t b){return H_.Degree[a]>H_.Degree[b];});
+         for(size_t w:Rs){
+            M.push_back(std::make_pair(v,w));
+            Search(Split(Domains,v,w),M);
+            M.pop_back();
+            if(Stop_)return;
+         }
+
+         //v stays unmatched
+         L.erase(std::find(L.begin(),L.end(),v));
+         if(L.empty())Domains.erase(Domains.begin()+Which);
+         Search(std::move(Domains),M);
+      }
+};
+
+}//End namespace detail
+
+/** \brief Finds a maximum common subgraph of two graphs
+ *
+ *  A common subgraph is a mapping of some nodes of one graph onto some
+ *  nodes of the other such that mapped nodes have the same label and two
+ *  mapped nodes are connected (by an edge of the same label) in one graph
+ *  exactly when their images are connected in the other, i.e. it is an
+ *  isomorphism between induced subgraphs.  For molecules this is the
+ *  largest shared substructure, e.g. what a reaction leaves untouched.
+ *
+ *  The search is McSplit, an exact branch and bound, so it can take
+ *  exponential time.  A budget of search nodes or seconds makes it return
+ *  the best mapping found by then, with Optimal() false if the search was
+ *  cut short.  Drug-sized molecules usually finish well within a second.
+ *  The edges are stored as dense matrices, which limits this to graphs of
+ *  a few thousand nodes.
+ *
+ *  Unlike FindSubGraph, which takes functors comparing nodes and edges,
+ *  this takes functors returning labels: McSplit groups nodes into classes
+ *  of equal labels, which it can't do with pairwise comparisons.  Edge
+ *  direction is ignored.
+ *
+ *  Syntax to use this class:
+ *  \code
+ *  MaxCommonSubgraph<MyGraph_t> MCS(Reactant,
+ *                                   [](const Atom& a){return a.Z;});
+ *  MCS.Run(Product,true,0,1.0);//Connected, at most one second
+ *  for(const auto& Pair:MCS.Mapping())...
+ *  \endcode
+ */
+template<typename Graph_t>
+class MaxCommonSubgraph{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///The type of the edges
+      typedef typename Graph_t::EdgeType Edge_t;
+      ///The type of a mapping between the two graphs
+      typedef std::map<Node_t,Node_t> Map_t;
+      ///A function giving the label of a node
+      typedef std::function<size_t(const Node_t&)> NodeLabel_t;
+      ///A function giving the label of an edge
+      typedef std::function<size_t(const Edge_t&)> EdgeLabel_t;
+
+      ///Takes the first graph and optionally the labels of nodes and edges
+      MaxCommonSubgraph(const Graph_t& Graph,NodeLabel_t NodeLabel=nullptr,
+                        EdgeLabel_t EdgeLabel=nullptr,
+                        parallel::ThreadPool& Pool=parallel::DefaultPool()):
+         Graph_(Graph),NodeLabel_(NodeLabel),EdgeLabel_(EdgeLabel),Pool_(Pool){}
+
+      /** \brief Finds a maximum common subgraph of this graph and \p Other
+       *
+       *  \param[in] Other The second graph
+       *  \param[in] Connected Whether the common subgraph has to be connected
+       *  \param[in] MaxNodes Give up after this many search nodes (0: never)
+       *  \param[in] MaxSeconds Give up after this many seconds (0: never)
+       *  \return True if the mapping is known to be the largest
+       */
+      bool Run(const Graph_t& Other,bool Connected=false,size_t MaxNodes=0,
+               double MaxSeconds=0.0){
+         Adjacency<Graph_t> A(Graph_),B(Other);
+         std::map<std::vector<size_t>,size_t> EdgeLabels;
+         detail::LabeledGraph G=Label(A,EdgeLabels),H=Label(B,EdgeLabels);
+         detail::McSplit Search(G,H,Connected,MaxNodes,MaxSeconds);
+         Mapping_.clear();
+         for(const auto& p:Search.Run(Pool_))
+            Mapping_[A.Node(p.first)]=B.Node(p.second);
+         Optimal_=Search.Optimal();
+         NNodes_=Search.NNodes();
+         return Optimal_;
+      }
+
+      ///The mapping from the first graph to the second found by Run()
+      const Map_t& Mapping()const{return Mapping_;}
+
+      ///The number of nodes in the common subgraph
+      size_t Size()const{return Mapping_.size();}
+
+      ///Whether the last Run() searched everything
+      bool Optimal()const{return Optimal_;}
+
+      ///Number of search nodes the last Run() visited
+      size_t NNodesSearched()const{return NNodes_;}
+
+   private:
+      ///The first graph
+      const Graph_t& Graph_;
+
+      ///The labels
+      NodeLabel_t NodeLabel_;
+      EdgeLabel_t EdgeLabel_;
+
+      ///Where the branches run
+      parallel::ThreadPool& Pool_;
+
+      ///The result of the last run
+      Map_t Mapping_;
+      bool Optimal_=false;
+      size_t NNodes_=0;
+
+      /** The labeled, dense form of a graph.  An undirected edge gets the
+       *  labels of all edges between its ends, numbered through \p Numbers
+       *  so that both graphs number them the same.
+       */
+      detail::LabeledGraph Label(const Adjacency<Graph_t>& A,
+            std::map<std::vector<size_t>,size_t>& Numbers)const{
+         detail::LabeledGraph temp;
+         const size_t n=temp.N=A.NNodes();
+         temp.Label.assign(n,0);
+         temp.Degree.resize(n);
+         for(size_t v=0;v<n;++v){
+            if(NodeLabel_)temp.Label[v]=NodeLabel_(A.Node(v));
+            temp.Degree[v]=A.Nodes().Degree(v);
+         }
+         std::map<std::pair<size_t,size_t>,std::vector<size_t>> Labels;
+         for(size_t e=0;e<A.NEdges();++e){
+            std::pair<size_t,size_t> Ends=A.Ends(e);
+            if(Ends.first==Ends.second)continue;
+            if(Ends.first>Ends.second)std::swap(Ends.first,Ends.second);
+            Labels[Ends].push_back(EdgeLabel_?EdgeLabel_(A.Edge(e)):0);
+         }
+         temp.Edge.assign(n*n,0);
+         for(auto& l:Labels){
+            std::sort(l.second.begin(),l.second.end());
+            const size_t i=Numbers.emplace(l.second,Numbers.size()).first->second;
+            temp.Edge[l.first.first*n+l.first.second]=i+1;
+            temp.Edge[l.first.second*n+l.first.first]=i+1;
+         }
+         return temp;
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_COMMONSUBGRAPH_HPP_ */
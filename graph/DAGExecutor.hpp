@@ -0,0 +1,236 @@
+#ifndef PULSAR_GUARD_GRAPH__DAGEXECUTOR_HPP_
+#define PULSAR_GUARD_GRAPH__DAGEXECUTOR_HPP_
+
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <functional>
+#include <algorithm>
+#include <boost/graph/graph_traits.hpp>
+
+#include "pulsar/datastore/graph/TopoSort.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+/** \brief Runs a function on every node of a dependency graph, in parallel
+ *
+ *  An edge u-->v means v can't start until u is done.  Nodes with nothing
+ *  pointing to them are started right away; every time a node finishes,
+ *  the count of unfinished predecessors of each of its successors drops by
+ *  one, and a successor whose count reaches zero is handed to the thread
+ *  pool.  Nothing waits on a level of the graph to finish, so a long node
+ *  only holds up the nodes that actually need it.  A newly ready node goes
+ *  onto the deque of the thread that finished its last predecessor, so it
+ *  usually runs there, next to the data that predecessor produced.
+ *
+ *  Every run records when each node started and stopped and on which
+ *  thread.  Comparing the average number of busy threads from this
+ *  timeline with TopoSort::CriticalPath() shows whether a workflow is
+ *  limited by its dependencies or by the number of threads.
+ *
+ *  \code
+ *  DAGExecutor<MyGraph_t> Exec(MyGraph);//Throws if MyGraph has a cycle
+ *  Exec.Run([](const Node_t& Module){Module.Run();});
+ *  std::cout<<Exec;//Prints the timeline
+ *  \endcode
+ */
+template<typename Graph_t>
+class DAGExecutor{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+
+      ///The function run on each node
+      typedef std::function<void(const Node_t&)> Task_t;
+
+      ///When a node ran, in seconds since the start of Run()
+      struct Event{
+         ///The node that ran
+         Node_t Node;
+         ///When it started
+         double Start;
+         ///When it finished
+         double End;
+         ///Which thread ran it, numbered from 0 in order of first use
+         size_t Thread;
+      };
+
+      /** \brief Prepares to run \p Graph on \p Pool
+       *
+       *  \throw pulsar::PulsarException if the graph has a cycle
+       */
+      DAGExecutor(const Graph_t& Graph,
+                  parallel::ThreadPool& Pool=parallel::DefaultPool()):
+         Graph_(Graph),Pool_(Pool){
+         TopoSort<Graph_t> Sort(Graph);//Only to check for cycles
+         auto Its=boost::vertices(Graph_.Base_);
+         for(;Its.first!=Its.second;++Its.first){
+            Index_[*Its.first]=Vertices_.size();
+            Vertices_.push_back(*Its.first);
+         }
+         const size_t n=Vertices_.size();
+         SuccPtr_.assign(n+1,0);
+         NIn_.assign(n,0);
+         for(size_t i=0;i<n;++i){
+            auto Out=boost::out_edges(Vertices_[i],Graph_.Base_);
+            for(;Out.first!=Out.second;++Out.first){
+               const size_t j=Index_.at(boost::target(*Out.first,Graph_.Base_));
+               Succ_.push_back(j);
+               ++NIn_[j];
+            }
+            SuccPtr_[i+1]=Succ_.size();
+         }
+      }
+
+      /** \brief Runs \p Task on every node, each after all of its
+       *         predecessors
+       *
+       *  Returns once every node has run.  If \p Task throws, the nodes
+       *  that depend (directly or not) on the failed one are not started,
+       *  every other node still runs, and then the first exception is
+       *  rethrown.  The timeline then has the nodes that finished.
+       *
+       *  \return The timeline, sorted by start time
+       */
+      const std::vector<Event>& Run(const Task_t& Task){
+         const size_t n=Vertices_.size();
+         std::unique_ptr<std::atomic<size_t>[]> Left(new std::atomic<size_t>[n]);
+         for(size_t i=0;i<n;++i)Left[i]=NIn_[i];
+         std::vector<double> Start(n,0.0),End(n,0.0);
+         std::vector<std::thread::id> Who(n);
+         std::vector<char> Ran(n,0);
+
+         typedef std::chrono::steady_clock Clock_t;
+         const Clock_t::time_point T0=Clock_t::now();
+         auto Seconds=[&](){
+            return std::chrono::duration<double>(Clock_t::now()-T0).count();
+         };
+
+         parallel::TaskGroup Group(Pool_);
+         std::function<void(size_t)> Launch=[&](size_t i){
+            Group.Run([&,i](){
+               Who[i]=std::this_thread::get_id();
+               Start[i]=Seconds();
+               //If this throws its successors are never released, so only
+               //the nodes that depend on it are skipped
+               Task(Graph_[Vertices_[i]]);
+               End[i]=Seconds();
+               Ran[i]=1;
+               for(size_t k=SuccPtr_[i];k<SuccPtr_[i+1];++k)
+                  if(--Left[Succ_[k]]==0)Launch(Succ_[k]);
+            });
+         };
+         for(size_t i=0;i<n;++i)
+            if(NIn_[i]==0)Launch(i);
+         std::exception_ptr Error;
+         try{Group.Wait();}
+         catch(...){Error=std::current_exception();}
+
+         std::vector<size_t> Done;
+         for(size_t i=0;i<n;++i)if(Ran[i])Done.push_back(i);
+         std::sort(Done.begin(),Done.end(),
+                   [&](size_t a,size_t b){return Start[a]<Start[b];});
+         Timeline_.clear();
+         std::map<std::thread::id,size_t> Threads;
+         for(size_t i:Done){
+            auto It=Threads.emplace(Who[i],Threads.size()).first;
+            Timeline_.push_back(Event{Graph_[Vertices_[i]],Start[i],End[i],
+                                      It->second});
+         }
+         if(Error)std::rethrow_exception(Error);
+         return Timeline_;
+      }
+
+      ///The timeline of the last run, sorted by start time
+      const std::vector<Event>& Timeline()const{return Timeline_;}
+
+      ///Wall time of the last run
+      double Makespan()const{
+         double temp=0.0;
+         for(const Event& e:Timeline_)temp=std::max(temp,e.End);
+         return temp;
+      }
+
+      ///Sum of the time spent in the nodes during the last run
+      double BusyTime()const{
+         double temp=0.0;
+         for(const Event& e:Timeline_)temp+=e.End-e.Start;
+         return temp;
+      }
+
+      ///Average number of nodes running at once during the last run
+      double AverageParallelism()const{
+         const double Span=Makespan();
+         return Span>0.0?BusyTime()/Span:0.0;
+      }
+
+      ///Most nodes that were running at the same time during the last run
+      size_t MaxConcurrency()const{
+         std::vector<std::pair<double,int>> Edges;
+         for(const Event& e:Timeline_){
+            Edges.push_back(std::make_pair(e.Start,1));
+            Edges.push_back(std::make_pair(e.End,-1));
+         }
+         //Ends sort before starts at the same time
+         std::sort(Edges.begin(),Edges.end());
+         int Now=0,Max=0;
+         for(const auto& e:Edges)Max=std::max(Max,Now+=e.second);
+         return static_cast<size_t>(Max);
+      }
+
+      ///Prints the timeline and a summary, assumes nodes can be printed
+      std::ostream& operator<<(std::ostream& os)const{
+         os<<"Node"<<'\t'<<"Thread"<<'\t'<<"Start"<<'\t'<<"End"<<std::endl;
+         for(const Event& e:Timeline_)
+            os<<e.Node<<'\t'<<e.Thread<<'\t'<<e.Start<<'\t'<<e.End<<std::endl;
+         os<<"Makespan: "<<Makespan()<<" s, busy: "<<BusyTime()
+           <<" s, average parallelism: "<<AverageParallelism()
+           <<", max concurrency: "<<MaxConcurrency()<<std::endl;
+         return os;
+      }
+
+   private:
+      ///What BGL uses for nodes
+      typedef typename Graph_t::Vertex_t Vertex_t;
+
+      ///The graph to run
+      const Graph_t& Graph_;
+
+      ///Where to run it
+      parallel::ThreadPool& Pool_;
+
+      ///The vertices, in the order the graph gives them
+      std::vector<Vertex_t> Vertices_;
+
+      ///Where each vertex is in Vertices_
+      std::map<Vertex_t,size_t> Index_;
+
+      ///Successors of vertex i are Succ_[SuccPtr_[i]] to Succ_[SuccPtr_[i+1]-1]
+      std::vector<size_t> SuccPtr_,Succ_;
+
+      ///Number of predecessors of each vertex
+      std::vector<size_t> NIn_;
+
+      ///What happened during the last run
+      std::vector<Event> Timeline_;
+};
+
+///Allows a DAGExecutor's timeline to be passed to an ostream
+template<typename T>
+inline std::ostream& operator<<(std::ostream& os, const DAGExecutor<T>& exec){
+   return exec<<os;
+}
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_DAGEXECUTOR_HPP_ */
@@ -116,7 +116,7 @@ class DFS: private DFSBase<DFS<Graph_t>,Graph_t>{
        *   happen because Y is already marked as finished.
        *
        */
-      void Run(const Node_t& Node, bool Clean=true){RunImpl(Node,Clean);}
+      void Run(const Node_t& Node, bool Clean=true){Base_t::RunImpl(Node,Clean);}
 
       ///The function for printing this beast
       virtual std::ostream& operator<<(std::ostream& os)const{
@@ -140,43 +140,44 @@ class DFSBase:public boost::default_dfs_visitor{
    public:
       typedef typename Graph_t::Vertex_t Vertex_t;
       typedef typename Graph_t::Arc_t Arc_t;
+      typedef typename Graph_t::Base_t BGL_t;
       typedef typename Graph_t::NodeType Node_t;
       typedef typename Graph_t::EdgeType Edge_t;
       typedef std::map<Node_t,size_t> Map_t;
       typedef typename
             boost::vector_property_map<boost::default_color_type> Color_t;
-      void start_vertex(const Vertex_t& Node,const Graph_t&){
+      void start_vertex(const Vertex_t& Node,const BGL_t&){
          if(Colors_[Node]!=
                boost::color_traits<boost::default_color_type>::white())
             throw DFSException();//This is BGL wants us to abort early...
       }
 
-      void discover_vertex(const Vertex_t& Node,const Graph_t&){
+      void discover_vertex(const Vertex_t& Node,const BGL_t&){
          Parent_.FoundNode(Graph_[Node]);
       }
 
-      void examine_edge(const Arc_t& Edge,const Graph_t&){
+      void examine_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.LookAtEdge(Graph_[Edge]);
       }
 
-      void tree_edge(const Arc_t& Edge,const Graph_t&){
+      void tree_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.TreeEdge(Graph_[Edge]);
       }
 
-      void back_edge(const Arc_t& Edge,const Graph_t&){
+      void back_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.BackEdge(Graph_[Edge]);
       }
 
 
-      void forward_or_cross_edge(const Arc_t& Edge,const Graph_t&){
+      void forward_or_cross_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.OtherEdge(Graph_[Edge]);
       }
 
-      void finish_vertex(const Vertex_t& Node,const Graph_t&){
+      void finish_vertex(const Vertex_t& Node,const BGL_t&){
          Parent_.NodeDone(Graph_[Node]);
       }
 
-      void finish_edge(const Arc_t& Edge,const Graph_t&){
+      void finish_edge(const Arc_t& Edge,const BGL_t&){
          Parent_.EdgeDone(Graph_[Edge]);
       }
 
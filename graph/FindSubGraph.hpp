@@ -3,6 +3,7 @@
 
 #include <map>
 #include <vector>
+#include <algorithm>
 #include <functional>
 #include <boost/graph/vf2_sub_graph_iso.hpp>
 
@@ -11,6 +12,8 @@ namespace pulsar{
 namespace datastore {
 namespace LibGraph{
 
+template<typename U> class InducedSubgraph;
+
 /** \brief Finds subgraphs of a graph
  *
  *
@@ -54,49 +57,45 @@ class FindSubGraph{
       typedef typename Graph_t::EdgeType Edge_t;
       ///The type of an edge mapping between the two graphs
       typedef std::map<Node_t,Node_t> Map_t;
-      ///What BGL uses for nodes
-      typedef typename boost::graph_traits<Graph_t>::vertex_descriptor
-            V_t;
-      ///What BGL uses for edges
-      typedef typename boost::graph_traits<Graph_t>::edge_descriptor E_t;
       ///The type of a functor for comparing our node types
       typedef std::function<bool (const Node_t&,const Node_t&)> NodeComp_t;
       ///The type of a functor for comparing our edge types
       typedef std::function<bool (const Edge_t&,const Edge_t&)> EdgeComp_t;
 
       ///A functor for handling BGL's call back interface
+      template<typename SubGraph_t>
       class CallBack{
          private:
             //The search this callback is tied to
             FindSubGraph<Graph_t>* Parent_;
             const Graph_t& LGraph_;//Large graph
-            const Graph_t& SGraph_;//Small graph
+            const SubGraph_t& SGraph_;//Small graph
             bool KeepGoing_;//Stop after this induced subgraph?
          public:
             ///Takes the subgraph search, the large and small graphs
             CallBack(FindSubGraph<Graph_t>* Parent,
                      const Graph_t& Graph,
-                     const Graph_t& SubGraph,
+                     const SubGraph_t& SubGraph,
                      bool KeepGoing=true):
                Parent_(Parent),LGraph_(Graph),SGraph_(SubGraph),
                KeepGoing_(KeepGoing){}
 
          ///The call BGL will use upon finding a subgraph
          template<typename Map1To2,typename Map2To1>
-         bool operator()(Map1To2 Map1,Map2To1 Map2)const{
-            Map_t Temp1,Temp2;
-            BGL_FORALL_VERTICES_T(v,SGraph_,Graph_t){
-               if(get(Map1,v)!=boost::graph_traits<Parent_::Base_t>::null_vertex())
+         bool operator()(Map1To2 Map1,Map2To1)const{
+            typedef typename Graph_t::Base_t LBase_t;
+            Map_t Temp1;
+            BGL_FORALL_VERTICES_T(v,SGraph_.Base_,typename SubGraph_t::Base_t){
+               if(get(Map1,v)!=boost::graph_traits<LBase_t>::null_vertex())
                   Temp1[LGraph_[get(Map1,v)]]=SGraph_[v];
             }
             Parent_->Large2Small_.push_back(Temp1);
-            //Parent_->Small2Large_.push_back(Temp2);
             return KeepGoing_;
          }
       };
 
       ///A dereference functor for the nodes/edges
-      template<typename Fxn_t>
+      template<typename Fxn_t,typename SubGraph_t>
       class Compare{
          private:
             ///The function to call
@@ -104,14 +103,14 @@ class FindSubGraph{
             ///The large graph
             const Graph_t& Large_;
             ///The small graph
-            const Graph_t& Small_;
+            const SubGraph_t& Small_;
          public:
             ///Takes the large, small, and compare fxn
-            Compare(const Graph_t& Large,const Graph_t& Small,Fxn_t& fxn):
+            Compare(const Graph_t& Large,const SubGraph_t& Small,Fxn_t& fxn):
                fxn_(fxn),Large_(Large),Small_(Small){}
             ///Dereferences a piece from the large and small graphs
-            template<typename Part_t>
-            bool operator()(const Part_t& p1,const Part_t& p2)const{
+            template<typename Part_t,typename Part2_t>
+            bool operator()(const Part_t& p1,const Part2_t& p2)const{
                return fxn_(Large_[p2],Small_[p1]);
             }
       };
@@ -140,14 +139,17 @@ class FindSubGraph{
       size_t NMatches()const{return Large2Small_.size();}
 
       ///Returns the i-th isomorphism
-      size_t Match(size_t i)const{return Large2Small_[i];}
+      const Map_t& Match(size_t i)const{return Large2Small_[i];}
 
       ///Returns true if any isomorphisms have been found
-      ///(clears existing isomorphisms)
-      bool Run(const Graph_t& SubGraph,
+      ///(clears existing isomorphisms).  Either graph may be an
+      ///InducedSubgraph, as long as the nodes are of the same type.
+      template<typename SubGraph_t>
+      bool Run(const SubGraph_t& SubGraph,
              bool StopOnFind=false,
              bool Induced=true
             ){
+         typedef typename SubGraph_t::Vertex_t V_t;
          Large2Small_.clear();
          //The BGL allows us to specify a search order and in its
          //infinite wisdom decides we'd want to override that before we'd
@@ -155,32 +157,45 @@ class FindSubGraph{
          //the hook for this...The default is to order them by
          //multiplicity (largest to smallest),
          //which is all this nasty next set of lines does
-
-         std::set<V_t,std::function<bool(const V_t&,const V_t&)> > Order(
+         std::vector<V_t> Order;
+         typename SubGraph_t::NodeItr_t NI=SubGraph.NodeBegin(),
+                                        NEnd=SubGraph.NodeEnd();
+         for(;NI!=NEnd;++NI)
+            Order.push_back(SubGraph.NodeLookUp_.at(*NI));
+         std::sort(Order.begin(),Order.end(),
                [&SubGraph](const V_t& v1,const V_t& v2){
-               size_t LEdges=SubGraph.NEdges(SubGraph[v1]),
-                      REdges=SubGraph.NEdges(SubGraph[v2]);
+               size_t LEdges=boost::out_degree(v1,SubGraph.Base_),
+                      REdges=boost::out_degree(v2,SubGraph.Base_);
                bool LessEdges=LEdges<REdges,MoreEdges=LEdges>REdges;
                return (!LessEdges && !MoreEdges? v2<v1 : MoreEdges);
          });
-         typename Graph_t::NodeItr_t NI=SubGraph.NodeBegin(),
-                                     NEnd=SubGraph.NodeEnd();
-         for(;NI!=NEnd;++NI)
-            Order.insert(SubGraph.NodeLookUp_.at(*NI));
-
-         CallBack CB(this,Graph_,SubGraph,!StopOnFind);
-         Compare<NodeComp_t> VComp(Graph_,SubGraph,NodeComp_);
-         Compare<EdgeComp_t> EComp(Graph_,SubGraph,EdgeComp_);
-         return boost::vf2_subgraph_iso(SubGraph,Graph_.base_,CB,Order
-                      ,boost::vertices_equivalent(VComp).
-                       edges_equivalent(EComp)
-                 );
-                /* This is the call for non-induced
-                 *
-                 * boost::vf2_subgraph_mono(SubGraph,Graph_,CB,
-                 *       boost::vertices_equivalent(NC))
-                 */
 
+         CallBack<SubGraph_t> CB(this,Graph_,SubGraph,!StopOnFind);
+         Compare<NodeComp_t,SubGraph_t> VComp(Graph_,SubGraph,NodeComp_);
+         Compare<EdgeComp_t,SubGraph_t> EComp(Graph_,SubGraph,EdgeComp_);
+         if(Induced)
+            return boost::vf2_subgraph_iso(SubGraph.Base_,Graph_.Base_,CB,Order,
+                         boost::vertices_equivalent(VComp).
+                         edges_equivalent(EComp));
+         return boost::vf2_subgraph_mono(SubGraph.Base_,Graph_.Base_,CB,Order,
+                      boost::vertices_equivalent(VComp).
+                      edges_equivalent(EComp));
+      }
+
+      /** \brief Same as above, for a subgraph that is a view
+       *
+       *  VF2 sizes its state by num_vertices() and expects every vertex of
+       *  the small graph to be matched, but a filtered graph reports the
+       *  full graph's vertices, so the view is copied first.  The small
+       *  graph is the pattern, so the copy is cheap; the large graph can
+       *  stay a view.
+       */
+      template<typename T>
+      bool Run(const InducedSubgraph<T>& SubGraph,
+             bool StopOnFind=false,
+             bool Induced=true
+            ){
+         return Run(SubGraph.Materialize(),StopOnFind,Induced);
       }
 
       std::ostream& operator<<(std::ostream& os)const{
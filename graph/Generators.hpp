@@ -0,0 +1,315 @@
+#ifndef PULSAR_GUARD_GRAPH__GENERATORS_HPP_
+#define PULSAR_GUARD_GRAPH__GENERATORS_HPP_
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <unordered_set>
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+/** \brief A made-up molecular graph: nodes 0 to NNodes()-1, the element of
+ *         each, and the bonds between them
+ *
+ *  The generators below return these, so that benchmarks and tests can
+ *  make graphs of realistic shape at any size without reading structures
+ *  from disk.  Build() turns one into a Graph whose nodes are the indices:
+ *  \code
+ *  SyntheticGraph Mol=DiamondLattice(10,10,10);
+ *  UGraph<size_t,std::tuple<size_t,size_t>> G=Mol.Build<decltype(G)>();
+ *  \endcode
+ *
+ *  Bonds go from the lower numbered node to the higher one, except where a
+ *  periodic boundary wraps around.
+ */
+struct SyntheticGraph{
+   ///What the graph is, e.g. "alkane C1000"
+   std::string Name;
+   ///The atomic number of each node
+   std::vector<int> Elements;
+   ///The bonds
+   std::vector<std::pair<size_t,size_t>> Edges;
+
+   size_t NNodes()const{return Elements.size();}
+   size_t NEdges()const{return Edges.size();}
+
+   ///Adds an atom of element \p Z, returns its index
+   size_t AddNode(int Z){
+      Elements.push_back(Z);
+      return Elements.size()-1;
+   }
+
+   void AddEdge(size_t i,size_t j){Edges.emplace_back(i,j);}
+
+   ///Adds a copy of \p Other, with its nodes numbered after these
+   void Append(const SyntheticGraph& Other){
+      const size_t Offset=NNodes();
+      Elements.insert(Elements.end(),Other.Elements.begin(),Other.Elements.end());
+      for(const auto& e:Other.Edges)AddEdge(e.first+Offset,e.second+Offset);
+   }
+
+   ///Makes a Graph_t whose node i is Node_t(i)
+   template<typename Graph_t>
+   Graph_t Build()const{
+      typedef typename Graph_t::NodeType Node_t;
+      typedef typename Graph_t::EdgeType Edge_t;
+      Graph_t temp;
+      std::vector<Node_t> Nodes;
+      Nodes.reserve(NNodes());
+      for(size_t i=0;i<NNodes();++i)Nodes.push_back(Node_t(i));
+      temp.AddNode(Nodes.begin(),Nodes.end());
+      std::vector<Edge_t> Bonds;
+      Bonds.reserve(NEdges());
+      for(const auto& e:Edges)Bonds.push_back(Edge_t(Nodes[e.first],Nodes[e.second]));
+      temp.AddEdge(Bonds.begin(),Bonds.end());
+      return temp;
+   }
+};
+
+/** \brief A linear alkane, C_nH_{2n+2}
+ *
+ *  The carbons are nodes 0 to \p NCarbons-1, each followed by its
+ *  hydrogens.
+ */
+inline SyntheticGraph Alkane(size_t NCarbons){
+   SyntheticGraph temp;
+   temp.Name="alkane C"+std::to_string(NCarbons);
+   size_t Last=0;
+   for(size_t i=0;i<NCarbons;++i){
+      const size_t C=temp.AddNode(6);
+      if(i)temp.AddEdge(Last,C);
+      const size_t NH=2+(i==0)+(i+1==NCarbons);
+      for(size_t h=0;h<NH;++h)temp.AddEdge(C,temp.AddNode(1));
+      Last=C;
+   }
+   return temp;
+}
+
+namespace detail{
+
+///An atom of a side chain, bonded to an earlier one (-1 for CA)
+struct SideChainAtom{
+   int Z;
+   int Parent;
+};
+
+///A residue's side chain and its ring closures (-2 for the backbone N)
+struct SideChain{
+   std::vector<SideChainAtom> Atoms;
+   std::vector<std::pair<int,int>> Rings;
+};
+
+///Heavy atoms of some common residues' side chains
+inline const std::vector<SideChain>& SideChains(){
+   static const std::vector<SideChain> temp={
+      {{},{}},                                                   //Gly
+      {{{6,-1}},{}},                                             //Ala
+      {{{6,-1},{8,0}},{}},                                       //Ser
+      {{{6,-1},{16,0}},{}},                                      //Cys
+      {{{6,-1},{6,0},{6,0}},{}},                                 //Val
+      {{{6,-1},{8,0},{6,0}},{}},                                 //Thr
+      {{{6,-1},{6,0},{6,1},{6,1}},{}},                           //Leu
+      {{{6,-1},{6,0},{8,1},{8,1}},{}},                           //Asp
+      {{{6,-1},{6,0},{6,1},{6,2},{7,3}},{}},                     //Lys
+      {{{6,-1},{6,0},{6,1},{6,1},{6,2},{6,3},{6,4}},{{5,6}}},    //Phe
+      {{{6,-1},{6,0},{6,1}},{{2,-2}}}                            //Pro
+   };
+   return temp;
+}
+
+}//End namespace detail
+
+/** \brief The heavy atoms of a protein chain with \p NResidues residues
+ *
+ *  Residues are drawn at random from a table of eleven common ones
+ *  (glycine through proline, including an aromatic and a proline ring),
+ *  averaging a little under eight heavy atoms each.
+ */
+inline SyntheticGraph Polypeptide(size_t NResidues,unsigned Seed=1){
+   SyntheticGraph temp;
+   temp.Name="polypeptide "+std::to_string(NResidues)+" residues";
+   const std::vector<detail::SideChain>& Table=detail::SideChains();
+   std::mt19937_64 Gen(Seed);
+   std::uniform_int_distribution<size_t> Pick(0,Table.size()-1);
+   size_t LastC=0;
+   for(size_t i=0;i<NResidues;++i){
+      const size_t N=temp.AddNode(7),CA=temp.AddNode(6),C=temp.AddNode(6);
+      if(i)temp.AddEdge(LastC,N);
+      temp.AddEdge(N,CA);
+      temp.AddEdge(CA,C);
+      temp.AddEdge(C,temp.AddNode(8));
+      const detail::SideChain& R=Table[Pick(Gen)];
+      std::vector<size_t> Atoms;
+      for(const auto& a:R.Atoms){
+         Atoms.push_back(temp.AddNode(a.Z));
+         temp.AddEdge(a.Parent<0?CA:Atoms[a.Parent],Atoms.back());
+      }
+      for(const auto& r:R.Rings)
+         temp.AddEdge(Atoms[r.first],r.second==-2?N:Atoms[r.second]);
+      LastC=C;
+   }
+   return temp;
+}
+
+/** \brief Periodic diamond lattice (e.g. bulk silicon) of \p Nx by \p Ny
+ *         by \p Nz conventional cells
+ *
+ *  Eight atoms per cell, each bonded to four others.  Use at least two
+ *  cells per side, or the periodic images of a bond coincide.
+ */
+inline SyntheticGraph DiamondLattice(size_t Nx,size_t Ny,size_t Nz,int Z=14){
+   SyntheticGraph temp;
+   temp.Name="diamond lattice "+std::to_string(Nx)+"x"+std::to_string(Ny)+
+             "x"+std::to_string(Nz);
+   //Positions in the cell, in quarters of the cell edge
+   static const int Basis[8][3]={{0,0,0},{0,2,2},{2,0,2},{2,2,0},
+                                 {1,1,1},{1,3,3},{3,1,3},{3,3,1}};
+   //Bonds of the first four atoms, the other four get theirs from these
+   static const int Bonds[4][3]={{1,1,1},{1,-1,-1},{-1,1,-1},{-1,-1,1}};
+   const long N[3]={long(Nx),long(Ny),long(Nz)};
+   temp.Elements.assign(8*Nx*Ny*Nz,Z);
+   auto Index=[&](const long* p){
+      long Cell[3];
+      int b=0;
+      for(int k=0;k<3;++k){
+         long q=((p[k]%(4*N[k]))+4*N[k])%(4*N[k]);
+         Cell[k]=q/4;
+         b=b*4+int(q%4);
+      }
+      int Which=0;
+      for(int i=0;i<8;++i)
+         if(Basis[i][0]*16+Basis[i][1]*4+Basis[i][2]==b)Which=i;
+      return size_t(((Cell[0]*N[1]+Cell[1])*N[2]+Cell[2])*8+Which);
+   };
+   for(long x=0;x<N[0];++x)
+      for(long y=0;y<N[1];++y)
+         for(long z=0;z<N[2];++z)
+            for(int b=0;b<4;++b){
+               const long p[3]={4*x+Basis[b][0],4*y+Basis[b][1],4*z+Basis[b][2]};
+               for(const auto& d:Bonds){
+                  const long q[3]={p[0]+d[0],p[1]+d[1],p[2]+d[2]};
+                  temp.AddEdge(Index(p),Index(q));
+               }
+            }
+   return temp;
+}
+
+/** \brief \p NNodes carbons with random bonds, at most \p MaxDegree per
+ *         atom and \p MeanDegree on average
+ *
+ *  No self-bonds and no repeated bonds.  If the degree limit makes the
+ *  mean unreachable the graph ends up with fewer bonds.
+ */
+inline SyntheticGraph RandomGraph(size_t NNodes,size_t MaxDegree=4,
+                                  double MeanDegree=3.0,unsigned Seed=1){
+   SyntheticGraph temp;
+   temp.Name="random graph, degree <= "+std::to_string(MaxDegree);
+   temp.Elements.assign(NNodes,6);
+   if(NNodes<2)return temp;
+   const size_t NBonds=size_t(MeanDegree*NNodes/2);
+   std::vector<size_t> Degree(NNodes,0);
+   std::unordered_set<uint64_t> Seen;
+   std::mt19937_64 Gen(Seed);
+   std::uniform_int_distribution<size_t> Pick(0,NNodes-1);
+   for(size_t Tries=0;temp.NEdges()<NBonds && Tries<8*NBonds;++Tries){
+      size_t i=Pick(Gen),j=Pick(Gen);
+      if(i==j || Degree[i]>=MaxDegree || Degree[j]>=MaxDegree)continue;
+      if(j<i)std::swap(i,j);
+      if(!Seen.insert(uint64_t(i)*NNodes+j).second)continue;
+      ++Degree[i];
+      ++Degree[j];
+      temp.AddEdge(i,j);
+   }
+   return temp;
+}
+
+/** \brief A zigzag (n,0) carbon nanotube, \p Length rings long, with
+ *         hydrogens on the open ends
+ *
+ *  Each ring is a zigzag chain of 2n carbons around the circumference;
+ *  ring r, carbon c is node 2nr+c.  Every other carbon of a ring is bonded
+ *  to the carbon above it in the next ring, giving n hexagons around.
+ */
+inline SyntheticGraph Nanotube(size_t n,size_t Length){
+   SyntheticGraph temp;
+   temp.Name="("+std::to_string(n)+",0) nanotube, "+
+             std::to_string(Length)+" rings";
+   const size_t W=2*n;
+   temp.Elements.assign(W*Length,6);
+   for(size_t r=0;r<Length;++r)
+      for(size_t c=0;c<W;++c){
+         const size_t i=r*W+c;
+         temp.AddEdge(i,r*W+(c+1)%W);
+         if(r+1<Length && (r+c)%2==0)temp.AddEdge(i,i+W);
+      }
+   //Carbons on the ends with only two carbon neighbors
+   for(size_t c=0;c<W && Length;++c){
+      if(c%2 || Length==1)temp.AddEdge(c,temp.AddNode(1));
+      const size_t r=Length-1;
+      if(r && (r+c)%2==0)temp.AddEdge(r*W+c,temp.AddNode(1));
+   }
+   return temp;
+}
+
+/** \brief Buckminsterfullerene, C60
+ *
+ *  Built by truncating an icosahedron: atom 5a+k sits on the k-th edge
+ *  out of vertex a, the atoms around each vertex form a pentagon, and the
+ *  two atoms on each icosahedron edge are bonded.
+ */
+inline SyntheticGraph Fullerene(){
+   SyntheticGraph temp;
+   temp.Name="C60";
+   const double Phi=(1.0+std::sqrt(5.0))/2.0;
+   double V[12][3];
+   for(int i=0;i<4;++i){
+      const double a=(i&1?-1.0:1.0),b=(i&2?-Phi:Phi);
+      const double p[3][3]={{0,a,b},{a,b,0},{b,0,a}};
+      for(int k=0;k<3;++k)
+         for(int x=0;x<3;++x)V[4*k+i][x]=p[k][x];
+   }
+   auto Bonded=[&](int a,int b){
+      double d=0.0;
+      for(int x=0;x<3;++x)d+=(V[a][x]-V[b][x])*(V[a][x]-V[b][x]);
+      return a!=b && std::fabs(d-4.0)<1e-6;
+   };
+   std::vector<std::vector<int>> Nbrs(12);
+   for(int a=0;a<12;++a)
+      for(int b=0;b<12;++b)
+         if(Bonded(a,b))Nbrs[a].push_back(b);
+   temp.Elements.assign(60,6);
+   auto Atom=[&](int a,int b){
+      for(size_t k=0;k<5;++k)if(Nbrs[a][k]==b)return size_t(5*a+k);
+      return size_t(0);
+   };
+   for(int a=0;a<12;++a)
+      for(size_t k=0;k<5;++k){
+         const int b=Nbrs[a][k];
+         if(a<b)temp.AddEdge(Atom(a,b),Atom(b,a));
+         for(size_t l=k+1;l<5;++l)
+            if(Bonded(b,Nbrs[a][l]))temp.AddEdge(5*a+k,5*a+l);
+      }
+   return temp;
+}
+
+///\p NMolecules separate C60 molecules, as in solid fullerite
+inline SyntheticGraph Fullerite(size_t NMolecules){
+   const SyntheticGraph C60=Fullerene();
+   SyntheticGraph temp;
+   temp.Name="fullerite, "+std::to_string(NMolecules)+" C60";
+   temp.Elements.reserve(60*NMolecules);
+   temp.Edges.reserve(90*NMolecules);
+   for(size_t i=0;i<NMolecules;++i)temp.Append(C60);
+   return temp;
+}
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_GENERATORS_HPP_ */
@@ -3,6 +3,8 @@
 
 #include <functional>
 #include <tuple>
+#include <set>
+#include <type_traits>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/adjacency_matrix.hpp>
@@ -11,6 +13,7 @@
 
 #include "pulsar/datastore/graph/FillMacro.h"
 #include "pulsar/datastore/graph/GraphItr.hpp"
+#include "pulsar/datastore/graph/PayloadStore.hpp"
 
 namespace pulsar{
 namespace datastore {
@@ -22,6 +25,10 @@ template<typename T,typename U> class DFSBase;
 template<typename U> class BFS;
 template<typename T,typename U> class BFSBase;
 template<typename U> class FindSubGraph;
+template<typename U> class TopoSort;
+template<typename U> class DAGExecutor;
+template<typename U> class Adjacency;
+template<typename U> class InducedSubgraph;
 
 /** \brief A basic graph object
  *
@@ -85,9 +92,10 @@ template<typename U> class FindSubGraph;
  *  order, not that the order reflects the physical ordering of the
  *  pointed to objects.
  *
- *  Last point about your Node/Edge types, there will be a fair bit of
- *  copying involved b/c of BGL's philosophies (you can read them in
- *  their FAQ section) so your Node/Edge types should be light weight.
+ *  Last point about your Node/Edge types, the graph keeps one copy of each
+ *  node and edge you give it (see PayloadStore), but accessors like
+ *  ConNodes() and Edges() return copies, so your Node/Edge types should
+ *  still be light weight.
  *  Again this is why I recommend the pointer option, but there are
  *  some scenarios in which you want to be able to construct a separate
  *  node or graph and compare them.  In these cases I recommend you keep
@@ -248,6 +256,15 @@ template<typename U> class FindSubGraph;
  *  1. Breadth first search (class: BFS)
  *  2. Depth first search (class: DFS)
  *  2. Subgraph searches (class:: FindSubGraph)
+ *  3. Topological order and critical path (class: TopoSort)
+ *  4. Running a dependency graph on a thread pool (class: DAGExecutor)
+ *  5. Node and edge coloring (class: GraphColoring)
+ *  6. Automorphism group and node orbits (class: Automorphisms)
+ *  7. Maximal and bounded-size cliques (class: CliqueFinder)
+ *  8. Maximum common subgraph of two graphs (class: MaxCommonSubgraph)
+ *
+ *  BFS, DFS, and FindSubGraph also run on an InducedSubgraph, a view of
+ *  some of a graph's nodes that copies nothing.
  *
  *  Other interesting, and likely to be wrapped eventually, algorithms
  *  include: shortest path, minimum cut,
@@ -316,10 +333,14 @@ template<typename U> class FindSubGraph;
  *  you realize that BGL maps them to size_t and pairs of size_t for nodes
  *  and edges respectively.  This is fine if it did this internally, but
  *  BGL demands you use the size_t and pairs of size_t mappings that it makes
- *  to access your elements.  This is why we need to store an std::map
+ *  to access your elements.  This is why we need to store a map
  *  between the interior properties the user gave us and the stupid look
  *  up values BGL gives us.  BGL calls interior properties, bundled
- *  properties when they are part of the adjacency_list type.
+ *  properties when they are part of the adjacency_list type.  Storing your
+ *  objects as the bundled properties and again as the keys of the map
+ *  doubles the memory they take, so the only bundled property is a
+ *  size_t saying where the object is in a PayloadStore, which holds the
+ *  object once and looks it up by value.
  *
  *  In what amounts to an uber pain in my butt, the type of the returned
  *  iterator is different depending on a bunch of things.  I would
@@ -347,13 +368,14 @@ template<typename U> class FindSubGraph;
  *                are the source and the sink
  *  \param EdgeCon_t The container structure that holds the edges (default std::vector)
  *  \param NodeCon_t The container structure that holds the nodes (default std::vector)
- *  \param Impl_t The BGL class that actually implements the graph
+ *  \param Impl_t The BGL class that actually implements the graph, its
+ *                bundled node and edge properties must be std::size_t
  */
  template<typename Node_t,typename Edge_t=std::tuple<Node_t,Node_t>,
           typename EdgeCon_t=boost::vecS,typename NodeCon_t=boost::vecS,
           typename Impl_t=
               boost::adjacency_list<EdgeCon_t,NodeCon_t,
-                     boost::bidirectionalS,Node_t,Edge_t>
+                     boost::bidirectionalS,std::size_t,std::size_t>
 >
  class Graph{
     private:
@@ -371,16 +393,26 @@ template<typename U> class FindSubGraph;
        
        Base_t Base_;
 
+       ///The nodes, and BGL's descriptor for each
+       typedef PayloadStore<Node_t,Vertex_t> NodeStore_t;
+
+       ///The edges, and BGL's descriptor for each
+       typedef PayloadStore<Edge_t,Arc_t> EdgeStore_t;
+
        ///This is so I can dereference BGL's node types back to what you want
-       std::map<Node_t,Vertex_t> NodeLookUp_;
+       NodeStore_t NodeLookUp_;
 
        ///This is so I can dereference BGL's edges back to what you want
-       std::map<Edge_t,Arc_t> EdgeLookUp_;
+       EdgeStore_t EdgeLookUp_;
 
        ///So that algorithms can work on our wrapped class
        friend BFSBase<BFS<My_t>,My_t>;
        friend DFSBase<DFS<My_t>,My_t>;
-       friend FindSubGraph<My_t>;
+       template<typename U> friend class FindSubGraph;
+       friend TopoSort<My_t>;
+       friend DAGExecutor<My_t>;
+       friend Adjacency<My_t>;
+       friend InducedSubgraph<My_t>;
 
 
     public:
@@ -426,20 +458,38 @@ template<typename U> class FindSubGraph;
 
        ///Removes NodeI (and all edges to it) all iterators are invalidated
        void RemoveNode(const Node_t& NodeI){
-          boost::clear_vertex(NodeLookUp_.at(NodeI),Base_);
-          boost::remove_vertex(NodeLookUp_.at(NodeI),Base_);
+          const Vertex_t V=NodeLookUp_.at(NodeI);
+          //An undirected graph reports each edge as both in and out
+          std::set<std::size_t> Slots;
+          auto Out=boost::out_edges(V,Base_);
+          for(;Out.first!=Out.second;++Out.first)Slots.insert(Base_[*Out.first]);
+          auto In=boost::in_edges(V,Base_);
+          for(;In.first!=In.second;++In.first)Slots.insert(Base_[*In.first]);
+          const std::size_t Slot=Base_[V];
+          boost::clear_vertex(V,Base_);
+          boost::remove_vertex(V,Base_);
+          for(std::size_t s:Slots)EdgeLookUp_.Erase(s);
+          NodeLookUp_.Erase(Slot);
+          //With vecS BGL renumbers the nodes after V, and the edges store
+          //node numbers
+          if(std::is_integral<Vertex_t>::value)UpdateLookUps();
        }
 
        ///Removes edge from NodeI to NodeJ iterators to edges are invalidated
        void RemoveEdge(const Node_t& NodeI,const Node_t& NodeJ){
-          boost::remove_edge(
-          boost::edge(NodeLookUp_.at(NodeI),NodeLookUp_.at(NodeJ),Base_).first,
-           Base_);
+          const Arc_t E=
+          boost::edge(NodeLookUp_.at(NodeI),NodeLookUp_.at(NodeJ),Base_).first;
+          const std::size_t Slot=Base_[E];
+          boost::remove_edge(E,Base_);
+          EdgeLookUp_.Erase(Slot);
        }
 
        ///Removes the passed in edge, iterators to edges are invalidated
        void RemoveEdge(const Edge_t& Edge){
-          boost::remove_edge(EdgeLookUp_[Edge],Base_);
+          const Arc_t E=EdgeLookUp_.at(Edge);
+          const std::size_t Slot=Base_[E];
+          boost::remove_edge(E,Base_);
+          EdgeLookUp_.Erase(Slot);
        }
 
 
@@ -465,7 +515,7 @@ template<typename U> class FindSubGraph;
            std::pair<Itr_t,Itr_t> Its=
                  boost::adjacent_vertices(NodeLookUp_.at(NodeI),Base_);
            for(;Its.first!=Its.second;++Its.first)
-              temp.push_back(Base_[*Its.first]);
+              temp.push_back((*this)[*Its.first]);
           return temp;
        }
        ///@}
@@ -501,7 +551,7 @@ template<typename U> class FindSubGraph;
           std::pair<Itr_t,Itr_t> Its=
                 boost::out_edges(NodeLookUp_.at(NodeI),Base_);
           for(;Its.first!=Its.second;++Its.first)
-             temp.push_back(Base_[*Its.first]);
+             temp.push_back((*this)[*Its.first]);
          return temp;
        }
 
@@ -512,7 +562,7 @@ template<typename U> class FindSubGraph;
           std::pair<Itr_t,Itr_t> Its=
                 boost::in_edges(NodeLookUp_.at(NodeI),Base_);
           for(;Its.first!=Its.second;++Its.first)
-             temp.push_back(Base_[*Its.first]);
+             temp.push_back((*this)[*Its.first]);
          return temp;
        }
        ///@}
@@ -527,7 +577,7 @@ template<typename U> class FindSubGraph;
        std::ostream& operator<<(std::ostream & os)const{
           class label_writer {
           public:
-            label_writer(const Impl_t& _name) : name(_name) {}
+            label_writer(const My_t& _name) : name(_name) {}
             void operator()(std::ostream& out, const Vertex_t& v) const {
               out << "[label=\"" << name[v] << "\"]";
             }
@@ -536,10 +586,10 @@ template<typename U> class FindSubGraph;
                out<<"[label=\""<<'\0'<<"\"]";
             }
           private:
-            const Impl_t& name;
+            const My_t& name;
           };
 
-          boost::write_graphviz(os,Base_,label_writer(Base_));
+          boost::write_graphviz(os,Base_,label_writer(*this));
           /*os<<"Graph contains: "<<NNodes()<<" nodes and "
                    <<NEdges()<<" edges."<<std::endl;
           NodeItr_t NI=NodeBegin(),NIEnd=NodeEnd();
@@ -554,23 +604,48 @@ template<typename U> class FindSubGraph;
        }
 
     private:
+       ///So iterators can dereference BGL's descriptors
+       friend GraphItr<Node_t,typename Impl_t::vertex_iterator,My_t>;
+       friend GraphItr<Edge_t,typename Impl_t::edge_iterator,My_t>;
+
+       ///Maps BGL's node type back to yours
+       const Node_t& operator[](const Vertex_t& V)const{
+          return NodeLookUp_[Base_[V]];
+       }
+
+       ///Maps BGL's edge type back to yours
+       const Edge_t& operator[](const Arc_t& E)const{
+          return EdgeLookUp_[Base_[E]];
+       }
+
        ///Actual function that fills in the BGL base class
        template<typename BeginItr_t,typename EndItr_t>
        void FillNodes(BeginItr_t BeginItr, EndItr_t EndItr){
           for(;BeginItr!=EndItr;++BeginItr){
-             NodeLookUp_[*BeginItr]=
-                   boost::add_vertex(*BeginItr,Base_);
+             const std::size_t Slot=NodeLookUp_.Add(*BeginItr);
+             NodeLookUp_.Map(Slot,boost::add_vertex(Slot,Base_));
           }
        }
 
        /** \brief Fills in the edges the user gave us */
        template<typename BeginItr_t,typename EndItr_t>
        void FillEdges(BeginItr_t BeginItr,EndItr_t EndItr){
-          for(;BeginItr!=EndItr;++BeginItr)
-             EdgeLookUp_[*BeginItr]=
-             boost::add_edge(NodeLookUp_.at(std::get<0>(*BeginItr)),
-                             NodeLookUp_.at(std::get<1>(*BeginItr)),
-                             Base_).first;
+          for(;BeginItr!=EndItr;++BeginItr){
+             const Vertex_t Source=NodeLookUp_.at(std::get<0>(*BeginItr)),
+                            Sink=NodeLookUp_.at(std::get<1>(*BeginItr));
+             const std::size_t Slot=EdgeLookUp_.Add(*BeginItr);
+             EdgeLookUp_.Map(Slot,boost::add_edge(Source,Sink,Slot,Base_).first);
+          }
+       }
+
+       ///Points the lookups at BGL's current descriptors
+       void UpdateLookUps(){
+          auto Vs=boost::vertices(Base_);
+          for(;Vs.first!=Vs.second;++Vs.first)
+             NodeLookUp_.Update(Base_[*Vs.first],*Vs.first);
+          auto Es=boost::edges(Base_);
+          for(;Es.first!=Es.second;++Es.first)
+             EdgeLookUp_.Update(Base_[*Es.first],*Es.first);
        }
  };
 
@@ -592,21 +667,21 @@ inline std::ostream& operator<<(std::ostream& os,
           typename NodeCon_t=boost::vecS>
  using UGraph=Graph<Node_t,Edge_t,EdgeCon_t,NodeCon_t,
        boost::adjacency_list<EdgeCon_t,NodeCon_t,boost::undirectedS,
-       Node_t,Edge_t> >;
+       std::size_t,std::size_t> >;
 
  ///A dense graph with no direction
  template<typename Node_t,typename Edge_t,
           typename EdgeCon_t=boost::vecS,
           typename NodeCon_t=boost::vecS>
  using DenseUGraph=Graph<Node_t,Edge_t,EdgeCon_t,NodeCon_t,
-       boost::adjacency_matrix<boost::undirectedS,NodeCon_t,EdgeCon_t> >;
+       boost::adjacency_matrix<boost::undirectedS,std::size_t,std::size_t> >;
 
  ///A dense bidirectional graph
  template<typename Node_t,typename Edge_t,
           typename EdgeCon_t=boost::vecS,
           typename NodeCon_t=boost::vecS>
  using DenseBiGraph=Graph<Node_t,Edge_t,EdgeCon_t,NodeCon_t,
-       boost::adjacency_matrix<boost::bidirectionalS,NodeCon_t,EdgeCon_t> >;
+       boost::adjacency_matrix<boost::bidirectionalS,std::size_t,std::size_t> >;
 
 } // close namespace LibGraph
 } // close namespace datastore
@@ -0,0 +1,216 @@
+/*! \file
+ *
+ * \brief Construction, traversal, and subgraph search cost of LibGraph
+ *        graphs on synthetic molecules
+ *
+ * For each generator in Generators.hpp (alkane chain, polypeptide, diamond
+ * lattice, random degree-bounded graph, nanotube, fullerite) a molecule
+ * of about n atoms is built into each backend:
+ *
+ *  - bidirectional or undirected BGL adjacency_list, and
+ *  - vecS (parallel bonds allowed) or setS (parallel bonds rejected) as
+ *    the policy for the edge container,
+ *
+ * and the following are reported:
+ *
+ *  - the time to add the nodes and then the bonds,
+ *  - heap bytes per node and per bond,
+ *  - BFS and DFS throughput over every component, in edges examined per
+ *    second, and
+ *  - the latency of FindSubGraph finding its first match of a six-atom
+ *    fragment (cut out of the molecule with InducedSubgraph), with atoms
+ *    matched by element.
+ *
+ * Usage: GraphBenchmark [n=100000] [repeats=3]
+ *
+ * Times are the best of the repeats.  Heap sizes come from mallinfo2()
+ * under glibc and from the resident set size otherwise, which is coarser.
+ * n=10000000 works, but needs several GB per backend.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/BFS.hpp"
+#include "pulsar/datastore/graph/DFS.hpp"
+#include "pulsar/datastore/graph/FindSubGraph.hpp"
+#include "pulsar/datastore/graph/InducedSubgraph.hpp"
+#include "pulsar/datastore/graph/Generators.hpp"
+
+using namespace pulsar::datastore::LibGraph;
+
+typedef std::tuple<size_t, size_t> Bond_t;
+
+///Bytes of heap in use
+size_t HeapBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    size_t pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+///Seconds since \p t0
+double Since(std::chrono::steady_clock::time_point t0)
+{
+    const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    return dt.count();
+}
+
+///Counts the edges a traversal examines and remembers which nodes it found
+template<typename Search_t, typename Graph_t>
+class Counter : public Search_t
+{
+    public:
+        Counter(const Graph_t & G, std::vector<char> & Seen, size_t & NEdges)
+            : Search_t(G), Seen_(Seen), NEdges_(NEdges) { }
+
+        void FoundNode(const size_t & Node) { Seen_[Node] = 1; }
+        void LookAtEdge(const Bond_t &) { ++NEdges_; }
+
+    private:
+        std::vector<char> & Seen_;
+        size_t & NEdges_;
+};
+
+///Edges per second of a search started from every node not yet found
+template<typename Search_t, typename Graph_t>
+double Traverse(const Graph_t & G, size_t Repeats)
+{
+    double best = 0.0;
+    for(size_t r = 0; r < Repeats; r++)
+    {
+        std::vector<char> seen(G.NNodes(), 0);
+        size_t nedges = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        Counter<Search_t, Graph_t> search(G, seen, nedges);
+        bool first = true;
+        for(size_t i = 0; i < G.NNodes(); i++)
+        {
+            if(seen[i])
+                continue;
+            search.Run(i, first);
+            first = false;
+        }
+        best = std::max(best, nedges / Since(t0));
+    }
+    return best;
+}
+
+///Six atoms around the middle of the molecule, as a view of it
+template<typename Graph_t>
+InducedSubgraph<Graph_t> Fragment(const Graph_t & G)
+{
+    std::vector<size_t> atoms(1, G.NNodes() / 2);
+    for(size_t i = 0; i < atoms.size() && atoms.size() < 6; i++)
+        for(size_t j : G.ConNodes(atoms[i]))
+            if(atoms.size() < 6 && std::find(atoms.begin(), atoms.end(), j) == atoms.end())
+                atoms.push_back(j);
+    return InducedSubgraph<Graph_t>(G, atoms.begin(), atoms.end());
+}
+
+///Runs everything on \p Mol stored as a Graph_t, prints one row
+template<typename Graph_t>
+void Benchmark(const std::string & Backend, const SyntheticGraph & Mol, size_t Repeats)
+{
+    std::vector<size_t> nodes(Mol.NNodes());
+    for(size_t i = 0; i < nodes.size(); i++)
+        nodes[i] = i;
+    std::vector<Bond_t> bonds;
+    bonds.reserve(Mol.NEdges());
+    for(const auto & e : Mol.Edges)
+        bonds.emplace_back(e.first, e.second);
+
+    const size_t heap0 = HeapBytes();
+    auto t0 = std::chrono::steady_clock::now();
+    Graph_t G;
+    G.AddNode(nodes.begin(), nodes.end());
+    const double tnodes = Since(t0);
+    const size_t heap1 = HeapBytes();
+    t0 = std::chrono::steady_clock::now();
+    G.AddEdge(bonds.begin(), bonds.end());
+    const double tedges = Since(t0);
+    const size_t heap2 = HeapBytes();
+
+    const double bfs = Traverse<BFS<Graph_t>>(G, Repeats);
+    const double dfs = Traverse<DFS<Graph_t>>(G, Repeats);
+
+    const InducedSubgraph<Graph_t> frag = Fragment(G);
+    const std::vector<int> & Z = Mol.Elements;
+    FindSubGraph<Graph_t> fsg(G,
+                              [&Z](const size_t & a, const size_t & b) { return Z[a] == Z[b]; },
+                              [](const Bond_t &, const Bond_t &) { return true; });
+    double search = 1e300;
+    bool found = false;
+    for(size_t r = 0; r < Repeats; r++)
+    {
+        t0 = std::chrono::steady_clock::now();
+        found = fsg.Run(frag, true);
+        search = std::min(search, Since(t0));
+    }
+
+    std::cout << std::setw(26) << std::left << Backend << std::right << std::fixed
+              << std::setprecision(3)
+              << std::setw(9) << tnodes << std::setw(9) << tedges
+              << std::setprecision(1)
+              << std::setw(9) << double(heap1 - heap0) / Mol.NNodes()
+              << std::setw(9) << (Mol.NEdges() ? double(heap2 - heap1) / Mol.NEdges() : 0.0)
+              << std::setprecision(2)
+              << std::setw(10) << bfs / 1e6 << std::setw(10) << dfs / 1e6
+              << std::setprecision(3)
+              << std::setw(10) << search * 1e3 << (found ? "" : " (no match)")
+              << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const size_t repeats = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3;
+
+    const size_t cells = std::max<size_t>(2, std::lround(std::cbrt(n / 8.0)));
+    const std::vector<std::function<SyntheticGraph()>> generators = {
+        [=] { return Alkane(std::max<size_t>(2, n / 3)); },
+        [=] { return Polypeptide(std::max<size_t>(1, n / 8)); },
+        [=] { return DiamondLattice(cells, cells, cells); },
+        [=] { return RandomGraph(n, 4, 3.0); },
+        [=] { return Nanotube(5, std::max<size_t>(2, n / 10)); },
+        [=] { return Fullerite(std::max<size_t>(1, n / 60)); }
+    };
+
+    for(const auto & make : generators)
+    {
+        const SyntheticGraph mol = make();
+        std::cout << mol.Name << ": " << mol.NNodes() << " atoms, "
+                  << mol.NEdges() << " bonds" << std::endl
+                  << std::setw(26) << std::left << "backend/edge policy" << std::right
+                  << std::setw(9) << "nodes s" << std::setw(9) << "bonds s"
+                  << std::setw(9) << "B/node" << std::setw(9) << "B/bond"
+                  << std::setw(10) << "BFS Me/s" << std::setw(10) << "DFS Me/s"
+                  << std::setw(10) << "match ms" << std::endl;
+        Benchmark<Graph<size_t, Bond_t>>("bidirectional/vecS", mol, repeats);
+        Benchmark<Graph<size_t, Bond_t, boost::setS>>("bidirectional/setS", mol, repeats);
+        Benchmark<UGraph<size_t, Bond_t>>("undirected/vecS", mol, repeats);
+        Benchmark<UGraph<size_t, Bond_t, boost::setS>>("undirected/setS", mol, repeats);
+        std::cout << std::endl;
+    }
+    return 0;
+}
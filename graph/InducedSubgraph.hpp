@@ -0,0 +1,301 @@
+#ifndef PULSAR_GUARD_GRAPH__INDUCEDSUBGRAPH_HPP_
+#define PULSAR_GUARD_GRAPH__INDUCEDSUBGRAPH_HPP_
+
+#include <vector>
+#include <stdexcept>
+#include <boost/graph/filtered_graph.hpp>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/GraphItr.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+/** \brief Some of the nodes of a graph, and all of the edges between them,
+ *         without copying anything
+ *
+ *  An induced subgraph of a graph is a subset of its nodes together with
+ *  every edge whose ends are both in the subset, e.g. a fragment of a
+ *  molecule with the bonds inside it.  This class is a view: it holds a
+ *  reference to the full graph and one byte per node saying whether the
+ *  node is in, so making one costs a pass over the nodes in it rather than
+ *  copying them, their edges, and the lookup tables.  Underneath it is a
+ *  boost::filtered_graph, so the BGL algorithms skip the other nodes as
+ *  they go.
+ *
+ *  The view has the same accessors as Graph, and BFS, DFS, and
+ *  FindSubGraph run on it directly (a view given to FindSubGraph::Run()
+ *  as the pattern is copied with Materialize(), as VF2 needs the exact
+ *  number of nodes):
+ *  \code
+ *  typedef InducedSubgraph<MyGraph_t> View_t;
+ *  View_t Fragment(Molecule,FragmentAtoms.begin(),FragmentAtoms.end());
+ *  BFS<View_t> bfs(Fragment);
+ *  bfs.Run(FragmentAtoms[0]);//Never leaves the fragment
+ *
+ *  MyGraph_t Copy=Fragment.Materialize();//When a real graph is needed
+ *  \endcode
+ *
+ *  The full graph must outlive the view and must not have nodes added or
+ *  removed while the view exists.  As with the algorithms, the graph's
+ *  nodes need to be stored in a boost::vecS (the default), since the
+ *  view indexes its mask by node descriptor.
+ */
+template<typename Graph_t>
+class InducedSubgraph{
+   private:
+      ///Typedef of this's type
+      typedef InducedSubgraph<Graph_t> My_t;
+      ///What BGL uses for nodes
+      typedef typename Graph_t::Vertex_t Vertex_t;
+      ///What BGL uses for edges
+      typedef typename Graph_t::Arc_t Arc_t;
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+      ///The type of the edges
+      typedef typename Graph_t::EdgeType Edge_t;
+
+      ///Tells boost::filtered_graph which vertices are in the view
+      struct InView{
+         const std::vector<char>* Mask=nullptr;
+         bool operator()(const Vertex_t& v)const{return (*Mask)[v];}
+      };
+
+      ///The BGL graph the algorithms see
+      typedef boost::filtered_graph<typename Graph_t::Base_t,
+                                    boost::keep_all,InView> Base_t;
+
+      ///Looks up nodes in the full graph, refusing ones not in the view
+      struct LookUp{
+         const typename Graph_t::NodeStore_t* Map;
+         const std::vector<char>* Mask;
+         const Vertex_t& at(const Node_t& NodeI)const{
+            const Vertex_t& v=Map->at(NodeI);
+            if(!(*Mask)[v])
+               throw std::out_of_range("Node is not in the induced subgraph");
+            return v;
+         }
+      };
+
+   public:
+      ///Type of an object that is on an edge
+      typedef Edge_t EdgeType;
+
+      ///Type of the an object on a node
+      typedef Node_t NodeType;
+
+      ///Type of an iterator to a set of nodes
+      typedef GraphItr<Node_t,typename boost::graph_traits<Base_t>::vertex_iterator,
+                       My_t> NodeItr_t;
+
+      ///Type of an iterator to a set of edges
+      typedef GraphItr<Edge_t,typename boost::graph_traits<Base_t>::edge_iterator,
+                       My_t> EdgeItr_t;
+
+      ///The subgraph of \p Graph induced by the nodes in [Begin,End)
+      template<typename Itr_t>
+      InducedSubgraph(const Graph_t& Graph,Itr_t Begin,Itr_t End):
+         Graph_(Graph),Mask_(Graph.NNodes(),0),Base_(MakeBase()),
+         NodeLookUp_{&Graph.NodeLookUp_,&Mask_}{
+         for(;Begin!=End;++Begin){
+            char& In=Mask_[Graph_.NodeLookUp_.at(*Begin)];
+            NNodes_+=!In;
+            In=1;
+         }
+      }
+
+      /** \brief The subgraph of \p Graph induced by the nodes whose entry
+       *         in \p Mask is true
+       *
+       *  \p Mask has one entry per node, in the order the graph's
+       *  NodeBegin() gives them.
+       */
+      InducedSubgraph(const Graph_t& Graph,const std::vector<bool>& Mask):
+         Graph_(Graph),Mask_(Mask.begin(),Mask.end()),Base_(MakeBase()),
+         NodeLookUp_{&Graph.NodeLookUp_,&Mask_}{
+         if(Mask_.size()!=Graph.NNodes())
+            throw std::length_error("Mask needs one entry per node");
+         for(char In:Mask_)NNodes_+=In;
+      }
+
+      ///Views refer to their own mask, so copying one builds a new filter
+      InducedSubgraph(const My_t& Other):
+         Graph_(Other.Graph_),Mask_(Other.Mask_),Base_(MakeBase()),
+         NodeLookUp_{&Graph_.NodeLookUp_,&Mask_},NNodes_(Other.NNodes_){}
+
+      My_t& operator=(const My_t&)=delete;
+
+      ///The full graph
+      const Graph_t& FullGraph()const{return Graph_;}
+
+      ///Returns true if \p NodeI is in the subgraph
+      bool HasNode(const Node_t& NodeI)const{
+         return Graph_.NodeLookUp_.count(NodeI) &&
+                Mask_[Graph_.NodeLookUp_.at(NodeI)];
+      }
+
+      /** \brief Node accessors*/
+      ///@{
+      ///Returns the number of nodes in the subgraph
+      size_t NNodes()const{return NNodes_;}
+
+      ///Returns an iterator to the first node
+      NodeItr_t NodeBegin()const{
+         return NodeItr_t(boost::vertices(Base_).first,*this);
+      }
+
+      ///Returns an iterator just past the last node
+      NodeItr_t NodeEnd()const{
+         return NodeItr_t(boost::vertices(Base_).second,*this);
+      }
+
+      ///Returns an std::vector of the Nodes in the subgraph connected to NodeI
+      std::vector<Node_t> ConNodes(const Node_t& NodeI)const{
+         std::vector<Node_t> temp;
+         auto Its=boost::adjacent_vertices(NodeLookUp_.at(NodeI),Base_);
+         for(;Its.first!=Its.second;++Its.first)temp.push_back(Graph_[*Its.first]);
+         return temp;
+      }
+      ///@}
+
+      /** \brief Edge accessors*/
+      ///@{
+      ///Returns the number of edges in the subgraph, which means counting them
+      size_t NEdges()const{
+         size_t temp=0;
+         auto Its=boost::edges(Base_);
+         for(;Its.first!=Its.second;++Its.first)++temp;
+         return temp;
+      }
+
+      ///Returns the number of edges in the subgraph emanating from NodeI
+      size_t NEdges(const Node_t& NodeI)const{
+         return boost::out_degree(NodeLookUp_.at(NodeI),Base_);
+      }
+
+      ///Returns the number of edges in the subgraph ending in NodeI
+      size_t NInEdges(const Node_t& NodeI)const{
+         return boost::in_degree(NodeLookUp_.at(NodeI),Base_);
+      }
+
+      ///Returns an iterator to the first edge
+      EdgeItr_t EdgeBegin()const{
+         return EdgeItr_t(boost::edges(Base_).first,*this);
+      }
+
+      ///Returns an iterator just past the last edge
+      EdgeItr_t EdgeEnd()const{
+         return EdgeItr_t(boost::edges(Base_).second,*this);
+      }
+
+      ///Returns an std::vector of edges in the subgraph emanating from NodeI
+      std::vector<Edge_t> Edges(const Node_t& NodeI)const{
+         std::vector<Edge_t> temp;
+         auto Its=boost::out_edges(NodeLookUp_.at(NodeI),Base_);
+         for(;Its.first!=Its.second;++Its.first)temp.push_back(Graph_[*Its.first]);
+         return temp;
+      }
+
+      ///Returns an std::vector of edges in the subgraph ending in NodeI
+      std::vector<Edge_t> InEdges(const Node_t& NodeI)const{
+         std::vector<Edge_t> temp;
+         auto Its=boost::in_edges(NodeLookUp_.at(NodeI),Base_);
+         for(;Its.first!=Its.second;++Its.first)temp.push_back(Graph_[*Its.first]);
+         return temp;
+      }
+      ///@}
+
+      ///Returns true if u and v are in the subgraph and u-->v
+      bool AreConn(const Node_t& u,const Node_t& v)const{
+         return HasNode(u) && HasNode(v) && Graph_.AreConn(u,v);
+      }
+
+      /** \brief Copies the subgraph into a Graph of its own
+       *
+       *  Unlike adding the nodes and edges to a new graph, which looks up
+       *  both ends of every edge by value, this renumbers the nodes once
+       *  and fills the new graph's lookup tables in order, in one pass over
+       *  the nodes and one over the edges of the full graph.
+       */
+      Graph_t Materialize()const{
+         Graph_t temp;
+         const typename Graph_t::Base_t& Full=Graph_.Base_;
+         //The new descriptor of each old one
+         std::vector<Vertex_t> New(Mask_.size());
+         //The lookups are sorted, so each insert goes at the end
+         Graph_.NodeLookUp_.ForEach([&](const Node_t& n,const Vertex_t& v){
+            if(!Mask_[v])return;
+            const size_t Slot=temp.NodeLookUp_.Add(n);
+            New[v]=boost::add_vertex(Slot,temp.Base_);
+            temp.NodeLookUp_.MapLast(Slot,New[v]);
+         });
+         Graph_.EdgeLookUp_.ForEach([&](const Edge_t& e,const Arc_t& a){
+            const Vertex_t s=boost::source(a,Full),t=boost::target(a,Full);
+            if(!Mask_[s] || !Mask_[t])return;
+            const size_t Slot=temp.EdgeLookUp_.Add(e);
+            temp.EdgeLookUp_.MapLast(Slot,
+                  boost::add_edge(New[s],New[t],Slot,temp.Base_).first);
+         });
+         return temp;
+      }
+
+      ///Prints the subgraph, assumes your nodes can be passed to std::ostream
+      std::ostream& operator<<(std::ostream& os)const{
+         NodeItr_t NI=NodeBegin(),NIEnd=NodeEnd();
+         for(;NI!=NIEnd;++NI){
+            os<<*NI<<"'s connections:"<<std::endl;
+            for(const Node_t& NJ:ConNodes(*NI))os<<*NI<<" --> "<<NJ<<std::endl;
+         }
+         return os;
+      }
+
+   private:
+      ///So that algorithms can work on the view
+      friend BFSBase<BFS<My_t>,My_t>;
+      friend DFSBase<DFS<My_t>,My_t>;
+      template<typename U> friend class FindSubGraph;
+
+      ///So iterators can dereference BGL's descriptors
+      friend NodeItr_t;
+      friend EdgeItr_t;
+
+      ///The full graph
+      const Graph_t& Graph_;
+
+      ///Whether each node of the full graph is in the view
+      std::vector<char> Mask_;
+
+      ///The filtered graph
+      Base_t Base_;
+
+      ///Same use as Graph's, but only finds nodes in the view
+      LookUp NodeLookUp_;
+
+      ///Number of nodes in the view
+      size_t NNodes_=0;
+
+      Base_t MakeBase()const{
+         InView Filter;
+         Filter.Mask=&Mask_;
+         return Base_t(Graph_.Base_,boost::keep_all(),Filter);
+      }
+
+      ///Maps BGL's node type back to yours
+      const Node_t& operator[](const Vertex_t& V)const{return Graph_[V];}
+
+      ///Maps BGL's edge type back to yours
+      const Edge_t& operator[](const Arc_t& E)const{return Graph_[E];}
+};
+
+///Allows a subgraph to be passed to an ostream
+template<typename T>
+inline std::ostream& operator<<(std::ostream& os,const InducedSubgraph<T>& g){
+   return g<<os;
+}
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_INDUCEDSUBGRAPH_HPP_ */
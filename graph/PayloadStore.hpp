@@ -0,0 +1,159 @@
+#ifndef PULSAR_GUARD_GRAPH__PAYLOADSTORE_HPP_
+#define PULSAR_GUARD_GRAPH__PAYLOADSTORE_HPP_
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <stdexcept>
+#include <boost/optional.hpp>
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+/** \brief Where Graph keeps its nodes (or edges): each object stored once,
+ *         plus a lookup from the object to its BGL descriptor
+ *
+ *  BGL only sees a slot number, the object's place in this store, as the
+ *  bundled property of each vertex (or edge).  The lookup, sorted by the
+ *  objects' operator<(), holds a pointer to the stored object rather than
+ *  a copy of it.  Before, every node was stored twice (once by BGL, once as
+ *  the key of the lookup) and every edge likewise, so for payloads that
+ *  own memory, like strings, the graph took two or more times the
+ *  payloads' size.
+ *
+ *  The objects live in a deque, which never moves them, so slots and the
+ *  pointers in the lookup stay valid as objects are added.  Removing an
+ *  object destroys it and frees its slot for the next one added.
+ *
+ *  \param T The type of the objects
+ *  \param Handle_t What the lookup maps an object to (the BGL descriptor)
+ */
+template<typename T,typename Handle_t>
+class PayloadStore{
+   private:
+      ///A stored object, ordered by value
+      struct Key{
+         const T* Item;
+         bool operator<(const Key& Other)const{return *Item<*Other.Item;}
+      };
+
+      ///What an object maps to
+      struct Entry{
+         size_t Slot;
+         Handle_t Handle;
+      };
+
+      typedef std::map<Key,Entry> Map_t;
+
+      ///The objects, empty if the slot is free
+      std::deque<boost::optional<T>> Items_;
+
+      ///Slots that can be reused
+      std::vector<size_t> Free_;
+
+      ///Object to slot and handle
+      Map_t Index_;
+
+   public:
+      PayloadStore()=default;
+
+      ///The lookup points into Items_, so it has to be rebuilt on copy
+      PayloadStore(const PayloadStore& Other):
+         Items_(Other.Items_),Free_(Other.Free_){
+         for(const auto& e:Other.Index_)
+            Index_.emplace_hint(Index_.end(),Key{&*Items_[e.second.Slot]},e.second);
+      }
+
+      PayloadStore& operator=(const PayloadStore& Other){
+         if(this!=&Other){
+            PayloadStore temp(Other);
+            Items_.swap(temp.Items_);
+            Free_.swap(temp.Free_);
+            Index_.swap(temp.Index_);
+         }
+         return *this;
+      }
+
+      ///Moving a deque keeps its elements where they are, so the lookup
+      ///comes along as is
+      PayloadStore(PayloadStore&&)=default;
+      PayloadStore& operator=(PayloadStore&&)=default;
+
+      ///Stores a copy of \p Item, returns its slot.  Doesn't add it to the
+      ///lookup; call Map() once the handle is known.
+      size_t Add(const T& Item){
+         if(Free_.empty()){
+            Items_.push_back(Item);
+            return Items_.size()-1;
+         }
+         const size_t Slot=Free_.back();
+         Free_.pop_back();
+         Items_[Slot]=Item;
+         return Slot;
+      }
+
+      /** \brief Makes the object in \p Slot look up to \p Handle
+       *
+       *  If an equal object was already in the lookup, it now refers to
+       *  this one; the old object stays stored for whatever still uses its
+       *  slot.
+       */
+      void Map(size_t Slot,const Handle_t& Handle){
+         const Key k{&*Items_[Slot]};
+         Index_.erase(k);
+         Index_.emplace(k,Entry{Slot,Handle});
+      }
+
+      ///Same as Map(), for objects added in sorted order: no search
+      void MapLast(size_t Slot,const Handle_t& Handle){
+         Index_.emplace_hint(Index_.end(),Key{&*Items_[Slot]},Entry{Slot,Handle});
+      }
+
+      ///The object in \p Slot
+      const T& operator[](size_t Slot)const{return *Items_[Slot];}
+
+      ///The handle of \p Item, throws std::out_of_range if it's not here
+      const Handle_t& at(const T& Item)const{
+         typename Map_t::const_iterator It=Index_.find(Key{&Item});
+         if(It==Index_.end())throw std::out_of_range("Object is not in the graph");
+         return It->second.Handle;
+      }
+
+      ///Is \p Item here
+      bool count(const T& Item)const{return Index_.count(Key{&Item})>0;}
+
+      ///Number of objects in the lookup
+      size_t size()const{return Index_.size();}
+
+      ///Calls f(Item,Handle) for each object in the lookup, in sorted order
+      template<typename Fxn_t>
+      void ForEach(Fxn_t&& f)const{
+         for(const auto& e:Index_)f(*e.first.Item,e.second.Handle);
+      }
+
+      /** \brief Points the object in \p Slot at a new handle, e.g. after BGL
+       *         renumbers its descriptors
+       *
+       *  Does nothing if the lookup has an equal object from another slot.
+       */
+      void Update(size_t Slot,const Handle_t& Handle){
+         typename Map_t::iterator It=Index_.find(Key{&*Items_[Slot]});
+         if(It!=Index_.end() && It->second.Slot==Slot)It->second.Handle=Handle;
+      }
+
+      ///Removes the object in \p Slot from the lookup (unless an equal object
+      ///from another slot is what's there) and frees the slot
+      void Erase(size_t Slot){
+         typename Map_t::iterator It=Index_.find(Key{&*Items_[Slot]});
+         if(It!=Index_.end() && It->second.Slot==Slot)Index_.erase(It);
+         Items_[Slot]=boost::none;
+         Free_.push_back(Slot);
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_PAYLOADSTORE_HPP_ */
@@ -0,0 +1,209 @@
+#ifndef PULSAR_GUARD_GRAPH__TOPOSORT_HPP_
+#define PULSAR_GUARD_GRAPH__TOPOSORT_HPP_
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <boost/graph/graph_traits.hpp>
+
+#include "pulsar/exception/PulsarException.hpp"
+
+namespace pulsar{
+namespace datastore {
+namespace LibGraph{
+
+/** \brief Topological order and critical path of a directed acyclic graph
+ *
+ *  If an edge u-->v means "v needs u" (e.g. module v uses the output of
+ *  module u) then a topological order is an order in which everything can
+ *  be run serially: every node comes after all of the nodes it needs.
+ *  Such an order exists if and only if the graph has no cycles.
+ *
+ *  The order is found with Kahn's algorithm: start with the nodes nothing
+ *  points to, and each time a node is placed remove its edges, placing
+ *  whatever is left with nothing pointing to it.  Ties are broken by the
+ *  order the nodes were added to the graph, so the order is reproducible.
+ *
+ *  Given a cost (e.g. the expected run time) for each node, the critical
+ *  path is the most expensive chain of dependent nodes.  No matter how many
+ *  threads are thrown at the graph it can't finish faster than this, and
+ *  the total cost divided by the length of the critical path is the most
+ *  parallelism the graph exposes.
+ *
+ *  \code
+ *  TopoSort<MyGraph_t> Sort(MyGraph);//Throws if MyGraph has a cycle
+ *  for(const auto& Node: Sort.Order())Run(Node);
+ *  auto Path=Sort.CriticalPath([](const Node_t& n){return n.Cost();});
+ *  std::cout<<Path.Parallelism()<<std::endl;
+ *  \endcode
+ */
+template<typename Graph_t>
+class TopoSort{
+   public:
+      ///The type of the nodes
+      typedef typename Graph_t::NodeType Node_t;
+
+      ///The type of a function giving the cost of a node
+      typedef std::function<double(const Node_t&)> Cost_t;
+
+      ///The result of a critical path analysis
+      struct PathInfo{
+         ///The nodes on the critical path, in order
+         std::vector<Node_t> Path;
+         ///The cost of the critical path
+         double Length=0.0;
+         ///The cost of all of the nodes
+         double Work=0.0;
+         ///Earliest time each node can start, given unlimited threads
+         std::map<Node_t,double> EarliestStart;
+         ///How late each node can start without delaying the whole graph
+         std::map<Node_t,double> Slack;
+         ///Work over length, the most threads that can be kept busy
+         double Parallelism()const{return Length>0.0?Work/Length:0.0;}
+      };
+
+      /** \brief Sorts the graph
+       *
+       *  \throw pulsar::PulsarException if the graph has a cycle
+       */
+      TopoSort(const Graph_t& Graph):Graph_(Graph){Sort();}
+
+      ///The nodes in topological order
+      std::vector<Node_t> Order()const{
+         std::vector<Node_t> temp;
+         temp.reserve(Order_.size());
+         for(const Vertex_t& v:Order_)temp.push_back(Graph_[v]);
+         return temp;
+      }
+
+      /** \brief The nodes grouped into levels
+       *
+       *  Level 0 is the nodes with no predecessors, level i the nodes whose
+       *  longest chain of predecessors has i nodes.  Everything in a level
+       *  can run at the same time once the previous levels are done.
+       */
+      std::vector<std::vector<Node_t>> Levels()const{
+         std::vector<size_t> Level(Order_.size(),0);
+         std::vector<std::vector<Node_t>> temp;
+         for(const Vertex_t& v:Order_){
+            const size_t l=Level[Index(v)];
+            if(temp.size()<=l)temp.resize(l+1);
+            temp[l].push_back(Graph_[v]);
+            for(const Vertex_t& w:Successors(v))
+               Level[Index(w)]=std::max(Level[Index(w)],l+1);
+         }
+         return temp;
+      }
+
+      /** \brief The most expensive chain of dependent nodes
+       *
+       *  \param[in] Cost The cost of each node, must not be negative
+       */
+      PathInfo CriticalPath(const Cost_t& Cost)const{
+         const size_t n=Order_.size();
+         std::vector<double> C(n),Start(n,0.0),Tail(n,0.0);
+         std::vector<size_t> Prev(n,n);
+         PathInfo Info;
+         for(const Vertex_t& v:Order_){
+            const size_t i=Index(v);
+            C[i]=Cost(Graph_[v]);
+            if(C[i]<0.0)
+               throw PulsarException("Node costs must not be negative",
+                                     "cost",C[i]);
+            Info.Work+=C[i];
+         }
+
+         //Forward: earliest start of each node
+         size_t Last=n;
+         for(const Vertex_t& v:Order_){
+            const size_t i=Index(v);
+            const double Finish=Start[i]+C[i];
+            if(Last==n || Finish>Info.Length){Info.Length=Finish;Last=i;}
+            for(const Vertex_t& w:Successors(v)){
+               const size_t j=Index(w);
+               if(Prev[j]==n || Finish>Start[j]){Start[j]=Finish;Prev[j]=i;}
+            }
+         }
+
+         //Backward: the longest chain from each node to the end
+         for(auto v=Order_.rbegin();v!=Order_.rend();++v){
+            const size_t i=Index(*v);
+            double Longest=0.0;
+            for(const Vertex_t& w:Successors(*v))
+               Longest=std::max(Longest,Tail[Index(w)]);
+            Tail[i]=C[i]+Longest;
+         }
+
+         for(const Vertex_t& v:Order_){
+            const size_t i=Index(v);
+            Info.EarliestStart[Graph_[v]]=Start[i];
+            Info.Slack[Graph_[v]]=std::max(0.0,Info.Length-Start[i]-Tail[i]);
+         }
+         for(size_t i=Last;i!=n;i=Prev[i])
+            Info.Path.push_back(Graph_[Vertices_[i]]);
+         std::reverse(Info.Path.begin(),Info.Path.end());
+         return Info;
+      }
+
+   private:
+      ///What BGL uses for nodes
+      typedef typename Graph_t::Vertex_t Vertex_t;
+
+      ///The graph we sorted
+      const Graph_t& Graph_;
+
+      ///The vertices, in the order the graph gives them
+      std::vector<Vertex_t> Vertices_;
+
+      ///Where each vertex is in Vertices_
+      std::map<Vertex_t,size_t> Index_;
+
+      ///The vertices in topological order
+      std::vector<Vertex_t> Order_;
+
+      size_t Index(const Vertex_t& v)const{return Index_.at(v);}
+
+      ///The nodes v points to
+      std::vector<Vertex_t> Successors(const Vertex_t& v)const{
+         std::vector<Vertex_t> temp;
+         auto Its=boost::out_edges(v,Graph_.Base_);
+         for(;Its.first!=Its.second;++Its.first)
+            temp.push_back(boost::target(*Its.first,Graph_.Base_));
+         return temp;
+      }
+
+      ///Kahn's algorithm
+      void Sort(){
+         auto Its=boost::vertices(Graph_.Base_);
+         for(;Its.first!=Its.second;++Its.first){
+            Index_[*Its.first]=Vertices_.size();
+            Vertices_.push_back(*Its.first);
+         }
+         std::vector<size_t> NIn(Vertices_.size(),0);
+         for(const Vertex_t& v:Vertices_)
+            for(const Vertex_t& w:Successors(v))++NIn[Index(w)];
+
+         std::deque<Vertex_t> Ready;
+         for(const Vertex_t& v:Vertices_)
+            if(NIn[Index(v)]==0)Ready.push_back(v);
+         while(!Ready.empty()){
+            const Vertex_t v=Ready.front();
+            Ready.pop_front();
+            Order_.push_back(v);
+            for(const Vertex_t& w:Successors(v))
+               if(--NIn[Index(w)]==0)Ready.push_back(w);
+         }
+         if(Order_.size()!=Vertices_.size())
+            throw PulsarException("Graph has a cycle, there is no topological order",
+                                  "nnodes",Vertices_.size(),
+                                  "nsorted",Order_.size());
+      }
+};
+
+} // close namespace LibGraph
+} // close namespace datastore
+} // close namespace pulsar
+
+#endif /* GRAPH_TOPOSORT_HPP_ */
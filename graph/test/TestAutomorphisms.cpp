@@ -0,0 +1,185 @@
+/*! \file
+ *
+ * \brief Tests of the automorphism group and node orbits
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/Automorphisms.hpp"
+#include "pulsar/datastore/graph/Generators.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<int,int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+typedef std::vector<std::pair<int,int>> Pairs_t;
+
+///Nodes 0 to n-1, with the bond order of each edge if given
+Graph_t Make(int n,const Pairs_t& Edges,const std::vector<int>& Order={}){
+   Graph_t G;
+   for(int i=0;i<n;++i)G.AddNode(i);
+   for(size_t k=0;k<Edges.size();++k)
+      G.AddEdge(Edge_t(Edges[k].first,Edges[k].second,Order.empty()?0:Order[k]));
+   return G;
+}
+
+Pairs_t Ring(int n){
+   Pairs_t temp;
+   for(int i=0;i<n;++i)temp.push_back(std::make_pair(i,(i+1)%n));
+   return temp;
+}
+
+///The undirected edges, with their orders
+std::map<std::pair<int,int>,int> EdgeSet(const Graph_t& G){
+   std::map<std::pair<int,int>,int> temp;
+   for(auto It=G.EdgeBegin();It!=G.EdgeEnd();++It){
+      const int a=std::get<0>(*It),b=std::get<1>(*It);
+      temp[std::make_pair(std::min(a,b),std::max(a,b))]=std::get<2>(*It);
+   }
+   return temp;
+}
+
+///Does p map edges to edges of the same order
+bool IsAutomorphism(const std::map<std::pair<int,int>,int>& Edges,const std::map<int,int>& p){
+   for(const auto& e:Edges){
+      const int a=p.at(e.first.first),b=p.at(e.first.second);
+      auto It=Edges.find(std::make_pair(std::min(a,b),std::max(a,b)));
+      if(It==Edges.end() || It->second!=e.second)return false;
+   }
+   return true;
+}
+
+///The generators and the maps from the representatives are automorphisms
+bool Consistent(const Graph_t& G,const Automorphisms<Graph_t>& A){
+   const auto Edges=EdgeSet(G);
+   for(const auto& g:A.Generators())
+      if(!IsAutomorphism(Edges,g))return false;
+   for(int v=0;v<static_cast<int>(G.NNodes());++v){
+      const auto p=A.FromRepresentative(v);
+      if(!IsAutomorphism(Edges,p) || p.at(A.Representative(v))!=v)return false;
+   }
+   return true;
+}
+
+///Order of the group and the orbits, by trying every permutation
+std::pair<size_t,std::vector<std::set<int>>> BruteForce(const Graph_t& G,int n){
+   const auto Edges=EdgeSet(G);
+   std::vector<int> p(n);
+   std::iota(p.begin(),p.end(),0);
+   size_t Count=0;
+   std::vector<std::set<int>> Orbit(n);
+   do{
+      std::map<int,int> m;
+      for(int i=0;i<n;++i)m[i]=p[i];
+      if(!IsAutomorphism(Edges,m))continue;
+      ++Count;
+      for(int i=0;i<n;++i)Orbit[i].insert(p[i]);
+   }while(std::next_permutation(p.begin(),p.end()));
+   return std::make_pair(Count,Orbit);
+}
+
+size_t Order(const Edge_t& e){return std::get<2>(e);}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Automorphisms");
+
+   //Graphs whose groups are known
+   struct Case{std::string Name;Graph_t G;double Size;size_t NOrbits;};
+   Pairs_t K4,Petersen,Cube,Torus;
+   for(int i=0;i<4;++i)
+      for(int j=i+1;j<4;++j)K4.push_back(std::make_pair(i,j));
+   for(int i=0;i<5;++i){
+      Petersen.push_back(std::make_pair(i,(i+1)%5));
+      Petersen.push_back(std::make_pair(i,i+5));
+      Petersen.push_back(std::make_pair(5+i,5+(i+2)%5));
+   }
+   for(int i=0;i<8;++i)
+      for(int b=0;b<3;++b)
+         if(i<(i^(1<<b)))Cube.push_back(std::make_pair(i,i^(1<<b)));
+   for(int x=0;x<6;++x)
+      for(int y=0;y<6;++y){
+         Torus.push_back(std::make_pair(6*x+y,6*((x+1)%6)+y));
+         Torus.push_back(std::make_pair(6*x+y,6*x+(y+1)%6));
+      }
+   const std::vector<Case> Cases={{"Hexagon",Make(6,Ring(6)),12,1},
+                                  {"K4",Make(4,K4),24,1},
+                                  {"Petersen graph",Make(10,Petersen),120,1},
+                                  {"Cube",Make(8,Cube),48,1},
+                                  {"6x6 torus",Make(36,Torus),288,1},
+                                  {"Path",Make(5,{{0,1},{1,2},{2,3},{3,4}}),2,3},
+                                  {"No edges",Make(5,{}),120,1},
+                                  {"Two triangles",Make(6,{{0,1},{1,2},{2,0},{3,4},{4,5},{5,3}}),72,1}};
+   for(const Case& c:Cases){
+      const Automorphisms<Graph_t> A(c.G);
+      Tester.TestClose(c.Name+": group order",A.GroupSize(),c.Size,1e-9);
+      Tester.Test(c.Name+": orbits",A.NOrbits()==c.NOrbits);
+      Tester.Test(c.Name+": generators and coset maps",Consistent(c.G,A));
+   }
+
+   //Colors: Kekule benzene keeps only the rotations by two bonds and the
+   //reflections through atoms, and labeling one atom of a ring fixes it
+   const Graph_t Kekule=Make(6,Ring(6),{1,2,1,2,1,2});
+   const Automorphisms<Graph_t> K(Kekule,nullptr,Order);
+   Tester.TestClose("Kekule benzene",K.GroupSize(),6.0,1e-12);
+   Tester.Test("Kekule benzene, consistent",Consistent(Kekule,K));
+   const Graph_t Hexagon=Make(6,Ring(6));
+   const Automorphisms<Graph_t> Labeled(Hexagon,[](const int& v){return v==0?1:0;});
+   Tester.TestClose("Labeled ring",Labeled.GroupSize(),2.0,1e-12);
+   Tester.Test("Labeled ring orbits",Labeled.NOrbits()==4 && Labeled.AreEquivalent(1,5) &&
+               !Labeled.AreEquivalent(1,2) && Labeled.Representative(5)==1);
+
+   //Random small graphs against every permutation
+   std::mt19937 gen(1);
+   bool SizeOk=true,OrbitOk=true,MapOk=true;
+   for(size_t t=0;t<200;++t){
+      const int n=3+static_cast<int>(gen()%5);
+      Pairs_t Edges;
+      for(int i=0;i<n;++i)
+         for(int j=i+1;j<n;++j)
+            if(gen()%2)Edges.push_back(std::make_pair(i,j));
+      const Graph_t G=Make(n,Edges);
+      const Automorphisms<Graph_t> A(G);
+      const auto Ref=BruteForce(G,n);
+      SizeOk=SizeOk && std::lround(A.GroupSize())==static_cast<long>(Ref.first);
+      for(int i=0;i<n;++i)
+         for(int j=0;j<n;++j)
+            OrbitOk=OrbitOk && (Ref.second[i].count(j)>0)==A.AreEquivalent(i,j);
+      MapOk=MapOk && Consistent(G,A);
+   }
+   Tester.Test("Random graphs, group order",SizeOk);
+   Tester.Test("Random graphs, orbits",OrbitOk);
+   Tester.Test("Random graphs, generators",MapOk);
+
+   //Molecules: an alkane's ends swap and each carbon's hydrogens are
+   //interchangeable, and every atom of separate C60s is equivalent
+   typedef std::tuple<size_t,size_t> Bond_t;
+   typedef UGraph<size_t,Bond_t> Mol_t;
+   const SyntheticGraph Chain=Alkane(60),Balls=Fullerite(6);
+   const Mol_t H=Chain.Build<Mol_t>(),B=Balls.Build<Mol_t>();
+   const Automorphisms<Mol_t> AH(H,[&](const size_t& i){return size_t(Chain.Elements[i]);});
+   Tester.TestClose("Alkane group order",std::log2(AH.GroupSize()),std::log2(36.0)+59.0,1e-9);
+   Tester.Test("Alkane orbits",AH.NOrbits()==60);
+   const Automorphisms<Mol_t> AB(B);
+   double Fact=1.0;
+   for(int i=2;i<=6;++i)Fact*=i;
+   Tester.TestClose("Fullerite group order",AB.GroupSize(),Fact*std::pow(120.0,6),1e-6*AB.GroupSize());
+   Tester.Test("Fullerite orbits",AB.NOrbits()==1);
+
+   const Graph_t Empty;
+   const Automorphisms<Graph_t> E(Empty);
+   Tester.Test("Empty graph",E.NOrbits()==0 && E.GroupSize()==1.0 && E.Generators().empty());
+
+   return Tester.Result();
+}
@@ -0,0 +1,167 @@
+/*! \file
+ *
+ * \brief Tests of the maximal and bounded clique enumerations
+ */
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <random>
+#include <set>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/Cliques.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+typedef std::set<std::set<int>> Cliques_t;
+
+Graph_t Make(int n,const std::vector<Edge_t>& Edges){
+   Graph_t G;
+   for(int i=0;i<n;++i)G.AddNode(i);
+   G.AddEdge(Edges.begin(),Edges.end());
+   return G;
+}
+
+///The cliques as sets, false if one came back twice
+bool AsSets(const std::vector<std::vector<int>>& Found,Cliques_t& Sets){
+   Sets.clear();
+   for(const auto& c:Found)
+      if(!Sets.insert(std::set<int>(c.begin(),c.end())).second)return false;
+   return true;
+}
+
+///Every clique and every maximal clique, by trying every subset
+void BruteForce(int n,const std::vector<std::vector<bool>>& A,Cliques_t& All,Cliques_t& Maximal){
+   All.clear();
+   Maximal.clear();
+   for(int m=1;m<(1<<n);++m){
+      bool Clique=true;
+      for(int i=0;i<n && Clique;++i)
+         for(int j=i+1;j<n && Clique;++j)
+            Clique=!((m>>i&1) && (m>>j&1) && !A[i][j]);
+      if(!Clique)continue;
+      std::set<int> s;
+      for(int i=0;i<n;++i)if(m>>i&1)s.insert(i);
+      All.insert(s);
+   }
+   for(const auto& s:All){
+      bool IsMaximal=true;
+      for(int v=0;v<n && IsMaximal;++v){
+         if(s.count(v))continue;
+         bool Joins=true;
+         for(int u:s)Joins=Joins && A[u][v];
+         IsMaximal=!Joins;
+      }
+      if(IsMaximal)Maximal.insert(s);
+   }
+}
+
+Cliques_t AtMost(const Cliques_t& C,size_t k){
+   Cliques_t temp;
+   for(const auto& s:C)if(s.size()<=k)temp.insert(s);
+   return temp;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Cliques");
+   parallel::ThreadPool Pool(4);
+
+   //Graphs whose cliques are known
+   std::vector<Edge_t> K5,Petersen;
+   for(int i=0;i<5;++i)
+      for(int j=i+1;j<5;++j)K5.push_back(Edge_t(i,j));
+   for(int i=0;i<5;++i){
+      Petersen.push_back(Edge_t(i,(i+1)%5));
+      Petersen.push_back(Edge_t(i,i+5));
+      Petersen.push_back(Edge_t(5+i,5+(i+2)%5));
+   }
+   const Graph_t Complete=Make(5,K5),P=Make(10,Petersen);
+   const CliqueFinder<Graph_t> CK(Complete,Pool),CP(P,Pool);
+   Tester.Test("K5: one maximal clique",CK.MaximalCliques().size()==1 &&
+               CK.MaximalCliques()[0].size()==5);
+   Tester.Test("K5: every subset is a clique",CK.AllCliques(5).size()==31);
+   Tester.Test("K5: up to pairs",CK.AllCliques(2).size()==15);
+   Tester.Test("K5: none that small are maximal",CK.MaximalCliques(4).empty());
+   Tester.Test("K5: degeneracy",CK.Degeneracy()==4);
+   Tester.Test("Petersen: edges are the maximal cliques",CP.MaximalCliques().size()==15);
+   Tester.Test("Petersen: no triangles",CP.AllCliques(3).size()==25);
+   Tester.Test("Petersen: degeneracy",CP.Degeneracy()==3);
+
+   //Random graphs against every subset, edges in either direction
+   std::mt19937 gen(5);
+   bool MaximalOk=true,BoundedOk=true,AllOk=true,OrderOk=true;
+   for(size_t t=0;t<200;++t){
+      const int n=2+static_cast<int>(gen()%12);
+      const size_t p=gen()%100;
+      std::vector<std::vector<bool>> A(n,std::vector<bool>(n,false));
+      std::vector<Edge_t> Edges;
+      for(int i=0;i<n;++i)
+         for(int j=i+1;j<n;++j)
+            if(gen()%100<p){
+               A[i][j]=A[j][i]=true;
+               Edges.push_back(gen()%2?Edge_t(i,j):Edge_t(j,i));
+            }
+      const Graph_t G=Make(n,Edges);
+      const CliqueFinder<Graph_t> F(G,Pool);
+      const size_t k=1+gen()%5;
+      Cliques_t All,Maximal,Got;
+      BruteForce(n,A,All,Maximal);
+      MaximalOk=MaximalOk && AsSets(F.MaximalCliques(),Got) && Got==Maximal;
+      BoundedOk=BoundedOk && AsSets(F.MaximalCliques(k),Got) && Got==AtMost(Maximal,k);
+      const auto Bounded=F.AllCliques(k);
+      AllOk=AllOk && AsSets(Bounded,Got) && Got==AtMost(All,k);
+      //Each clique's nodes follow the order of the single nodes
+      std::map<int,size_t> Pos;
+      for(size_t q=0;q<Bounded.size();++q)
+         if(Bounded[q].size()==1)Pos[Bounded[q][0]]=q;
+      for(const auto& c:Bounded)
+         for(size_t q=1;q<c.size();++q)OrderOk=OrderOk && Pos.at(c[q-1])<Pos.at(c[q]);
+   }
+   Tester.Test("Random graphs, maximal cliques",MaximalOk);
+   Tester.Test("Random graphs, small maximal cliques",BoundedOk);
+   Tester.Test("Random graphs, all cliques",AllOk);
+   Tester.Test("Random graphs, degeneracy order",OrderOk);
+
+   //An overlap graph of points in a box: same answer on any number of threads
+   std::uniform_real_distribution<double> U(0.0,12.0);
+   const int n=3000;
+   std::vector<std::array<double,3>> x(n);
+   for(auto& r:x)r={U(gen),U(gen),U(gen)};
+   std::vector<Edge_t> Edges;
+   for(int i=0;i<n;++i)
+      for(int j=i+1;j<n;++j){
+         double d=0.0;
+         for(size_t c=0;c<3;++c)d+=(x[i][c]-x[j][c])*(x[i][c]-x[j][c]);
+         if(d<2.0)Edges.push_back(Edge_t(i,j));
+      }
+   const Graph_t Overlaps=Make(n,Edges);
+   parallel::ThreadPool One(1);
+   const CliqueFinder<Graph_t> Serial(Overlaps,One),Threaded(Overlaps,Pool);
+   Tester.Test("Same maximal cliques on 1 and 4 threads",
+               Serial.MaximalCliques()==Threaded.MaximalCliques());
+   const auto Terms=Threaded.AllCliques(3);
+   Tester.Test("Same terms on 1 and 4 threads",Serial.AllCliques(3)==Terms);
+   size_t NPairs=0;
+   for(const auto& c:Terms)NPairs+=c.size()==2;
+   Tester.Test("Every node and edge is a term",NPairs==Edges.size() &&
+               Terms.size()>Edges.size()+n);
+
+   const Graph_t Empty;
+   Tester.Test("Empty graph",CliqueFinder<Graph_t>(Empty,Pool).MaximalCliques().empty() &&
+               CliqueFinder<Graph_t>(Empty,Pool).AllCliques(3).empty());
+   Tester.Test("Size 0",CK.AllCliques(0).empty());
+   const Graph_t Isolated=Make(3,{});
+   Tester.Test("Isolated nodes are maximal",CliqueFinder<Graph_t>(Isolated,Pool).MaximalCliques().size()==3);
+
+   return Tester.Result();
+}
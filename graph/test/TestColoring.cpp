@@ -0,0 +1,144 @@
+/*! \file
+ *
+ * \brief Tests of the node and edge colorings
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/Coloring.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+
+Graph_t Make(int n,const std::vector<Edge_t>& Edges){
+   Graph_t G;
+   for(int i=0;i<n;++i)G.AddNode(i);
+   G.AddEdge(Edges.begin(),Edges.end());
+   return G;
+}
+
+///A ring of n nodes
+Graph_t Ring(int n){
+   std::vector<Edge_t> Edges;
+   for(int i=0;i<n;++i)Edges.push_back(Edge_t(i,(i+1)%n));
+   return Make(n,Edges);
+}
+
+///Every pair of n nodes
+Graph_t Complete(int n){
+   std::vector<Edge_t> Edges;
+   for(int i=0;i<n;++i)
+      for(int j=i+1;j<n;++j)Edges.push_back(Edge_t(i,j));
+   return Make(n,Edges);
+}
+
+///No edge joins two nodes of the same color, and Classes agrees with Color
+bool ValidNodes(const ColorClasses<int>& C,const std::vector<Edge_t>& Edges,size_t n){
+   for(const auto& e:Edges)
+      if(C.Color.at(std::get<0>(e))==C.Color.at(std::get<1>(e)))return false;
+   size_t Total=0;
+   for(size_t c=0;c<C.NColors();++c){
+      if(C.Classes[c].empty())return false;
+      for(int v:C.Classes[c])if(C.Color.at(v)!=c)return false;
+      Total+=C.Classes[c].size();
+   }
+   return Total==n && C.Color.size()==n;
+}
+
+///No two edges at a node share a color
+bool ValidEdges(const ColorClasses<Edge_t>& C,const std::vector<Edge_t>& Edges){
+   std::map<int,std::set<size_t>> At;
+   for(const auto& e:Edges){
+      const size_t c=C.Color.at(e);
+      if(!At[std::get<0>(e)].insert(c).second || !At[std::get<1>(e)].insert(c).second)
+         return false;
+   }
+   return C.Color.size()==Edges.size();
+}
+
+size_t Largest(const ColorClasses<int>& C){
+   size_t m=0;
+   for(const auto& c:C.Classes)m=std::max(m,c.size());
+   return m;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Graph coloring");
+   parallel::ThreadPool Pool(4);
+   const std::vector<ColorMethod> Methods={ColorMethod::Greedy,ColorMethod::JonesPlassmann};
+
+   //Graphs whose chromatic numbers are known
+   for(ColorMethod m:Methods){
+      const std::string Name=m==ColorMethod::Greedy?"Greedy":"Jones-Plassmann";
+      Tester.Test(Name+": odd ring needs 3 colors",
+                  GraphColoring<Graph_t>(Ring(7),Pool).ColorNodes(m).NColors()==3);
+      Tester.Test(Name+": complete graph needs one color each",
+                  GraphColoring<Graph_t>(Complete(6),Pool).ColorNodes(m).NColors()==6);
+      Tester.Test(Name+": edges of K6 need 5 colors at least",
+                  GraphColoring<Graph_t>(Complete(6),Pool).ColorEdges(m).NColors()>=5);
+   }
+   Tester.Test("Greedy: even ring needs 2",GraphColoring<Graph_t>(Ring(8),Pool).ColorNodes().NColors()==2);
+
+   //Random sparse graph, like a large molecule's
+   std::mt19937 gen(3);
+   const int n=2000;
+   std::vector<Edge_t> Edges;
+   std::set<std::pair<int,int>> Seen;
+   std::vector<size_t> Degree(n,0);
+   for(int i=0;i<n;++i)
+      for(int k=0;k<3;++k){
+         const int j=std::uniform_int_distribution<int>(0,n-1)(gen);
+         if(j==i || !Seen.insert(std::make_pair(std::min(i,j),std::max(i,j))).second)continue;
+         Edges.push_back(Edge_t(i,j));
+         ++Degree[i];
+         ++Degree[j];
+      }
+   const size_t MaxDegree=*std::max_element(Degree.begin(),Degree.end());
+   const Graph_t G=Make(n,Edges);
+   const GraphColoring<Graph_t> Coloring(G,Pool);
+
+   for(ColorMethod m:Methods){
+      const std::string Name=m==ColorMethod::Greedy?"Greedy":"Jones-Plassmann";
+      const auto Plain=Coloring.ColorNodes(m,false,7),Balanced=Coloring.ColorNodes(m,true,7);
+      Tester.Test(Name+": valid",ValidNodes(Plain,Edges,n));
+      Tester.Test(Name+": balanced is valid",ValidNodes(Balanced,Edges,n));
+      Tester.Test(Name+": at most max degree + 1 colors",Plain.NColors()<=MaxDegree+1);
+      Tester.Test(Name+": balancing keeps the colors",Balanced.NColors()==Plain.NColors());
+      Tester.Test(Name+": balancing evens the classes",Largest(Balanced)<Largest(Plain) &&
+                  Largest(Balanced)<=(n+Plain.NColors()-1)/Plain.NColors()+1);
+      const auto E=Coloring.ColorEdges(m,true,7);
+      Tester.Test(Name+": edges valid",ValidEdges(E,Edges));
+      Tester.Test(Name+": edge colors between max degree and twice it",
+                  E.NColors()>=MaxDegree && E.NColors()<2*MaxDegree);
+   }
+   Tester.Test("Greedy uses fewer colors than max degree",Coloring.ColorNodes().NColors()<MaxDegree);
+   Tester.Test("Jones-Plassmann is reproducible for a seed",
+               Coloring.ColorNodes(ColorMethod::JonesPlassmann,false,5).Color==
+               Coloring.ColorNodes(ColorMethod::JonesPlassmann,false,5).Color);
+
+   //Edge direction doesn't matter
+   const Graph_t Both=Make(3,{Edge_t(0,1),Edge_t(2,1)});
+   const auto C=GraphColoring<Graph_t>(Both,Pool).ColorNodes();
+   Tester.Test("Direction is ignored",C.Color.at(1)!=C.Color.at(0) && C.Color.at(1)!=C.Color.at(2));
+
+   const Graph_t Empty;
+   Tester.Test("Empty graph",GraphColoring<Graph_t>(Empty,Pool).ColorNodes().NColors()==0 &&
+               GraphColoring<Graph_t>(Empty,Pool).ColorEdges().NColors()==0);
+   const Graph_t Isolated=Make(5,{});
+   Tester.Test("No edges, one color",GraphColoring<Graph_t>(Isolated,Pool).ColorNodes().NColors()==1);
+
+   return Tester.Result();
+}
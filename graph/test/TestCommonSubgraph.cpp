@@ -0,0 +1,171 @@
+/*! \file
+ *
+ * \brief Tests of the maximum common induced subgraph
+ */
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/CommonSubgraph.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<int,int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+
+///Node labels and a dense matrix of edge labels (0 for no edge)
+struct Dense{
+   std::vector<size_t> Label;
+   std::vector<std::vector<int>> A;
+   int N()const{return static_cast<int>(Label.size());}
+};
+
+Dense Random(std::mt19937& gen,int n,size_t NLabels,int NEdgeLabels){
+   Dense temp{std::vector<size_t>(n),std::vector<std::vector<int>>(n,std::vector<int>(n,0))};
+   for(size_t& l:temp.Label)l=gen()%NLabels;
+   for(int i=0;i<n;++i)
+      for(int j=i+1;j<n;++j)
+         if(gen()%2)temp.A[i][j]=temp.A[j][i]=1+static_cast<int>(gen()%NEdgeLabels);
+   return temp;
+}
+
+///Nodes Offset to Offset+n-1, so the two graphs' nodes differ
+Graph_t Build(const Dense& D,int Offset){
+   Graph_t G;
+   for(int i=0;i<D.N();++i)G.AddNode(Offset+i);
+   for(int i=0;i<D.N();++i)
+      for(int j=i+1;j<D.N();++j)
+         if(D.A[i][j])G.AddEdge(Edge_t(Offset+i,Offset+j,D.A[i][j]));
+   return G;
+}
+
+bool Connected(const Dense& D,const std::vector<int>& Nodes){
+   if(Nodes.empty())return true;
+   std::set<int> Seen={Nodes[0]};
+   std::vector<int> Stack={Nodes[0]};
+   while(!Stack.empty()){
+      const int u=Stack.back();
+      Stack.pop_back();
+      for(int v:Nodes)
+         if(D.A[u][v] && Seen.insert(v).second)Stack.push_back(v);
+   }
+   return Seen.size()==Nodes.size();
+}
+
+///Size of the largest common subgraph, trying every partial mapping
+size_t BruteForce(const Dense& G,const Dense& H,bool Conn,std::vector<int>& Map,int i){
+   if(i==G.N()){
+      std::vector<int> Nodes;
+      for(int k=0;k<G.N();++k)if(Map[k]>=0)Nodes.push_back(k);
+      return !Conn || Connected(G,Nodes)?Nodes.size():0;
+   }
+   Map[i]=-1;
+   size_t Best=BruteForce(G,H,Conn,Map,i+1);
+   for(int j=0;j<H.N();++j){
+      bool Ok=G.Label[i]==H.Label[j];
+      for(int k=0;k<i && Ok;++k)
+         Ok=Map[k]!=j && (Map[k]<0 || G.A[i][k]==H.A[j][Map[k]]);
+      if(!Ok)continue;
+      Map[i]=j;
+      Best=std::max(Best,BruteForce(G,H,Conn,Map,i+1));
+   }
+   Map[i]=-1;
+   return Best;
+}
+
+///The mapping is one to one and keeps labels and edges
+bool Valid(const Dense& G,const Dense& H,const std::map<int,int>& M,int Offset){
+   std::set<int> Image;
+   for(const auto& p:M){
+      if(!Image.insert(p.second).second || G.Label[p.first]!=H.Label[p.second-Offset])return false;
+      for(const auto& q:M)
+         if(G.A[p.first][q.first]!=H.A[p.second-Offset][q.second-Offset])return false;
+   }
+   return true;
+}
+
+size_t Order(const Edge_t& e){return std::get<2>(e);}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Maximum common subgraph");
+   parallel::ThreadPool Pool(3);
+
+   //Random labeled graphs against every partial mapping
+   std::mt19937 gen(9);
+   bool SizeOk=true,ValidOk=true,ConnOk=true,OptimalOk=true;
+   for(size_t t=0;t<150;++t){
+      const size_t NLabels=1+gen()%2;
+      const int NEdgeLabels=1+static_cast<int>(gen()%2);
+      const Dense G=Random(gen,2+gen()%6,NLabels,NEdgeLabels);
+      const Dense H=Random(gen,2+gen()%6,NLabels,NEdgeLabels);
+      const Graph_t GG=Build(G,0),GH=Build(H,100);
+      auto Label=[&](const int& v){return v<100?G.Label[v]:H.Label[v-100];};
+      for(bool Conn:{false,true}){
+         MaxCommonSubgraph<Graph_t> MCS(GG,Label,Order,Pool);
+         OptimalOk=OptimalOk && MCS.Run(GH,Conn);
+         std::vector<int> Map(G.N(),-1);
+         SizeOk=SizeOk && MCS.Size()==BruteForce(G,H,Conn,Map,0);
+         ValidOk=ValidOk && Valid(G,H,MCS.Mapping(),100);
+         std::vector<int> Nodes;
+         for(const auto& p:MCS.Mapping())Nodes.push_back(p.first);
+         ConnOk=ConnOk && (!Conn || Connected(G,Nodes));
+      }
+   }
+   Tester.Test("Random graphs, size",SizeOk);
+   Tester.Test("Random graphs, mapping keeps labels and edges",ValidOk);
+   Tester.Test("Random graphs, connected when asked",ConnOk);
+   Tester.Test("Random graphs, searched to the end",OptimalOk);
+
+   //Graphs whose answer is known
+   Dense Ring{std::vector<size_t>(6,0),std::vector<std::vector<int>>(6,std::vector<int>(6,0))};
+   Dense Path=Ring,Triangles=Ring;
+   for(int i=0;i<6;++i){
+      Ring.A[i][(i+1)%6]=Ring.A[(i+1)%6][i]=1;
+      if(i<5)Path.A[i][i+1]=Path.A[i+1][i]=1;
+   }
+   for(int i=0;i<6;++i)
+      for(int j=0;j<6;++j)
+         if(i!=j && i/3==j/3)Triangles.A[i][j]=1;
+   const Graph_t GRing=Build(Ring,0),GPath=Build(Path,100),GTri=Build(Triangles,100);
+   const Graph_t GRing2=Build(Ring,100);
+   MaxCommonSubgraph<Graph_t> FromRing(GRing,nullptr,nullptr,Pool);
+   FromRing.Run(GRing2);
+   Tester.Test("A ring and itself",FromRing.Size()==6 && Valid(Ring,Ring,FromRing.Mapping(),100));
+   FromRing.Run(GPath);
+   Tester.Test("Ring and path share a 5-node path",FromRing.Size()==5);
+   FromRing.Run(GTri);
+   Tester.Test("Ring and two triangles share two edges",FromRing.Size()==4);
+   FromRing.Run(GTri,true);
+   Tester.Test("Connected, only one edge",FromRing.Size()==2);
+
+   //Edge labels: only the single bonds of Kekule benzene match the plain ring
+   Dense Kekule=Ring;
+   for(int i=0;i<6;++i)Kekule.A[i][(i+1)%6]=Kekule.A[(i+1)%6][i]=1+i%2;
+   const Graph_t GKekule=Build(Kekule,100);
+   MaxCommonSubgraph<Graph_t> Labeled(GRing,nullptr,Order,Pool);
+   Labeled.Run(GKekule);
+   Tester.Test("Bond orders leave three atoms",Labeled.Size()==3);
+
+   //A budget of one search node stops early but still maps something valid
+   const Dense Big=Random(gen,14,1,1),Other=Random(gen,14,1,1);
+   const Graph_t GBig=Build(Big,0),GOther=Build(Other,100);
+   MaxCommonSubgraph<Graph_t> Budget(GBig,nullptr,nullptr,Pool);
+   Tester.Test("Budget stops the search",!Budget.Run(GOther,false,1) && !Budget.Optimal());
+   Tester.Test("Budget mapping is valid",Valid(Big,Other,Budget.Mapping(),100));
+   Tester.Test("Full search",Budget.Run(GOther) && Budget.NNodesSearched()>1);
+
+   const Graph_t Empty;
+   MaxCommonSubgraph<Graph_t> None(Empty,nullptr,nullptr,Pool);
+   Tester.Test("Empty graph",None.Run(GRing) && None.Size()==0);
+
+   return Tester.Result();
+}
@@ -0,0 +1,133 @@
+/*! \file
+ *
+ * \brief Tests of running a dependency graph on the thread pool
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/DAGExecutor.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<std::string,std::string> Edge_t;
+typedef Graph<std::string,Edge_t> Graph_t;
+typedef std::tuple<size_t,size_t> IEdge_t;
+typedef Graph<size_t,IEdge_t> IGraph_t;
+
+Graph_t Workflow(){
+   const std::vector<std::string> Nodes={"scf","ints","guess","mp2","grad","cc","report"};
+   const std::vector<Edge_t> Edges={Edge_t("ints","scf"),Edge_t("guess","scf"),
+                                    Edge_t("scf","mp2"),Edge_t("scf","cc"),
+                                    Edge_t("mp2","grad"),Edge_t("cc","report"),
+                                    Edge_t("grad","report")};
+   Graph_t G;
+   G.AddNode(Nodes.begin(),Nodes.end());
+   G.AddEdge(Edges.begin(),Edges.end());
+   return G;
+}
+
+///The nodes in a timeline, sorted
+template<typename Event_t>
+std::vector<std::string> Ran(const std::vector<Event_t>& Timeline){
+   std::vector<std::string> temp;
+   for(const auto& e:Timeline)temp.push_back(e.Node);
+   std::sort(temp.begin(),temp.end());
+   return temp;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("DAG executor");
+   parallel::ThreadPool Pool(4);
+
+   //Every node runs once, after everything it needs has finished
+   const Graph_t G=Workflow();
+   DAGExecutor<Graph_t> Exec(G,Pool);
+   std::mutex Mutex;
+   std::map<std::string,size_t> Count;
+   const auto& Timeline=Exec.Run([&](const std::string& s){
+      std::this_thread::sleep_for(std::chrono::milliseconds(s=="mp2" || s=="cc"?30:2));
+      std::lock_guard<std::mutex> Lock(Mutex);
+      ++Count[s];
+   });
+   Tester.Test("Every node ran once",Count.size()==7 && Timeline.size()==7 &&
+               std::all_of(Count.begin(),Count.end(),[](const std::pair<const std::string,size_t>& c){
+                  return c.second==1;}));
+   std::map<std::string,std::pair<double,double>> When;
+   for(const auto& e:Timeline)When[e.Node]=std::make_pair(e.Start,e.End);
+   bool Ordered=true;
+   const std::vector<Edge_t> Edges={Edge_t("ints","scf"),Edge_t("guess","scf"),
+                                    Edge_t("scf","mp2"),Edge_t("scf","cc"),
+                                    Edge_t("mp2","grad"),Edge_t("cc","report"),
+                                    Edge_t("grad","report")};
+   for(const auto& e:Edges)
+      Ordered=Ordered && When.at(std::get<0>(e)).second<=When.at(std::get<1>(e)).first;
+   Tester.Test("Dependencies are respected",Ordered);
+   bool Sorted=true;
+   for(size_t i=1;i<Timeline.size();++i)Sorted=Sorted && Timeline[i-1].Start<=Timeline[i].Start;
+   Tester.Test("Timeline is sorted by start",Sorted);
+   Tester.Test("mp2 and cc ran at the same time",Exec.MaxConcurrency()>=2 &&
+               When.at("mp2").first<When.at("cc").second &&
+               When.at("cc").first<When.at("mp2").second);
+   Tester.Test("Busy time and makespan",Exec.BusyTime()>=0.06 && Exec.Makespan()<Exec.BusyTime() &&
+               Exec.AverageParallelism()>1.0);
+
+   //A failure skips only the nodes that depend on it
+   Tester.TestThrows("Failure is rethrown",[&]{
+      Exec.Run([](const std::string& s){if(s=="mp2")throw std::runtime_error("mp2 failed");});});
+   Tester.Test("Independent nodes still ran",Ran(Exec.Timeline())==
+               std::vector<std::string>({"cc","guess","ints","scf"}));
+
+   //A wide random DAG: each node checks its predecessors are done
+   std::mt19937 gen(13);
+   const size_t n=400;
+   std::vector<IEdge_t> IEdges;
+   std::vector<std::vector<size_t>> Pred(n);
+   for(size_t j=1;j<n;++j)
+      for(size_t k=0;k<3;++k){
+         const size_t i=std::uniform_int_distribution<size_t>(0,j-1)(gen);
+         if(std::find(Pred[j].begin(),Pred[j].end(),i)!=Pred[j].end())continue;
+         IEdges.push_back(IEdge_t(i,j));
+         Pred[j].push_back(i);
+      }
+   IGraph_t R;
+   for(size_t i=0;i<n;++i)R.AddNode(n-1-i);
+   R.AddEdge(IEdges.begin(),IEdges.end());
+   std::unique_ptr<std::atomic<bool>[]> Done(new std::atomic<bool>[n]);
+   for(size_t i=0;i<n;++i)Done[i]=false;
+   std::atomic<size_t> Early(0);
+   DAGExecutor<IGraph_t> RExec(R,Pool);
+   RExec.Run([&](size_t j){
+      for(size_t i:Pred[j])if(!Done[i])++Early;
+      Done[j]=true;
+   });
+   Tester.Test("Random DAG, all ran",RExec.Timeline().size()==n);
+   Tester.Test("Random DAG, none ran early",Early==0);
+
+   //Runs on the default pool too
+   DAGExecutor<Graph_t> Default(G);
+   Tester.Test("Default pool",Default.Run([](const std::string&){}).size()==7);
+
+   const Graph_t Empty;
+   Tester.Test("Empty graph",DAGExecutor<Graph_t>(Empty,Pool).Run([](const std::string&){}).empty());
+   Graph_t Cycle=Workflow();
+   Cycle.AddEdge(Edge_t("report","ints"));
+   Tester.TestThrows("Cycle",[&]{DAGExecutor<Graph_t> Bad(Cycle,Pool);});
+
+   return Tester.Result();
+}
@@ -0,0 +1,196 @@
+/*! \file
+ *
+ * \brief Tests of the synthetic molecular graphs
+ */
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <set>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/Generators.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+///Bonds between existing atoms, no atom bonded to itself or twice to another
+bool Simple(const SyntheticGraph& G){
+   std::set<std::pair<size_t,size_t>> Seen;
+   for(const auto& e:G.Edges){
+      if(e.first==e.second || e.first>=G.NNodes() || e.second>=G.NNodes())return false;
+      if(!Seen.insert(std::make_pair(std::min(e.first,e.second),
+                                     std::max(e.first,e.second))).second)return false;
+   }
+   return true;
+}
+
+std::vector<size_t> Degrees(const SyntheticGraph& G){
+   std::vector<size_t> temp(G.NNodes(),0);
+   for(const auto& e:G.Edges){
+      ++temp[e.first];
+      ++temp[e.second];
+   }
+   return temp;
+}
+
+///How many atoms of each element have each degree
+std::map<std::pair<int,size_t>,size_t> Histogram(const SyntheticGraph& G){
+   std::map<std::pair<int,size_t>,size_t> temp;
+   const std::vector<size_t> d=Degrees(G);
+   for(size_t i=0;i<G.NNodes();++i)++temp[std::make_pair(G.Elements[i],d[i])];
+   return temp;
+}
+
+size_t Components(const SyntheticGraph& G){
+   std::vector<size_t> Parent(G.NNodes());
+   std::iota(Parent.begin(),Parent.end(),0);
+   auto Find=[&](size_t i){
+      while(Parent[i]!=i)i=Parent[i]=Parent[Parent[i]];
+      return i;
+   };
+   size_t temp=G.NNodes();
+   for(const auto& e:G.Edges){
+      const size_t a=Find(e.first),b=Find(e.second);
+      if(a!=b){
+         Parent[a]=b;
+         --temp;
+      }
+   }
+   return temp;
+}
+
+///Number of independent rings, bonds - atoms + pieces
+size_t NRings(const SyntheticGraph& G){
+   return G.NEdges()+Components(G)-G.NNodes();
+}
+
+///Number of simple cycles of length \p L, each counted once
+size_t NCycles(const SyntheticGraph& G,size_t L){
+   std::vector<std::vector<size_t>> Nbrs(G.NNodes());
+   for(const auto& e:G.Edges){
+      Nbrs[e.first].push_back(e.second);
+      Nbrs[e.second].push_back(e.first);
+   }
+   size_t Count=0;
+   std::vector<size_t> Path;
+   //Cycles whose smallest atom is Path[0], walked both ways
+   std::function<void(size_t)> Walk=[&](size_t v){
+      for(size_t w:Nbrs[v]){
+         if(w==Path[0] && Path.size()==L)++Count;
+         if(w<=Path[0] || Path.size()==L ||
+            std::find(Path.begin(),Path.end(),w)!=Path.end())continue;
+         Path.push_back(w);
+         Walk(w);
+         Path.pop_back();
+      }
+   };
+   for(size_t s=0;s<G.NNodes();++s){
+      Path.assign(1,s);
+      Walk(s);
+   }
+   return Count/2;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Molecular graph generators");
+   typedef std::map<std::pair<int,size_t>,size_t> Hist_t;
+
+   //Alkanes are trees of 4-valent carbons and 1-valent hydrogens
+   const SyntheticGraph Methane=Alkane(1),Decane=Alkane(10);
+   Tester.Test("Methane",Methane.NNodes()==5 && Methane.NEdges()==4 &&
+               Histogram(Methane)==Hist_t({{{6,4},1},{{1,1},4}}));
+   Tester.Test("Decane, C10H22",Decane.NNodes()==32 && Decane.NEdges()==31 && Simple(Decane) &&
+               Histogram(Decane)==Hist_t({{{6,4},10},{{1,1},22}}));
+   Tester.Test("Decane is one tree",Components(Decane)==1 && NRings(Decane)==0);
+   bool Ordered=true;
+   for(size_t i=0;i<10;++i)
+      Ordered=Ordered && Decane.Elements[i==0?0:1+3*i]==6;
+   Tester.Test("Each carbon followed by its hydrogens",Ordered);
+
+   //A protein chain: one piece, valences at most four, reproducible
+   const SyntheticGraph Protein=Polypeptide(1000),Same=Polypeptide(1000),Other=Polypeptide(1000,7);
+   const std::vector<size_t> PD=Degrees(Protein);
+   const double PerResidue=double(Protein.NNodes())/1000;
+   size_t NN=0,NO=0;
+   for(int Z:Protein.Elements){
+      NN+=Z==7;
+      NO+=Z==8;
+   }
+   Tester.Test("Protein is simple and connected",Simple(Protein) && Components(Protein)==1);
+   Tester.Test("Protein valences",*std::max_element(PD.begin(),PD.end())<=4 &&
+               *std::min_element(PD.begin(),PD.end())>=1);
+   Tester.Test("Protein has a backbone N and O per residue",NN>=1000 && NO>=1000);
+   Tester.Test("Protein averages a little under eight atoms per residue",
+               PerResidue>6.5 && PerResidue<8.0);
+   Tester.Test("Protein rings only from Phe and Pro",NRings(Protein)>0 && NRings(Protein)<1000);
+   Tester.Test("Same seed, same protein",Same.Elements==Protein.Elements && Same.Edges==Protein.Edges);
+   Tester.Test("Different seed, different protein",Other.Elements!=Protein.Elements);
+
+   //Diamond: every atom 4-bonded, bonds only between the two sublattices
+   const SyntheticGraph Silicon=DiamondLattice(2,3,2),Diamond=DiamondLattice(2,2,2,6);
+   bool Bipartite=true;
+   for(const auto& e:Silicon.Edges)Bipartite=Bipartite && (e.first%8<4)!=(e.second%8<4);
+   Tester.Test("Diamond lattice counts",Silicon.NNodes()==96 && Silicon.NEdges()==192 &&
+               Simple(Silicon) && Histogram(Silicon)==Hist_t({{{14,4},96}}));
+   Tester.Test("Diamond lattice is connected",Components(Silicon)==1);
+   Tester.Test("Diamond lattice sublattices",Bipartite);
+   Tester.Test("Diamond lattice element",Histogram(Diamond)==Hist_t({{{6,4},64}}));
+   Tester.Test("Diamond has no rings smaller than six",NCycles(Diamond,4)==0 &&
+               NCycles(Diamond,6)>0);
+
+   //Random graphs keep to the degree limit and reach the mean when they can
+   const SyntheticGraph R=RandomGraph(1000),RAgain=RandomGraph(1000);
+   const std::vector<size_t> RD=Degrees(R);
+   Tester.Test("Random graph, mean degree",R.NNodes()==1000 && R.NEdges()==1500 && Simple(R));
+   Tester.Test("Random graph, degree limit",*std::max_element(RD.begin(),RD.end())<=4);
+   Tester.Test("Random graph, reproducible",RAgain.Edges==R.Edges);
+   const SyntheticGraph Limited=RandomGraph(10,1,3.0);
+   const std::vector<size_t> LD=Degrees(Limited);
+   Tester.Test("Random graph, unreachable mean",Limited.NEdges()<=5 && Simple(Limited) &&
+               *std::max_element(LD.begin(),LD.end())<=1);
+   Tester.Test("Random graph of one atom",RandomGraph(1).NNodes()==1 && RandomGraph(1).NEdges()==0);
+
+   //Nanotube: n hexagons around per pair of rings, plus the ring around
+   const SyntheticGraph Tube=Nanotube(5,4),Ring=Nanotube(4,1);
+   Tester.Test("Nanotube counts",Tube.NNodes()==50 && Tube.NEdges()==65 && Simple(Tube) &&
+               Histogram(Tube)==Hist_t({{{6,3},40},{{1,1},10}}));
+   Tester.Test("Nanotube rings",Components(Tube)==1 && NRings(Tube)==16 && NCycles(Tube,6)==15);
+   Tester.Test("One ring of a nanotube",Ring.NNodes()==16 && Ring.NEdges()==16 &&
+               Histogram(Ring)==Hist_t({{{6,3},8},{{1,1},8}}));
+
+   //C60: 12 pentagons, 20 hexagons, nothing smaller
+   const SyntheticGraph C60=Fullerene(),Solid=Fullerite(3);
+   Tester.Test("C60 counts",C60.NNodes()==60 && C60.NEdges()==90 && Simple(C60) &&
+               Histogram(C60)==Hist_t({{{6,3},60}}));
+   Tester.Test("C60 faces",NCycles(C60,3)==0 && NCycles(C60,4)==0 && NCycles(C60,5)==12 &&
+               NCycles(C60,6)==20 && NRings(C60)==31);
+   Tester.Test("Fullerite is separate molecules",Solid.NNodes()==180 && Solid.NEdges()==270 &&
+               Simple(Solid) && Components(Solid)==3);
+
+   //Build makes the same graph
+   typedef std::tuple<size_t,size_t> Bond_t;
+   typedef UGraph<size_t,Bond_t> Mol_t;
+   typedef Graph<size_t,Bond_t> DMol_t;
+   const Mol_t G=C60.Build<Mol_t>();
+   const DMol_t D=Tube.Build<DMol_t>();
+   bool Bonded=true;
+   for(const auto& e:C60.Edges)Bonded=Bonded && G.AreConn(e.first,e.second);
+   for(const auto& e:Tube.Edges)Bonded=Bonded && D.AreConn(e.first,e.second);
+   Tester.Test("Build",G.NNodes()==60 && G.NEdges()==90 && D.NNodes()==50 &&
+               D.NEdges()==65 && Bonded);
+
+   SyntheticGraph Two=Methane;
+   Two.Append(Decane);
+   Tester.Test("Append numbers after",Two.NNodes()==37 && Two.NEdges()==35 &&
+               Two.Edges[4]==std::make_pair(size_t(5),size_t(6)) && Components(Two)==2);
+
+   return Tester.Result();
+}
@@ -0,0 +1,171 @@
+/*! \file
+ *
+ * \brief Tests of induced subgraph views
+ */
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/BFS.hpp"
+#include "pulsar/datastore/graph/FindSubGraph.hpp"
+#include "pulsar/datastore/graph/InducedSubgraph.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+typedef InducedSubgraph<Graph_t> View_t;
+
+///The edges of a graph or view, as a set
+template<typename T>
+std::set<Edge_t> EdgeSet(const T& G){
+   std::set<Edge_t> temp;
+   for(auto It=G.EdgeBegin();It!=G.EdgeEnd();++It)temp.insert(*It);
+   return temp;
+}
+
+template<typename T>
+std::set<int> NodeSet(const T& G){
+   std::set<int> temp;
+   for(auto It=G.NodeBegin();It!=G.NodeEnd();++It)temp.insert(*It);
+   return temp;
+}
+
+///The matches of a search, with each mapping as a set of pairs
+std::set<std::set<std::pair<int,int>>> Matches(const FindSubGraph<Graph_t>& F){
+   std::set<std::set<std::pair<int,int>>> temp;
+   for(size_t i=0;i<F.NMatches();++i)
+      temp.insert(std::set<std::pair<int,int>>(F.Match(i).begin(),F.Match(i).end()));
+   return temp;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Induced subgraph");
+
+   //A chain 0-1-2-3-4-5 with a triangle 2-6-7 hanging off it
+   Graph_t G;
+   for(int i=0;i<8;++i)G.AddNode(i);
+   const std::vector<Edge_t> Edges={Edge_t(0,1),Edge_t(1,2),Edge_t(2,3),Edge_t(3,4),
+                                    Edge_t(4,5),Edge_t(2,6),Edge_t(6,7),Edge_t(7,2)};
+   G.AddEdge(Edges.begin(),Edges.end());
+   const std::vector<int> Nodes={1,2,3,6,7,3};
+   const View_t V(G,Nodes.begin(),Nodes.end());
+
+   Tester.Test("Counts, repeats ignored",V.NNodes()==5 && V.NEdges()==5);
+   Tester.Test("Nodes",NodeSet(V)==std::set<int>({1,2,3,6,7}));
+   Tester.Test("Edges with both ends in",EdgeSet(V)==std::set<Edge_t>(
+               {Edge_t(1,2),Edge_t(2,3),Edge_t(2,6),Edge_t(6,7),Edge_t(7,2)}));
+   std::vector<int> Conn=V.ConNodes(2);
+   std::sort(Conn.begin(),Conn.end());
+   Tester.Test("Neighbors",Conn==std::vector<int>({3,6}) && V.NEdges(2)==2 && V.NInEdges(2)==2);
+   Tester.Test("HasNode",V.HasNode(1) && !V.HasNode(0) && !V.HasNode(42));
+   Tester.Test("AreConn",V.AreConn(2,3) && !V.AreConn(3,4) && !V.AreConn(0,1));
+   Tester.TestThrows("A node outside the view",[&]{V.ConNodes(4);});
+   Tester.Test("Full graph",&V.FullGraph()==&G);
+
+   //BFS stays inside: without 2, the view {0,1,3,4} is two pieces
+   BFS<View_t> Search(V);
+   Search.Run(1);
+   Tester.Test("BFS reaches the view",Search.WasSeen(7) && Search.WasSeen(3));
+   const std::vector<int> Split={0,1,3,4};
+   const View_t Pieces(G,Split.begin(),Split.end());
+   BFS<View_t> SplitSearch(Pieces);
+   SplitSearch.Run(0);
+   Tester.Test("BFS stays in the view",SplitSearch.WasSeen(1) && !SplitSearch.WasSeen(3) &&
+               !SplitSearch.WasSeen(4));
+   Tester.TestThrows("BFS of a node outside the view",[&]{SplitSearch.WasSeen(2);});
+
+   //The same view from a mask, a copy, and a materialized copy
+   std::vector<bool> Mask(8,false);
+   for(int i:Nodes)Mask[i]=true;
+   const View_t FromMask(G,Mask),Copy(V);
+   Tester.Test("From a mask",NodeSet(FromMask)==NodeSet(V) && EdgeSet(FromMask)==EdgeSet(V));
+   Tester.Test("Copy",NodeSet(Copy)==NodeSet(V) && EdgeSet(Copy)==EdgeSet(V) && Copy.NNodes()==5);
+   Tester.TestThrows("Mask of the wrong length",[&]{View_t Bad(G,std::vector<bool>(3,true));});
+   const Graph_t M=V.Materialize();
+   Tester.Test("Materialize",NodeSet(M)==NodeSet(V) && EdgeSet(M)==EdgeSet(V) &&
+               M.NNodes()==5 && M.AreConn(7,2));
+
+   //FindSubGraph with a view for either graph: a view as the pattern has to
+   //give the same matches as its copy
+   Graph_t Path;
+   for(int i:{3,2,1})Path.AddNode(i);
+   Path.AddEdge(Edge_t(1,2));
+   Path.AddEdge(Edge_t(2,3));
+   const std::vector<int> PathNodes={3,2,1};
+   const View_t Pattern(G,PathNodes.begin(),PathNodes.end());
+   FindSubGraph<Graph_t> InFull(G);
+   const bool Found=InFull.Run(Pattern);
+   const auto ViewMatches=Matches(InFull);
+   InFull.Run(Pattern.Materialize());
+   Tester.Test("View as the pattern",Found && ViewMatches==Matches(InFull));
+   Tester.Test("View pattern finds itself",ViewMatches.count({{1,1},{2,2},{3,3}})==1);
+   InFull.Run(Path);
+   Tester.Test("View pattern matches like a graph",ViewMatches==Matches(InFull));
+   Tester.Test("Stop on the first match",InFull.Run(Pattern,true) && InFull.NMatches()==1);
+
+   Graph_t Triangle;
+   for(int i:{10,11,12})Triangle.AddNode(i);
+   Triangle.AddEdge(Edge_t(10,11));
+   Triangle.AddEdge(Edge_t(11,12));
+   Triangle.AddEdge(Edge_t(12,10));
+   auto Any=[](const int&,const int&){return true;};
+   auto AnyEdge=[](const Edge_t&,const Edge_t&){return true;};
+   //The triangles are directed cycles, so each matches in three rotations
+   FindSubGraph<View_t> InView(V,Any,AnyEdge);
+   Tester.Test("View as the graph searched",InView.Run(Triangle) && InView.NMatches()==3);
+   std::vector<bool> NoSix(8,true);
+   NoSix[6]=false;
+   const View_t Broken(G,NoSix);
+   FindSubGraph<View_t> InBroken(Broken,Any,AnyEdge);
+   Tester.Test("Nothing outside the view matches",!InBroken.Run(Triangle));
+   const std::vector<int> TriNodes={2,6,7};
+   const View_t TriView(G,TriNodes.begin(),TriNodes.end());
+   Tester.Test("Views for both",InView.Run(TriView) && InView.NMatches()==3);
+
+   //Random graphs against filtering the edges by hand
+   std::mt19937 gen(4);
+   bool NodesOk=true,EdgesOk=true,CopyOk=true;
+   for(size_t t=0;t<50;++t){
+      const int n=30;
+      Graph_t R;
+      for(int i=0;i<n;++i)R.AddNode(i);
+      std::vector<Edge_t> REdges;
+      for(int i=0;i<n;++i)
+         for(int j=0;j<n;++j)
+            if(i!=j && gen()%10==0)REdges.push_back(Edge_t(i,j));
+      R.AddEdge(REdges.begin(),REdges.end());
+      std::vector<bool> In(n);
+      std::set<int> Want;
+      for(int i=0;i<n;++i)
+         if((In[i]=gen()%2))Want.insert(i);
+      std::set<Edge_t> WantEdges;
+      for(const auto& e:REdges)
+         if(In[std::get<0>(e)] && In[std::get<1>(e)])WantEdges.insert(e);
+      const View_t RV(R,In);
+      NodesOk=NodesOk && NodeSet(RV)==Want && RV.NNodes()==Want.size();
+      EdgesOk=EdgesOk && EdgeSet(RV)==WantEdges && RV.NEdges()==WantEdges.size();
+      const Graph_t RM=RV.Materialize();
+      CopyOk=CopyOk && NodeSet(RM)==Want && EdgeSet(RM)==WantEdges;
+   }
+   Tester.Test("Random graphs, nodes",NodesOk);
+   Tester.Test("Random graphs, edges",EdgesOk);
+   Tester.Test("Random graphs, materialized",CopyOk);
+
+   const std::vector<int> None;
+   const View_t Empty(G,None.begin(),None.end());
+   Tester.Test("Empty view",Empty.NNodes()==0 && Empty.NEdges()==0 &&
+               Empty.NodeBegin()==Empty.NodeEnd() && Empty.Materialize().NNodes()==0);
+
+   return Tester.Result();
+}
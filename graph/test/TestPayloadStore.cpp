@@ -0,0 +1,184 @@
+/*! \file
+ *
+ * \brief Tests of PayloadStore and of the Graph that keeps its nodes and
+ *        edges in it
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/PayloadStore.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef PayloadStore<std::string,int> Store_t;
+
+///A payload that counts how many copies of it are alive
+struct Counted{
+   static int Live;
+   std::string Name;
+   Counted(const std::string& N):Name(N){++Live;}
+   Counted(const Counted& Other):Name(Other.Name){++Live;}
+   Counted& operator=(const Counted&)=default;
+   ~Counted(){--Live;}
+   bool operator<(const Counted& Other)const{return Name<Other.Name;}
+   bool operator==(const Counted& Other)const{return Name==Other.Name;}
+};
+int Counted::Live=0;
+
+///The lookup's contents, in order
+std::vector<std::pair<std::string,int>> Contents(const Store_t& S){
+   std::vector<std::pair<std::string,int>> temp;
+   S.ForEach([&](const std::string& s,int h){temp.push_back(std::make_pair(s,h));});
+   return temp;
+}
+
+typedef std::tuple<int,int> Edge_t;
+typedef Graph<int,Edge_t> Graph_t;
+
+template<typename T>
+std::set<Edge_t> EdgeSet(const T& G){
+   std::set<Edge_t> temp;
+   for(auto It=G.EdgeBegin();It!=G.EdgeEnd();++It)temp.insert(*It);
+   return temp;
+}
+
+template<typename T>
+std::set<int> NodeSet(const T& G){
+   std::set<int> temp;
+   for(auto It=G.NodeBegin();It!=G.NodeEnd();++It)temp.insert(*It);
+   return temp;
+}
+
+///The graph has exactly these nodes and edges, and every lookup agrees
+bool Matches(const Graph_t& G,const std::set<int>& Nodes,const std::set<Edge_t>& Edges){
+   if(NodeSet(G)!=Nodes || EdgeSet(G)!=Edges || G.NNodes()!=Nodes.size() ||
+      G.NEdges()!=Edges.size())return false;
+   for(int i:Nodes){
+      std::set<int> Want;
+      for(const auto& e:Edges)if(std::get<0>(e)==i)Want.insert(std::get<1>(e));
+      const std::vector<int> Got=G.ConNodes(i);
+      if(std::set<int>(Got.begin(),Got.end())!=Want || G.NEdges(i)!=Want.size())return false;
+      for(int j:Nodes)
+         if(G.AreConn(i,j)!=(Edges.count(Edge_t(i,j))>0))return false;
+   }
+   return true;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Payload store");
+
+   //The store on its own
+   Store_t S;
+   const size_t b=S.Add("b"),a=S.Add("a"),c=S.Add("c");
+   S.Map(b,20);
+   S.Map(a,10);
+   S.Map(c,30);
+   Tester.Test("Slots in order added",a==1 && b==0 && c==2 && S[a]=="a");
+   Tester.Test("Lookup",S.at("a")==10 && S.at("c")==30 && S.size()==3);
+   Tester.Test("Count",S.count("b") && !S.count("d"));
+   Tester.TestThrows("Missing object",[&]{S.at("d");});
+   Tester.Test("ForEach is sorted",Contents(S)==std::vector<std::pair<std::string,int>>(
+               {{"a",10},{"b",20},{"c",30}}));
+   S.Update(b,21);
+   Tester.Test("Update",S.at("b")==21);
+
+   //An equal object takes over the lookup; the old one can't remove it
+   const size_t b2=S.Add("b");
+   S.Map(b2,22);
+   Tester.Test("Equal object replaces",S.at("b")==22 && S.size()==3 && S[b]=="b");
+   S.Update(b,23);
+   S.Erase(b);
+   Tester.Test("Old slot leaves the lookup alone",S.at("b")==22 && S.size()==3);
+   Tester.Test("Freed slot is reused",S.Add("d")==b);
+   S.Map(b,40);
+   S.Erase(a);
+   Tester.Test("Erase",!S.count("a") && S.size()==3);
+
+   //Copies own their objects, moves keep them
+   Store_t Copy(S);
+   S.Erase(c);
+   Tester.Test("Copy is independent",Copy.at("c")==30 && !S.count("c"));
+   Store_t Assigned;
+   Assigned=Copy;
+   Copy.Erase(b2);
+   Tester.Test("Assignment",Assigned.at("b")==22 && Assigned.at("d")==40 && !Copy.count("b"));
+   const std::string* Where=&Assigned[b2];
+   Store_t Moved(std::move(Assigned));
+   Tester.Test("Move keeps the objects in place",&Moved[b2]==Where && Moved.at("b")==22);
+
+   //A graph stores each node and edge once
+   {
+      typedef Graph<Counted> CGraph_t;
+      typedef CGraph_t::EdgeType CEdge_t;
+      const int n=50;
+      CGraph_t G;
+      for(int i=0;i<n;++i)G.AddNode(Counted("atom "+std::to_string(i)));
+      const int NodeCopies=Counted::Live;
+      for(int i=0;i+1<n;++i)
+         G.AddEdge(CEdge_t(Counted("atom "+std::to_string(i)),Counted("atom "+std::to_string(i+1))));
+      Tester.Test("One copy of each node",NodeCopies==n);
+      Tester.Test("One copy of each edge",Counted::Live==n+2*(n-1));
+      CGraph_t Copy(G);
+      Tester.Test("A copy doubles that",Counted::Live==2*(n+2*(n-1)));
+      G.RemoveNode(Counted("atom 0"));
+      Tester.Test("Removing destroys",Counted::Live==2*(n+2*(n-1))-3 &&
+                  Copy.AreConn(Counted("atom 0"),Counted("atom 1")));
+   }
+   Tester.Test("Nothing leaks",Counted::Live==0);
+
+   //Random adds and removes against sets of nodes and edges
+   std::mt19937 gen(8);
+   Graph_t G;
+   std::set<int> Nodes;
+   std::set<Edge_t> Edges;
+   bool Ok=true;
+   for(size_t t=0;t<2000;++t){
+      const int i=gen()%40,j=gen()%40;
+      switch(gen()%5){
+         case 0:
+         case 1:
+            if(Nodes.insert(i).second)G.AddNode(i);
+            break;
+         case 2:
+            if(Nodes.count(i) && Nodes.count(j) && i!=j && Edges.insert(Edge_t(i,j)).second)
+               G.AddEdge(Edge_t(i,j));
+            break;
+         case 3:
+            if(!Nodes.count(i))break;
+            G.RemoveNode(i);
+            Nodes.erase(i);
+            for(auto It=Edges.begin();It!=Edges.end();)
+               It=std::get<0>(*It)==i || std::get<1>(*It)==i?Edges.erase(It):++It;
+            break;
+         case 4:
+            if(Edges.empty())break;
+            auto It=Edges.begin();
+            std::advance(It,gen()%Edges.size());
+            if(gen()%2)G.RemoveEdge(*It);
+            else G.RemoveEdge(std::get<0>(*It),std::get<1>(*It));
+            Edges.erase(It);
+            break;
+      }
+      if(t%100==0)Ok=Ok && Matches(G,Nodes,Edges);
+   }
+   Tester.Test("Random adds and removes",Ok && Matches(G,Nodes,Edges));
+   Graph_t GCopy(G),GAssigned;
+   GAssigned=G;
+   if(!Nodes.empty())G.RemoveNode(*Nodes.begin());
+   Tester.Test("Graph copies",Matches(GCopy,Nodes,Edges) && Matches(GAssigned,Nodes,Edges));
+   Tester.TestThrows("Removing a missing node",[&]{G.RemoveNode(1000);});
+
+   return Tester.Result();
+}
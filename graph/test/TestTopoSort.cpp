@@ -0,0 +1,138 @@
+/*! \file
+ *
+ * \brief Tests of the topological order, levels and critical path
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+
+#include "pulsar/datastore/graph/Graph.hpp"
+#include "pulsar/datastore/graph/TopoSort.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::datastore::LibGraph;
+
+namespace {
+
+typedef std::tuple<std::string,std::string> Edge_t;
+typedef Graph<std::string,Edge_t> Graph_t;
+typedef std::tuple<size_t,size_t> IEdge_t;
+typedef Graph<size_t,IEdge_t> IGraph_t;
+
+///A small module workflow: two setup steps, an SCF, two methods on it
+Graph_t Workflow(){
+   const std::vector<std::string> Nodes={"scf","ints","guess","mp2","grad","cc","report"};
+   const std::vector<Edge_t> Edges={Edge_t("ints","scf"),Edge_t("guess","scf"),
+                                    Edge_t("scf","mp2"),Edge_t("scf","cc"),
+                                    Edge_t("mp2","grad"),Edge_t("cc","report"),
+                                    Edge_t("grad","report")};
+   Graph_t G;
+   G.AddNode(Nodes.begin(),Nodes.end());
+   G.AddEdge(Edges.begin(),Edges.end());
+   return G;
+}
+
+///True if every edge goes forward in Order
+template<typename Node_t>
+bool IsTopological(const std::vector<Node_t>& Order,
+                   const std::vector<std::tuple<Node_t,Node_t>>& Edges){
+   std::map<Node_t,size_t> Pos;
+   for(size_t i=0;i<Order.size();++i)Pos[Order[i]]=i;
+   for(const auto& e:Edges)
+      if(Pos.at(std::get<0>(e))>=Pos.at(std::get<1>(e)))return false;
+   return true;
+}
+
+///Cost of the most expensive path starting at i, trying every path
+double LongestFrom(size_t i,const std::vector<std::vector<size_t>>& Succ,
+                   const std::vector<double>& Cost){
+   double Best=0.0;
+   for(size_t j:Succ[i])Best=std::max(Best,LongestFrom(j,Succ,Cost));
+   return Cost[i]+Best;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+   UnitTest Tester("Topological sort");
+
+   const Graph_t G=Workflow();
+   const TopoSort<Graph_t> Sort(G);
+   Tester.Test("Order, ties broken by insertion",Sort.Order()==
+               std::vector<std::string>({"ints","guess","scf","mp2","cc","grad","report"}));
+   Tester.Test("Levels",Sort.Levels()==std::vector<std::vector<std::string>>(
+               {{"ints","guess"},{"scf"},{"mp2","cc"},{"grad"},{"report"}}));
+
+   std::map<std::string,double> Cost={{"scf",3},{"ints",2},{"guess",1},{"mp2",4},
+                                      {"grad",2},{"cc",5},{"report",1}};
+   const auto Path=Sort.CriticalPath([&](const std::string& s){return Cost.at(s);});
+   Tester.Test("Critical path",Path.Path==
+               std::vector<std::string>({"ints","scf","mp2","grad","report"}));
+   Tester.TestClose("Critical path length",Path.Length,12.0,0.0);
+   Tester.TestClose("Work",Path.Work,18.0,0.0);
+   Tester.TestClose("Parallelism",Path.Parallelism(),1.5,1e-15);
+   Tester.TestClose("Earliest start",Path.EarliestStart.at("report"),11.0,0.0);
+   Tester.Test("No slack on the critical path",Path.Slack.at("mp2")==0.0 &&
+               Path.Slack.at("scf")==0.0);
+   Tester.Test("Slack off it",Path.Slack.at("cc")==1.0 && Path.Slack.at("guess")==1.0);
+
+   //Random DAGs against trying every path: edges only go from lower to
+   //higher rank, with the ranks shuffled so the node order doesn't help
+   std::mt19937 gen(11);
+   bool OrderOk=true,LengthOk=true,LevelOk=true;
+   for(size_t t=0;t<20;++t){
+      const size_t n=14;
+      std::vector<size_t> Rank(n);
+      for(size_t i=0;i<n;++i)Rank[i]=i;
+      std::shuffle(Rank.begin(),Rank.end(),gen);
+      std::vector<IEdge_t> Edges;
+      std::vector<std::vector<size_t>> Succ(n);
+      std::bernoulli_distribution Coin(0.25);
+      for(size_t i=0;i<n;++i)
+         for(size_t j=0;j<n;++j)
+            if(Rank[i]<Rank[j] && Coin(gen)){
+               Edges.push_back(IEdge_t(i,j));
+               Succ[i].push_back(j);
+            }
+      std::vector<double> C(n);
+      for(double& c:C)c=std::uniform_real_distribution<double>(0.0,5.0)(gen);
+      IGraph_t R;
+      for(size_t i=0;i<n;++i)R.AddNode(i);
+      R.AddEdge(Edges.begin(),Edges.end());
+      const TopoSort<IGraph_t> RSort(R);
+      OrderOk=OrderOk && RSort.Order().size()==n && IsTopological(RSort.Order(),Edges);
+      double Longest=0.0;
+      for(size_t i=0;i<n;++i)Longest=std::max(Longest,LongestFrom(i,Succ,C));
+      const auto RPath=RSort.CriticalPath([&](size_t i){return C[i];});
+      double PathCost=0.0;
+      for(size_t i:RPath.Path)PathCost+=C[i];
+      LengthOk=LengthOk && std::fabs(RPath.Length-Longest)<1e-12 &&
+               std::fabs(PathCost-Longest)<1e-12;
+      //Every edge goes up at least one level
+      std::map<size_t,size_t> Level;
+      const auto Levels=RSort.Levels();
+      for(size_t l=0;l<Levels.size();++l)
+         for(size_t i:Levels[l])Level[i]=l;
+      for(const auto& e:Edges)
+         LevelOk=LevelOk && Level.at(std::get<0>(e))<Level.at(std::get<1>(e));
+   }
+   Tester.Test("Random DAGs, order",OrderOk);
+   Tester.Test("Random DAGs, critical path",LengthOk);
+   Tester.Test("Random DAGs, levels",LevelOk);
+
+   const Graph_t Empty;
+   Tester.Test("Empty graph",TopoSort<Graph_t>(Empty).Order().empty() &&
+               TopoSort<Graph_t>(Empty).CriticalPath([](const std::string&){return 1.0;}).Length==0.0);
+
+   Graph_t Cycle=Workflow();
+   Cycle.AddEdge(Edge_t("report","scf"));
+   Tester.TestThrows("Cycle",[&]{TopoSort<Graph_t> Bad(Cycle);});
+   Tester.TestThrows("Negative cost",[&]{Sort.CriticalPath([](const std::string&){return -1.0;});});
+
+   return Tester.Result();
+}
@@ -0,0 +1,185 @@
+/*! \file
+ *
+ * \brief Where the pages of large matrices are placed in memory
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef PULSAR_HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+#include "pulsar/math/AllocationPolicy.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+namespace {
+
+std::atomic<int> placement(static_cast<int>(PagePlacement::Default));
+std::atomic<bool> hugepages(false);
+std::atomic<size_t> minbytes(AllocationPolicy().MinBytes);
+
+size_t PageSize(void)
+{
+#ifdef __linux__
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page;
+#else
+    return 4096;
+#endif
+}
+
+///The whole pages inside [p, p+n), as madvise and mbind want
+bool PageRange(void * p, size_t n, void *& start, size_t & len)
+{
+#ifdef __linux__
+    const uintptr_t page = PageSize();
+    const uintptr_t b = reinterpret_cast<uintptr_t>(p);
+    const uintptr_t first = (b + page - 1) / page * page;
+    const uintptr_t last = (b + n) / page * page;
+    if(last <= first)
+        return false;
+    start = reinterpret_cast<void *>(first);
+    len = last - first;
+    return true;
+#else
+    (void)p; (void)n; (void)start; (void)len;
+    return false;
+#endif
+}
+
+void AdviseHugePages(void * p, size_t n)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    void * start;
+    size_t len;
+    if(PageRange(p, n, start, len))
+        madvise(start, len, MADV_HUGEPAGE);  //Only a hint, failure is fine
+#else
+    (void)p; (void)n;
+#endif
+}
+
+///Returns true if the pages were interleaved
+bool Interleave(void * p, size_t n)
+{
+#ifdef PULSAR_HAVE_LIBNUMA
+    void * start;
+    size_t len;
+    if(numa_available() < 0 || !PageRange(p, n, start, len))
+        return false;
+    numa_interleave_memory(start, len, numa_all_nodes_ptr);
+    return true;
+#else
+    (void)p; (void)n;
+    return false;
+#endif
+}
+
+} // close anonymous namespace
+
+
+void SetAllocationPolicy(const AllocationPolicy & Policy)
+{
+    placement = static_cast<int>(Policy.Placement);
+    hugepages = Policy.HugePages;
+    minbytes = Policy.MinBytes;
+}
+
+AllocationPolicy GetAllocationPolicy(void)
+{
+    AllocationPolicy Policy;
+    Policy.Placement = static_cast<PagePlacement>(placement.load());
+    Policy.HugePages = hugepages;
+    Policy.MinBytes = minbytes;
+    return Policy;
+}
+
+
+namespace detail{
+
+void * AllocatePlaced(size_t Bytes)
+{
+#ifdef __linux__
+    const PagePlacement where = static_cast<PagePlacement>(placement.load());
+    const bool huge = hugepages;
+    if(Bytes == 0 || Bytes < minbytes || (where == PagePlacement::Default && !huge))
+        return nullptr;
+
+    void * p = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        throw std::bad_alloc();
+
+    //Both have to happen before the first write
+    if(huge)
+        AdviseHugePages(p, Bytes);
+    if(where == PagePlacement::Interleave)
+        Interleave(p, Bytes);
+    return p;
+#else
+    //Without mmap there's no control over the pages
+    (void)Bytes;
+    return nullptr;
+#endif
+}
+
+void FreePlaced(void * Data, size_t Bytes)
+{
+#ifdef __linux__
+    munmap(Data, Bytes);
+#else
+    (void)Data; (void)Bytes;
+#endif
+}
+
+bool PlaceRows(void * Data, size_t NRows, size_t RowBytes, const void * Src)
+{
+    const size_t bytes = NRows * RowBytes;
+    const PagePlacement where = static_cast<PagePlacement>(placement.load());
+    if(bytes == 0 || where == PagePlacement::Default)
+        return false;
+
+    char * dst = static_cast<char *>(Data);
+    const char * src = static_cast<const char *>(Src);
+
+    //One contiguous block of rows per thread.  With fewer rows than threads
+    //(e.g. a SimpleVector) the bytes are split on page boundaries instead.
+    //Which thread gets which block is up to the scheduler (see
+    //AllocationPolicy).
+    const size_t nthreads = parallel::NumThreads();
+    const size_t rows = (NRows + nthreads - 1) / nthreads;
+    const size_t page = PageSize();
+    auto Boundary = [&](size_t b)
+    {
+        if(NRows >= nthreads)
+            return std::min(b * rows, NRows) * RowBytes;
+        return std::min((b * bytes / nthreads + page - 1) / page * page, bytes);
+    };
+    parallel::ParallelFor(0, nthreads, [&](size_t b)
+    {
+        const size_t b0 = Boundary(b), b1 = Boundary(b + 1);
+        if(b1 <= b0)
+            return;
+        if(src)
+            std::memcpy(dst + b0, src + b0, b1 - b0);
+        else
+            std::memset(dst + b0, 0, b1 - b0);
+    }, 1);
+    return true;
+}
+
+} // close namespace detail
+
+} // close namespace math
+} // close namespace pulsar
@@ -0,0 +1,124 @@
+/*! \file
+ *
+ * \brief Where the pages of large matrices are placed in memory
+ */
+
+#ifndef PULSAR_GUARD_MATH__ALLOCATIONPOLICY_HPP_
+#define PULSAR_GUARD_MATH__ALLOCATIONPOLICY_HPP_
+
+#include <cstddef>
+#include <memory>
+
+namespace pulsar{
+namespace math{
+
+/*! \brief How the pages of a new matrix are spread over NUMA nodes
+ *
+ * Linux puts a page on the NUMA node of the thread that first writes it.
+ * If one thread fills a large matrix, all of it ends up on that thread's
+ * socket and parallel kernels on the other sockets read it over the
+ * interconnect.
+ */
+enum class PagePlacement
+{
+    Default,     //!< Leave it to whoever writes the matrix first
+    FirstTouch,  //!< Fill the matrix in row blocks, one per pool thread
+    Interleave   //!< Round-robin the pages over all nodes (needs libnuma)
+};
+
+/*! \brief How SimpleMatrix allocates large matrices
+ *
+ * With anything other than the defaults, a new SimpleMatrix of at least
+ * \p MinBytes (and a type with a trivial default constructor, e.g. float
+ * and double) gets its own pages straight from mmap, so no other data
+ * shares them and none of them has been written yet.  With FirstTouch or
+ * Interleave it is then zeroed by the threads of the default pool, each
+ * writing a contiguous block of rows.  Copies are made the same way.
+ *
+ * FirstTouch is best-effort.  The blocks are handed out like any other
+ * ParallelFor, so which thread writes which block (and hence which node
+ * its pages end up on) changes from run to run, and a thread may write
+ * more than one block if the others are busy.  The pool's threads aren't
+ * bound to cores either, so placement can only match later kernels on
+ * average, and only if the process is bound with, e.g., numactl or
+ * taskset.  Interleave doesn't depend on which thread writes.
+ *
+ * Interleave falls back to FirstTouch unless built with libnuma
+ * (PULSAR_HAVE_LIBNUMA).  HugePages asks for transparent huge pages with
+ * madvise, which cuts TLB misses when streaming through large matrices;
+ * it is a hint the kernel may ignore.
+ */
+struct AllocationPolicy
+{
+    PagePlacement Placement = PagePlacement::Default;  //!< Placement of the pages
+    bool HugePages = false;                            //!< madvise(MADV_HUGEPAGE)
+    size_t MinBytes = 4 << 20;                         //!< Smaller matrices are left alone
+};
+
+/*! \brief Sets the policy used by newly constructed matrices
+ *
+ * Meant to be set once at startup, e.g. from the input options.
+ */
+void SetAllocationPolicy(const AllocationPolicy & Policy);
+
+/// The policy used by newly constructed matrices
+AllocationPolicy GetAllocationPolicy(void);
+
+
+namespace detail{
+
+/*! \brief Allocates an array the allocation policy applies to
+ *
+ * The pages come from mmap, page-aligned and unwritten, and are given to
+ * madvise and libnuma here, before anything touches them.
+ *
+ * \param[in] Bytes Length of the array
+ * \return The array, or nullptr if the policy leaves arrays of this
+ *         length to new[]
+ * \throw std::bad_alloc if mmap fails
+ */
+void * AllocatePlaced(size_t Bytes);
+
+/// Frees an array from AllocatePlaced
+void FreePlaced(void * Data, size_t Bytes);
+
+/*! \brief Deleter for arrays that came from either new[] or AllocatePlaced
+ *
+ * Converts from std::default_delete so that a std::unique_ptr<T[]> can be
+ * moved into a unique_ptr using it.
+ */
+template<typename T>
+struct PlacedDelete
+{
+    size_t Bytes = 0;  //!< Length of an array from AllocatePlaced, 0 if from new[]
+
+    PlacedDelete() = default;
+    PlacedDelete(std::default_delete<T[]>) { }
+    explicit PlacedDelete(size_t bytes) : Bytes(bytes) { }
+
+    void operator()(T * p) const
+    {
+        if(Bytes)
+            FreePlaced(p, Bytes);
+        else
+            delete [] p;
+    }
+};
+
+/*! \brief Applies the allocation policy to an array from AllocatePlaced
+ *
+ * \param[in] Data The untouched array
+ * \param[in] NRows Number of rows
+ * \param[in] RowBytes Length of a row in bytes
+ * \param[in] Src What to copy into the array, nullptr to zero it
+ * \return True if the array was filled, false if the placement is Default
+ *         and filling it is up to the caller
+ */
+bool PlaceRows(void * Data, size_t NRows, size_t RowBytes, const void * Src);
+
+} // close namespace detail
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
@@ -28,6 +28,14 @@ extern "C" {
                double*,int*,double*,int*,int*);
     void dgesvd(char*, char*, int*,int*,double*,int*,double*,double*,int*,
                 double*,int*,double*,int*,int*);
+    void dgeqrf(int*,int*,double*,int*,double*,double*,int*,int*);
+    void dorgqr(int*,int*,int*,double*,int*,double*,double*,int*,int*);
+    void dgemm(char*,char*,int*,int*,int*,double*,double*,int*,double*,int*,
+               double*,double*,int*);
+    void dgetrf(int*,int*,double*,int*,int*,int*);
+    void dgetrs(char*,int*,int*,double*,int*,int*,double*,int*,int*);
+    void dpotrf(char*,int*,double*,int*,int*);
+    void dpotrs(char*,int*,int*,double*,int*,double*,int*,int*);
 }
 
 ///The return type of the non-symmetric diagonalizer
@@ -147,6 +155,28 @@ SVDReturn_t SVD(Mat_t M, size_t m, size_t n,size_t LDA=0,size_t LDU=0,
     return std::make_tuple(LVecs,SVals,RVecs);    
 }
 
+/** \brief A C++-ified call to BLAS's matrix multiply for row-major data
+ *
+ *  Computes \f$C=\alpha op(A)op(B)+\beta C\f$ where \f$op(X)\f$ is
+ *  either \f$X\f$ or \f$X^T\f$.  All matrices are row-major (the layout
+ *  of SimpleMatrix), which we get by asking Fortran for \f$C^T\f$.
+ *
+ *  \param[in] TransA True if \f$op(A)=A^T\f$
+ *  \param[in] TransB True if \f$op(B)=B^T\f$
+ *  \param[in] M Number of rows of \f$op(A)\f$ and \f$C\f$
+ *  \param[in] N Number of columns of \f$op(B)\f$ and \f$C\f$
+ *  \param[in] K Number of columns of \f$op(A)\f$ and rows of \f$op(B)\f$
+ *  \param[in] LDA,LDB,LDC The number of elements in a row of A, B, and C
+ *                          as stored (i.e. before applying op)
+ */
+inline void Gemm(bool TransA,bool TransB,int M,int N,int K,double alpha,
+                 const double* A,int LDA,const double* B,int LDB,
+                 double beta,double* C,int LDC){
+    if(M==0 || N==0)return;
+    char ta=TransA?'T':'N',tb=TransB?'T':'N';
+    dgemm(&tb,&ta,&N,&M,&K,&alpha,const_cast<double*>(B),&LDB,
+          const_cast<double*>(A),&LDA,&beta,C,&LDC);
+}
 
 ///Returns the cross product of two vectors
 ///\todo write in terms of wedge product
@@ -0,0 +1,93 @@
+/*! \file
+ *
+ * \brief Memory bandwidth of a parallel kernel under each AllocationPolicy
+ *
+ * Runs a STREAM-like triad, C = A + s B, over large SimpleMatrixD with
+ * the rows spread over the default thread pool, once for each allocation
+ * policy.  A and B are copied from a buffer filled by the main thread,
+ * which is how a serially built matrix ends up with the default policy.
+ * Under the default placement C comes back untouched, so it is zeroed
+ * here by the main thread, again as a serial code would.  Otherwise the
+ * pool threads have already zeroed it.  Either way the timed triads never
+ * first-touch a page.
+ *
+ * Usage: BandwidthBenchmark [n=4096] [repeats=10]
+ *
+ * Differences only show on multi-socket nodes, and only if the process is
+ * bound to the cores (e.g. numactl --cpunodebind=all, or taskset).
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/math/AllocationPolicy.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+using namespace pulsar::math;
+using namespace pulsar::parallel;
+
+///Best bandwidth (GB/s) of the triad over \p Repeats runs
+double Triad(size_t n, size_t Repeats, const std::vector<double> & Src)
+{
+    SimpleMatrixD A(n, n, Src.data()), B(n, n, Src.data()), C(n, n);
+    if(GetAllocationPolicy().Placement == PagePlacement::Default)
+        C.Zero();
+    const double s = 3.0;
+    const size_t rows = (n + NumThreads() - 1) / NumThreads();
+
+    double best = 0.0;
+    for(size_t r = 0; r < Repeats; r++)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        ParallelFor(0, n, [&](size_t i)
+        {
+            const double * a = &A(i, 0), * b = &B(i, 0);
+            double * c = &C(i, 0);
+            for(size_t j = 0; j < n; j++)
+                c[j] = a[j] + s * b[j];
+        }, rows);
+        const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        best = std::max(best, 3.0 * sizeof(double) * n * n / dt.count() / 1e9);
+    }
+    return best;
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    const size_t repeats = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    std::vector<double> src(n * n);
+    for(size_t i = 0; i < src.size(); i++)
+        src[i] = static_cast<double>(i % 1000);
+
+    struct Case { std::string name; PagePlacement where; bool huge; };
+    const std::vector<Case> cases = {
+        {"default",               PagePlacement::Default,    false},
+        {"default + huge pages",  PagePlacement::Default,    true},
+        {"first touch",           PagePlacement::FirstTouch, false},
+        {"first touch + huge",    PagePlacement::FirstTouch, true},
+        {"interleave",            PagePlacement::Interleave, false},
+        {"interleave + huge",     PagePlacement::Interleave, true}
+    };
+
+    std::cout << "Triad on " << n << " x " << n << " matrices ("
+              << 8.0 * n * n / (1 << 20) << " MiB each), "
+              << NumThreads() << " threads" << std::endl;
+    for(const auto & c : cases)
+    {
+        AllocationPolicy policy;
+        policy.Placement = c.where;
+        policy.HugePages = c.huge;
+        SetAllocationPolicy(policy);
+        std::cout << std::setw(24) << std::left << c.name
+                  << std::setw(10) << std::right << std::fixed << std::setprecision(2)
+                  << Triad(n, repeats, src) << " GB/s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+/*! \file
+ *
+ * \brief Pivoted, incomplete Cholesky decomposition
+ */
+
+#ifndef PULSAR_GUARD_MATH__CHOLESKY_HPP_
+#define PULSAR_GUARD_MATH__CHOLESKY_HPP_
+
+#include <vector>
+#include <tuple>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+/*! \brief Signature of a function that computes columns of a matrix
+ *
+ *  The first argument is the list of requested column indices.  The second
+ *  is a matrix that is already sized to (number of columns) by n; row i of
+ *  it is to be filled with column Cols[i] of the matrix.  Since the matrices
+ *  we decompose are symmetric, rows and columns are interchangeable.
+ */
+typedef std::function<void(const std::vector<size_t>&, SimpleMatrixD&)>
+    ColumnGenerator_t;
+
+///The return of PivotedCholesky: the factor and the pivots, in order
+typedef std::tuple<SimpleMatrixD,std::vector<size_t>> PivotedCholeskyReturn_t;
+
+/*! \brief Pivoted, incomplete Cholesky decomposition of a positive
+ *         semidefinite matrix that is only available column by column
+ *
+ *  Finds \f$L\f$ such that \f$A\approx L^TL\f$, stopping when the largest
+ *  remaining diagonal element of the residual, \f$A-L^TL\f$, is below
+ *  \p Tol.  The residual diagonal is also an upper bound on the error of
+ *  any element of the residual.
+ *
+ *  Columns are requested from \p Gen in batches of up to \p BlockSize
+ *  (the columns belonging to the largest residual diagonal elements).
+ *  Once a batch is in hand it is updated against the existing Cholesky
+ *  vectors in one pass, and then pivots are taken from it for as long as
+ *  they remain good, i.e. within a factor of \p BatchQuality of the global maximum.
+ *  Any columns that are not used are discarded and requested again later
+ *  if need be.  This is the usual trade-off of a few extra column
+ *  evaluations for far fewer calls to \p Gen.
+ *
+ *  Storage is the factor itself plus one batch of columns, i.e. it scales
+ *  as n times the rank.
+ *
+ *  \param[in] Diag The diagonal of the matrix
+ *  \param[in] Gen Callback computing columns of the matrix
+ *  \param[in] Tol Decomposition threshold on the residual diagonal
+ *  \param[in] MaxRank Maximum number of Cholesky vectors (0 for no limit)
+ *  \param[in] BlockSize Maximum number of columns requested per call of
+ *                       \p Gen
+ *  \param[in] BatchQuality A pivot taken from a batch must be at least
+ *                          this fraction of the largest residual diagonal,
+ *                          must be in (0,1]
+ *
+ *  \return The factor, as a rank by n matrix whose rows are the Cholesky
+ *          vectors, and the indices of the pivot columns in the order they
+ *          were chosen.
+ */
+inline PivotedCholeskyReturn_t PivotedCholesky(std::vector<double> Diag,
+                                               const ColumnGenerator_t & Gen,
+                                               double Tol=1e-8,
+                                               size_t MaxRank=0,
+                                               size_t BlockSize=32,
+                                               double BatchQuality=1e-2)
+{
+    //Above 1 not even a batch's largest element qualifies, and the loop
+    //below would never take a pivot
+    if(!(BatchQuality > 0.0 && BatchQuality <= 1.0))
+        throw PulsarException("BatchQuality must be in (0,1]",
+                              "BatchQuality", BatchQuality);
+
+    const size_t n = Diag.size();
+    if(MaxRank == 0 || MaxRank > n)
+        MaxRank = n;
+    if(BlockSize == 0)
+        BlockSize = 1;
+
+    //Cholesky vectors, back to back (rank*n)
+    std::vector<double> L;
+    std::vector<size_t> Pivots;
+    std::vector<size_t> Order(n);
+
+    auto MaxDiag = [&Diag](void){
+        return Diag.empty() ? 0.0 : *std::max_element(Diag.begin(), Diag.end());
+    };
+
+    while(Pivots.size() < MaxRank)
+    {
+        const double DMax = MaxDiag();
+        if(DMax <= Tol)
+            break;
+
+        //The batch: the largest remaining diagonal elements above Tol
+        std::iota(Order.begin(), Order.end(), 0);
+        const size_t NCand = std::min(BlockSize, MaxRank - Pivots.size());
+        std::partial_sort(Order.begin(), Order.begin() + NCand, Order.end(),
+                          [&Diag](size_t i, size_t j){ return Diag[i] > Diag[j]; });
+        std::vector<size_t> Cand;
+        for(size_t c = 0; c < NCand && Diag[Order[c]] > Tol; ++c)
+            Cand.push_back(Order[c]);
+
+        SimpleMatrixD Cols(Cand.size(), n);
+        Gen(Cand, Cols);
+
+        //Remove what the existing vectors already account for
+        const size_t Rank = Pivots.size();
+        const size_t NCols = Cand.size();
+        parallel::ParallelFor(0, NCols, [&](size_t c)
+        {
+            double * Col = Cols.Data() + c * n;
+            for(size_t k = 0; k < Rank; ++k)
+            {
+                const double * Lk = L.data() + k * n;
+                const double Lkp = Lk[Cand[c]];
+                for(size_t i = 0; i < n; ++i)
+                    Col[i] -= Lkp * Lk[i];
+            }
+        }, 1);
+
+        //Take pivots from the batch while they are still good ones
+        std::vector<bool> Used(Cand.size(), false);
+        for(size_t Step = 0; Step < Cand.size(); ++Step)
+        {
+            size_t Best = Cand.size();
+            for(size_t c = 0; c < Cand.size(); ++c)
+                if(!Used[c] && (Best == Cand.size() || Diag[Cand[c]] > Diag[Cand[Best]]))
+                    Best = c;
+
+            const size_t p = Cand[Best];
+            const double Dp = Diag[p];
+            if(Dp <= Tol || Dp < BatchQuality * MaxDiag())
+                break;
+            Used[Best] = true;
+
+            //New vector is the updated column scaled by 1/sqrt(D_p)
+            const double Scale = 1.0 / std::sqrt(Dp);
+            L.resize(L.size() + n);
+            double * LNew = L.data() + L.size() - n;
+            const double * Col = Cols.Data() + Best * n;
+            parallel::ParallelFor(0, n, [&](size_t i)
+            {
+                LNew[i] = Col[i] * Scale;
+                Diag[i] = std::max(Diag[i] - LNew[i] * LNew[i], 0.0);
+            }, 4096);
+            Diag[p] = 0.0;
+            Pivots.push_back(p);
+
+            //Update the rest of the batch against the new vector
+            parallel::ParallelFor(0, NCols, [&](size_t c)
+            {
+                if(Used[c])
+                    return;
+                double * Ci = Cols.Data() + c * n;
+                const double Lcp = LNew[Cand[c]];
+                for(size_t i = 0; i < n; ++i)
+                    Ci[i] -= Lcp * LNew[i];
+            }, 1);
+
+            if(Pivots.size() == MaxRank)
+                break;
+        }
+    }
+
+    return std::make_tuple(SimpleMatrixD(Pivots.size(), n, L), Pivots);
+}
+
+/*! \brief Pivoted, incomplete Cholesky decomposition of a dense,
+ *         symmetric positive semidefinite matrix
+ *
+ *  See the column generator version for details, this one simply serves
+ *  the rows of \p A (which equal its columns).
+ */
+inline PivotedCholeskyReturn_t PivotedCholesky(const SimpleMatrixD & A,
+                                               double Tol=1e-8,
+                                               size_t MaxRank=0,
+                                               size_t BlockSize=32,
+                                               double BatchQuality=1e-2)
+{
+    const size_t n = A.NRows();
+    if(A.NCols() != n)
+        throw PulsarException("Cholesky decomposition requires a square matrix",
+                              "nrows", A.NRows(), "ncols", A.NCols());
+
+    std::vector<double> Diag(n);
+    for(size_t i = 0; i < n; ++i)
+        Diag[i] = A(i, i);
+
+    auto Gen = [&A, n](const std::vector<size_t> & Cols, SimpleMatrixD & Out){
+        for(size_t c = 0; c < Cols.size(); ++c)
+            std::copy(A.Data() + Cols[c] * n, A.Data() + (Cols[c] + 1) * n,
+                      Out.Data() + c * n);
+    };
+    return PivotedCholesky(std::move(Diag), Gen, Tol, MaxRank, BlockSize,
+                           BatchQuality);
+}
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
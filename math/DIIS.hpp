@@ -0,0 +1,284 @@
+/*! \file
+ *
+ * \brief Direct inversion in the iterative subspace (DIIS) extrapolation
+ */
+
+#ifndef PULSAR_GUARD_MATH__DIIS_HPP_
+#define PULSAR_GUARD_MATH__DIIS_HPP_
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/math/IrrepSpinMatrix.hpp"
+#include "pulsar/math/BLAS.hpp"
+
+
+namespace pulsar{
+namespace math{
+namespace detail{
+
+///A contiguous piece of the data making up a DIIS vector
+typedef std::pair<double *, size_t> DIISSpan_t;
+
+///A SimpleMatrix is a single span
+inline std::vector<DIISSpan_t> DIISSpans(SimpleMatrixD & M)
+{
+    return {DIISSpan_t(M.Data(), M.Size())};
+}
+
+///Each irrep/spin block of an IrrepSpinMatrix is a span (in key order)
+inline std::vector<DIISSpan_t> DIISSpans(IrrepSpinMatrixD & M)
+{
+    std::vector<DIISSpan_t> spans;
+    for(auto & it : M)
+        spans.emplace_back(it.second.Data(), it.second.Size());
+    return spans;
+}
+
+///Throws unless two SimpleMatrix have the same dimensions
+inline void DIISCheckShape(const SimpleMatrixD & New, const SimpleMatrixD & Old,
+                           const char * What)
+{
+    if(New.NRows() != Old.NRows() || New.NCols() != Old.NCols())
+        throw MathException("DIIS vectors have different shapes", "vector", What,
+                            "nrows", New.NRows(), "ncols", New.NCols(),
+                            "expected nrows", Old.NRows(), "expected ncols", Old.NCols());
+}
+
+///Throws unless two IrrepSpinMatrix have the same blocks, with the same
+///dimensions
+inline void DIISCheckShape(const IrrepSpinMatrixD & New, const IrrepSpinMatrixD & Old,
+                           const char * What)
+{
+    if(New.Size() != Old.Size())
+        throw MathException("DIIS vectors have a different number of blocks",
+                            "vector", What, "nblocks", New.Size(),
+                            "expected nblocks", Old.Size());
+    for(auto in = New.begin(), io = Old.begin(); in != New.end(); ++in, ++io)
+    {
+        if(in->first != io->first)
+            throw MathException("DIIS vectors have different irrep/spin blocks",
+                                "vector", What, "irrep", static_cast<int>(in->first.first),
+                                "spin", in->first.second,
+                                "expected irrep", static_cast<int>(io->first.first),
+                                "expected spin", io->first.second);
+        DIISCheckShape(in->second, io->second, What);
+    }
+}
+
+///The spans of a const object (we never write through these)
+template<typename Vector_t>
+std::vector<DIISSpan_t> DIISSpans(const Vector_t & M)
+{
+    return DIISSpans(const_cast<Vector_t &>(M));
+}
+
+} // close namespace detail
+
+
+/*! \brief Accelerates a fixed-point iteration via DIIS
+ *
+ *  Given a set of trial vectors \f$p_i\f$ and their error vectors \f$e_i\f$,
+ *  DIIS finds the coefficients \f$c_i\f$ minimizing
+ *  \f$|\sum_i c_ie_i|\f$ subject to \f$\sum_i c_i=1\f$, and returns
+ *  \f$\sum_i c_ip_i\f$ as the next guess.
+ *
+ *  The last \p MaxVecs vectors are kept in a ring buffer.  Each slot is
+ *  allocated the first time it is used and then overwritten in place, so
+ *  after the buffer fills up no more allocations happen.  The matrix of
+ *  error overlaps, \f$B_{ij}=e_i\cdot e_j\f$, is also kept around and only
+ *  the row for the newest vector is recomputed each iteration.
+ *
+ *  Usage:
+ *  \code
+ *  DIIS<IrrepSpinMatrixD> Diis(6);
+ *  while(!Converged){
+ *      //...build Fock matrix F and error FDS-SDF...
+ *      Diis.Extrapolate(F,Error);//F is now the extrapolated Fock matrix
+ *  }
+ *  \endcode
+ *
+ *  \tparam Vector_t The type of the parameters and errors.  Either
+ *                   SimpleMatrixD or IrrepSpinMatrixD.  All vectors passed
+ *                   in must have the same shape (for the latter, the same
+ *                   irrep/spin blocks with the same dimensions).
+ */
+template<typename Vector_t>
+class DIIS{
+    public:
+        /*! \brief Makes a DIIS extrapolator
+         *
+         * \param[in] MaxVecs The maximum number of vectors to keep
+         * \param[in] Threshold Relative cutoff below which eigenvalues of the
+         *                      DIIS equations are treated as zero (guards
+         *                      against the near-linear dependence that sets
+         *                      in as the iterations converge)
+         */
+        DIIS(size_t MaxVecs=8, double Threshold=1e-12)
+            : MaxVecs_(MaxVecs), Threshold_(Threshold), NVecs_(0), Next_(0),
+              B_(MaxVecs, MaxVecs)
+        {
+            if(MaxVecs == 0)
+                throw PulsarException("DIIS needs room for at least one vector");
+            B_.Zero();
+        }
+
+        ///Number of vectors currently in the subspace
+        size_t NVecs(void) const noexcept { return NVecs_; }
+
+        ///Maximum number of vectors kept in the subspace
+        size_t MaxVecs(void) const noexcept { return MaxVecs_; }
+
+        ///Forgets all stored vectors (their memory is kept for reuse)
+        void Reset(void) noexcept
+        {
+            NVecs_ = Next_ = 0;
+        }
+
+        /*! \brief Adds a vector and its error, then extrapolates
+         *
+         * \param[in,out] Params On entry the newest trial vector, on exit the
+         *                       extrapolated vector
+         * \param[in] Error The error vector associated with \p Params
+         * \return The coefficients of the stored vectors, in slot order
+         * \throw pulsar::MathException if \p Params and \p Error differ in
+         *        shape from each other or from the vectors already stored.
+         *        Nothing is stored in that case.
+         */
+        std::vector<double> Extrapolate(Vector_t & Params, const Vector_t & Error)
+        {
+            const size_t Slot = Store_(Params, Error);
+
+            //One new row (and column) of the B matrix
+            for(size_t i = 0; i < NVecs_; ++i)
+                B_(Slot, i) = B_(i, Slot) = Dot_(Errors_[Slot], Errors_[i]);
+
+            std::vector<double> Coefs = Solve_();
+
+            //Params = sum_i c_i p_i, written straight into the caller's blocks
+            auto Out = detail::DIISSpans(Params);
+            for(size_t b = 0; b < Out.size(); ++b)
+                std::fill(Out[b].first, Out[b].first + Out[b].second, 0.0);
+            for(size_t i = 0; i < NVecs_; ++i)
+            {
+                auto In = detail::DIISSpans(Params_[i]);
+                for(size_t b = 0; b < Out.size(); ++b)
+                    for(size_t j = 0; j < Out[b].second; ++j)
+                        Out[b].first[j] += Coefs[i] * In[b].first[j];
+            }
+            return Coefs;
+        }
+
+    private:
+        size_t MaxVecs_;           //!< Size of the ring buffer
+        double Threshold_;         //!< Relative eigenvalue cutoff
+        size_t NVecs_;             //!< Number of filled slots
+        size_t Next_;              //!< Slot the next vector goes into
+        std::vector<Vector_t> Params_;  //!< Stored trial vectors
+        std::vector<Vector_t> Errors_;  //!< Stored error vectors
+        SimpleMatrixD B_;          //!< Error overlaps, MaxVecs_ by MaxVecs_
+
+        ///Copies the vectors into the next slot, returns that slot
+        size_t Store_(const Vector_t & Params, const Vector_t & Error)
+        {
+            detail::DIISCheckShape(Error, Params, "error");
+            if(!Params_.empty())
+                detail::DIISCheckShape(Params, Params_.front(), "parameters");
+
+            const size_t Slot = Next_;
+            if(Slot == Params_.size())
+            {
+                //First use of this slot, this is the only allocation it gets
+                Params_.push_back(Params);
+                Errors_.push_back(Error);
+            }
+            else
+            {
+                Copy_(Params, Params_[Slot]);
+                Copy_(Error, Errors_[Slot]);
+            }
+            Next_ = (Next_ + 1) % MaxVecs_;
+            NVecs_ = std::min(NVecs_ + 1, MaxVecs_);
+            return Slot;
+        }
+
+        ///Copies \p From into the existing storage of \p To (same shape,
+        ///checked by Store_())
+        static void Copy_(const Vector_t & From, Vector_t & To)
+        {
+            auto Src = detail::DIISSpans(From), Dest = detail::DIISSpans(To);
+            for(size_t b = 0; b < Src.size(); ++b)
+                std::copy(Src[b].first, Src[b].first + Src[b].second, Dest[b].first);
+        }
+
+        ///Blockwise dot product of two vectors
+        static double Dot_(const Vector_t & LHS, const Vector_t & RHS)
+        {
+            auto L = detail::DIISSpans(LHS), R = detail::DIISSpans(RHS);
+            double Sum = 0.0;
+            for(size_t b = 0; b < L.size(); ++b)
+                for(size_t i = 0; i < L[b].second; ++i)
+                    Sum += L[b].first[i] * R[b].first[i];
+            return Sum;
+        }
+
+        /*! \brief Solves the DIIS equations
+         *
+         *  The bordered system
+         *  \f[
+         *     \left[\begin{array}{cc}B & -1\\ -1 & 0\end{array}\right]
+         *     \left[\begin{array}{c}c\\ \lambda\end{array}\right]=
+         *     \left[\begin{array}{c}0\\ -1\end{array}\right]
+         *  \f]
+         *  is symmetric, so we solve it via SymmetricDiagonalize and drop
+         *  the eigenvalues below the threshold (a pseudo-inverse).  B is
+         *  scaled by its largest diagonal element first, which doesn't
+         *  change the coefficients.
+         */
+        std::vector<double> Solve_(void) const
+        {
+            const size_t N = NVecs_ + 1;
+            double Scale = 0.0;
+            for(size_t i = 0; i < NVecs_; ++i)
+                Scale = std::max(Scale, B_(i, i));
+            if(Scale == 0.0)
+                Scale = 1.0;
+
+            std::vector<double> A(N * N, 0.0), EVals(N);
+            for(size_t i = 0; i < NVecs_; ++i)
+            {
+                for(size_t j = 0; j < NVecs_; ++j)
+                    A[i * N + j] = B_(i, j) / Scale;
+                A[i * N + NVecs_] = A[NVecs_ * N + i] = -1.0;
+            }
+
+            SymmetricDiagonalize(A, EVals);
+
+            double MaxEVal = 0.0;
+            for(double e : EVals)
+                MaxEVal = std::max(MaxEVal, std::fabs(e));
+
+            //x = sum_k v_k (v_k . rhs) / e_k, with rhs = (0,...,0,-1)
+            std::vector<double> X(N, 0.0);
+            for(size_t k = 0; k < N; ++k)
+            {
+                if(std::fabs(EVals[k]) <= Threshold_ * MaxEVal)
+                    continue;
+                const double * V = A.data() + k * N;
+                const double Proj = -V[NVecs_] / EVals[k];
+                for(size_t i = 0; i < N; ++i)
+                    X[i] += Proj * V[i];
+            }
+            X.resize(NVecs_);
+            return X;
+        }
+};
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
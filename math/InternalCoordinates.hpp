@@ -0,0 +1,453 @@
+/*! \file
+ *
+ * \brief Primitive internal coordinates (bonds, angles, dihedrals) and
+ *        their Wilson B matrix
+ */
+
+#ifndef PULSAR_GUARD_MATH__INTERNALCOORDINATES_HPP_
+#define PULSAR_GUARD_MATH__INTERNALCOORDINATES_HPP_
+
+#include <array>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/constants.h"//For Pi
+#include "pulsar/math/BLAS.hpp"
+#include "pulsar/math/SparseMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+///The kinds of primitive internal coordinates
+enum class InternalType{Bond,Angle,Dihedral};
+
+/** \brief A primitive internal coordinate
+ *
+ *  The atoms are i-j for a bond, i-j-k for the angle at j, and i-j-k-l for
+ *  the dihedral about the j-k bond.  Unused atoms are ignored.
+ */
+struct PrimitiveInternal{
+    InternalType Type;
+    std::array<size_t,4> Atoms;
+};
+
+///Number of atoms a primitive of a given type involves
+inline size_t NInternalAtoms(InternalType Type){
+    return Type==InternalType::Bond?2:(Type==InternalType::Angle?3:4);
+}
+
+namespace detail{
+
+typedef std::array<double,3> InternalVector_t;
+
+///The vector from atom b to atom a
+inline InternalVector_t InternalDiff(const double* X,size_t a,size_t b){
+    return {X[3*a]-X[3*b],X[3*a+1]-X[3*b+1],X[3*a+2]-X[3*b+2]};
+}
+
+///Value and derivatives (x,y,z of each atom in turn) of a bond
+inline double EvaluateBond(const size_t* Atoms,const double* X,double* dq){
+    const InternalVector_t u=InternalDiff(X,Atoms[0],Atoms[1]);
+    const double r=std::sqrt(Dot(u,u));
+    for(size_t c=0;c<3;++c){
+        dq[c]=u[c]/r;
+        dq[3+c]=-u[c]/r;
+    }
+    return r;
+}
+
+///Value and derivatives (x,y,z of each atom in turn) of an angle
+inline double EvaluateAngle(const size_t* Atoms,const double* X,double* dq){
+    const InternalVector_t u=InternalDiff(X,Atoms[0],Atoms[1]),
+                           v=InternalDiff(X,Atoms[2],Atoms[1]);
+    const double lu=std::sqrt(Dot(u,u)),lv=std::sqrt(Dot(v,v));
+    const double cost=std::max(-1.0,std::min(1.0,Dot(u,v)/(lu*lv)));
+    const double sint=std::sqrt(1.0-cost*cost);
+    //The derivative is undefined for linear angles, leave it zero
+    const double s=sint>1e-8?1.0/sint:0.0;
+    for(size_t c=0;c<3;++c){
+        dq[c]=s*(cost*u[c]/lu-v[c]/lv)/lu;
+        dq[6+c]=s*(cost*v[c]/lv-u[c]/lu)/lv;
+        dq[3+c]=-dq[c]-dq[6+c];
+    }
+    return std::acos(cost);
+}
+
+///Value and derivatives (x,y,z of each atom in turn) of a dihedral,
+///Blondel and Karplus, J. Comput. Chem. 17, 1132 (1996)
+inline double EvaluateDihedral(const size_t* Atoms,const double* X,double* dq){
+    const InternalVector_t F=InternalDiff(X,Atoms[0],Atoms[1]),
+                           G=InternalDiff(X,Atoms[1],Atoms[2]),
+                           H=InternalDiff(X,Atoms[3],Atoms[2]);
+    const InternalVector_t A=Cross(F,G),B=Cross(H,G);
+    const double A2=Dot(A,A),B2=Dot(B,B),lG=std::sqrt(Dot(G,G));
+    const InternalVector_t BxA=Cross(B,A);
+    const double phi=std::atan2(Dot(BxA,G)/lG,Dot(A,B));
+    if(A2<1e-16 || B2<1e-16){
+        std::fill(dq,dq+12,0.0);
+        return phi;
+    }
+    const double FG=Dot(F,G)/(A2*lG),HG=Dot(H,G)/(B2*lG);
+    for(size_t c=0;c<3;++c){
+        dq[c]=-lG/A2*A[c];
+        dq[9+c]=lG/B2*B[c];
+        dq[3+c]=-dq[c]+FG*A[c]-HG*B[c];
+        dq[6+c]=-dq[9+c]+HG*B[c]-FG*A[c];
+    }
+    return phi;
+}
+
+///Value and derivatives (x,y,z of each atom in turn) of one primitive
+inline double EvaluateInternal(InternalType Type,const size_t* Atoms,
+                               const double* X,double* dq){
+    if(Type==InternalType::Bond)return EvaluateBond(Atoms,X,dq);
+    if(Type==InternalType::Angle)return EvaluateAngle(Atoms,X,dq);
+    return EvaluateDihedral(Atoms,X,dq);
+}
+
+}//End namespace detail
+
+/** \brief Primitive internal coordinates of a molecule and the
+ *         transformations between them and Cartesian coordinates
+ *
+ *  The primitives are enumerated once, from the bonding topology: every
+ *  bond, every angle between two bonds sharing an atom, and every dihedral
+ *  about a bond.  Each call to Evaluate() then gives the values and the
+ *  Wilson B matrix, \f$B_{qx}=\partial q/\partial x\f$, for a geometry.
+ *  Each primitive depends on at most four atoms, so B is stored sparsely
+ *  (CSR), with its sparsity pattern set up once.  The primitives are kept
+ *  grouped by type, and each group is evaluated in its own parallel sweep
+ *  with the type, and so the number of derivatives per row, fixed for the
+ *  whole sweep.
+ *
+ *  Cartesian coordinates are always a flat array of 3N numbers, the x, y,
+ *  and z of each atom in turn.
+ *
+ *  ToCartesian() caches the pseudo-inverse it uses.  The cache is guarded
+ *  by a mutex, so all members may be called from several threads at once.
+ */
+class InternalCoordinates{
+public:
+    /** \brief Enumerates the primitives from a bond graph
+     *
+     *  \param[in] Bonds A graph whose nodes are the atom indices,
+     *                   0 to \p NAtoms - 1, all of which must be in the
+     *                   graph.  Direction of the edges is ignored.
+     *  \param[in] NAtoms The number of atoms
+     */
+    template<typename Graph_t>
+    InternalCoordinates(const Graph_t& Bonds,size_t NAtoms):natoms_(NAtoms){
+        std::vector<std::set<size_t>> Conns(NAtoms);
+        for(size_t i=0;i<NAtoms;++i)
+            for(const auto& Node:Bonds.ConNodes(i)){
+                const size_t j=static_cast<size_t>(Node);
+                if(j>=NAtoms)
+                    throw MathException("Bonded atom out of range",
+                                        "atom",j,"natoms",NAtoms);
+                if(j==i)continue;
+                Conns[i].insert(j);
+                Conns[j].insert(i);
+            }
+
+        std::vector<PrimitiveInternal> Prims;
+        for(size_t i=0;i<NAtoms;++i)
+            for(size_t j:Conns[i])
+                if(i<j)Prims.push_back({InternalType::Bond,{i,j,0,0}});
+        for(size_t j=0;j<NAtoms;++j)
+            for(auto i=Conns[j].begin();i!=Conns[j].end();++i)
+                for(auto k=std::next(i);k!=Conns[j].end();++k)
+                    Prims.push_back({InternalType::Angle,{*i,j,*k,0}});
+        for(size_t j=0;j<NAtoms;++j)
+            for(size_t k:Conns[j]){
+                if(k<j)continue;
+                for(size_t i:Conns[j])
+                    for(size_t l:Conns[k])
+                        if(i!=k && l!=j && i!=l)
+                            Prims.push_back({InternalType::Dihedral,{i,j,k,l}});
+            }
+        SetUp_(std::move(Prims));
+    }
+
+    ///Uses the given primitives as they are
+    InternalCoordinates(std::vector<PrimitiveInternal> Prims,size_t NAtoms)
+        :natoms_(NAtoms){
+        SetUp_(std::move(Prims));
+    }
+
+    ///Copies everything, the cached pseudo-inverse is shared
+    InternalCoordinates(const InternalCoordinates& rhs)
+        :natoms_(rhs.natoms_),prims_(rhs.prims_),groups_(rhs.groups_),
+         rowptr_(rhs.rowptr_),colidx_(rhs.colidx_),slot_(rhs.slot_),
+         cache_(rhs.Cache_()){}
+
+    InternalCoordinates& operator=(const InternalCoordinates& rhs){
+        if(this!=&rhs){
+            InternalCoordinates tmp(rhs);
+            std::lock_guard<std::mutex> l(mutex_);
+            natoms_=tmp.natoms_;
+            prims_=std::move(tmp.prims_);
+            groups_=tmp.groups_;
+            rowptr_=std::move(tmp.rowptr_);
+            colidx_=std::move(tmp.colidx_);
+            slot_=std::move(tmp.slot_);
+            cache_=std::move(tmp.cache_);
+        }
+        return *this;
+    }
+
+    ///The primitives, bonds first, then angles, then dihedrals
+    const std::vector<PrimitiveInternal>& Primitives(void)const noexcept{
+        return prims_;
+    }
+    size_t NPrimitives(void)const noexcept{return prims_.size();}
+    size_t NAtoms(void)const noexcept{return natoms_;}
+
+    /** \brief The values of the primitives and the B matrix at a geometry
+     *
+     *  Bonds are in the units of \p X, angles and dihedrals in radians,
+     *  with dihedrals in \f$(-\pi,\pi]\f$.
+     *
+     *  \param[in] X The Cartesian coordinates, 3N long
+     *  \param[out] q The values of the primitives
+     *  \param[out] B The NPrimitives() by 3N B matrix
+     */
+    void Evaluate(const std::vector<double>& X,std::vector<double>& q,
+                  CSRMatrix<double>& B)const{
+        CheckGeometry_(X);
+        q.resize(prims_.size());
+        std::vector<double> Values(colidx_.size());
+        EvaluateGroup_<6>(InternalType::Bond,detail::EvaluateBond,X,q,Values);
+        EvaluateGroup_<9>(InternalType::Angle,detail::EvaluateAngle,X,q,Values);
+        EvaluateGroup_<12>(InternalType::Dihedral,detail::EvaluateDihedral,X,q,Values);
+        B=CSRMatrix<double>(prims_.size(),3*natoms_,rowptr_,colidx_,
+                            std::move(Values));
+    }
+
+    ///The values of the primitives at a geometry
+    std::vector<double> Values(const std::vector<double>& X)const{
+        std::vector<double> q;
+        CSRMatrix<double> B;
+        Evaluate(X,q,B);
+        return q;
+    }
+
+    ///The B matrix at a geometry
+    CSRMatrix<double> BMatrix(const std::vector<double>& X)const{
+        std::vector<double> q;
+        CSRMatrix<double> B;
+        Evaluate(X,q,B);
+        return B;
+    }
+
+    /** \brief Differences between primitive values, with dihedrals wrapped
+     *         into \f$(-\pi,\pi]\f$
+     */
+    std::vector<double> Difference(const std::vector<double>& q1,
+                                   const std::vector<double>& q2)const{
+        std::vector<double> dq(prims_.size());
+        for(size_t p=0;p<prims_.size();++p){
+            dq[p]=q1[p]-q2[p];
+            if(prims_[p].Type==InternalType::Dihedral){
+                while(dq[p]>PI)dq[p]-=2.0*PI;
+                while(dq[p]<=-PI)dq[p]+=2.0*PI;
+            }
+        }
+        return dq;
+    }
+
+    /** \brief Converts a step in internal coordinates to Cartesians
+     *
+     *  Redundant internals can't all be satisfied at once, so this finds the
+     *  geometry whose internals are closest to \f$q(X)+dq\f$ by iterating
+     *  \f$X\leftarrow X+(B^TB)^{-1}B^T(q_{target}-q(X))\f$, keeping B (and
+     *  the pseudo-inverse of \f$B^TB\f$, from one eigendecomposition) fixed
+     *  at the starting geometry.  The pseudo-inverse is kept, so further
+     *  calls from the same starting geometry (e.g. retrying with a shorter
+     *  step) don't redo it.
+     *
+     *  If the iterations don't converge the result of the first iteration,
+     *  which is the linear approximation, is returned.
+     *
+     *  \param[in] X The starting geometry
+     *  \param[in] dq The step in the primitives
+     *  \param[in] Tol Convergence threshold on the RMS Cartesian change
+     *  \param[in] MaxIter Maximum number of iterations
+     *  \return The new geometry
+     */
+    std::vector<double> ToCartesian(const std::vector<double>& X,
+                                    const std::vector<double>& dq,
+                                    double Tol=1e-10,size_t MaxIter=50)const{
+        CheckGeometry_(X);
+        if(dq.size()!=prims_.size())
+            throw MathException("Step has the wrong number of primitives",
+                                "nprims",prims_.size(),"nstep",dq.size());
+        std::vector<double> q0;
+        CSRMatrix<double> B0;
+        Evaluate(X,q0,B0);
+        std::shared_ptr<const Inverse_> Cache=Cache_();
+        if(!Cache || Cache->X!=X){
+            Cache=MakeInverse_(X,B0);
+            std::lock_guard<std::mutex> l(mutex_);
+            cache_=Cache;
+        }
+        const std::vector<double>& ginv=Cache->GInv;
+
+        std::vector<double> Target(q0.size());
+        for(size_t p=0;p<q0.size();++p)Target[p]=q0[p]+dq[p];
+
+        std::vector<double> Xi(X),First,Resid(dq);
+        const size_t n3=3*natoms_;
+        for(size_t iter=0;iter<MaxIter;++iter){
+            //dx = (B^TB)^+ B^T r
+            std::vector<double> BtR(n3,0.0),dx(n3,0.0);
+            const auto& rp=B0.RowPtr();
+            const auto& ci=B0.ColIdx();
+            const auto& v=B0.Values();
+            for(size_t p=0;p<prims_.size();++p)
+                for(size_t k=rp[p];k<rp[p+1];++k)
+                    BtR[ci[k]]+=v[k]*Resid[p];
+            for(size_t i=0;i<n3;++i)
+                for(size_t j=0;j<n3;++j)
+                    dx[i]+=ginv[i*n3+j]*BtR[j];
+
+            double rms=0.0;
+            for(size_t i=0;i<n3;++i){
+                Xi[i]+=dx[i];
+                rms+=dx[i]*dx[i];
+            }
+            rms=std::sqrt(rms/std::max<size_t>(n3,1));
+            if(iter==0)First=Xi;
+            if(rms<Tol)return Xi;
+            Resid=Difference(Target,Values(Xi));
+        }
+        return First;
+    }
+
+private:
+    ///The pseudo-inverse of B^TB, 3N by 3N, and the geometry it is for
+    struct Inverse_{
+        std::vector<double> X;
+        std::vector<double> GInv;
+    };
+
+    size_t natoms_;
+    std::vector<PrimitiveInternal> prims_;
+
+    ///Where the bonds, angles, and dihedrals start in prims_ (and the end)
+    std::array<size_t,4> groups_;
+
+    ///The sparsity pattern of B
+    std::vector<size_t> rowptr_,colidx_;
+
+    ///For each derivative of each primitive, its offset within B's row
+    std::vector<size_t> slot_;
+
+    ///Guards cache_
+    mutable std::mutex mutex_;
+
+    ///The last pseudo-inverse ToCartesian() made.  It is never modified,
+    ///only replaced, so a caller can keep using one while another thread
+    ///replaces it.
+    mutable std::shared_ptr<const Inverse_> cache_;
+
+    std::shared_ptr<const Inverse_> Cache_(void)const{
+        std::lock_guard<std::mutex> l(mutex_);
+        return cache_;
+    }
+
+    ///Evaluates the primitives of one type, each having NSlot derivatives
+    template<size_t NSlot,typename Fxn_t>
+    void EvaluateGroup_(InternalType Type,Fxn_t Fxn,const std::vector<double>& X,
+                        std::vector<double>& q,std::vector<double>& Values)const{
+        const size_t g=static_cast<size_t>(Type);
+        parallel::ParallelFor(groups_[g],groups_[g+1],[&](size_t p){
+            double dq[NSlot];
+            q[p]=Fxn(prims_[p].Atoms.data(),X.data(),dq);
+            const size_t start=rowptr_[p];
+            for(size_t s=0;s<NSlot;++s)
+                Values[start+slot_[start+s]]=dq[s];
+        });
+    }
+
+    void SetUp_(std::vector<PrimitiveInternal> Prims){
+        for(const auto& Prim:Prims)
+            for(size_t a=0;a<NInternalAtoms(Prim.Type);++a)
+                if(Prim.Atoms[a]>=natoms_)
+                    throw MathException("Primitive atom out of range",
+                                        "atom",Prim.Atoms[a],"natoms",natoms_);
+
+        //Grouping by type keeps each parallel sweep on one code path
+        std::stable_sort(Prims.begin(),Prims.end(),
+            [](const PrimitiveInternal& a,const PrimitiveInternal& b){
+                return a.Type<b.Type;});
+        prims_=std::move(Prims);
+        for(size_t g=0;g<3;++g)
+            groups_[g]=std::find_if(prims_.begin(),prims_.end(),
+                [g](const PrimitiveInternal& p){
+                    return static_cast<size_t>(p.Type)>=g;})-prims_.begin();
+        groups_[3]=prims_.size();
+
+        rowptr_.assign(1,0);
+        for(const auto& Prim:prims_){
+            const size_t na=NInternalAtoms(Prim.Type),start=colidx_.size();
+            std::vector<size_t> Cols(3*na),Order(3*na);
+            for(size_t a=0;a<na;++a)
+                for(size_t c=0;c<3;++c)
+                    Cols[3*a+c]=3*Prim.Atoms[a]+c;
+            for(size_t s=0;s<Order.size();++s)Order[s]=s;
+            std::sort(Order.begin(),Order.end(),
+                      [&](size_t a,size_t b){return Cols[a]<Cols[b];});
+            slot_.resize(start+3*na);
+            for(size_t s=0;s<Order.size();++s){
+                colidx_.push_back(Cols[Order[s]]);
+                slot_[start+Order[s]]=s;
+            }
+            rowptr_.push_back(colidx_.size());
+        }
+    }
+
+    void CheckGeometry_(const std::vector<double>& X)const{
+        if(X.size()!=3*natoms_)
+            throw MathException("Geometry has the wrong length",
+                                "length",X.size(),"natoms",natoms_);
+    }
+
+    std::shared_ptr<const Inverse_> MakeInverse_(const std::vector<double>& X,
+                                                 const CSRMatrix<double>& B)const{
+        const size_t n3=3*natoms_;
+        std::vector<double> G(n3*n3,0.0);
+        const auto& rp=B.RowPtr();
+        const auto& ci=B.ColIdx();
+        const auto& v=B.Values();
+        for(size_t p=0;p<prims_.size();++p)
+            for(size_t a=rp[p];a<rp[p+1];++a)
+                for(size_t b=rp[p];b<rp[p+1];++b)
+                    G[ci[a]*n3+ci[b]]+=v[a]*v[b];
+
+        //Rows of G are now the eigenvectors; translations and rotations
+        //(and any other redundancy) have zero eigenvalues and are dropped
+        std::vector<double> Evals(n3);
+        SymmetricDiagonalize(G,Evals);
+        const double Max=Evals.empty()?0.0:std::fabs(Evals.back());
+        auto Inv=std::make_shared<Inverse_>();
+        Inv->X=X;
+        Inv->GInv.assign(n3*n3,0.0);
+        for(size_t k=0;k<n3;++k){
+            if(Evals[k]<=1e-10*Max)continue;
+            const double* vk=G.data()+k*n3;
+            for(size_t i=0;i<n3;++i)
+                for(size_t j=0;j<n3;++j)
+                    Inv->GInv[i*n3+j]+=vk[i]*vk[j]/Evals[k];
+        }
+        return Inv;
+    }
+};
+
+}}//End namespaces
+#endif /* INTERNALCOORDINATES_HPP */
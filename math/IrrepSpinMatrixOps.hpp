@@ -0,0 +1,287 @@
+/*! \file
+ *
+ * \brief Reductions and elementwise operations over irrep/spin blocks
+ */
+
+#ifndef PULSAR_GUARD_MATH__IRREPSPINMATRIXOPS_HPP_
+#define PULSAR_GUARD_MATH__IRREPSPINMATRIXOPS_HPP_
+
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/IrrepSpinMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+namespace detail{
+
+///Complex conjugate that leaves real numbers alone
+template<typename T>
+T Conj(const T & x){ return x; }
+
+template<typename T>
+std::complex<T> Conj(const std::complex<T> & x){ return std::conj(x); }
+
+
+/*! \brief Kahan-Babuska (Neumaier) compensated accumulator
+ *
+ * Sums of many terms of mixed sign (traces and dot products of large
+ * matrices) lose digits with naive summation.  This keeps a running
+ * correction for the low order bits lost at each addition.
+ */
+template<typename T>
+class CompensatedSum
+{
+    public:
+        CompensatedSum() : sum_(0), c_(0) { }
+
+        void Add(const T & x)
+        {
+            const T t = sum_ + x;
+            if(std::abs(sum_) >= std::abs(x))
+                c_ += (sum_ - t) + x;
+            else
+                c_ += (x - t) + sum_;
+            sum_ = t;
+        }
+
+        void Add(const CompensatedSum & other)
+        {
+            Add(other.sum_);
+            Add(other.c_);
+        }
+
+        T Value(void) const { return sum_ + c_; }
+
+    private:
+        T sum_;  //!< The running sum
+        T c_;    //!< The accumulated correction
+};
+
+template<typename T>
+class CompensatedSum<std::complex<T>>
+{
+    public:
+        void Add(const std::complex<T> & x)
+        {
+            re_.Add(x.real());
+            im_.Add(x.imag());
+        }
+
+        void Add(const CompensatedSum & other)
+        {
+            re_.Add(other.re_);
+            im_.Add(other.im_);
+        }
+
+        std::complex<T> Value(void) const
+        {
+            return std::complex<T>(re_.Value(), im_.Value());
+        }
+
+    private:
+        CompensatedSum<T> re_, im_;
+};
+
+
+///A contiguous run of elements of one block
+template<typename T>
+struct Chunk
+{
+    T * data;       //!< First element of the block
+    size_t begin;   //!< First element (offset into data) of this chunk
+    size_t end;     //!< One past the last element of this chunk
+};
+
+/*! \brief Splits blocks into chunks of roughly equal size
+ *
+ * Blocks are few and their sizes vary a lot (e.g. A1 vs A2 in C2v), so
+ * threading over blocks alone leaves most threads idle.  Instead every
+ * block is cut into pieces of at most \p grain elements, and all pieces of
+ * all blocks are distributed over the threads.
+ */
+template<typename T, typename Matrix_t>
+std::vector<Chunk<T>> MakeChunks(Matrix_t & M, size_t grain = 16384)
+{
+    std::vector<Chunk<T>> chunks;
+    for(auto & it : M)
+    {
+        const size_t n = it.second.Size();
+        T * data = n ? it.second.Data() : nullptr;
+        for(size_t start = 0; start < n; start += grain)
+            chunks.push_back(Chunk<T>{data, start, std::min(start + grain, n)});
+    }
+    return chunks;
+}
+
+///Checks that two objects have the same blocks with the same shapes
+template<typename T, typename U>
+void CheckSameShape(const BlockByIrrepSpin<SimpleMatrix<T>> & A,
+                    const BlockByIrrepSpin<SimpleMatrix<U>> & B)
+{
+    if(A.Size() != B.Size())
+        throw MathException("Irrep/spin matrices have a different number of blocks",
+                            "lhs", A.Size(), "rhs", B.Size());
+    auto ia = A.begin();
+    auto ib = B.begin();
+    for(; ia != A.end(); ++ia, ++ib)
+    {
+        if(ia->first != ib->first)
+            throw MathException("Irrep/spin matrices have different blocks",
+                                "lhsirrep", static_cast<int>(ia->first.first),
+                                "lhsspin", ia->first.second,
+                                "rhsirrep", static_cast<int>(ib->first.first),
+                                "rhsspin", ib->first.second);
+        if(ia->second.NRows() != ib->second.NRows() ||
+           ia->second.NCols() != ib->second.NCols())
+            throw MathException("Irrep/spin matrix blocks have different shapes",
+                                "lhsrows", ia->second.NRows(), "lhscols", ia->second.NCols(),
+                                "rhsrows", ib->second.NRows(), "rhscols", ib->second.NCols());
+    }
+}
+
+} // close namespace detail
+
+
+/*! \brief The sum of the traces of all blocks
+ *
+ * \throw pulsar::MathException if a block isn't square
+ */
+template<typename T>
+T Trace(const BlockByIrrepSpin<SimpleMatrix<T>> & A)
+{
+    detail::CompensatedSum<T> sum;
+    for(const auto & it : A)
+    {
+        const SimpleMatrix<T> & M = it.second;
+        if(M.NRows() != M.NCols())
+            throw MathException("Trace of a non-square block",
+                                "nrows", M.NRows(), "ncols", M.NCols());
+        for(size_t i = 0; i < M.NRows(); i++)
+            sum.Add(M(i, i));
+    }
+    return sum.Value();
+}
+
+/*! \brief The Frobenius inner product, sum over blocks of
+ *         \f$\sum_{ij}A_{ij}^*B_{ij}\f$
+ *
+ * This is also \f$\mathrm{Tr}(A^\dagger B)\f$, e.g. the energy from the
+ * density and Fock matrices.  Compensated summation is used within and
+ * across threads.
+ *
+ * \throw pulsar::MathException if A and B don't have the same blocks
+ */
+template<typename T>
+T Dot(const BlockByIrrepSpin<SimpleMatrix<T>> & A,
+      const BlockByIrrepSpin<SimpleMatrix<T>> & B)
+{
+    detail::CheckSameShape(A, B);
+    auto ca = detail::MakeChunks<const T>(A);
+    auto cb = detail::MakeChunks<const T>(B);
+
+    std::vector<detail::CompensatedSum<T>> partial(ca.size());
+    parallel::ParallelFor(0, ca.size(), [&](size_t c)
+    {
+        const T * a = ca[c].data;
+        const T * b = cb[c].data;
+        for(size_t i = ca[c].begin; i < ca[c].end; i++)
+            partial[c].Add(detail::Conj(a[i]) * b[i]);
+    }, 1);
+
+    detail::CompensatedSum<T> sum;
+    for(const auto & p : partial)
+        sum.Add(p);
+    return sum.Value();
+}
+
+/*! \brief The Frobenius norm over all blocks
+ *
+ * Accumulated in compensated double precision, via the sum of squares.
+ */
+template<typename T>
+double Norm(const BlockByIrrepSpin<SimpleMatrix<T>> & A)
+{
+    auto ca = detail::MakeChunks<const T>(A);
+
+    std::vector<detail::CompensatedSum<double>> partial(ca.size());
+    parallel::ParallelFor(0, ca.size(), [&](size_t c)
+    {
+        const T * a = ca[c].data;
+        for(size_t i = ca[c].begin; i < ca[c].end; i++)
+            partial[c].Add(static_cast<double>(std::norm(a[i])));
+    }, 1);
+
+    detail::CompensatedSum<double> sum;
+    for(const auto & p : partial)
+        sum.Add(p);
+    return std::sqrt(sum.Value());
+}
+
+/*! \brief The largest magnitude of any element of any block
+ *
+ * Typically the convergence criterion on an error matrix.  Returns 0 if
+ * there are no elements.
+ */
+template<typename T>
+double MaxAbs(const BlockByIrrepSpin<SimpleMatrix<T>> & A)
+{
+    auto ca = detail::MakeChunks<const T>(A);
+
+    std::vector<double> partial(ca.size(), 0.0);
+    parallel::ParallelFor(0, ca.size(), [&](size_t c)
+    {
+        const T * a = ca[c].data;
+        double m = 0.0;
+        for(size_t i = ca[c].begin; i < ca[c].end; i++)
+            m = std::max(m, static_cast<double>(std::abs(a[i])));
+        partial[c] = m;
+    }, 1);
+
+    return partial.empty() ? 0.0 : *std::max_element(partial.begin(), partial.end());
+}
+
+/*! \brief Y = alpha*X + Y, block by block
+ *
+ * \throw pulsar::MathException if X and Y don't have the same blocks
+ */
+template<typename T>
+void Axpy(const T & alpha,
+          const BlockByIrrepSpin<SimpleMatrix<T>> & X,
+          BlockByIrrepSpin<SimpleMatrix<T>> & Y)
+{
+    detail::CheckSameShape(X, Y);
+    auto cx = detail::MakeChunks<const T>(X);
+    auto cy = detail::MakeChunks<T>(Y);
+
+    parallel::ParallelFor(0, cx.size(), [&](size_t c)
+    {
+        const T * x = cx[c].data;
+        T * y = cy[c].data;
+        for(size_t i = cx[c].begin; i < cx[c].end; i++)
+            y[i] += alpha * x[i];
+    }, 1);
+}
+
+/*! \brief X = alpha*X, block by block */
+template<typename T>
+void Scale(const T & alpha, BlockByIrrepSpin<SimpleMatrix<T>> & X)
+{
+    auto cx = detail::MakeChunks<T>(X);
+
+    parallel::ParallelFor(0, cx.size(), [&](size_t c)
+    {
+        T * x = cx[c].data;
+        for(size_t i = cx[c].begin; i < cx[c].end; i++)
+            x[i] *= alpha;
+    }, 1);
+}
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
@@ -0,0 +1,448 @@
+/*! \file
+ *
+ * \brief Preconditioned Krylov solvers for many linear systems at once
+ */
+
+#ifndef PULSAR_GUARD_MATH__KRYLOV_HPP_
+#define PULSAR_GUARD_MATH__KRYLOV_HPP_
+
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+/** \brief Applies an operator to a batch of vectors
+ *
+ *  The vectors are the rows of \p X, and the results go in the
+ *  corresponding rows of \p AX (already the same shape as \p X).  Row r
+ *  belongs to system Systems[r]; operators that are the same for all
+ *  systems can ignore this, while for shifted systems it says which shift
+ *  to use.  Systems drop out of the batch as they converge, so the same
+ *  system is not always in the same row.
+ *
+ *  This is where the cost is, and getting all vectors at once is what
+ *  lets it be done with matrix-matrix rather than matrix-vector products.
+ */
+typedef std::function<void(const std::vector<size_t>& Systems,
+                           const SimpleMatrixD& X,SimpleMatrixD& AX)> KrylovOperator_t;
+
+///Settings for the Krylov solvers
+struct KrylovOptions{
+    double Tol=1e-8;      //!< Converged when residual norm/RHS norm is below this
+    size_t MaxIter=200;   //!< Maximum number of products with A per system
+    size_t Restart=30;    //!< GMRES only, size of the subspace before restarting
+};
+
+///What happened to each system
+struct KrylovResult{
+    std::vector<bool> Converged;     //!< Whether each system converged
+    std::vector<size_t> Iterations;  //!< Products with A used by each system
+    std::vector<double> Residual;    //!< Final relative residual of each system
+    size_t NBatches=0;               //!< Calls made to the operator and preconditioner
+};
+
+/** \brief Makes the operator \f$(A-\omega_sB)\f$ from ones for \f$A\f$ and
+ *         \f$B\f$, with a shift \f$\omega_s\f$ per system
+ *
+ *  For response properties at several frequencies put one copy of each
+ *  right-hand side per frequency in the batch.  The products with \f$A\f$
+ *  and \f$B\f$ are then each one call for all frequencies.
+ *
+ *  \param[in] A The operator for \f$A\f$
+ *  \param[in] B The operator for \f$B\f$, if empty \f$B\f$ is the identity
+ *  \param[in] Shifts \f$\omega_s\f$ for each system s
+ */
+inline KrylovOperator_t ShiftedOperator(KrylovOperator_t A,KrylovOperator_t B,
+                                        std::vector<double> Shifts){
+    return [=](const std::vector<size_t>& Systems,const SimpleMatrixD& X,
+               SimpleMatrixD& AX){
+        A(Systems,X,AX);
+        SimpleMatrixD BX(X.NRows(),X.NCols());
+        if(B)B(Systems,X,BX);
+        else if(X.Size())std::copy(X.Data(),X.Data()+X.Size(),BX.Data());
+        for(size_t r=0;r<X.NRows();++r){
+            const double w=Shifts.at(Systems[r]);
+            for(size_t i=0;i<X.NCols();++i)AX(r,i)-=w*BX(r,i);
+        }
+    };
+}
+
+namespace detail{
+
+inline double RowDot(const double* a,const double* b,size_t n){
+    double sum=0.0;
+    for(size_t i=0;i<n;++i)sum+=a[i]*b[i];
+    return sum;
+}
+
+/** \brief Applies \p Op to rows \p Active of \p Src, putting the results in
+ *         the same rows of \p Dst (an empty \p Op is the identity)
+ */
+inline void ApplyToActive(const KrylovOperator_t& Op,const std::vector<size_t>& Active,
+                          const SimpleMatrixD& Src,SimpleMatrixD& Dst,
+                          KrylovResult& Result){
+    const size_t n=Src.NCols();
+    if(!Op){
+        for(size_t k:Active)
+            std::copy(Src.Data()+k*n,Src.Data()+(k+1)*n,Dst.Data()+k*n);
+        return;
+    }
+    if(Active.empty())return;
+    SimpleMatrixD X(Active.size(),n),AX(Active.size(),n);
+    for(size_t r=0;r<Active.size();++r)
+        std::copy(Src.Data()+Active[r]*n,Src.Data()+(Active[r]+1)*n,X.Data()+r*n);
+    Op(Active,X,AX);
+    ++Result.NBatches;
+    for(size_t r=0;r<Active.size();++r)
+        std::copy(AX.Data()+r*n,AX.Data()+(r+1)*n,Dst.Data()+Active[r]*n);
+}
+
+///Sets up the result and the norms of the right-hand sides
+inline std::vector<double> StartKrylov(const SimpleMatrixD& B,SimpleMatrixD& X,
+                                       KrylovResult& Result){
+    if(X.NRows()!=B.NRows() || X.NCols()!=B.NCols())
+        throw MathException("Guess and right-hand sides have different shapes",
+                            "guessrows",X.NRows(),"guesscols",X.NCols(),
+                            "rhsrows",B.NRows(),"rhscols",B.NCols());
+    const size_t nsys=B.NRows(),n=B.NCols();
+    Result.Converged.assign(nsys,false);
+    Result.Iterations.assign(nsys,0);
+    Result.Residual.assign(nsys,0.0);
+    std::vector<double> BNorm(nsys);
+    for(size_t k=0;k<nsys;++k)
+        BNorm[k]=std::sqrt(RowDot(B.Data()+k*n,B.Data()+k*n,n));
+    return BNorm;
+}
+
+///R = B - A X for the active systems
+inline void Residuals(const KrylovOperator_t& A,const std::vector<size_t>& Active,
+                      const SimpleMatrixD& B,const SimpleMatrixD& X,
+                      SimpleMatrixD& R,KrylovResult& Result){
+    ApplyToActive(A,Active,X,R,Result);
+    const size_t n=B.NCols();
+    for(size_t k:Active)
+        for(size_t i=0;i<n;++i)
+            R(k,i)=B(k,i)-R(k,i);
+}
+
+/** \brief Marks systems whose residual is below \p Tol as converged, then
+ *         removes them (and those out of iterations) from Active
+ *
+ *  Done serially, after the parallel updates, as Converged is a
+ *  vector<bool> and can't be written by several threads.
+ */
+inline void Prune(std::vector<size_t>& Active,KrylovResult& Result,
+                  size_t MaxIter,double Tol){
+    for(size_t k:Active)
+        Result.Converged[k]=Result.Residual[k]<Tol;
+    Active.erase(std::remove_if(Active.begin(),Active.end(),[&](size_t k){
+        return Result.Converged[k] || Result.Iterations[k]>=MaxIter;}),
+        Active.end());
+}
+
+}//End namespace detail
+
+/** \brief Preconditioned conjugate gradient for symmetric positive definite
+ *         systems
+ *
+ *  Each row of \p B is the right-hand side of its own system.  The systems
+ *  are solved independently, but in lock step, so each iteration makes one
+ *  call to \p A (and one to \p M) for all systems that have yet to
+ *  converge.
+ *
+ *  \param[in] A The operator, must be symmetric positive definite
+ *  \param[in] B The right-hand sides, one per row
+ *  \param[in,out] X The initial guesses on entry, the solutions on exit
+ *  \param[in] M Applies the preconditioner (an approximation to
+ *               \f$A^{-1}\f$, symmetric positive definite), or empty for none
+ *  \param[in] Options Tolerance and iteration limit
+ */
+inline KrylovResult ConjugateGradient(const KrylovOperator_t& A,const SimpleMatrixD& B,
+                                      SimpleMatrixD& X,const KrylovOperator_t& M=nullptr,
+                                      const KrylovOptions& Options=KrylovOptions()){
+    KrylovResult Result;
+    const std::vector<double> BNorm=detail::StartKrylov(B,X,Result);
+    const size_t nsys=B.NRows(),n=B.NCols();
+    std::vector<size_t> Active(nsys);
+    for(size_t k=0;k<nsys;++k)Active[k]=k;
+
+    SimpleMatrixD R(nsys,n),Z(nsys,n),P(nsys,n),AP(nsys,n);
+    detail::Residuals(A,Active,B,X,R,Result);
+    for(size_t k:Active){
+        const double r=std::sqrt(detail::RowDot(&R(k,0),&R(k,0),n));
+        Result.Residual[k]=BNorm[k]>0.0?r/BNorm[k]:r;
+        Result.Converged[k]=Result.Residual[k]<Options.Tol;
+    }
+    detail::Prune(Active,Result,Options.MaxIter,Options.Tol);
+    detail::ApplyToActive(M,Active,R,Z,Result);
+    std::vector<double> RZ(nsys,0.0);
+    for(size_t k:Active){
+        std::copy(&Z(k,0),&Z(k,0)+n,&P(k,0));
+        RZ[k]=detail::RowDot(&R(k,0),&Z(k,0),n);
+    }
+
+    while(!Active.empty()){
+        detail::ApplyToActive(A,Active,P,AP,Result);
+        parallel::ParallelFor(0,Active.size(),[&](size_t a){
+            const size_t k=Active[a];
+            double *x=&X(k,0),*r=&R(k,0),*p=&P(k,0),*ap=&AP(k,0);
+            const double pap=detail::RowDot(p,ap,n);
+            const double alpha=pap!=0.0?RZ[k]/pap:0.0;
+            for(size_t i=0;i<n;++i){
+                x[i]+=alpha*p[i];
+                r[i]-=alpha*ap[i];
+            }
+            const double res=std::sqrt(detail::RowDot(r,r,n));
+            Result.Residual[k]=BNorm[k]>0.0?res/BNorm[k]:res;
+            ++Result.Iterations[k];
+        },1);
+        detail::Prune(Active,Result,Options.MaxIter,Options.Tol);
+        if(Active.empty())break;
+
+        detail::ApplyToActive(M,Active,R,Z,Result);
+        for(size_t k:Active){
+            const double rz=detail::RowDot(&R(k,0),&Z(k,0),n);
+            const double beta=RZ[k]!=0.0?rz/RZ[k]:0.0;
+            RZ[k]=rz;
+            for(size_t i=0;i<n;++i)P(k,i)=Z(k,i)+beta*P(k,i);
+        }
+    }
+    return Result;
+}
+
+/** \brief Preconditioned MINRES for symmetric, possibly indefinite, systems
+ *
+ *  This is the case for response equations above the first excitation
+ *  energy, where conjugate gradient can break down.  The systems are
+ *  batched as in ConjugateGradient().  The residual tracked (and tested
+ *  against the tolerance) is the one MINRES minimizes, the residual in the
+ *  norm defined by the preconditioner, relative to the same norm of
+ *  \p B.  Without a preconditioner that's the usual residual.
+ *
+ *  \param[in] A The operator, must be symmetric
+ *  \param[in] B The right-hand sides, one per row
+ *  \param[in,out] X The initial guesses on entry, the solutions on exit
+ *  \param[in] M Applies the preconditioner, which must be symmetric positive
+ *               definite, or empty for none
+ *  \param[in] Options Tolerance and iteration limit
+ *  \throw pulsar::MathException if the preconditioner is found not to be
+ *         positive definite
+ */
+inline KrylovResult MINRES(const KrylovOperator_t& A,const SimpleMatrixD& B,
+                           SimpleMatrixD& X,const KrylovOperator_t& M=nullptr,
+                           const KrylovOptions& Options=KrylovOptions()){
+    KrylovResult Result;
+    detail::StartKrylov(B,X,Result);
+    const size_t nsys=B.NRows(),n=B.NCols();
+    std::vector<size_t> Active(nsys);
+    for(size_t k=0;k<nsys;++k)Active[k]=k;
+
+    //Norms of B in the preconditioner's metric
+    SimpleMatrixD V0(nsys,n),V1(nsys,n),Z1(nsys,n),Z2(nsys,n),
+                  W0(nsys,n),W1(nsys,n),AZ(nsys,n);
+    detail::ApplyToActive(M,Active,B,Z1,Result);
+    std::vector<double> BNorm(nsys);
+    for(size_t k=0;k<nsys;++k)
+        BNorm[k]=std::sqrt(std::max(0.0,detail::RowDot(&B(k,0),&Z1(k,0),n)));
+
+    detail::Residuals(A,Active,B,X,V1,Result);
+    detail::ApplyToActive(M,Active,V1,Z1,Result);
+    std::vector<double> Gamma0(nsys,1.0),Gamma1(nsys),Eta(nsys),
+                        C0(nsys,1.0),C1(nsys,1.0),S0(nsys,0.0),S1(nsys,0.0);
+    V0.Zero();
+    W0.Zero();
+    W1.Zero();
+    std::atomic<bool> NotPD(false);
+    for(size_t k:Active){
+        const double g2=detail::RowDot(&Z1(k,0),&V1(k,0),n);
+        if(g2<0.0)NotPD=true;
+        Gamma1[k]=std::sqrt(std::max(0.0,g2));
+        Eta[k]=Gamma1[k];
+        Result.Residual[k]=BNorm[k]>0.0?Gamma1[k]/BNorm[k]:Gamma1[k];
+        Result.Converged[k]=Result.Residual[k]<Options.Tol;
+    }
+    if(NotPD)
+        throw MathException("MINRES preconditioner is not positive definite");
+    detail::Prune(Active,Result,Options.MaxIter,Options.Tol);
+
+    while(!Active.empty()){
+        for(size_t k:Active)
+            for(size_t i=0;i<n;++i)Z1(k,i)/=Gamma1[k];
+        detail::ApplyToActive(A,Active,Z1,AZ,Result);
+
+        //Lanczos step, the new v ends up in V1 and the previous one in V0
+        std::vector<double> Delta(nsys);
+        for(size_t k:Active){
+            double *v0=&V0(k,0),*v1=&V1(k,0);
+            const double *z=&Z1(k,0),*az=&AZ(k,0);
+            Delta[k]=detail::RowDot(az,z,n);
+            const double a=Delta[k]/Gamma1[k],b=Gamma1[k]/Gamma0[k];
+            for(size_t i=0;i<n;++i)v0[i]=az[i]-a*v1[i]-b*v0[i];
+            std::swap_ranges(v0,v0+n,v1);
+        }
+        detail::ApplyToActive(M,Active,V1,Z2,Result);
+
+        parallel::ParallelFor(0,Active.size(),[&](size_t a){
+            const size_t k=Active[a];
+            const double g2=detail::RowDot(&Z2(k,0),&V1(k,0),n);
+            if(g2<0.0)NotPD=true;
+            const double Gamma2=std::sqrt(std::max(0.0,g2));
+
+            //Givens rotations to keep the tridiagonal least squares solved
+            const double a0=C1[k]*Delta[k]-C0[k]*S1[k]*Gamma1[k];
+            const double a1=std::sqrt(a0*a0+Gamma2*Gamma2);
+            const double a2=S1[k]*Delta[k]+C0[k]*C1[k]*Gamma1[k];
+            const double a3=S0[k]*Gamma1[k];
+            const double c=a1>0.0?a0/a1:1.0,s=a1>0.0?Gamma2/a1:0.0;
+
+            double *w0=&W0(k,0),*w1=&W1(k,0),*x=&X(k,0);
+            const double *z=&Z1(k,0);
+            for(size_t i=0;i<n;++i)
+                w0[i]=a1>0.0?(z[i]-a3*w0[i]-a2*w1[i])/a1:0.0;
+            std::swap_ranges(w0,w0+n,w1);
+            for(size_t i=0;i<n;++i)x[i]+=c*Eta[k]*w1[i];
+
+            Eta[k]=-s*Eta[k];
+            C0[k]=C1[k];C1[k]=c;
+            S0[k]=S1[k];S1[k]=s;
+            Gamma0[k]=Gamma1[k];Gamma1[k]=Gamma2;
+            std::swap_ranges(&Z2(k,0),&Z2(k,0)+n,&Z1(k,0));
+
+            const double res=std::fabs(Eta[k]);
+            Result.Residual[k]=BNorm[k]>0.0?res/BNorm[k]:res;
+            //Gamma2 is zero once the Krylov space contains the solution
+            if(Gamma2==0.0)Result.Residual[k]=0.0;
+            ++Result.Iterations[k];
+        },1);
+        if(NotPD)
+            throw MathException("MINRES preconditioner is not positive definite");
+        detail::Prune(Active,Result,Options.MaxIter,Options.Tol);
+    }
+    return Result;
+}
+
+/** \brief Restarted, flexible GMRES for general systems
+ *
+ *  The preconditioner is applied on the right and the preconditioned
+ *  vectors are kept (flexible GMRES), so it may change from one iteration
+ *  to the next (e.g. an inner iterative solve).  The systems are batched
+ *  as in ConjugateGradient(): each Arnoldi step makes one call to \p M and
+ *  one to \p A for every system still working.  Storage is
+ *  2*Options.Restart+1 vectors per system.
+ *
+ *  \param[in] A The operator
+ *  \param[in] B The right-hand sides, one per row
+ *  \param[in,out] X The initial guesses on entry, the solutions on exit
+ *  \param[in] M Applies the preconditioner, or empty for none
+ *  \param[in] Options Tolerance, iteration limit, and restart length
+ */
+inline KrylovResult GMRES(const KrylovOperator_t& A,const SimpleMatrixD& B,
+                          SimpleMatrixD& X,const KrylovOperator_t& M=nullptr,
+                          const KrylovOptions& Options=KrylovOptions()){
+    KrylovResult Result;
+    const std::vector<double> BNorm=detail::StartKrylov(B,X,Result);
+    const size_t nsys=B.NRows(),n=B.NCols(),m=std::max<size_t>(1,Options.Restart);
+    std::vector<size_t> Active(nsys);
+    for(size_t k=0;k<nsys;++k)Active[k]=k;
+
+    //Per system: Arnoldi vectors, preconditioned vectors, Hessenberg matrix
+    //(column-major, (m+1) by m), Givens rotations, and rotated RHS
+    std::vector<std::vector<double>> V(nsys),Zs(nsys),H(nsys),Cs(nsys),Sn(nsys),G(nsys);
+    SimpleMatrixD R(nsys,n),Vj(nsys,n),Zj(nsys,n),W(nsys,n);
+
+    //Solves the j by j triangular system and adds Z y to x
+    auto Finish=[&](size_t k,size_t j){
+        std::vector<double> y(G[k].begin(),G[k].begin()+j);
+        for(size_t i=j;i>0;--i){
+            for(size_t l=i;l<j;++l)y[i-1]-=H[k][l*(m+1)+i-1]*y[l];
+            y[i-1]/=H[k][(i-1)*(m+1)+i-1];
+        }
+        for(size_t l=0;l<j;++l)
+            for(size_t i=0;i<n;++i)X(k,i)+=y[l]*Zs[k][l*n+i];
+    };
+
+    while(!Active.empty()){
+        detail::Residuals(A,Active,B,X,R,Result);
+        for(size_t k:Active){
+            const double beta=std::sqrt(detail::RowDot(&R(k,0),&R(k,0),n));
+            Result.Residual[k]=BNorm[k]>0.0?beta/BNorm[k]:beta;
+            Result.Converged[k]=Result.Residual[k]<Options.Tol;
+            if(Result.Converged[k])continue;
+            V[k].assign((m+1)*n,0.0);
+            Zs[k].assign(m*n,0.0);
+            H[k].assign((m+1)*m,0.0);
+            Cs[k].assign(m,0.0);
+            Sn[k].assign(m,0.0);
+            G[k].assign(m+1,0.0);
+            G[k][0]=beta;
+            for(size_t i=0;i<n;++i)V[k][i]=R(k,i)/beta;
+        }
+        detail::Prune(Active,Result,Options.MaxIter,Options.Tol);
+
+        std::vector<size_t> Cycle(Active);
+        for(size_t j=0;j<m && !Cycle.empty();++j){
+            for(size_t k:Cycle)
+                std::copy(V[k].begin()+j*n,V[k].begin()+(j+1)*n,&Vj(k,0));
+            detail::ApplyToActive(M,Cycle,Vj,Zj,Result);
+            detail::ApplyToActive(A,Cycle,Zj,W,Result);
+
+            std::vector<char> Done(nsys,0);
+            parallel::ParallelFor(0,Cycle.size(),[&](size_t c){
+                const size_t k=Cycle[c];
+                std::copy(&Zj(k,0),&Zj(k,0)+n,Zs[k].begin()+j*n);
+                double* w=&W(k,0);
+                double* h=H[k].data()+j*(m+1);
+
+                //Modified Gram-Schmidt against the Arnoldi vectors
+                for(size_t i=0;i<=j;++i){
+                    const double* vi=V[k].data()+i*n;
+                    h[i]=detail::RowDot(w,vi,n);
+                    for(size_t l=0;l<n;++l)w[l]-=h[i]*vi[l];
+                }
+                h[j+1]=std::sqrt(detail::RowDot(w,w,n));
+                if(h[j+1]>0.0)
+                    for(size_t l=0;l<n;++l)V[k][(j+1)*n+l]=w[l]/h[j+1];
+
+                //Previous rotations, then a new one to zero h[j+1]
+                for(size_t i=0;i<j;++i){
+                    const double t=Cs[k][i]*h[i]+Sn[k][i]*h[i+1];
+                    h[i+1]=-Sn[k][i]*h[i]+Cs[k][i]*h[i+1];
+                    h[i]=t;
+                }
+                const double d=std::sqrt(h[j]*h[j]+h[j+1]*h[j+1]);
+                Cs[k][j]=d>0.0?h[j]/d:1.0;
+                Sn[k][j]=d>0.0?h[j+1]/d:0.0;
+                const bool Breakdown=(h[j+1]==0.0);
+                h[j]=d;
+                h[j+1]=0.0;
+                G[k][j+1]=-Sn[k][j]*G[k][j];
+                G[k][j]=Cs[k][j]*G[k][j];
+
+                const double res=std::fabs(G[k][j+1]);
+                Result.Residual[k]=BNorm[k]>0.0?res/BNorm[k]:res;
+                ++Result.Iterations[k];
+                if(Result.Residual[k]<Options.Tol || Breakdown || j+1==m ||
+                   Result.Iterations[k]>=Options.MaxIter){
+                    if(d>0.0)Finish(k,j+1);
+                    else if(j>0)Finish(k,j);
+                    Done[k]=1;
+                }
+            },1);
+            Cycle.erase(std::remove_if(Cycle.begin(),Cycle.end(),
+                        [&](size_t k){return Done[k];}),Cycle.end());
+        }
+        //Convergence is decided on the true residual at the restart
+    }
+    return Result;
+}
+
+}}//End namespaces
+#endif /* KRYLOV_HPP */
@@ -0,0 +1,196 @@
+/*! \file
+ *
+ * \brief Solvers for linear systems that keep their factorization
+ */
+
+#ifndef PULSAR_GUARD_MATH__LINEARSOLVER_HPP_
+#define PULSAR_GUARD_MATH__LINEARSOLVER_HPP_
+
+#include <vector>
+#include <algorithm>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/math/BLAS.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+namespace detail{
+
+/** \brief What LUSolver and CholeskySolver have in common
+ *
+ *  The factorization is kept along with the hash of the matrix it came
+ *  from, so asking to factor the same matrix again is (nearly) free.
+ *  Right-hand sides are the rows of a SimpleMatrix; for row-major storage
+ *  that is exactly the column-major n by nrhs layout LAPACK wants, so no
+ *  copies are made.  Large sets of right-hand sides are split into blocks
+ *  of rows which are solved in parallel.
+ *
+ *  \param Derived_t The actual solver, which provides Factor_() and
+ *                   Solve_() (returning LAPACK's info) for the LAPACK calls
+ */
+template<typename Derived_t>
+class CachedFactorization{
+public:
+    /** \brief Factors \p A, unless it is the matrix already factored
+     *
+     *  \return True if a new factorization was made
+     *  \throw pulsar::MathException if \p A isn't square or can't be
+     *         factored
+     */
+    bool Factor(const SimpleMatrixD& A){
+        if(A.NRows()!=A.NCols())
+            throw MathException("Can only solve systems with square matrices",
+                                "nrows",A.NRows(),"ncols",A.NCols());
+        bphash::HashValue Hash=A.MyHash();
+        if(factored_ && Hash==hash_)return false;
+        factored_=false;
+        n_=A.NRows();
+        lu_.assign(A.Data(),A.Data()+A.Size());
+        static_cast<Derived_t*>(this)->Factor_();
+        hash_=std::move(Hash);
+        factored_=true;
+        return true;
+    }
+
+    ///True if there is a factorization to solve with
+    bool IsFactored(void)const noexcept{return factored_;}
+
+    ///The dimension of the factored matrix
+    size_t Dim(void)const noexcept{return n_;}
+
+    /** \brief Solves \f$Ax=b\f$ for each row \f$b\f$ of \p B, in place
+     *
+     *  \param[in,out] B On entry the right-hand sides, one per row; on exit
+     *                   the solutions
+     *  \param[in] BlockSize Number of right-hand sides per LAPACK call
+     *  \throw pulsar::MathException if nothing has been factored or the
+     *         rows of \p B have the wrong length
+     */
+    void Solve(SimpleMatrixD& B,size_t BlockSize=64)const{
+        CheckSolve_(B.NCols());
+        if(B.NRows()==0 || n_==0)return;
+        if(BlockSize==0)BlockSize=B.NRows();
+        const size_t nblocks=(B.NRows()+BlockSize-1)/BlockSize;
+        double* b=B.Data();
+        std::vector<int> Info(nblocks,0);
+        parallel::ParallelFor(0,nblocks,[&](size_t blk){
+            const size_t r0=blk*BlockSize,r1=std::min(r0+BlockSize,B.NRows());
+            Info[blk]=static_cast<const Derived_t*>(this)->Solve_(b+r0*n_,r1-r0);
+        },1);
+        for(int i:Info)
+            if(i!=0)
+                throw MathException("Linear solve failed","info code:",i);
+    }
+
+    ///Solves \f$Ax=b\f$ for a single right-hand side, in place
+    void Solve(std::vector<double>& b)const{
+        CheckSolve_(b.size());
+        if(n_==0)return;
+        const int Info=static_cast<const Derived_t*>(this)->Solve_(b.data(),1);
+        if(Info!=0)
+            throw MathException("Linear solve failed","info code:",Info);
+    }
+
+    ///Returns the solutions for the rows of \p B
+    SimpleMatrixD Solution(const SimpleMatrixD& B,size_t BlockSize=64)const{
+        SimpleMatrixD X(B);
+        Solve(X,BlockSize);
+        return X;
+    }
+
+protected:
+    size_t n_=0;                 //!< Dimension of the matrix
+    std::vector<double> lu_;     //!< The factors, in LAPACK's layout
+    bphash::HashValue hash_;     //!< Hash of the matrix that was factored
+    bool factored_=false;        //!< Whether lu_ is valid
+
+    void CheckSolve_(size_t n)const{
+        if(!factored_)
+            throw MathException("Solve called before a matrix was factored");
+        if(n!=n_)
+            throw MathException("Right-hand side has the wrong length",
+                                "length",n,"dim",n_);
+    }
+};
+
+}//End namespace detail
+
+/** \brief Solves \f$Ax=b\f$ for general square \f$A\f$ via the LU
+ *         decomposition with partial pivoting (LAPACK's dgetrf/dgetrs)
+ *
+ *  \code
+ *  LUSolver Solver(A);
+ *  Solver.Solve(B);      //Rows of B are now A^{-1}b
+ *  Solver.Factor(A);     //Same A, returns false and does nothing
+ *  \endcode
+ */
+class LUSolver:public detail::CachedFactorization<LUSolver>{
+public:
+    LUSolver()=default;
+
+    ///Factors \p A right away
+    explicit LUSolver(const SimpleMatrixD& A){Factor(A);}
+
+private:
+    friend class detail::CachedFactorization<LUSolver>;
+    std::vector<int> ipiv_;  //!< The pivots
+
+    void Factor_(void){
+        int n=n_,info;
+        ipiv_.resize(n_);
+        dgetrf(&n,&n,lu_.data(),&n,ipiv_.data(),&info);
+        if(info>0)
+            throw MathException("Matrix is singular","zero pivot",info);
+        if(info<0)
+            throw MathException("LU factorization failed","info code:",info);
+    }
+
+    //lu_ holds A^T in column-major order, so solve with its transpose
+    int Solve_(double* b,size_t nrhs)const{
+        int n=n_,nb=nrhs,info;
+        char t='T';
+        dgetrs(&t,&n,&nb,const_cast<double*>(lu_.data()),&n,
+               const_cast<int*>(ipiv_.data()),b,&n,&info);
+        return info;
+    }
+};
+
+/** \brief Solves \f$Ax=b\f$ for symmetric positive definite \f$A\f$ via
+ *         the Cholesky decomposition (LAPACK's dpotrf/dpotrs)
+ *
+ *  About half the work and storage of LUSolver.  Only one triangle of
+ *  \f$A\f$ is read; as \f$A\f$ is symmetric it doesn't matter which.
+ */
+class CholeskySolver:public detail::CachedFactorization<CholeskySolver>{
+public:
+    CholeskySolver()=default;
+
+    ///Factors \p A right away
+    explicit CholeskySolver(const SimpleMatrixD& A){Factor(A);}
+
+private:
+    friend class detail::CachedFactorization<CholeskySolver>;
+
+    void Factor_(void){
+        int n=n_,info;
+        char u='L';
+        dpotrf(&u,&n,lu_.data(),&n,&info);
+        if(info>0)
+            throw MathException("Matrix is not positive definite",
+                                "leading minor",info);
+        if(info<0)
+            throw MathException("Cholesky factorization failed","info code:",info);
+    }
+
+    int Solve_(double* b,size_t nrhs)const{
+        int n=n_,nb=nrhs,info;
+        char u='L';
+        dpotrs(&u,&n,&nb,const_cast<double*>(lu_.data()),&n,b,&n,&info);
+        return info;
+    }
+};
+
+}}//End namespaces
+#endif /* LINEARSOLVER_HPP */
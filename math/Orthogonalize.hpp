@@ -0,0 +1,186 @@
+/*! \file
+ *
+ * \brief QR decompositions and orthonormalization of sets of column vectors
+ */
+
+#ifndef PULSAR_GUARD_MATH__ORTHOGONALIZE_HPP_
+#define PULSAR_GUARD_MATH__ORTHOGONALIZE_HPP_
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/math/BLAS.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+///The return type of the QR decompositions: Q then R
+typedef std::tuple<SimpleMatrixD,SimpleMatrixD> QRReturn_t;
+
+/** \brief Thin QR decomposition via (blocked) Householder reflections
+ *
+ *  For an m by n matrix \f$A\f$, with \f$k=\min(m,n)\f$, finds the m by k
+ *  matrix \f$Q\f$ with orthonormal columns and the k by n upper
+ *  triangular \f$R\f$ such that \f$A=QR\f$.  This is LAPACK's dgeqrf and
+ *  dorgqr, which apply the reflections in blocks via matrix multiplies.
+ *
+ *  \param[in] A The matrix to decompose
+ *  \return A tuple of \f$Q\f$ and \f$R\f$
+ */
+inline QRReturn_t HouseholderQR(const SimpleMatrixD& A){
+    int m=A.NRows(),n=A.NCols(),k=std::min(m,n),info,lwork=-1;
+    SimpleMatrixD Q(m,k),R(k,n);
+    R.Zero();
+    if(k==0)return std::make_tuple(std::move(Q),std::move(R));
+
+    //Fortran wants column-major, so transpose on the way in
+    std::vector<double> CM(m*n),tau(k);
+    for(int i=0;i<m;++i)
+        for(int j=0;j<n;++j)
+            CM[j*m+i]=A(i,j);
+
+    double wkopt;
+    dgeqrf(&m,&n,CM.data(),&m,tau.data(),&wkopt,&lwork,&info);
+    lwork=(int)wkopt;
+    std::vector<double> work(lwork);
+    dgeqrf(&m,&n,CM.data(),&m,tau.data(),work.data(),&lwork,&info);
+    if(info!=0)
+        throw PulsarException("QR decomposition failed","info code:",info);
+
+    for(int i=0;i<k;++i)
+        for(int j=i;j<n;++j)
+            R(i,j)=CM[j*m+i];
+
+    lwork=-1;
+    dorgqr(&m,&k,&k,CM.data(),&m,tau.data(),&wkopt,&lwork,&info);
+    lwork=(int)wkopt;
+    work.resize(lwork);
+    dorgqr(&m,&k,&k,CM.data(),&m,tau.data(),work.data(),&lwork,&info);
+    if(info!=0)
+        throw PulsarException("Forming Q of the QR decomposition failed",
+                              "info code:",info);
+
+    for(int i=0;i<m;++i)
+        for(int j=0;j<k;++j)
+            Q(i,j)=CM[j*m+i];
+    return std::make_tuple(std::move(Q),std::move(R));
+}
+
+/** \brief Thin QR decomposition of a tall-skinny matrix (TSQR)
+ *
+ *  The rows of \f$A\f$ are split into \p NBlocks blocks, each of which is
+ *  QR decomposed independently (and in parallel).  The stacked R factors
+ *  are then QR decomposed once more, which gives the final R, and the
+ *  final Q is each block's Q times its piece of the second Q.  Compared to
+ *  Householder QR of the whole matrix, this only ever works on blocks that
+ *  fit in cache and parallelizes over them.
+ *
+ *  \param[in] A The matrix to decompose, should have many more rows than
+ *               columns
+ *  \param[in] NBlocks The number of row blocks.  Each block needs at
+ *                     least as many rows as \f$A\f$ has columns, so fewer
+ *                     blocks may be used.  0 picks blocks of about 4n rows.
+ *  \return A tuple of \f$Q\f$ and \f$R\f$
+ */
+inline QRReturn_t TSQR(const SimpleMatrixD& A,size_t NBlocks=0){
+    const size_t m=A.NRows(),n=A.NCols();
+    if(n==0 || m<2*n)return HouseholderQR(A);
+    if(NBlocks==0)NBlocks=m/(4*n);
+    NBlocks=std::max<size_t>(1,std::min(NBlocks,m/n));
+    if(NBlocks==1)return HouseholderQR(A);
+
+    //Row ranges of the blocks, the first few get any extra rows
+    std::vector<size_t> Start(NBlocks+1,0);
+    for(size_t b=0;b<NBlocks;++b)
+        Start[b+1]=Start[b]+m/NBlocks+(b<m%NBlocks?1:0);
+
+    std::vector<SimpleMatrixD> Qs(NBlocks);
+    SimpleMatrixD Stack(NBlocks*n,n);
+    parallel::ParallelFor(0,NBlocks,[&](size_t b){
+        SimpleMatrixD Block(Start[b+1]-Start[b],n,A.Data()+Start[b]*n);
+        QRReturn_t QR=HouseholderQR(Block);
+        Qs[b]=std::move(std::get<0>(QR));
+        std::copy(std::get<1>(QR).Data(),std::get<1>(QR).Data()+n*n,
+                  Stack.Data()+b*n*n);
+    },1);
+
+    QRReturn_t QR2=HouseholderQR(Stack);
+    const SimpleMatrixD& Q2=std::get<0>(QR2);
+
+    SimpleMatrixD Q(m,n);
+    parallel::ParallelFor(0,NBlocks,[&](size_t b){
+        Gemm(false,false,Start[b+1]-Start[b],n,n,1.0,Qs[b].Data(),n,
+             Q2.Data()+b*n*n,n,0.0,Q.Data()+Start[b]*n,n);
+    },1);
+    return std::make_tuple(std::move(Q),std::move(std::get<1>(QR2)));
+}
+
+/** \brief Orthonormalizes new vectors against a basis and each other
+ *
+ *  The vectors are the columns of the matrices.  The columns of \p W are
+ *  projected out of the orthonormal basis \p V with block classical
+ *  Gram-Schmidt, \f$W\leftarrow W-V(V^TW)\f$, which is two matrix
+ *  multiplies.  Classical Gram-Schmidt loses orthogonality in finite
+ *  precision, so the projection is done twice ("twice is enough").  The
+ *  remainder is then orthonormalized with TSQR.
+ *
+ *  Columns of \p W that are (numerically) in the span of \p V or of the
+ *  other new columns are dropped, hence the result may have fewer columns
+ *  than \p W.
+ *
+ *  \param[in] V The current basis, m by k, with orthonormal columns (k may
+ *               be 0)
+ *  \param[in] W The new vectors, m by p
+ *  \param[in] Tol A column is dropped if the norm of what remains of it,
+ *                 relative to its original norm, is below this
+ *  \return An m by p' matrix (p'<=p) of orthonormal columns that are also
+ *          orthogonal to the columns of \p V
+ */
+inline SimpleMatrixD BlockGramSchmidt(const SimpleMatrixD& V,
+                                      const SimpleMatrixD& W,
+                                      double Tol=1e-10){
+    const size_t m=W.NRows(),p=W.NCols(),k=V.NCols();
+    if(k>0 && V.NRows()!=m)
+        throw PulsarException("Basis and new vectors have different lengths",
+                              "basis",V.NRows(),"new",m);
+
+    std::vector<double> Norms(p,0.0);
+    for(size_t i=0;i<m;++i)
+        for(size_t j=0;j<p;++j)
+            Norms[j]+=W(i,j)*W(i,j);
+
+    SimpleMatrixD X(W);
+    if(k>0){
+        SimpleMatrixD C(k,p);
+        for(size_t pass=0;pass<2;++pass){
+            Gemm(true,false,k,p,m,1.0,V.Data(),k,X.Data(),p,0.0,C.Data(),p);
+            Gemm(false,false,m,p,k,-1.0,V.Data(),k,C.Data(),p,1.0,X.Data(),p);
+        }
+    }
+
+    QRReturn_t QR=TSQR(X);
+    const SimpleMatrixD& R=std::get<1>(QR);
+
+    std::vector<size_t> Keep;
+    for(size_t j=0;j<std::min(p,R.NRows());++j)
+        if(std::fabs(R(j,j))>Tol*std::sqrt(Norms[j]))
+            Keep.push_back(j);
+    if(Keep.size()==p)return std::move(std::get<0>(QR));
+
+    //The Q columns of dropped vectors are arbitrary directions (not
+    //necessarily orthogonal to V) and later columns were orthogonalized
+    //against them, so factor just the independent vectors again
+    SimpleMatrixD Kept(m,Keep.size());
+    for(size_t i=0;i<m;++i)
+        for(size_t j=0;j<Keep.size();++j)
+            Kept(i,j)=X(i,Keep[j]);
+    return std::move(std::get<0>(TSQR(Kept)));
+}
+
+}}//End namespaces
+#endif /* ORTHOGONALIZE_HPP */
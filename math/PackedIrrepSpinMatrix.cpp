@@ -0,0 +1,22 @@
+/*! \file
+ *
+ * \brief Matrices blocked by irrep and spin, with all blocks in one buffer
+ */
+
+
+#include "pulsar/math/PackedIrrepSpinMatrix.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+
+// Explicit instantiations
+template class PackedIrrepSpinMatrix<float>;
+template class PackedIrrepSpinMatrix<double>;
+template class PackedIrrepSpinMatrix<std::complex<float>>;
+template class PackedIrrepSpinMatrix<std::complex<double>>;
+
+} // close namespace math
+} // close namespace pulsar
+
@@ -0,0 +1,376 @@
+/*! \file
+ *
+ * \brief Matrices blocked by irrep and spin, with all blocks in one buffer
+ */
+
+#ifndef PULSAR_GUARD_MATH__PACKEDIRREPSPINMATRIX_HPP_
+#define PULSAR_GUARD_MATH__PACKEDIRREPSPINMATRIX_HPP_
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/IrrepSpinMatrix.hpp"
+#include "pulsar/util/Serialization.hpp"
+#include "bphash/Hasher.hpp"
+#include "bphash/types/complex.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+/*! \brief Holds the same data as an IrrepSpinMatrix, but in a single
+ *         allocation
+ *
+ * Each block of a BlockByIrrepSpin<SimpleMatrix<T>> is a separate heap
+ * allocation.  Here all blocks live in one arena and a table holds the
+ * offset and shape of each block.  Each block starts on a cache line
+ * boundary (Alignment bytes); the padding between blocks is kept zero.
+ *
+ * Since the arena is contiguous, copying, zeroing, and hashing are each a
+ * single pass over one buffer, and the whole object can be handed to
+ * anything that wants a pointer and a length (e.g. a checkpoint or a
+ * message) via Data() and Size().
+ *
+ * The blocks are stored in the order of their (irrep, spin) keys.
+ *
+ * \tparam T The type of data stored in the matrices
+ *
+ * \par Hashing
+ *     The hash value is unique with respect to the block layout and the
+ *     values in the blocks.
+ */
+template<typename T>
+class PackedIrrepSpinMatrix
+{
+    public:
+        ///Each block starts on a multiple of this many bytes
+        static constexpr size_t Alignment = 64;
+
+        /*! \brief Constructs an object with no blocks */
+        PackedIrrepSpinMatrix() : size_(0) { }
+
+        /*! \brief Copies an IrrepSpinMatrix into the packed layout */
+        explicit PackedIrrepSpinMatrix(const BlockByIrrepSpin<SimpleMatrix<T>> & m)
+            : size_(0)
+        {
+            for(Irrep irrep : m.GetIrreps())
+                for(int spin : m.GetSpins(irrep))
+                {
+                    const SimpleMatrix<T> & b = m.Get(irrep, spin);
+                    AddBlock_(irrep, spin, b.NRows(), b.NCols());
+                }
+            Allocate_();
+
+            for(const auto & it : index_)
+            {
+                const BlockInfo_ & info = blocks_[it.second];
+                const SimpleMatrix<T> & b = m.Get(it.first.first, it.first.second);
+                std::copy(b.Data(), b.Data() + b.Size(), data_.get() + info.offset);
+            }
+        }
+
+        /*! \brief Creates zeroed blocks with the same layout as \p m
+         *
+         * Only the dimensions of the blocks of \p m are used.
+         */
+        template<typename U>
+        static PackedIrrepSpinMatrix SameLayout(const BlockByIrrepSpin<SimpleMatrix<U>> & m)
+        {
+            PackedIrrepSpinMatrix ret;
+            for(Irrep irrep : m.GetIrreps())
+                for(int spin : m.GetSpins(irrep))
+                {
+                    const SimpleMatrix<U> & b = m.Get(irrep, spin);
+                    ret.AddBlock_(irrep, spin, b.NRows(), b.NCols());
+                }
+            ret.Allocate_();
+            return ret;
+        }
+
+        /*! \brief Deep copy constructor (one copy of the arena) */
+        PackedIrrepSpinMatrix(const PackedIrrepSpinMatrix & rhs)
+            : index_(rhs.index_), blocks_(rhs.blocks_), size_(0)
+        {
+            Allocate_();
+            if(size_)
+                std::copy(rhs.data_.get(), rhs.data_.get() + size_, data_.get());
+        }
+
+        PackedIrrepSpinMatrix(PackedIrrepSpinMatrix && rhs)
+            : index_(std::move(rhs.index_)), blocks_(std::move(rhs.blocks_)),
+              size_(rhs.size_), data_(std::move(rhs.data_))
+        {
+            rhs.size_ = 0;
+        }
+
+        PackedIrrepSpinMatrix & operator=(PackedIrrepSpinMatrix && rhs)
+        {
+            index_ = std::move(rhs.index_);
+            blocks_ = std::move(rhs.blocks_);
+            size_ = rhs.size_;
+            data_ = std::move(rhs.data_);
+            rhs.size_ = 0;
+            return *this;
+        }
+
+        PackedIrrepSpinMatrix & operator=(const PackedIrrepSpinMatrix & rhs)
+        {
+            using std::swap;
+
+            if(this != &rhs)
+            {
+                PackedIrrepSpinMatrix tmp(rhs);
+                swap(*this, tmp);
+            }
+            return *this;
+        }
+
+        /*! \brief Comparison
+         *
+         * The layouts must match and the values must match exactly
+         */
+        bool operator==(const PackedIrrepSpinMatrix & rhs) const
+        {
+            PRAGMA_WARNING_PUSH
+            PRAGMA_WARNING_IGNORE_FP_EQUALITY
+            return index_ == rhs.index_ && blocks_ == rhs.blocks_ &&
+                   std::equal(data_.get(), data_.get() + size_, rhs.data_.get());
+            PRAGMA_WARNING_POP
+        }
+
+        /// Inequality comparison
+        bool operator!=(const PackedIrrepSpinMatrix & rhs) const
+        {
+            return !((*this) == rhs);
+        }
+
+        /// Copies the blocks back out to an IrrepSpinMatrix
+        BlockByIrrepSpin<SimpleMatrix<T>> Unpack(void) const
+        {
+            BlockByIrrepSpin<SimpleMatrix<T>> ret;
+            for(const auto & it : index_)
+            {
+                const BlockInfo_ & info = blocks_[it.second];
+                ret.Take(it.first.first, it.first.second,
+                         SimpleMatrix<T>(info.nrows, info.ncols, data_.get() + info.offset));
+            }
+            return ret;
+        }
+
+        /// Number of blocks
+        size_t NBlocks(void) const noexcept { return blocks_.size(); }
+
+        /// Does this have a block for the given irrep and spin
+        bool Has(Irrep irrep, int spin) const
+        {
+            return index_.count(std::make_pair(irrep, spin));
+        }
+
+        /// Number of rows of a block
+        size_t NRows(Irrep irrep, int spin) const { return Info_(irrep, spin).nrows; }
+
+        /// Number of columns of a block
+        size_t NCols(Irrep irrep, int spin) const { return Info_(irrep, spin).ncols; }
+
+        /// Pointer to the start of a block (row-major, like SimpleMatrix)
+        T * Block(Irrep irrep, int spin)
+        {
+            return data_.get() + Info_(irrep, spin).offset;
+        }
+
+        /// Pointer to the start of a block (row-major, like SimpleMatrix)
+        const T * Block(Irrep irrep, int spin) const
+        {
+            return data_.get() + Info_(irrep, spin).offset;
+        }
+
+        /*! \brief Obtain a reference to an element of a block
+         *
+         * \throw pulsar::MathException if the block doesn't exist or the
+         *        row or column is out of range
+         */
+        T & At(Irrep irrep, int spin, size_t row, size_t col)
+        {
+            const BlockInfo_ & info = Info_(irrep, spin);
+            CheckIndices_(info, row, col);
+            return data_[info.offset + row*info.ncols + col];
+        }
+
+        /*! \brief Obtain a const reference to an element of a block
+         *
+         * \throw pulsar::MathException if the block doesn't exist or the
+         *        row or column is out of range
+         */
+        const T & At(Irrep irrep, int spin, size_t row, size_t col) const
+        {
+            const BlockInfo_ & info = Info_(irrep, spin);
+            CheckIndices_(info, row, col);
+            return data_[info.offset + row*info.ncols + col];
+        }
+
+        /// Total length of the arena (including padding between blocks)
+        size_t Size(void) const noexcept { return size_; }
+
+        /// Pointer to the arena
+        T * Data(void) noexcept { return data_.get(); }
+
+        /// Pointer to the arena
+        const T * Data(void) const noexcept { return data_.get(); }
+
+        /// Fill all blocks with zeroes
+        void Zero(void)
+        {
+            std::fill(data_.get(), data_.get() + size_, static_cast<T>(0));
+        }
+
+        bphash::HashValue MyHash(void) const
+        {
+            return bphash::MakeHash(bphash::HashType::Hash128, *this);
+        }
+
+
+    private:
+        ///Where a block lives in the arena
+        struct BlockInfo_
+        {
+            size_t offset;  //!< Offset (in elements) from the start of the arena
+            size_t nrows;   //!< Number of rows of the block
+            size_t ncols;   //!< Number of columns of the block
+
+            bool operator==(const BlockInfo_ & rhs) const
+            {
+                return offset == rhs.offset && nrows == rhs.nrows && ncols == rhs.ncols;
+            }
+        };
+
+        ///Frees memory from posix_memalign
+        struct Free_
+        {
+            void operator()(T * p) const { std::free(p); }
+        };
+
+        std::map<std::pair<Irrep, int>, size_t> index_;  //!< Key -> position in blocks_
+        std::vector<BlockInfo_> blocks_;  //!< Layout of the arena
+        size_t size_;                     //!< Length of the arena (elements)
+        std::unique_ptr<T[], Free_> data_;  //!< The arena
+
+        const BlockInfo_ & Info_(Irrep irrep, int spin) const
+        {
+            auto it = index_.find(std::make_pair(irrep, spin));
+            if(it == index_.end())
+                throw MathException("No block for this irrep and spin",
+                                    "irrep", static_cast<int>(irrep), "spin", spin);
+            return blocks_[it->second];
+        }
+
+        void CheckIndices_(const BlockInfo_ & info, size_t row, size_t col) const
+        {
+            if(row >= info.nrows)
+                throw MathException("Row out of range", "row", row, "nrows", info.nrows);
+            if(col >= info.ncols)
+                throw MathException("Column out of range", "col", col, "ncols", info.ncols);
+        }
+
+        ///Appends a block to the layout (before Allocate_)
+        void AddBlock_(Irrep irrep, int spin, size_t nrows, size_t ncols)
+        {
+            const size_t align = std::max<size_t>(1, Alignment / sizeof(T));
+            size_ = (size_ + align - 1) / align * align;
+            index_[std::make_pair(irrep, spin)] = blocks_.size();
+            blocks_.push_back(BlockInfo_{size_, nrows, ncols});
+            size_ += nrows * ncols;
+        }
+
+        ///Recomputes size_ from the layout and allocates a zeroed arena
+        void Allocate_(void)
+        {
+            size_ = 0;
+            for(const auto & b : blocks_)
+                size_ = std::max(size_, b.offset + b.nrows * b.ncols);
+
+            void * mem = nullptr;
+            if(posix_memalign(&mem, Alignment, std::max<size_t>(size_, 1) * sizeof(T)))
+                throw MathException("Unable to allocate packed irrep/spin matrix",
+                                    "size", size_);
+            data_ = std::unique_ptr<T[], Free_>(static_cast<T *>(mem));
+            std::uninitialized_fill(data_.get(), data_.get() + size_, static_cast<T>(0));
+        }
+
+
+        //! \name Serialization
+        ///@{
+
+        DECLARE_SERIALIZATION_FRIENDS
+        friend class bphash::Hasher;
+
+        template<class Archive>
+        void save(Archive & ar) const
+        {
+            ar(index_.size());
+            for(const auto & it : index_)
+            {
+                const BlockInfo_ & info = blocks_[it.second];
+                ar(static_cast<int>(it.first.first), it.first.second,
+                   info.nrows, info.ncols);
+            }
+            for(size_t i = 0; i < size_; i++)
+                ar(data_[i]);
+        }
+
+        template<class Archive>
+        void load(Archive & ar)
+        {
+            size_t nblocks;
+            ar(nblocks);
+
+            index_.clear();
+            blocks_.clear();
+            size_ = 0;
+            for(size_t i = 0; i < nblocks; i++)
+            {
+                int irrep, spin;
+                size_t nrows, ncols;
+                ar(irrep, spin, nrows, ncols);
+                AddBlock_(static_cast<Irrep>(irrep), spin, nrows, ncols);
+            }
+            Allocate_();
+            for(size_t i = 0; i < size_; i++)
+                ar(data_[i]);
+        }
+
+        void hash(bphash::Hasher & h) const
+        {
+            h(size_);
+            for(const auto & it : index_)
+            {
+                const BlockInfo_ & info = blocks_[it.second];
+                h(static_cast<int>(it.first.first), it.first.second,
+                  info.offset, info.nrows, info.ncols);
+            }
+            h(bphash::HashPointer(data_.get(), size_));
+        }
+
+        ///@}
+};
+
+
+// Explicit instantiations
+extern template class PackedIrrepSpinMatrix<float>;
+extern template class PackedIrrepSpinMatrix<double>;
+extern template class PackedIrrepSpinMatrix<std::complex<float>>;
+extern template class PackedIrrepSpinMatrix<std::complex<double>>;
+
+typedef PackedIrrepSpinMatrix<float>  PackedIrrepSpinMatrixF;
+typedef PackedIrrepSpinMatrix<double> PackedIrrepSpinMatrixD;
+typedef PackedIrrepSpinMatrix<std::complex<float>>  PackedIrrepSpinMatrixCF;
+typedef PackedIrrepSpinMatrix<std::complex<double>> PackedIrrepSpinMatrixCD;
+
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
@@ -0,0 +1,305 @@
+/*! \file
+ *
+ * \brief Kernels over all pairs of points: distance matrices and Coulomb sums
+ */
+
+#ifndef PULSAR_GUARD_MATH__PAIRWISE_HPP_
+#define PULSAR_GUARD_MATH__PAIRWISE_HPP_
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+/*! \brief Points stored as separate x, y, and z arrays
+ *
+ * The pair kernels vectorize over the second point of each pair, which
+ * needs the coordinates of consecutive points to be contiguous.  Those
+ * loops are marked omp simd; pulsar_math builds its users with
+ * -fopenmp-simd (which needs no OpenMP runtime) and -fno-math-errno,
+ * without which GCC won't vectorize a loop containing a sqrt.
+ */
+struct CoordinatesSoA{
+    std::vector<double> x,y,z;
+
+    CoordinatesSoA()=default;
+
+    ///Converts from the usual array of points
+    explicit CoordinatesSoA(const std::vector<std::array<double,3>>& Points)
+        :x(Points.size()),y(Points.size()),z(Points.size()){
+        for(size_t i=0;i<Points.size();++i){
+            x[i]=Points[i][0];
+            y[i]=Points[i][1];
+            z[i]=Points[i][2];
+        }
+    }
+
+    size_t Size(void)const noexcept{return x.size();}
+};
+
+namespace detail{
+
+///The tile pairs (I,J), J>=I, covering the upper triangle of an n by n matrix
+inline std::vector<std::array<size_t,2>> UpperTiles(size_t n,size_t Tile){
+    const size_t nt=(n+Tile-1)/Tile;
+    std::vector<std::array<size_t,2>> Tiles;
+    Tiles.reserve(nt*(nt+1)/2);
+    for(size_t I=0;I<nt;++I)
+        for(size_t J=I;J<nt;++J)
+            Tiles.push_back({I,J});
+    return Tiles;
+}
+
+/*! \brief Fills a matrix with f(r) over all pairs, computing only j>=i
+ *
+ * The matrix is split into Tile by Tile blocks and the blocks of the upper
+ * triangle are spread over the threads.  Each block is also written to
+ * its mirror image, which stays in cache because the blocks are small.
+ */
+template<typename Fxn_t>
+SimpleMatrixD PairMatrix(const CoordinatesSoA& P,size_t Tile,Fxn_t f){
+    const size_t n=P.Size();
+    if(Tile==0)
+        throw MathException("Tile size must be positive");
+    SimpleMatrixD M(n,n);
+    double* m=M.Data();
+    const double *x=P.x.data(),*y=P.y.data(),*z=P.z.data();
+    const auto Tiles=UpperTiles(n,Tile);
+    parallel::ParallelFor(0,Tiles.size(),[&](size_t t){
+        const size_t i0=Tiles[t][0]*Tile,i1=std::min(i0+Tile,n);
+        const size_t j0=Tiles[t][1]*Tile,j1=std::min(j0+Tile,n);
+        for(size_t i=i0;i<i1;++i){
+            const size_t jstart=std::max(j0,i);
+            double* mi=m+i*n;
+            const double xi=x[i],yi=y[i],zi=z[i];
+            #pragma omp simd
+            for(size_t j=jstart;j<j1;++j){
+                const double dx=xi-x[j],dy=yi-y[j],dz=zi-z[j];
+                mi[j]=f(dx*dx+dy*dy+dz*dz);
+            }
+            for(size_t j=jstart;j<j1;++j)
+                m[j*n+i]=mi[j];
+        }
+    },1);
+    return M;
+}
+
+}//End namespace detail
+
+/** \brief The matrix of all distances between the points
+ *
+ *  \param[in] P The points
+ *  \param[in] Tile The edge length of the blocks the work is split into
+ */
+inline SimpleMatrixD DistanceMatrix(const CoordinatesSoA& P,size_t Tile=64){
+    return detail::PairMatrix(P,Tile,[](double r2){return std::sqrt(r2);});
+}
+
+/** \brief The matrix of all inverse distances between the points
+ *
+ *  The diagonal is set to zero, as are the elements of any other
+ *  coincident points.
+ *
+ *  \param[in] P The points
+ *  \param[in] Tile The edge length of the blocks the work is split into
+ */
+inline SimpleMatrixD InverseDistanceMatrix(const CoordinatesSoA& P,size_t Tile=64){
+    return detail::PairMatrix(P,Tile,
+                  [](double r2){return r2>0.0?1.0/std::sqrt(r2):0.0;});
+}
+
+/** \brief The Coulomb energy \f$\sum_{i<j}q_iq_j/r_{ij}\f$ of a set of charges
+ *
+ *  Nothing of size \f$N^2\f$ is formed; tiles of the upper triangle of
+ *  pairs are summed in parallel.
+ *
+ *  The points must be distinct: two coincident points make the energy
+ *  infinite (or NaN).  This isn't checked, since skipping such pairs
+ *  would take a branch in the inner loop and keep it from vectorizing.
+ *
+ *  \param[in] P The positions of the charges
+ *  \param[in] Q The charges
+ *  \param[in] Tile The edge length of the blocks of pairs
+ *  \throw pulsar::MathException if \p P and \p Q differ in length
+ */
+inline double CoulombEnergy(const CoordinatesSoA& P,const std::vector<double>& Q,
+                            size_t Tile=256){
+    const size_t n=P.Size();
+    if(Q.size()!=n)
+        throw MathException("Number of charges and points differ",
+                            "npoints",n,"ncharges",Q.size());
+    if(Tile==0)
+        throw MathException("Tile size must be positive");
+    const double *x=P.x.data(),*y=P.y.data(),*z=P.z.data(),*q=Q.data();
+    const auto Tiles=detail::UpperTiles(n,Tile);
+    return parallel::ParallelReduce(0,Tiles.size(),0.0,[&](size_t t,double& E){
+        const size_t i0=Tiles[t][0]*Tile,i1=std::min(i0+Tile,n);
+        const size_t j0=Tiles[t][1]*Tile,j1=std::min(j0+Tile,n);
+        for(size_t i=i0;i<i1;++i){
+            const double xi=x[i],yi=y[i],zi=z[i];
+            double Ei=0.0;
+            #pragma omp simd reduction(+:Ei)
+            for(size_t j=std::max(j0,i+1);j<j1;++j){
+                const double dx=xi-x[j],dy=yi-y[j],dz=zi-z[j];
+                Ei+=q[j]/std::sqrt(dx*dx+dy*dy+dz*dz);
+            }
+            E+=q[i]*Ei;
+        }
+    },std::plus<double>(),1);
+}
+
+/** \brief The Coulomb energy of a set of charges and its gradient
+ *
+ *  Each thread owns whole rows \f$i\f$ and sums over all \f$j\f$, so every
+ *  pair is visited twice.  In exchange no thread ever writes to another
+ *  thread's part of the gradient, so there are no atomics or per-thread
+ *  copies of the gradient (which for \f$10^5\f$ charges would be larger
+ *  than the cache).
+ *
+ *  As for the energy, the points must be distinct.
+ *
+ *  \param[in] P The positions of the charges
+ *  \param[in] Q The charges
+ *  \param[out] Grad Resized to 3N and set to \f$\partial E/\partial r_i\f$,
+ *                   x, y, and z of each point in turn
+ *  \return The energy
+ *  \throw pulsar::MathException if \p P and \p Q differ in length
+ */
+inline double CoulombGradient(const CoordinatesSoA& P,const std::vector<double>& Q,
+                              std::vector<double>& Grad){
+    const size_t n=P.Size();
+    if(Q.size()!=n)
+        throw MathException("Number of charges and points differ",
+                            "npoints",n,"ncharges",Q.size());
+    const double *x=P.x.data(),*y=P.y.data(),*z=P.z.data(),*q=Q.data();
+    Grad.assign(3*n,0.0);
+    const double E=parallel::ParallelReduce(0,n,0.0,[&](size_t i,double& E){
+        const double xi=x[i],yi=y[i],zi=z[i];
+        double Ei=0.0,gx=0.0,gy=0.0,gz=0.0;
+        #pragma omp simd reduction(+:Ei,gx,gy,gz)
+        for(size_t j=0;j<n;++j){
+            const double dx=xi-x[j],dy=yi-y[j],dz=zi-z[j];
+            const double r2=dx*dx+dy*dy+dz*dz;
+            const double rinv=(j==i?0.0:1.0/std::sqrt(r2));
+            const double qr=q[j]*rinv;
+            const double qr3=qr*rinv*rinv;
+            Ei+=qr;
+            gx-=qr3*dx;
+            gy-=qr3*dy;
+            gz-=qr3*dz;
+        }
+        E+=q[i]*Ei;
+        Grad[3*i]=q[i]*gx;
+        Grad[3*i+1]=q[i]*gy;
+        Grad[3*i+2]=q[i]*gz;
+    },std::plus<double>(),64);
+    return 0.5*E;
+}
+
+/** \brief The Coulomb energy \f$\sum_{i\in A,j\in B}q_iq_j/r_{ij}\f$ between
+ *         two sets of charges
+ *
+ *  This is the interaction of, e.g., a QM region with a point-charge
+ *  embedding.  The two sets must not share any points; a shared point
+ *  makes the energy infinite.  As for a single set, this isn't checked.
+ *
+ *  \param[in] A, QA The positions and charges of the first set
+ *  \param[in] B, QB The positions and charges of the second set
+ *  \param[in] Tile The number of points of \p B handled at once
+ *  \throw pulsar::MathException if a set of points and its charges differ
+ *         in length
+ */
+inline double CoulombEnergy(const CoordinatesSoA& A,const std::vector<double>& QA,
+                            const CoordinatesSoA& B,const std::vector<double>& QB,
+                            size_t Tile=1024){
+    const size_t na=A.Size(),nb=B.Size();
+    if(QA.size()!=na || QB.size()!=nb)
+        throw MathException("Number of charges and points differ",
+                            "npointsA",na,"nchargesA",QA.size(),
+                            "npointsB",nb,"nchargesB",QB.size());
+    if(Tile==0)
+        throw MathException("Tile size must be positive");
+    const double *xb=B.x.data(),*yb=B.y.data(),*zb=B.z.data(),*qb=QB.data();
+    const size_t ntiles=(nb+Tile-1)/Tile;
+    return parallel::ParallelReduce(0,ntiles,0.0,[&](size_t t,double& E){
+        const size_t j0=t*Tile,j1=std::min(j0+Tile,nb);
+        for(size_t i=0;i<na;++i){
+            const double xi=A.x[i],yi=A.y[i],zi=A.z[i];
+            double Ei=0.0;
+            #pragma omp simd reduction(+:Ei)
+            for(size_t j=j0;j<j1;++j){
+                const double dx=xi-xb[j],dy=yi-yb[j],dz=zi-zb[j];
+                Ei+=qb[j]/std::sqrt(dx*dx+dy*dy+dz*dz);
+            }
+            E+=QA[i]*Ei;
+        }
+    },std::plus<double>(),1);
+}
+
+/** \brief The Coulomb energy between two sets of charges and its gradient
+ *         with respect to the positions of both
+ *
+ *  Done in two sweeps, one parallel over the points of \p A and one over
+ *  those of \p B, for the same reason as the single-set version.  The
+ *  two sets must not share any points.
+ *
+ *  \param[in] A, QA The positions and charges of the first set
+ *  \param[in] B, QB The positions and charges of the second set
+ *  \param[out] GradA Resized to 3N_A, the gradient for the points of \p A
+ *  \param[out] GradB Resized to 3N_B, the gradient for the points of \p B
+ *  \return The energy
+ *  \throw pulsar::MathException if a set of points and its charges differ
+ *         in length
+ */
+inline double CoulombGradient(const CoordinatesSoA& A,const std::vector<double>& QA,
+                              const CoordinatesSoA& B,const std::vector<double>& QB,
+                              std::vector<double>& GradA,std::vector<double>& GradB){
+    const size_t na=A.Size(),nb=B.Size();
+    if(QA.size()!=na || QB.size()!=nb)
+        throw MathException("Number of charges and points differ",
+                            "npointsA",na,"nchargesA",QA.size(),
+                            "npointsB",nb,"nchargesB",QB.size());
+
+    //Gradient on the points of P due to the charges of O, returns the energy
+    auto Sweep=[](const CoordinatesSoA& P,const std::vector<double>& QP,
+                  const CoordinatesSoA& O,const std::vector<double>& QO,
+                  std::vector<double>& Grad){
+        const size_t np=P.Size(),no=O.Size();
+        const double *x=O.x.data(),*y=O.y.data(),*z=O.z.data(),*q=QO.data();
+        Grad.assign(3*np,0.0);
+        return parallel::ParallelReduce(0,np,0.0,[&](size_t i,double& E){
+            const double xi=P.x[i],yi=P.y[i],zi=P.z[i];
+            double Ei=0.0,gx=0.0,gy=0.0,gz=0.0;
+            #pragma omp simd reduction(+:Ei,gx,gy,gz)
+            for(size_t j=0;j<no;++j){
+                const double dx=xi-x[j],dy=yi-y[j],dz=zi-z[j];
+                const double rinv=1.0/std::sqrt(dx*dx+dy*dy+dz*dz);
+                const double qr=q[j]*rinv;
+                const double qr3=qr*rinv*rinv;
+                Ei+=qr;
+                gx-=qr3*dx;
+                gy-=qr3*dy;
+                gz-=qr3*dz;
+            }
+            E+=QP[i]*Ei;
+            Grad[3*i]=QP[i]*gx;
+            Grad[3*i+1]=QP[i]*gy;
+            Grad[3*i+2]=QP[i]*gz;
+        },std::plus<double>(),16);
+    };
+
+    const double E=Sweep(A,QA,B,QB,GradA);
+    Sweep(B,QB,A,QA,GradB);
+    return E;
+}
+
+}}//End namespaces
+#endif /* PAIRWISE_HPP */
@@ -0,0 +1,263 @@
+/*! \file
+ *
+ * \brief Sparse transformation between AO matrices and irrep blocks
+ */
+
+#ifndef PULSAR_GUARD_MATH__SALCTRANSFORM_HPP_
+#define PULSAR_GUARD_MATH__SALCTRANSFORM_HPP_
+
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/IrrepSpinMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+/*! \brief Moves square matrices between the AO basis and the basis of
+ *         symmetry adapted linear combinations (SALCs)
+ *
+ * The SALCs of irrep \f$h\f$ are the columns of an AO by \f$n_h\f$ matrix
+ * \f$C_h\f$, and the irrep blocks of an AO matrix \f$F\f$ are
+ * \f$F_h=C_h^TFC_h\f$.  Done as dense multiplies this costs
+ * \f$O(n_{AO}^2n_h)\f$ per irrep even though each SALC only involves the
+ * handful of AOs related by symmetry to one another.  Here the
+ * coefficients are stored sparsely (once, when the object is made for a
+ * given geometry and basis) and the transforms run in two sparse passes:
+ *
+ * \f[
+ *    T=FC_h,\qquad F_h=C_h^TT
+ * \f]
+ *
+ * which costs \f$O(n_{AO}\,nnz_h+n_h\,nnz_h)\f$ with \f$nnz_h\f$ the number of
+ * nonzero coefficients of irrep \f$h\f$.  The back transformation,
+ * \f$F=\sum_hC_hF_hC_h^T\f$, is done the same way.  The irreps are
+ * processed in parallel.
+ *
+ * The back transformation is the inverse of the forward one when the
+ * SALCs form an orthonormal basis of the AO space, which is the usual
+ * case.
+ */
+class SALCTransform
+{
+    public:
+        /*! \brief Sets up the transform from the SALC coefficients
+         *
+         * \param[in] Coefs For each irrep, the n_AO by n_h matrix whose
+         *                  columns are the SALCs of that irrep.  All must
+         *                  have the same number of rows.
+         * \param[in] Tol Coefficients with a magnitude at or below this are
+         *                dropped
+         */
+        SALCTransform(const std::map<Irrep, SimpleMatrixD> & Coefs, double Tol=1e-12)
+            : nao_(Coefs.empty() ? 0 : Coefs.begin()->second.NRows()),
+              aoterms_(nao_)
+        {
+            for(const auto & it : Coefs)
+            {
+                const SimpleMatrixD & C = it.second;
+                if(C.NRows() != nao_)
+                    throw MathException("SALC coefficients have the wrong number of AOs",
+                                        "nao", nao_, "nrows", C.NRows());
+
+                const size_t h = irreps_.size();
+                Irrep_ block;
+                block.irrep = it.first;
+                block.nsalc = C.NCols();
+                block.salcptr.assign(1, 0);
+                for(size_t i = 0; i < C.NCols(); i++)
+                {
+                    for(size_t mu = 0; mu < nao_; mu++)
+                        if(std::fabs(C(mu, i)) > Tol)
+                        {
+                            block.terms.push_back(Term_{mu, C(mu, i)});
+                            aoterms_[mu].push_back(AOTerm_{h, i, C(mu, i)});
+                        }
+                    block.salcptr.push_back(block.terms.size());
+                }
+                irreps_.push_back(std::move(block));
+            }
+        }
+
+        ///Number of AOs
+        size_t NAO(void) const noexcept { return nao_; }
+
+        ///Total number of stored (nonzero) coefficients
+        size_t NNZ(void) const noexcept
+        {
+            size_t n = 0;
+            for(const auto & h : irreps_)
+                n += h.terms.size();
+            return n;
+        }
+
+        /*! \brief Transforms an AO matrix into irrep blocks
+         *
+         * \param[in] Full The n_AO by n_AO matrix
+         * \param[in] Spin The spin to store the blocks under
+         * \param[in,out] Blocks Receives a block for each irrep.  Blocks
+         *                       that already exist with the right shape are
+         *                       overwritten in place.
+         */
+        void ToIrreps(const SimpleMatrixD & Full, int Spin, IrrepSpinMatrixD & Blocks) const
+        {
+            CheckFull_(Full);
+            for(const auto & h : irreps_)
+                if(!Blocks.Has(h.irrep, Spin) ||
+                   Blocks.Get(h.irrep, Spin).NRows() != h.nsalc ||
+                   Blocks.Get(h.irrep, Spin).NCols() != h.nsalc)
+                    Blocks.Take(h.irrep, Spin, SimpleMatrixD(h.nsalc, h.nsalc));
+
+            const size_t n = nao_;
+            const double * F = Full.Data();
+            parallel::ParallelFor(0, irreps_.size(), [&](size_t ih)
+            {
+                const Irrep_ & h = irreps_[ih];
+                const size_t nh = h.nsalc;
+
+                //T = F C_h, n_AO by n_h
+                std::vector<double> T(n * nh);
+                for(size_t mu = 0; mu < n; mu++)
+                {
+                    const double * Fmu = F + mu * n;
+                    for(size_t j = 0; j < nh; j++)
+                    {
+                        double sum = 0.0;
+                        for(size_t k = h.salcptr[j]; k < h.salcptr[j+1]; k++)
+                            sum += Fmu[h.terms[k].ao] * h.terms[k].coef;
+                        T[mu * nh + j] = sum;
+                    }
+                }
+
+                //F_h = C_h^T T
+                SimpleMatrixD & B = Blocks.Get(h.irrep, Spin);
+                B.Zero();
+                double * b = B.Data();
+                for(size_t i = 0; i < nh; i++)
+                    for(size_t k = h.salcptr[i]; k < h.salcptr[i+1]; k++)
+                    {
+                        const double * Tmu = T.data() + h.terms[k].ao * nh;
+                        const double c = h.terms[k].coef;
+                        for(size_t j = 0; j < nh; j++)
+                            b[i * nh + j] += c * Tmu[j];
+                    }
+            }, 1);
+        }
+
+        ///Transforms an AO matrix into newly allocated irrep blocks
+        IrrepSpinMatrixD ToIrreps(const SimpleMatrixD & Full, int Spin) const
+        {
+            IrrepSpinMatrixD Blocks;
+            ToIrreps(Full, Spin, Blocks);
+            return Blocks;
+        }
+
+        /*! \brief Transforms irrep blocks back to an AO matrix
+         *
+         * \param[in] Blocks Must have a block of the right size for every
+         *                   irrep (of spin \p Spin)
+         * \param[in] Spin The spin of the blocks to use
+         * \param[in,out] Full Receives the n_AO by n_AO matrix.  Reused if it
+         *                     already has the right shape.
+         */
+        void FromIrreps(const IrrepSpinMatrixD & Blocks, int Spin, SimpleMatrixD & Full) const
+        {
+            if(Full.NRows() != nao_ || Full.NCols() != nao_)
+                Full = SimpleMatrixD(nao_, nao_);
+
+            for(const auto & h : irreps_)
+            {
+                const SimpleMatrixD & B = Blocks.Get(h.irrep, Spin);
+                if(B.NRows() != h.nsalc || B.NCols() != h.nsalc)
+                    throw MathException("Irrep block has the wrong shape", "nsalc", h.nsalc,
+                                        "nrows", B.NRows(), "ncols", B.NCols());
+            }
+
+            //U_h = F_h C_h^T, n_h by n_AO, for each irrep in parallel
+            const size_t n = nao_;
+            std::vector<std::vector<double>> U(irreps_.size());
+            parallel::ParallelFor(0, irreps_.size(), [&](size_t ih)
+            {
+                const Irrep_ & h = irreps_[ih];
+                const size_t nh = h.nsalc;
+                const double * b = Blocks.Get(h.irrep, Spin).Data();
+                U[ih].assign(nh * n, 0.0);
+                for(size_t j = 0; j < nh; j++)
+                    for(size_t k = h.salcptr[j]; k < h.salcptr[j+1]; k++)
+                    {
+                        const size_t nu = h.terms[k].ao;
+                        const double c = h.terms[k].coef;
+                        for(size_t i = 0; i < nh; i++)
+                            U[ih][i * n + nu] += b[i * nh + j] * c;
+                    }
+            }, 1);
+
+            //F = sum_h C_h U_h, each AO row gathers from all irreps so rows
+            //can be done in parallel
+            double * F = Full.Data();
+            parallel::ParallelFor(0, n, [&](size_t mu)
+            {
+                double * Fmu = F + mu * n;
+                std::fill(Fmu, Fmu + n, 0.0);
+                for(const AOTerm_ & t : aoterms_[mu])
+                {
+                    const double * Ui = U[t.irrep].data() + t.salc * n;
+                    for(size_t nu = 0; nu < n; nu++)
+                        Fmu[nu] += t.coef * Ui[nu];
+                }
+            }, 16);
+        }
+
+        ///Transforms irrep blocks back to a newly allocated AO matrix
+        SimpleMatrixD FromIrreps(const IrrepSpinMatrixD & Blocks, int Spin) const
+        {
+            SimpleMatrixD Full;
+            FromIrreps(Blocks, Spin, Full);
+            return Full;
+        }
+
+    private:
+        ///A nonzero coefficient of a SALC
+        struct Term_
+        {
+            size_t ao;    //!< The AO
+            double coef;  //!< Its coefficient
+        };
+
+        ///A nonzero coefficient, indexed from the AO side
+        struct AOTerm_
+        {
+            size_t irrep; //!< Position of the irrep in irreps_
+            size_t salc;  //!< The SALC within that irrep
+            double coef;  //!< The coefficient
+        };
+
+        ///The SALCs of one irrep in compressed form
+        struct Irrep_
+        {
+            Irrep irrep;                  //!< Which irrep
+            size_t nsalc;                 //!< Number of SALCs
+            std::vector<size_t> salcptr;  //!< Start of each SALC in terms
+            std::vector<Term_> terms;     //!< The nonzero coefficients
+        };
+
+        size_t nao_;                                //!< Number of AOs
+        std::vector<Irrep_> irreps_;                //!< SALCs by irrep
+        std::vector<std::vector<AOTerm_>> aoterms_; //!< SALCs each AO is in
+
+        void CheckFull_(const SimpleMatrixD & Full) const
+        {
+            if(Full.NRows() != nao_ || Full.NCols() != nao_)
+                throw MathException("AO matrix has the wrong shape",
+                                    "nao", nao_, "nrows", Full.NRows(), "ncols", Full.NCols());
+        }
+};
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
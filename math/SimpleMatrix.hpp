@@ -11,9 +11,12 @@
 #include <complex>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <type_traits>
 
 #include "pulsar/exception/Assert.hpp"
 #include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/AllocationPolicy.hpp"
 #include "pulsar/util/Serialization.hpp"
 #include "bphash/Hasher.hpp"
 #include "bphash/types/memory.hpp"
@@ -41,35 +44,44 @@ template<typename T>
 class SimpleMatrix
 {
     public:
+        /// Owner of the elements, which may or may not be from new[]
+        typedef std::unique_ptr<T [], detail::PlacedDelete<T>> Data_t;
+
         /*! \brief Constructs an empty matrix */
         SimpleMatrix() : SimpleMatrix(0, 0) { }
 
-        /*! \brief Construct a matrix of a given size */
+        /*! \brief Construct a matrix of a given size
+         *
+         * The elements are left uninitialized, unless the AllocationPolicy
+         * applies, in which case they are zeroed by the pool threads to
+         * place the pages.
+         */
         SimpleMatrix(size_t nrows, size_t ncols)
             : nrows_(nrows), ncols_(ncols), size_(nrows*ncols),
-              data_(new T[nrows_*ncols_])
-        { }
+              data_(Allocate_(size_))
+        {
+            Place_(nullptr);
+        }
 
         /*! \brief Construct a matrix by copying data from a raw pointer */
         SimpleMatrix(size_t nrows, size_t ncols, const T * data)
-            : SimpleMatrix(nrows, ncols)
+            : nrows_(nrows), ncols_(ncols), size_(nrows*ncols),
+              data_(Allocate_(size_))
         {
-            std::copy(data, data + size_, data_.get());
+            if(!Place_(data))
+                std::copy(data, data + size_, data_.get());
         }
 
         /*! \brief Construct a matrix by copying data from an std::vector */
         SimpleMatrix(size_t nrows, size_t ncols, const std::vector<T> & v)
-            : SimpleMatrix(nrows, ncols)
-        {
-            if(v.size() != size_)
-                throw MathException("Vector has incompatible length", "vecsize", v.size(),
-                                               "nrows", nrows, "ncols", ncols);
- 
-            std::copy(v.begin(), v.end(), data_.get()); 
-        }
+            : SimpleMatrix(nrows, ncols, CheckLength_(v, nrows, ncols))
+        { }
 
-        /*! \brief Construct a matrix by moving a unique_ptr */
-        SimpleMatrix(size_t nrows, size_t ncols, std::unique_ptr<T []> && data)
+        /*! \brief Construct a matrix by moving a unique_ptr
+         *
+         * This may be a plain std::unique_ptr<T[]> or one from Release().
+         */
+        SimpleMatrix(size_t nrows, size_t ncols, Data_t && data)
             : nrows_(nrows), ncols_(ncols), size_(nrows*ncols),
               data_(std::move(data))
         { }
@@ -221,15 +233,15 @@ class SimpleMatrix
          * \note After this call, rows, cols, etc are all set
          *       to zero. So make sure you get that info beforehand
          */
-        std::unique_ptr<T[]> Release(void)
+        Data_t Release(void)
         {
             nrows_ = ncols_ = size_ = 0;
             // rather than move, this assures data_ == nullptr
-            return std::unique_ptr<T[]>(data_.release()); 
+            return Data_t(data_.release(), data_.get_deleter()); 
         }
 
         /// Take ownership of raw data
-        void Take(size_t nrows, size_t ncols, std::unique_ptr<T[]> && data)
+        void Take(size_t nrows, size_t ncols, Data_t && data)
         {
             nrows_ = nrows;
             ncols_ = ncols;
@@ -241,14 +253,142 @@ class SimpleMatrix
         {
             return bphash::MakeHash(bphash::HashType::Hash128, *this);
         } 
-    
+
+        /*! \brief Hash of the values rounded to a tolerance
+         *
+         * MyHash() changes with the last bit of any element, so results
+         * that differ only by roundoff (summation order, number of threads)
+         * never compare equal.  This instead hashes every element rounded to
+         * a multiple of \f$q\f$, the largest power of two not above \p tol.
+         * \f$q\f$ depends on nothing but \p tol, so roundoff can't change
+         * the rounding of every element at once.  For a relative tolerance,
+         * scale \p tol by something fixed for the problem (e.g. the norm of
+         * a reference matrix), not by this matrix.
+         *
+         * Matrices that agree to within \p tol will usually, but not always
+         * (an element may sit right at a rounding boundary), have the same
+         * quantized hash, so a mismatch just means a cache miss.  Matches
+         * should be confirmed with AlmostEqual(), since different matrices
+         * can also share a quantized hash.
+         *
+         * Elements too large to round are already multiples of \f$q\f$
+         * and are hashed as they are.  All NaNs hash alike, as do each of
+         * the infinities.
+         *
+         * \param[in] tol The absolute tolerance, must be positive and finite
+         * \throw pulsar::MathException if \p tol isn't positive and finite
+         */
+        bphash::HashValue QuantizedHash(double tol) const
+        {
+            if(!(tol > 0.0) || std::isinf(tol))
+                throw MathException("Quantized hash needs a positive, finite tolerance",
+                                    "tol", tol);
+
+            bphash::Hasher h(bphash::HashType::Hash128);
+            h(nrows_, ncols_, size_);
+            const double q = std::exp2(std::floor(std::log2(tol)));
+            for(size_t i = 0; i < size_; i++)
+                Quantize_(h, data_[i], q);
+            return h.finalize();
+        }
+
+        /*! \brief Checks that two matrices agree to within a relative tolerance
+         *
+         * True if they have the same shape and
+         * \f$\|A-B\|_F\leq rtol\,\|A\|_F\f$.  This is the check to do
+         * after finding a cached result under QuantizedHash().  It makes one
+         * pass over this matrix for its norm, then one over both matrices
+         * that returns as soon as the accumulated difference is larger than
+         * the bound allows.  Any NaN makes the matrices unequal.
+         */
+        bool AlmostEqual(const SimpleMatrix & rhs, double rtol) const
+        {
+            if(nrows_ != rhs.nrows_ || ncols_ != rhs.ncols_)
+                return false;
+
+            double norm2 = 0.0;
+            for(size_t i = 0; i < size_; i++)
+                norm2 += std::norm(data_[i]);
+            const double bound2 = rtol * rtol * norm2;
+
+            double diff2 = 0.0;
+            for(size_t i = 0; i < size_; i++)
+            {
+                diff2 += std::norm(data_[i] - rhs.data_[i]);
+                if(!(diff2 <= bound2))
+                    return false;
+            }
+            return true;
+        }
+
 
 
     private:
         size_t nrows_;  //!< Number of rows
         size_t ncols_;  //!< Number of columns
         size_t size_;
-        std::unique_ptr<T []> data_;  //!< Actual stored data
+        Data_t data_;  //!< Actual stored data
+
+        /// New storage for n elements, from mmap if the AllocationPolicy applies
+        static Data_t Allocate_(size_t n)
+        {
+            if(std::is_trivial<T>::value)
+                if(void * p = detail::AllocatePlaced(n * sizeof(T)))
+                    return Data_t(static_cast<T *>(p), detail::PlacedDelete<T>(n * sizeof(T)));
+            return Data_t(new T[n]);
+        }
+
+        /*! \brief Fills the new data_ from \p src (or zeros) as the
+         *         AllocationPolicy says
+         *
+         * \return False if the policy doesn't apply and data_ is untouched
+         */
+        bool Place_(const T * src)
+        {
+            return data_.get_deleter().Bytes &&
+                   detail::PlaceRows(data_.get(), nrows_, ncols_ * sizeof(T), src);
+        }
+
+        ///Returns the data of \p v if it has nrows*ncols elements
+        static const T * CheckLength_(const std::vector<T> & v, size_t nrows, size_t ncols)
+        {
+            if(v.size() != nrows * ncols)
+                throw MathException("Vector has incompatible length", "vecsize", v.size(),
+                                               "nrows", nrows, "ncols", ncols);
+            return v.data();
+        }
+
+        /*! \brief Rounds to the nearest multiple of q and hashes the multiple
+         *
+         * Each kind of value is hashed with its own tag first, so e.g. an
+         * infinity and a large finite value can't collide.
+         */
+        template<typename U>
+        static void Quantize_(bphash::Hasher & h, const U & x, double q)
+        {
+            const double v = static_cast<double>(x);
+            if(std::isnan(v))
+                h(0);
+            else if(std::isinf(v))
+                h(v > 0 ? 1 : 2);
+            else
+            {
+                //Past 2^62 multiples of q don't fit in a long long, but from
+                //2^53 on every double is one already
+                const double r = v / q;
+                if(std::fabs(r) < std::ldexp(1.0, 62))
+                    h(3, static_cast<long long>(std::llround(r)));
+                else
+                    h(4, v);
+            }
+        }
+
+        template<typename U>
+        static void Quantize_(bphash::Hasher & h, const std::complex<U> & x, double q)
+        {
+            Quantize_(h, x.real(), q);
+            Quantize_(h, x.imag(), q);
+        }
 
         void CheckIndices_(size_t row, size_t col) const
         {
@@ -280,7 +420,7 @@ class SimpleMatrix
         {
             //! \todo might be slow. Do a row at a time or something?
             ar(nrows_, ncols_, size_);
-            data_ = std::unique_ptr<T[]>(new T[size_]);
+            data_ = Allocate_(size_);
             for(size_t i = 0; i < size_; i++)
                 ar(data_[i]);
         }
@@ -288,7 +428,7 @@ class SimpleMatrix
         void hash(bphash::Hasher & h) const
         {
             h(nrows_, ncols_, size_,
-              bphash::HashPointer(data_, size_));
+              bphash::HashPointer(data_.get(), size_));
         }
 
         ///@}
@@ -328,7 +468,7 @@ class SimpleVector : public SimpleMatrix<T>
         { }
 
         /*! \brief Construct a vector by moving a unique_ptr */
-        SimpleVector(size_t nelements, std::unique_ptr<T []> && data)
+        SimpleVector(size_t nelements, typename SimpleMatrix<T>::Data_t && data)
             : SimpleMatrix<T>(1, nelements, std::move(data))
         { }
 
@@ -387,7 +527,7 @@ class SimpleVector : public SimpleMatrix<T>
 
 
         /// Take ownership of raw data
-        void Take(size_t nelements, std::unique_ptr<T[]> && data)
+        void Take(size_t nelements, typename SimpleMatrix<T>::Data_t && data)
         {
             SimpleMatrix<T>::Take(1, nelements, std::move(data));
         }
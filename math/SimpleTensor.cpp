@@ -0,0 +1,19 @@
+/*! \file
+ *
+ * \brief General-purpose dense N-dimensional tensor and views of it
+ */
+
+#include "pulsar/math/SimpleTensor.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+template class SimpleTensor<float>;
+template class SimpleTensor<double>;
+template class SimpleTensor<std::complex<float>>;
+template class SimpleTensor<std::complex<double>>;
+
+
+} // close namespace math
+} // close namespace pulsar
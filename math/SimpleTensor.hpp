@@ -0,0 +1,584 @@
+/*! \file
+ *
+ * \brief General-purpose dense N-dimensional tensor and views of it
+ */
+
+#ifndef PULSAR_GUARD_MATH__SIMPLETENSOR_HPP_
+#define PULSAR_GUARD_MATH__SIMPLETENSOR_HPP_
+
+#include <array>
+#include <memory>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+#include "pulsar/exception/Assert.hpp"
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/util/Serialization.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "bphash/Hasher.hpp"
+#include "bphash/types/memory.hpp"
+#include "bphash/types/complex.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+namespace detail{
+
+///Row-major strides for a shape
+inline std::vector<size_t> RowMajorStrides(const std::vector<size_t> & shape)
+{
+    std::vector<size_t> strides(shape.size(), 1);
+    for(size_t d = shape.size(); d > 1; d--)
+        strides[d-2] = strides[d-1] * shape[d-1];
+    return strides;
+}
+
+///The number of elements of a shape (1 for rank 0)
+inline size_t ShapeSize(const std::vector<size_t> & shape)
+{
+    size_t n = 1;
+    for(size_t s : shape)
+        n *= s;
+    return n;
+}
+
+} // close namespace detail
+
+
+/*! \brief A non-owning view of N-dimensional data with arbitrary strides
+ *
+ * Element \f$(i_0,i_1,\ldots)\f$ is at Data()[\f$\sum_d i_d s_d\f$] where
+ * \f$s_d\f$ are the strides (in elements, not bytes).  Views of part of a
+ * tensor (Slice(), Fix()) just change the pointer, shape, and strides, so
+ * no data is copied.
+ *
+ * The data must outlive the view.  Use TensorView<const T> for read-only
+ * views.
+ *
+ * \tparam T The type of data viewed
+ */
+template<typename T>
+class TensorView
+{
+    public:
+        TensorView() : data_(nullptr) { }
+
+        /*! \brief Views data with the given shape and strides
+         *
+         * \throw pulsar::MathException if the shape and strides have
+         *        different lengths
+         */
+        TensorView(T * data, std::vector<size_t> shape, std::vector<size_t> strides)
+            : data_(data), shape_(std::move(shape)), strides_(std::move(strides))
+        {
+            if(shape_.size() != strides_.size())
+                throw MathException("Shape and strides have different ranks",
+                                    "shape", shape_.size(), "strides", strides_.size());
+        }
+
+        ///Views contiguous row-major data
+        TensorView(T * data, std::vector<size_t> shape)
+            : data_(data), shape_(std::move(shape)),
+              strides_(detail::RowMajorStrides(shape_))
+        { }
+
+        ///A view of non-const data converts to a view of const data
+        template<typename U, typename = typename std::enable_if<
+                    std::is_same<const U, T>::value>::type>
+        TensorView(const TensorView<U> & rhs)
+            : data_(rhs.Data()), shape_(rhs.Shape()), strides_(rhs.Strides())
+        { }
+
+        /// Number of dimensions
+        size_t Rank(void) const noexcept { return shape_.size(); }
+
+        /// Extent of each dimension
+        const std::vector<size_t> & Shape(void) const noexcept { return shape_; }
+
+        /// Stride of each dimension, in elements
+        const std::vector<size_t> & Strides(void) const noexcept { return strides_; }
+
+        /// Total number of elements
+        size_t Size(void) const noexcept { return detail::ShapeSize(shape_); }
+
+        /// Pointer to the first element
+        T * Data(void) const noexcept { return data_; }
+
+        /// True if the elements are contiguous and in row-major order
+        bool IsContiguous(void) const
+        {
+            return strides_ == detail::RowMajorStrides(shape_);
+        }
+
+        /*! \brief Obtain a reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range (only if assertions are
+         *        enabled)
+         */
+        template<typename... Idx>
+        T & operator()(Idx... idx) const ASSERTIONS_ONLY
+        {
+            const std::array<size_t, sizeof...(Idx)> i{{static_cast<size_t>(idx)...}};
+            #ifndef NDEBUG
+            CheckIndices_(i.data(), i.size());
+            #endif
+            size_t off = 0;
+            for(size_t d = 0; d < sizeof...(Idx); d++)
+                off += i[d] * strides_[d];
+            return data_[off];
+        }
+
+        /*! \brief Obtain a reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range
+         */
+        T & At(const std::vector<size_t> & idx) const
+        {
+            CheckIndices_(idx.data(), idx.size());
+            size_t off = 0;
+            for(size_t d = 0; d < idx.size(); d++)
+                off += idx[d] * strides_[d];
+            return data_[off];
+        }
+
+        /*! \brief View of the elements [begin, end) along dimension \p dim
+         *
+         * \throw pulsar::MathException if the range is out of bounds
+         */
+        TensorView Slice(size_t dim, size_t begin, size_t end) const
+        {
+            if(dim >= Rank())
+                throw MathException("Dimension out of range", "dim", dim, "rank", Rank());
+            if(begin > end || end > shape_[dim])
+                throw MathException("Slice out of range", "begin", begin, "end", end,
+                                    "extent", shape_[dim]);
+            TensorView v(*this);
+            v.data_ += begin * strides_[dim];
+            v.shape_[dim] = end - begin;
+            return v;
+        }
+
+        /*! \brief View with dimension \p dim fixed at \p index (rank one less)
+         *
+         * \throw pulsar::MathException if the index is out of bounds
+         */
+        TensorView Fix(size_t dim, size_t index) const
+        {
+            if(dim >= Rank())
+                throw MathException("Dimension out of range", "dim", dim, "rank", Rank());
+            if(index >= shape_[dim])
+                throw MathException("Index out of range", "index", index,
+                                    "extent", shape_[dim]);
+            TensorView v(*this);
+            v.data_ += index * strides_[dim];
+            v.shape_.erase(v.shape_.begin() + dim);
+            v.strides_.erase(v.strides_.begin() + dim);
+            return v;
+        }
+
+    private:
+        T * data_;                     //!< First element
+        std::vector<size_t> shape_;    //!< Extent of each dimension
+        std::vector<size_t> strides_;  //!< Stride of each dimension
+
+        void CheckIndices_(const size_t * idx, size_t n) const
+        {
+            if(n != shape_.size())
+                throw MathException("Wrong number of indices", "nidx", n, "rank", shape_.size());
+            for(size_t d = 0; d < n; d++)
+                if(idx[d] >= shape_[d])
+                    throw MathException("Index out of range", "dim", d,
+                                        "index", idx[d], "extent", shape_[d]);
+        }
+};
+
+
+/*! \brief A general-purpose dense N-dimensional tensor storage class
+ *
+ * The N-dimensional analog of SimpleMatrix: it stores data and
+ * its shape, and little else.  Storage is row-major (the last index is
+ * contiguous).  Permutations and contractions are free functions in
+ * TensorOps.hpp.
+ *
+ * \tparam T The type of data stored in the tensor
+ *
+ * \par Hashing
+ *     The hash value of a SimpleTensor is unique with respect its
+ *     shape and the values it contains.
+ */
+template<typename T>
+class SimpleTensor
+{
+    public:
+        /*! \brief Constructs an empty (rank 1, length 0) tensor */
+        SimpleTensor() : SimpleTensor(std::vector<size_t>(1, 0)) { }
+
+        /*! \brief Construct a tensor of a given shape */
+        explicit SimpleTensor(std::vector<size_t> shape)
+            : shape_(std::move(shape)), strides_(detail::RowMajorStrides(shape_)),
+              size_(detail::ShapeSize(shape_)), data_(new T[size_])
+        { }
+
+        /*! \brief Construct a tensor by copying data from a raw pointer */
+        SimpleTensor(std::vector<size_t> shape, const T * data)
+            : SimpleTensor(std::move(shape))
+        {
+            std::copy(data, data + size_, data_.get());
+        }
+
+        /*! \brief Construct a tensor by copying data from an std::vector */
+        SimpleTensor(std::vector<size_t> shape, const std::vector<T> & v)
+            : SimpleTensor(std::move(shape))
+        {
+            if(v.size() != size_)
+                throw MathException("Vector has incompatible length", "vecsize", v.size(),
+                                    "size", size_);
+            std::copy(v.begin(), v.end(), data_.get());
+        }
+
+        /*! \brief Construct a tensor by moving a unique_ptr */
+        SimpleTensor(std::vector<size_t> shape, std::unique_ptr<T []> && data)
+            : shape_(std::move(shape)), strides_(detail::RowMajorStrides(shape_)),
+              size_(detail::ShapeSize(shape_)), data_(std::move(data))
+        { }
+
+        /*! \brief Construct by copying whatever a view looks at */
+        explicit SimpleTensor(const TensorView<const T> & v)
+            : SimpleTensor(v.Shape())
+        {
+            CopyFrom_(v);
+        }
+
+        /*! \brief Deep copy constructor */
+        SimpleTensor(const SimpleTensor & rhs)
+            : SimpleTensor(rhs.shape_, rhs.data_.get())
+        { }
+
+        SimpleTensor(SimpleTensor && rhs)
+          : shape_(std::move(rhs.shape_)),
+            strides_(std::move(rhs.strides_)),
+            size_(rhs.size_),
+            data_(std::move(rhs.data_))
+        {
+            rhs.size_ = 0;
+        }
+
+        SimpleTensor & operator=(SimpleTensor && rhs)
+        {
+            shape_ = std::move(rhs.shape_);
+            strides_ = std::move(rhs.strides_);
+            size_ = rhs.size_;
+            data_ = std::move(rhs.data_);
+            rhs.size_ = 0;
+            return *this;
+        }
+
+        SimpleTensor & operator=(const SimpleTensor & rhs)
+        {
+            if(this != &rhs)
+            {
+                SimpleTensor tmp(rhs);
+                *this = std::move(tmp);
+            }
+            return *this;
+        }
+
+
+        /*! \brief Comparison
+         *
+         * Compares shapes and then elementwise. Values must exactly match
+         * (ie, to all bits for floating point)
+         */
+        bool operator==(const SimpleTensor & rhs) const
+        {
+            PRAGMA_WARNING_PUSH
+            PRAGMA_WARNING_IGNORE_FP_EQUALITY
+
+            if(!data_ && !rhs.data_)
+                return true;
+            else if(!data_ || !rhs.data_)
+                return false;
+            else
+                return (shape_ == rhs.shape_ &&
+                        std::equal(data_.get(), data_.get() + size_, rhs.data_.get()));
+
+            PRAGMA_WARNING_POP
+        }
+
+        /// Inequality comparison
+        bool operator!=(const SimpleTensor & rhs) const
+        {
+            return !((*this) == rhs);
+        }
+
+        /// Number of dimensions
+        size_t Rank(void) const noexcept { return shape_.size(); }
+
+        /// Extent of each dimension
+        const std::vector<size_t> & Shape(void) const noexcept { return shape_; }
+
+        /// Stride of each dimension, in elements
+        const std::vector<size_t> & Strides(void) const noexcept { return strides_; }
+
+        /// Get the total size of this tensor
+        size_t Size(void) const noexcept { return size_; }
+
+        /// Fill this tensor with zeroes
+        void Zero(void)
+        {
+            std::fill(data_.get(), data_.get()+size_, static_cast<T>(0));
+        }
+
+        /*! \brief Obtain a reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range (only if assertions are
+         *        enabled)
+         */
+        template<typename... Idx>
+        T & operator()(Idx... idx) ASSERTIONS_ONLY
+        {
+            return data_[Offset_(idx...)];
+        }
+
+        /*! \brief Obtain a const reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range (only if assertions are
+         *        enabled)
+         */
+        template<typename... Idx>
+        const T & operator()(Idx... idx) const ASSERTIONS_ONLY
+        {
+            return data_[Offset_(idx...)];
+        }
+
+        /*! \brief Obtain a reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range
+         */
+        T & At(const std::vector<size_t> & idx)
+        {
+            return data_[CheckedOffset_(idx)];
+        }
+
+        /*! \brief Obtain a const reference to an element
+         *
+         * \throw pulsar::MathException if the number of indices is
+         *        wrong or one is out of range
+         */
+        const T & At(const std::vector<size_t> & idx) const
+        {
+            return data_[CheckedOffset_(idx)];
+        }
+
+        /// Obtain a pointer to the raw data
+        T * Data(void) ASSERTIONS_ONLY
+        {
+            if(!data_)
+                throw MathException("Null pointer in SimpleTensor");
+            return data_.get();
+        }
+
+        /// Obtain a pointer to the raw data
+        const T * Data(void) const ASSERTIONS_ONLY
+        {
+            if(!data_)
+                throw MathException("Null pointer in SimpleTensor");
+            return data_.get();
+        }
+
+        /// A view of the whole tensor
+        TensorView<T> View(void)
+        {
+            return TensorView<T>(data_.get(), shape_, strides_);
+        }
+
+        /// A read-only view of the whole tensor
+        TensorView<const T> View(void) const
+        {
+            return TensorView<const T>(data_.get(), shape_, strides_);
+        }
+
+        /*! \brief Changes the shape without touching the data
+         *
+         * \throw pulsar::MathException if the new shape has a different
+         *        number of elements
+         */
+        void Reshape(std::vector<size_t> shape)
+        {
+            if(detail::ShapeSize(shape) != size_)
+                throw MathException("Reshape changes the number of elements",
+                                    "size", size_, "newsize", detail::ShapeSize(shape));
+            shape_ = std::move(shape);
+            strides_ = detail::RowMajorStrides(shape_);
+        }
+
+        /*! \brief Copies into a matrix, with the first \p NRowDims
+         *         dimensions making up the rows
+         *
+         * \throw pulsar::MathException if \p NRowDims is larger than the rank
+         */
+        SimpleMatrix<T> ToMatrix(size_t NRowDims) const
+        {
+            if(NRowDims > Rank())
+                throw MathException("More row dimensions than the rank",
+                                    "nrowdims", NRowDims, "rank", Rank());
+            size_t nrows = 1;
+            for(size_t d = 0; d < NRowDims; d++)
+                nrows *= shape_[d];
+            return SimpleMatrix<T>(nrows, nrows ? size_/nrows : 0, data_.get());
+        }
+
+        /*! \brief Release the raw data
+         *
+         * \note After this call the tensor has no elements, so get
+         *       its shape beforehand
+         */
+        std::unique_ptr<T[]> Release(void)
+        {
+            shape_.assign(1, 0);
+            strides_.assign(1, 1);
+            size_ = 0;
+            return std::unique_ptr<T[]>(data_.release());
+        }
+
+        /// Take ownership of raw data
+        void Take(std::vector<size_t> shape, std::unique_ptr<T[]> && data)
+        {
+            shape_ = std::move(shape);
+            strides_ = detail::RowMajorStrides(shape_);
+            size_ = detail::ShapeSize(shape_);
+            data_ = std::move(data);
+        }
+
+        bphash::HashValue MyHash(void) const
+        {
+            return bphash::MakeHash(bphash::HashType::Hash128, *this);
+        }
+
+
+    private:
+        std::vector<size_t> shape_;    //!< Extent of each dimension
+        std::vector<size_t> strides_;  //!< Row-major strides
+        size_t size_;                  //!< Total number of elements
+        std::unique_ptr<T []> data_;   //!< Actual stored data
+
+        template<typename... Idx>
+        size_t Offset_(Idx... idx) const
+        {
+            const std::array<size_t, sizeof...(Idx)> i{{static_cast<size_t>(idx)...}};
+            #ifndef NDEBUG
+            CheckIndices_(i.data(), i.size());
+            #endif
+            size_t off = 0;
+            for(size_t d = 0; d < sizeof...(Idx); d++)
+                off += i[d] * strides_[d];
+            return off;
+        }
+
+        size_t CheckedOffset_(const std::vector<size_t> & idx) const
+        {
+            CheckIndices_(idx.data(), idx.size());
+            size_t off = 0;
+            for(size_t d = 0; d < idx.size(); d++)
+                off += idx[d] * strides_[d];
+            return off;
+        }
+
+        void CheckIndices_(const size_t * idx, size_t n) const
+        {
+            if(n != shape_.size())
+                throw MathException("Wrong number of indices", "nidx", n, "rank", shape_.size());
+            for(size_t d = 0; d < n; d++)
+                if(idx[d] >= shape_[d])
+                    throw MathException("Index out of range", "dim", d,
+                                        "index", idx[d], "extent", shape_[d]);
+        }
+
+        ///Copies a view of the same shape, element by element in row-major order
+        void CopyFrom_(const TensorView<const T> & v)
+        {
+            std::vector<size_t> idx(Rank(), 0);
+            for(size_t n = 0; n < size_; n++)
+            {
+                size_t off = 0;
+                for(size_t d = 0; d < idx.size(); d++)
+                    off += idx[d] * v.Strides()[d];
+                data_[n] = v.Data()[off];
+                for(size_t d = idx.size(); d > 0; d--)
+                {
+                    if(++idx[d-1] < shape_[d-1])
+                        break;
+                    idx[d-1] = 0;
+                }
+            }
+        }
+
+
+        //! \name Serialization
+        ///@{
+
+        DECLARE_SERIALIZATION_FRIENDS
+        friend class bphash::Hasher;
+
+        template<class Archive>
+        void save(Archive & ar) const
+        {
+            ar(shape_.size());
+            for(size_t s : shape_)
+                ar(s);
+            for(size_t i = 0; i < size_; i++)
+                ar(data_[i]);
+        }
+
+        template<class Archive>
+        void load(Archive & ar)
+        {
+            size_t rank;
+            ar(rank);
+            shape_.resize(rank);
+            for(size_t & s : shape_)
+                ar(s);
+            strides_ = detail::RowMajorStrides(shape_);
+            size_ = detail::ShapeSize(shape_);
+            data_ = std::unique_ptr<T[]>(new T[size_]);
+            for(size_t i = 0; i < size_; i++)
+                ar(data_[i]);
+        }
+
+        void hash(bphash::Hasher & h) const
+        {
+            h(shape_.size());
+            for(size_t s : shape_)
+                h(s);
+            h(bphash::HashPointer(data_, size_));
+        }
+
+        ///@}
+};
+
+
+
+// Explicit instantiations
+extern template class SimpleTensor<float>;
+extern template class SimpleTensor<double>;
+extern template class SimpleTensor<std::complex<float>>;
+extern template class SimpleTensor<std::complex<double>>;
+
+
+typedef SimpleTensor<float> SimpleTensorF;
+typedef SimpleTensor<double> SimpleTensorD;
+typedef SimpleTensor<std::complex<float>> SimpleTensorCF;
+typedef SimpleTensor<std::complex<double>> SimpleTensorCD;
+
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
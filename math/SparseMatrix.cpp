@@ -0,0 +1,23 @@
+/*! \file
+ *
+ * \brief Compressed sparse row (CSR) and block sparse row (BSR) matrices
+ */
+
+#include "pulsar/math/SparseMatrix.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+template class CSRMatrix<float>;
+template class CSRMatrix<double>;
+template class CSRMatrix<std::complex<float>>;
+template class CSRMatrix<std::complex<double>>;
+template class BSRMatrix<float>;
+template class BSRMatrix<double>;
+template class BSRMatrix<std::complex<float>>;
+template class BSRMatrix<std::complex<double>>;
+
+
+} // close namespace math
+} // close namespace pulsar
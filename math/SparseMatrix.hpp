@@ -0,0 +1,648 @@
+/*! \file
+ *
+ * \brief Compressed sparse row (CSR) and block sparse row (BSR) matrices
+ */
+
+#ifndef PULSAR_GUARD_MATH__SPARSEMATRIX_HPP_
+#define PULSAR_GUARD_MATH__SPARSEMATRIX_HPP_
+
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+#include "pulsar/util/Serialization.hpp"
+#include "bphash/Hasher.hpp"
+#include "bphash/types/vector.hpp"
+#include "bphash/types/complex.hpp"
+
+
+namespace pulsar{
+namespace math{
+
+/*! \brief A sparse matrix in compressed sparse row (CSR) format
+ *
+ * The nonzero elements of row i are Values()[RowPtr()[i]] through
+ * Values()[RowPtr()[i+1]-1], and their columns are the corresponding
+ * elements of ColIdx().  Within a row the columns are sorted.
+ *
+ * Like SimpleMatrix this is mainly a storage class; the products with
+ * dense matrices are provided as free functions (SparseMultiply).
+ *
+ * \tparam T The type of data stored in the matrix
+ *
+ * \par Hashing
+ *     The hash value is unique with respect to the dimensions, the
+ *     sparsity pattern, and the stored values.
+ */
+template<typename T>
+class CSRMatrix
+{
+    public:
+        /*! \brief Constructs an empty matrix */
+        CSRMatrix() : CSRMatrix(0, 0) { }
+
+        /*! \brief Constructs an nrows by ncols matrix with no nonzeros */
+        CSRMatrix(size_t nrows, size_t ncols)
+            : nrows_(nrows), ncols_(ncols), rowptr_(nrows+1, 0)
+        { }
+
+        /*! \brief Constructs a matrix from existing CSR arrays
+         *
+         * The arrays are taken as is, so they must already be in the form
+         * described above: \p rowptr starts at 0, never decreases, and
+         * ends at the number of nonzeros, and within each row the columns
+         * are in range, sorted, and unique.  At() and the products rely on
+         * all of this.
+         *
+         * \throw pulsar::MathException if the arrays are inconsistent
+         */
+        CSRMatrix(size_t nrows, size_t ncols,
+                  std::vector<size_t> rowptr,
+                  std::vector<size_t> colidx,
+                  std::vector<T> values)
+            : nrows_(nrows), ncols_(ncols), rowptr_(std::move(rowptr)),
+              colidx_(std::move(colidx)), values_(std::move(values))
+        {
+            if(rowptr_.size() != nrows_+1)
+                throw MathException("Row pointer has incompatible length",
+                                    "length", rowptr_.size(), "nrows", nrows_);
+            if(colidx_.size() != values_.size() || rowptr_.back() != values_.size())
+                throw MathException("Inconsistent number of nonzeros in CSR arrays",
+                                    "ncolidx", colidx_.size(), "nvalues", values_.size(),
+                                    "rowptr", rowptr_.back());
+            if(rowptr_.front() != 0)
+                throw MathException("Row pointer must start at zero",
+                                    "rowptr", rowptr_.front());
+            for(size_t i = 0; i < nrows_; i++)
+            {
+                if(rowptr_[i+1] < rowptr_[i])
+                    throw MathException("Row pointer is decreasing", "row", i,
+                                        "start", rowptr_[i], "end", rowptr_[i+1]);
+                for(size_t k = rowptr_[i]; k < rowptr_[i+1]; k++)
+                {
+                    if(colidx_[k] >= ncols_)
+                        throw MathException("Column out of range", "row", i,
+                                            "col", colidx_[k], "ncols", ncols_);
+                    if(k > rowptr_[i] && colidx_[k] <= colidx_[k-1])
+                        throw MathException("Columns within a row must be sorted and unique",
+                                            "row", i, "col", colidx_[k],
+                                            "previous col", colidx_[k-1]);
+                }
+            }
+        }
+
+        /*! \brief Converts a dense matrix, dropping small elements
+         *
+         * Elements whose magnitude is not larger than \p droptol are
+         * not stored.  The default only drops exact zeros.
+         */
+        explicit CSRMatrix(const SimpleMatrix<T> & dense, double droptol = 0.0)
+            : CSRMatrix(dense.NRows(), dense.NCols())
+        {
+            for(size_t i = 0; i < nrows_; i++)
+            {
+                for(size_t j = 0; j < ncols_; j++)
+                {
+                    const T & v = dense(i, j);
+                    if(std::abs(v) > droptol)
+                    {
+                        colidx_.push_back(j);
+                        values_.push_back(v);
+                    }
+                }
+                rowptr_[i+1] = values_.size();
+            }
+        }
+
+        CSRMatrix(const CSRMatrix &) = default;
+        CSRMatrix(CSRMatrix &&) = default;
+        CSRMatrix & operator=(const CSRMatrix &) = default;
+        CSRMatrix & operator=(CSRMatrix &&) = default;
+
+        /*! \brief Comparison
+         *
+         * The dimensions, the sparsity patterns, and the values must
+         * match exactly.
+         */
+        bool operator==(const CSRMatrix & rhs) const
+        {
+            PRAGMA_WARNING_PUSH
+            PRAGMA_WARNING_IGNORE_FP_EQUALITY
+            return nrows_ == rhs.nrows_ && ncols_ == rhs.ncols_ &&
+                   rowptr_ == rhs.rowptr_ && colidx_ == rhs.colidx_ &&
+                   values_ == rhs.values_;
+            PRAGMA_WARNING_POP
+        }
+
+        /// Inequality comparison
+        bool operator!=(const CSRMatrix & rhs) const
+        {
+            return !((*this) == rhs);
+        }
+
+        /// Get the number of rows of this matrix
+        size_t NRows(void) const noexcept { return nrows_; }
+
+        /// Get the number of columns of this matrix
+        size_t NCols(void) const noexcept { return ncols_; }
+
+        /// Get the number of stored elements
+        size_t NNZ(void) const noexcept { return values_.size(); }
+
+        /// The offsets of the rows into ColIdx() and Values()
+        const std::vector<size_t> & RowPtr(void) const noexcept { return rowptr_; }
+
+        /// The column of each stored element
+        const std::vector<size_t> & ColIdx(void) const noexcept { return colidx_; }
+
+        /// The stored elements
+        const std::vector<T> & Values(void) const noexcept { return values_; }
+
+        /// The stored elements (the pattern can't be changed this way)
+        std::vector<T> & Values(void) noexcept { return values_; }
+
+        /*! \brief Returns element (row, col), zero if it isn't stored
+         *
+         * \throw pulsar::MathException if the row or column is out of range
+         */
+        T At(size_t row, size_t col) const
+        {
+            if(row >= nrows_)
+                throw MathException("Row out of range", "row", row, "nrows", nrows_);
+            if(col >= ncols_)
+                throw MathException("Column out of range", "col", col, "ncols", ncols_);
+            auto begin = colidx_.begin() + rowptr_[row];
+            auto end = colidx_.begin() + rowptr_[row+1];
+            auto it = std::lower_bound(begin, end, col);
+            if(it == end || *it != col)
+                return static_cast<T>(0);
+            return values_[it - colidx_.begin()];
+        }
+
+        /// Converts to a dense matrix
+        SimpleMatrix<T> ToDense(void) const
+        {
+            SimpleMatrix<T> dense(nrows_, ncols_);
+            dense.Zero();
+            for(size_t i = 0; i < nrows_; i++)
+                for(size_t k = rowptr_[i]; k < rowptr_[i+1]; k++)
+                    dense(i, colidx_[k]) = values_[k];
+            return dense;
+        }
+
+        bphash::HashValue MyHash(void) const
+        {
+            return bphash::MakeHash(bphash::HashType::Hash128, *this);
+        }
+
+    private:
+        size_t nrows_;                //!< Number of rows
+        size_t ncols_;                //!< Number of columns
+        std::vector<size_t> rowptr_;  //!< Start of each row (nrows_+1)
+        std::vector<size_t> colidx_;  //!< Column of each element
+        std::vector<T> values_;       //!< The stored elements
+
+
+        //! \name Serialization
+        ///@{
+
+        DECLARE_SERIALIZATION_FRIENDS
+        friend class bphash::Hasher;
+
+        template<class Archive>
+        void save(Archive & ar) const
+        {
+            ar(nrows_, ncols_, rowptr_, colidx_, values_);
+        }
+
+        template<class Archive>
+        void load(Archive & ar)
+        {
+            ar(nrows_, ncols_, rowptr_, colidx_, values_);
+        }
+
+        void hash(bphash::Hasher & h) const
+        {
+            h(nrows_, ncols_, rowptr_, colidx_, values_);
+        }
+
+        ///@}
+};
+
+
+/*! \brief A sparse matrix in block sparse row (BSR) format
+ *
+ * The matrix is divided into dense blocks of a fixed size and only the
+ * blocks containing significant elements are stored.  This suits matrices
+ * in a basis of shells, where nonzeros come in dense clumps, and the dense
+ * blocks keep the inner loops of the products vectorizable.
+ *
+ * The layout mirrors CSR, but over block rows and block columns: the
+ * blocks of block row I are BlockColIdx()[BlockRowPtr()[I]] and onward.
+ * Each stored block is BlockRows() by BlockCols(), row-major, and the
+ * blocks are contiguous in Values().  If the dimensions are not multiples
+ * of the block size, the last block row/column is padded with zeros.
+ *
+ * \tparam T The type of data stored in the matrix
+ *
+ * \par Hashing
+ *     The hash value is unique with respect to the dimensions, block size,
+ *     the block sparsity pattern, and the stored values.
+ */
+template<typename T>
+class BSRMatrix
+{
+    public:
+        /*! \brief Constructs an empty matrix */
+        BSRMatrix() : BSRMatrix(0, 0, 1, 1) { }
+
+        /*! \brief Constructs a matrix with no stored blocks */
+        BSRMatrix(size_t nrows, size_t ncols, size_t brows, size_t bcols)
+            : nrows_(nrows), ncols_(ncols), brows_(brows), bcols_(bcols),
+              nbrows_(NBlocks_(nrows, brows)), nbcols_(NBlocks_(ncols, bcols)),
+              browptr_(nbrows_+1, 0)
+        {
+            if(brows == 0 || bcols == 0)
+                throw MathException("Block size must be nonzero",
+                                    "brows", brows, "bcols", bcols);
+        }
+
+        /*! \brief Converts a dense matrix, dropping small blocks
+         *
+         * A block is stored if any of its elements has a magnitude larger
+         * than \p droptol.
+         */
+        BSRMatrix(const SimpleMatrix<T> & dense, size_t brows, size_t bcols,
+                  double droptol = 0.0)
+            : BSRMatrix(dense.NRows(), dense.NCols(), brows, bcols)
+        {
+            const size_t bsize = brows_ * bcols_;
+            for(size_t I = 0; I < nbrows_; I++)
+            {
+                const size_t rend = std::min((I+1)*brows_, nrows_);
+                for(size_t J = 0; J < nbcols_; J++)
+                {
+                    const size_t cend = std::min((J+1)*bcols_, ncols_);
+
+                    bool keep = false;
+                    for(size_t i = I*brows_; i < rend && !keep; i++)
+                        for(size_t j = J*bcols_; j < cend && !keep; j++)
+                            keep = std::abs(dense(i, j)) > droptol;
+                    if(!keep)
+                        continue;
+
+                    bcolidx_.push_back(J);
+                    values_.resize(values_.size() + bsize, static_cast<T>(0));
+                    T * block = values_.data() + values_.size() - bsize;
+                    for(size_t i = I*brows_; i < rend; i++)
+                        for(size_t j = J*bcols_; j < cend; j++)
+                            block[(i - I*brows_)*bcols_ + (j - J*bcols_)] = dense(i, j);
+                }
+                browptr_[I+1] = bcolidx_.size();
+            }
+        }
+
+        BSRMatrix(const BSRMatrix &) = default;
+        BSRMatrix(BSRMatrix &&) = default;
+        BSRMatrix & operator=(const BSRMatrix &) = default;
+        BSRMatrix & operator=(BSRMatrix &&) = default;
+
+        /*! \brief Comparison
+         *
+         * The dimensions, block sizes, patterns, and values must match
+         * exactly.
+         */
+        bool operator==(const BSRMatrix & rhs) const
+        {
+            PRAGMA_WARNING_PUSH
+            PRAGMA_WARNING_IGNORE_FP_EQUALITY
+            return nrows_ == rhs.nrows_ && ncols_ == rhs.ncols_ &&
+                   brows_ == rhs.brows_ && bcols_ == rhs.bcols_ &&
+                   browptr_ == rhs.browptr_ && bcolidx_ == rhs.bcolidx_ &&
+                   values_ == rhs.values_;
+            PRAGMA_WARNING_POP
+        }
+
+        /// Inequality comparison
+        bool operator!=(const BSRMatrix & rhs) const
+        {
+            return !((*this) == rhs);
+        }
+
+        /// Get the number of rows of this matrix
+        size_t NRows(void) const noexcept { return nrows_; }
+
+        /// Get the number of columns of this matrix
+        size_t NCols(void) const noexcept { return ncols_; }
+
+        /// Get the number of rows in a block
+        size_t BlockRows(void) const noexcept { return brows_; }
+
+        /// Get the number of columns in a block
+        size_t BlockCols(void) const noexcept { return bcols_; }
+
+        /// Get the number of block rows
+        size_t NBlockRows(void) const noexcept { return nbrows_; }
+
+        /// Get the number of block columns
+        size_t NBlockCols(void) const noexcept { return nbcols_; }
+
+        /// Get the number of stored blocks
+        size_t NBlocks(void) const noexcept { return bcolidx_.size(); }
+
+        /// The offsets of the block rows into BlockColIdx()
+        const std::vector<size_t> & BlockRowPtr(void) const noexcept { return browptr_; }
+
+        /// The block column of each stored block
+        const std::vector<size_t> & BlockColIdx(void) const noexcept { return bcolidx_; }
+
+        /// The stored blocks, back to back
+        const std::vector<T> & Values(void) const noexcept { return values_; }
+
+        /// The stored blocks (the pattern can't be changed this way)
+        std::vector<T> & Values(void) noexcept { return values_; }
+
+        /// Converts to a dense matrix
+        SimpleMatrix<T> ToDense(void) const
+        {
+            SimpleMatrix<T> dense(nrows_, ncols_);
+            dense.Zero();
+            const size_t bsize = brows_ * bcols_;
+            for(size_t I = 0; I < nbrows_; I++)
+            {
+                const size_t rend = std::min((I+1)*brows_, nrows_);
+                for(size_t k = browptr_[I]; k < browptr_[I+1]; k++)
+                {
+                    const size_t J = bcolidx_[k];
+                    const size_t cend = std::min((J+1)*bcols_, ncols_);
+                    const T * block = values_.data() + k*bsize;
+                    for(size_t i = I*brows_; i < rend; i++)
+                        for(size_t j = J*bcols_; j < cend; j++)
+                            dense(i, j) = block[(i - I*brows_)*bcols_ + (j - J*bcols_)];
+                }
+            }
+            return dense;
+        }
+
+        bphash::HashValue MyHash(void) const
+        {
+            return bphash::MakeHash(bphash::HashType::Hash128, *this);
+        }
+
+    private:
+        size_t nrows_;                 //!< Number of rows
+        size_t ncols_;                 //!< Number of columns
+        size_t brows_;                 //!< Rows per block
+        size_t bcols_;                 //!< Columns per block
+        size_t nbrows_;                //!< Number of block rows
+        size_t nbcols_;                //!< Number of block columns
+        std::vector<size_t> browptr_;  //!< Start of each block row (nbrows_+1)
+        std::vector<size_t> bcolidx_;  //!< Block column of each block
+        std::vector<T> values_;        //!< The stored blocks
+
+        static size_t NBlocks_(size_t n, size_t bsize)
+        {
+            return bsize == 0 ? 0 : (n + bsize - 1) / bsize;
+        }
+
+
+        //! \name Serialization
+        ///@{
+
+        DECLARE_SERIALIZATION_FRIENDS
+        friend class bphash::Hasher;
+
+        template<class Archive>
+        void save(Archive & ar) const
+        {
+            ar(nrows_, ncols_, brows_, bcols_, browptr_, bcolidx_, values_);
+        }
+
+        template<class Archive>
+        void load(Archive & ar)
+        {
+            ar(nrows_, ncols_, brows_, bcols_, browptr_, bcolidx_, values_);
+            nbrows_ = NBlocks_(nrows_, brows_);
+            nbcols_ = NBlocks_(ncols_, bcols_);
+        }
+
+        void hash(bphash::Hasher & h) const
+        {
+            h(nrows_, ncols_, brows_, bcols_, browptr_, bcolidx_, values_);
+        }
+
+        ///@}
+};
+
+
+/*! \brief Sparse times dense product, C = A B
+ *
+ * Rows of C are computed in parallel.  For a matrix-vector product use
+ * the SimpleVector overload.
+ */
+template<typename T>
+SimpleMatrix<T> SparseMultiply(const CSRMatrix<T> & A, const SimpleMatrix<T> & B)
+{
+    if(A.NCols() != B.NRows())
+        throw MathException("Incompatible dimensions for sparse product",
+                            "acols", A.NCols(), "brows", B.NRows());
+
+    const size_t n = B.NCols();
+    SimpleMatrix<T> C(A.NRows(), n);
+    C.Zero();
+
+    const auto & rowptr = A.RowPtr();
+    const auto & colidx = A.ColIdx();
+    const auto & values = A.Values();
+    const T * b = B.Data();
+    T * c = C.Data();
+
+    parallel::ParallelFor(0, A.NRows(), [&](size_t i)
+    {
+        T * ci = c + i*n;
+        for(size_t k = rowptr[i]; k < rowptr[i+1]; k++)
+        {
+            const T aik = values[k];
+            const T * bk = b + colidx[k]*n;
+            for(size_t j = 0; j < n; j++)
+                ci[j] += aik * bk[j];
+        }
+    }, 64);
+    return C;
+}
+
+/*! \brief Sparse matrix times vector, y = A x
+ */
+template<typename T>
+SimpleVector<T> SparseMultiply(const CSRMatrix<T> & A, const SimpleVector<T> & x)
+{
+    if(A.NCols() != x.Size())
+        throw MathException("Incompatible dimensions for sparse product",
+                            "acols", A.NCols(), "xsize", x.Size());
+
+    SimpleVector<T> y(A.NRows());
+
+    const auto & rowptr = A.RowPtr();
+    const auto & colidx = A.ColIdx();
+    const auto & values = A.Values();
+    const T * xd = x.Data();
+    T * yd = y.Data();
+
+    parallel::ParallelFor(0, A.NRows(), [&](size_t i)
+    {
+        T sum = static_cast<T>(0);
+        for(size_t k = rowptr[i]; k < rowptr[i+1]; k++)
+            sum += values[k] * xd[colidx[k]];
+        yd[i] = sum;
+    }, 256);
+    return y;
+}
+
+/*! \brief Dense times sparse product, C = B A
+ *
+ * Each row of C is a combination of the rows of A, so rows of C are
+ * computed in parallel without any write conflicts.
+ */
+template<typename T>
+SimpleMatrix<T> SparseMultiply(const SimpleMatrix<T> & B, const CSRMatrix<T> & A)
+{
+    if(B.NCols() != A.NRows())
+        throw MathException("Incompatible dimensions for sparse product",
+                            "bcols", B.NCols(), "arows", A.NRows());
+
+    const size_t n = A.NCols(), m = B.NCols();
+    SimpleMatrix<T> C(B.NRows(), n);
+    C.Zero();
+
+    const auto & rowptr = A.RowPtr();
+    const auto & colidx = A.ColIdx();
+    const auto & values = A.Values();
+    const T * b = B.Data();
+    T * c = C.Data();
+
+    parallel::ParallelFor(0, B.NRows(), [&](size_t i)
+    {
+        T * ci = c + i*n;
+        for(size_t k = 0; k < m; k++)
+        {
+            const T bik = b[i*m + k];
+            for(size_t l = rowptr[k]; l < rowptr[k+1]; l++)
+                ci[colidx[l]] += bik * values[l];
+        }
+    }, 0);
+    return C;
+}
+
+/*! \brief Block sparse times dense product, C = A B
+ *
+ * Block rows of C are computed in parallel.
+ */
+template<typename T>
+SimpleMatrix<T> SparseMultiply(const BSRMatrix<T> & A, const SimpleMatrix<T> & B)
+{
+    if(A.NCols() != B.NRows())
+        throw MathException("Incompatible dimensions for sparse product",
+                            "acols", A.NCols(), "brows", B.NRows());
+
+    const size_t n = B.NCols();
+    const size_t br = A.BlockRows(), bc = A.BlockCols(), bsize = br*bc;
+    SimpleMatrix<T> C(A.NRows(), n);
+    C.Zero();
+
+    const auto & browptr = A.BlockRowPtr();
+    const auto & bcolidx = A.BlockColIdx();
+    const auto & values = A.Values();
+    const T * b = B.Data();
+    T * c = C.Data();
+
+    parallel::ParallelFor(0, A.NBlockRows(), [&](size_t I)
+    {
+        const size_t r0 = I*br, rend = std::min(r0 + br, A.NRows());
+        for(size_t k = browptr[I]; k < browptr[I+1]; k++)
+        {
+            const size_t c0 = bcolidx[k]*bc, cend = std::min(c0 + bc, A.NCols());
+            const T * block = values.data() + k*bsize;
+            for(size_t i = r0; i < rend; i++)
+            {
+                T * ci = c + i*n;
+                for(size_t kk = c0; kk < cend; kk++)
+                {
+                    const T aik = block[(i - r0)*bc + (kk - c0)];
+                    const T * bk = b + kk*n;
+                    for(size_t j = 0; j < n; j++)
+                        ci[j] += aik * bk[j];
+                }
+            }
+        }
+    }, 4);
+    return C;
+}
+
+/*! \brief Block sparse matrix times vector, y = A x
+ */
+template<typename T>
+SimpleVector<T> SparseMultiply(const BSRMatrix<T> & A, const SimpleVector<T> & x)
+{
+    if(A.NCols() != x.Size())
+        throw MathException("Incompatible dimensions for sparse product",
+                            "acols", A.NCols(), "xsize", x.Size());
+
+    SimpleVector<T> y(A.NRows());
+    y.Zero();
+
+    const size_t br = A.BlockRows(), bc = A.BlockCols(), bsize = br*bc;
+    const auto & browptr = A.BlockRowPtr();
+    const auto & bcolidx = A.BlockColIdx();
+    const auto & values = A.Values();
+    const T * xd = x.Data();
+    T * yd = y.Data();
+
+    parallel::ParallelFor(0, A.NBlockRows(), [&](size_t I)
+    {
+        const size_t r0 = I*br, rend = std::min(r0 + br, A.NRows());
+        for(size_t k = browptr[I]; k < browptr[I+1]; k++)
+        {
+            const size_t c0 = bcolidx[k]*bc, cend = std::min(c0 + bc, A.NCols());
+            const T * block = values.data() + k*bsize;
+            for(size_t i = r0; i < rend; i++)
+            {
+                T sum = static_cast<T>(0);
+                for(size_t j = c0; j < cend; j++)
+                    sum += block[(i - r0)*bc + (j - c0)] * xd[j];
+                yd[i] += sum;
+            }
+        }
+    }, 16);
+    return y;
+}
+
+
+// Explicit instantiations
+extern template class CSRMatrix<float>;
+extern template class CSRMatrix<double>;
+extern template class CSRMatrix<std::complex<float>>;
+extern template class CSRMatrix<std::complex<double>>;
+extern template class BSRMatrix<float>;
+extern template class BSRMatrix<double>;
+extern template class BSRMatrix<std::complex<float>>;
+extern template class BSRMatrix<std::complex<double>>;
+
+
+typedef CSRMatrix<float> CSRMatrixF;
+typedef CSRMatrix<double> CSRMatrixD;
+typedef CSRMatrix<std::complex<float>> CSRMatrixCF;
+typedef CSRMatrix<std::complex<double>> CSRMatrixCD;
+typedef BSRMatrix<float> BSRMatrixF;
+typedef BSRMatrix<double> BSRMatrixD;
+typedef BSRMatrix<std::complex<float>> BSRMatrixCF;
+typedef BSRMatrix<std::complex<double>> BSRMatrixCD;
+
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
@@ -0,0 +1,285 @@
+/*! \file
+ *
+ * \brief Cached atom permutations and orbits under symmetry operations
+ */
+
+#ifndef PULSAR_GUARD_MATH__SYMMETRYORBITS_HPP_
+#define PULSAR_GUARD_MATH__SYMMETRYORBITS_HPP_
+
+#include <array>
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "bphash/Hasher.hpp"
+#include "bphash/types/vector.hpp"
+#include "bphash/types/array.hpp"
+
+namespace pulsar{
+namespace math{
+
+///A symmetry operation as a row-major 3x3 matrix (e.g. from rotation())
+typedef std::array<double,9> SymmetryOp_t;
+
+///A Cartesian point
+typedef std::array<double,3> Point_t;
+
+/*! \brief How the atoms of a molecule are related by its symmetry operations
+ *
+ * Everything here follows from the geometry and the operations, so it is
+ * computed once (see GetSymmetryOrbits()) and then only looked up.
+ */
+struct SymmetryOrbits{
+    ///Perm[op][i] is the atom that atom i is moved onto by operation op
+    std::vector<std::vector<size_t>> Perm;
+
+    ///The symmetry-unique atoms, the lowest index of each orbit
+    std::vector<size_t> UniqueAtoms;
+
+    ///Orbits[k] are the atoms equivalent to UniqueAtoms[k], in increasing order
+    std::vector<std::vector<size_t>> Orbits;
+
+    ///OrbitOf[i] is the index (into UniqueAtoms) of the orbit atom i is in
+    std::vector<size_t> OrbitOf;
+
+    ///Stabilizer[i] are the operations that leave atom i in place
+    std::vector<std::vector<size_t>> Stabilizer;
+
+    size_t NAtoms(void)const noexcept{return OrbitOf.size();}
+    size_t NOps(void)const noexcept{return Perm.size();}
+};
+
+/** \brief Applies the operations to the atoms and works out the orbits
+ *
+ *  Symmetry operations are orthogonal, so an atom is moved onto an atom at
+ *  the same distance from the origin.  The atoms are sorted by that
+ *  distance once, and the image of each atom is looked for only among the
+ *  atoms with (nearly) the same distance and the same label, making this
+ *  \f$O(N_{op}N\log N)\f$ for non-pathological geometries.
+ *
+ *  The orbits are closed under products of the operations, so \p Ops only
+ *  needs to generate the point group (e.g. a rotation and a reflection
+ *  rather than all of \f$C_{2v}\f$).  Perm and Stabilizer are only about
+ *  the operations as given, so Stabilizer is the full stabilizer of each
+ *  atom only if \p Ops is the whole group.
+ *
+ *  \param[in] Coords The positions of the atoms, with the symmetry elements
+ *                    passing through the origin
+ *  \param[in] Labels Atoms with different labels are never equivalent.
+ *                    Usually the atomic number, but anything that
+ *                    distinguishes atoms (isotopes, ghost atoms...) works.
+ *  \param[in] Ops The symmetry operations
+ *  \param[in] Tol How close (in each coordinate) an image must be to an atom
+ *  \throw pulsar::MathException if the geometry isn't symmetric under one
+ *         of the operations, if an operation doesn't permute the atoms
+ *         (two atoms are closer than \p Tol and get the same image), or if
+ *         the lengths of \p Coords and \p Labels differ
+ */
+inline SymmetryOrbits MakeSymmetryOrbits(const std::vector<Point_t>& Coords,
+                                         const std::vector<int>& Labels,
+                                         const std::vector<SymmetryOp_t>& Ops,
+                                         double Tol=1e-6){
+    const size_t NAtoms=Coords.size();
+    if(Labels.size()!=NAtoms)
+        throw MathException("Number of labels and atoms differ",
+                            "natoms",NAtoms,"nlabels",Labels.size());
+
+    std::vector<double> Dist(NAtoms);
+    std::vector<size_t> Order(NAtoms);
+    for(size_t i=0;i<NAtoms;++i){
+        const Point_t& r=Coords[i];
+        Dist[i]=std::sqrt(r[0]*r[0]+r[1]*r[1]+r[2]*r[2]);
+        Order[i]=i;
+    }
+    std::sort(Order.begin(),Order.end(),
+              [&](size_t a,size_t b){return Dist[a]<Dist[b];});
+    std::vector<double> SortedDist(NAtoms);
+    for(size_t i=0;i<NAtoms;++i)SortedDist[i]=Dist[Order[i]];
+
+    //The distance window has to allow for Tol in every coordinate
+    const double DistTol=2.0*std::sqrt(3.0)*Tol;
+
+    SymmetryOrbits Result;
+    Result.Perm.assign(Ops.size(),std::vector<size_t>(NAtoms));
+    for(size_t op=0;op<Ops.size();++op){
+        const SymmetryOp_t& R=Ops[op];
+        for(size_t i=0;i<NAtoms;++i){
+            const Point_t& r=Coords[i];
+            Point_t Image;
+            for(size_t j=0;j<3;++j)
+                Image[j]=R[j*3]*r[0]+R[j*3+1]*r[1]+R[j*3+2]*r[2];
+
+            auto Begin=std::lower_bound(SortedDist.begin(),SortedDist.end(),
+                                        Dist[i]-DistTol);
+            size_t Found=NAtoms;
+            for(auto it=Begin;it!=SortedDist.end() && *it<=Dist[i]+DistTol;++it){
+                const size_t k=Order[it-SortedDist.begin()];
+                if(Labels[k]!=Labels[i])continue;
+                if(std::fabs(Coords[k][0]-Image[0])<=Tol &&
+                   std::fabs(Coords[k][1]-Image[1])<=Tol &&
+                   std::fabs(Coords[k][2]-Image[2])<=Tol){
+                    Found=k;
+                    break;
+                }
+            }
+            if(Found==NAtoms)
+                throw MathException("Atom has no image under symmetry operation",
+                                    "atom",i,"operation",op);
+            Result.Perm[op][i]=Found;
+        }
+
+        //Two atoms within Tol of each other can both find the same image
+        std::vector<bool> Hit(NAtoms,false);
+        for(size_t i=0;i<NAtoms;++i){
+            const size_t k=Result.Perm[op][i];
+            if(Hit[k])
+                throw MathException("Symmetry operation maps two atoms onto the same atom",
+                                    "atom",i,"image",k,"operation",op);
+            Hit[k]=true;
+        }
+    }
+
+    //Atoms are visited in order, so the first of each orbit is the lowest
+    const size_t None=NAtoms;
+    Result.OrbitOf.assign(NAtoms,None);
+    Result.Stabilizer.resize(NAtoms);
+    for(size_t i=0;i<NAtoms;++i){
+        for(size_t op=0;op<Ops.size();++op)
+            if(Result.Perm[op][i]==i)Result.Stabilizer[i].push_back(op);
+        if(Result.OrbitOf[i]!=None)continue;
+
+        //Everything reachable by repeatedly applying the operations
+        const size_t k=Result.UniqueAtoms.size();
+        Result.UniqueAtoms.push_back(i);
+        std::vector<size_t> Orbit(1,i);
+        Result.OrbitOf[i]=k;
+        for(size_t a=0;a<Orbit.size();++a)
+            for(size_t op=0;op<Ops.size();++op){
+                const size_t j=Result.Perm[op][Orbit[a]];
+                if(Result.OrbitOf[j]!=None)continue;
+                Result.OrbitOf[j]=k;
+                Orbit.push_back(j);
+            }
+        std::sort(Orbit.begin(),Orbit.end());
+        Result.Orbits.push_back(std::move(Orbit));
+    }
+    return Result;
+}
+
+namespace detail{
+
+/** \brief The process-wide cache behind GetSymmetryOrbits()
+ *
+ *  Least recently used tables are dropped once there are more than
+ *  MaxSize of them, so e.g. the steps of a geometry optimization, each a
+ *  new geometry, don't accumulate.
+ */
+struct SymmetryOrbitCache{
+    typedef std::shared_ptr<const SymmetryOrbits> Table_t;
+    typedef std::list<bphash::HashValue> Recent_t;
+
+    std::mutex Mutex;
+    size_t MaxSize=64;
+    ///Most recently used first
+    Recent_t Recent;
+    std::map<bphash::HashValue,std::pair<Table_t,Recent_t::iterator>> Orbits;
+
+    static SymmetryOrbitCache& Instance(void){
+        static SymmetryOrbitCache Cache;
+        return Cache;
+    }
+
+    ///The table for Key, or null; marks it as just used.  Lock first.
+    Table_t Find(const bphash::HashValue& Key){
+        auto it=Orbits.find(Key);
+        if(it==Orbits.end())return Table_t();
+        Recent.splice(Recent.begin(),Recent,it->second.second);
+        return it->second.first;
+    }
+
+    ///Adds a table (unless Key is already there), returns the cached one.
+    ///Lock first.
+    Table_t Insert(const bphash::HashValue& Key,Table_t Table){
+        Table_t Old=Find(Key);
+        if(Old)return Old;
+        Recent.push_front(Key);
+        Orbits.emplace(Key,std::make_pair(std::move(Table),Recent.begin()));
+        Shrink();
+        return Orbits.at(Key).first;
+    }
+
+    ///Drops the least recently used tables down to MaxSize.  Lock first.
+    void Shrink(void){
+        while(Orbits.size()>MaxSize && Orbits.size()>1){
+            Orbits.erase(Recent.back());
+            Recent.pop_back();
+        }
+    }
+};
+
+}//End namespace detail
+
+/** \brief The orbit table for a geometry, computed on first use
+ *
+ *  Tables are stored under a hash of all of the arguments, so any module
+ *  asking about the same geometry and operations gets the same table
+ *  without redoing the work.  The table itself is immutable and may be
+ *  shared freely between threads.  Only the most recently used tables are
+ *  kept (see SetSymmetryOrbitCacheSize()).
+ *
+ *  The table is built outside of the lock, so two threads asking for the
+ *  same new geometry at once may both build it; only one copy is kept.
+ *
+ *  \param[in] Coords, Labels, Ops, Tol As for MakeSymmetryOrbits()
+ *  \throw pulsar::MathException under the same conditions as
+ *         MakeSymmetryOrbits()
+ */
+inline std::shared_ptr<const SymmetryOrbits>
+GetSymmetryOrbits(const std::vector<Point_t>& Coords,
+                  const std::vector<int>& Labels,
+                  const std::vector<SymmetryOp_t>& Ops,
+                  double Tol=1e-6){
+    bphash::Hasher h(bphash::HashType::Hash128);
+    h(Coords,Labels,Ops,Tol);
+    const bphash::HashValue Key=h.finalize();
+
+    detail::SymmetryOrbitCache& Cache=detail::SymmetryOrbitCache::Instance();
+    {
+        std::lock_guard<std::mutex> l(Cache.Mutex);
+        auto Found=Cache.Find(Key);
+        if(Found)return Found;
+    }
+
+    auto Orbits=std::make_shared<const SymmetryOrbits>(
+                    MakeSymmetryOrbits(Coords,Labels,Ops,Tol));
+    std::lock_guard<std::mutex> l(Cache.Mutex);
+    return Cache.Insert(Key,std::move(Orbits));
+}
+
+/** \brief Sets how many orbit tables GetSymmetryOrbits() keeps (default 64)
+ *
+ *  The least recently used ones beyond that are dropped; tables still in
+ *  use stay valid.  At least one table is always kept.
+ */
+inline void SetSymmetryOrbitCacheSize(size_t MaxSize){
+    detail::SymmetryOrbitCache& Cache=detail::SymmetryOrbitCache::Instance();
+    std::lock_guard<std::mutex> l(Cache.Mutex);
+    Cache.MaxSize=MaxSize;
+    Cache.Shrink();
+}
+
+///Drops all cached orbit tables (tables still in use stay valid)
+inline void ClearSymmetryOrbitCache(void){
+    detail::SymmetryOrbitCache& Cache=detail::SymmetryOrbitCache::Instance();
+    std::lock_guard<std::mutex> l(Cache.Mutex);
+    Cache.Orbits.clear();
+    Cache.Recent.clear();
+}
+
+}}//End namespaces
+#endif /* SYMMETRYORBITS_HPP */
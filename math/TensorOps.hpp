@@ -0,0 +1,328 @@
+/*! \file
+ *
+ * \brief Index permutations and contractions of SimpleTensor
+ */
+
+#ifndef PULSAR_GUARD_MATH__TENSOROPS_HPP_
+#define PULSAR_GUARD_MATH__TENSOROPS_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <type_traits>
+
+#include "pulsar/exception/PulsarException.hpp"
+#include "pulsar/math/SimpleTensor.hpp"
+#include "pulsar/math/BLAS.hpp"
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace math{
+
+/*! \brief Copies a tensor with its indices permuted
+ *
+ * Sets \f$Out(i_0,i_1,\ldots)=In(j_0,j_1,\ldots)\f$ with
+ * \f$j_{Perm[d]}=i_d\f$, i.e. dimension d of the output is dimension
+ * Perm[d] of the input.  Either view may have any strides.
+ *
+ * Naively one of the two tensors is read or written with a large stride.
+ * Instead the dimension that is contiguous in the output and the one that
+ * is contiguous in the input are cut into tiles, and each pair of tiles is
+ * transposed while it is in cache.  The tiles (and all other indices) are
+ * spread over the threads.  If the same dimension is contiguous in both,
+ * whole rows are copied.
+ *
+ * \throw pulsar::MathException if \p Perm isn't a permutation of the
+ *        dimensions, or the shape of \p Out isn't the permuted shape of
+ *        \p In
+ */
+template<typename T>
+void Permute(const TensorView<T> & In, const std::vector<size_t> & Perm,
+             const TensorView<typename std::remove_const<T>::type> & Out)
+{
+    const size_t r = In.Rank();
+    if(Perm.size() != r || Out.Rank() != r)
+        throw MathException("Permutation has the wrong rank", "rank", r,
+                            "nperm", Perm.size(), "outrank", Out.Rank());
+    std::vector<bool> seen(r, false);
+    for(size_t d = 0; d < r; d++)
+    {
+        if(Perm[d] >= r || seen[Perm[d]])
+            throw MathException("Not a permutation", "dim", d, "perm", Perm[d]);
+        seen[Perm[d]] = true;
+        if(Out.Shape()[d] != In.Shape()[Perm[d]])
+            throw MathException("Output has the wrong shape", "dim", d,
+                                "extent", Out.Shape()[d],
+                                "expected", In.Shape()[Perm[d]]);
+    }
+    if(In.Size() == 0)
+        return;
+    if(r == 0)
+    {
+        *Out.Data() = *In.Data();
+        return;
+    }
+
+    //Everything in terms of the output's dimensions
+    std::vector<size_t> n(Out.Shape()), os(Out.Strides()), is(r);
+    for(size_t d = 0; d < r; d++)
+        is[d] = In.Strides()[Perm[d]];
+
+    //a is contiguous in the output, b in the input
+    size_t a = r-1, b = r-1;
+    for(size_t d = r; d > 0; d--)
+    {
+        if(os[d-1] < os[a]) a = d-1;
+        if(is[d-1] < is[b]) b = d-1;
+    }
+
+    const size_t tile = 32;
+    const size_t tilea = (a == b) ? n[a] : tile;
+    const size_t tileb = (a == b) ? 1 : tile;
+    const size_t nta = (n[a] + tilea - 1) / tilea;
+    const size_t ntb = (a == b) ? 1 : (n[b] + tileb - 1) / tileb;
+
+    std::vector<size_t> loop;
+    size_t nouter = 1;
+    for(size_t d = 0; d < r; d++)
+        if(d != a && d != b)
+        {
+            loop.push_back(d);
+            nouter *= n[d];
+        }
+
+    const T * in = In.Data();
+    typename std::remove_const<T>::type * out = Out.Data();
+    parallel::ParallelFor(0, nouter * nta * ntb, [&](size_t item)
+    {
+        size_t w = item;
+        const size_t tb = w % ntb; w /= ntb;
+        const size_t ta = w % nta; w /= nta;
+        size_t io = 0, oo = 0;
+        for(size_t l = loop.size(); l > 0; l--)
+        {
+            const size_t d = loop[l-1];
+            const size_t i = w % n[d];
+            w /= n[d];
+            io += i * is[d];
+            oo += i * os[d];
+        }
+
+        const size_t a0 = ta * tilea, a1 = std::min(a0 + tilea, n[a]);
+        if(a == b)
+        {
+            for(size_t j = a0; j < a1; j++)
+                out[oo + j * os[a]] = in[io + j * is[a]];
+            return;
+        }
+        const size_t b0 = tb * tileb, b1 = std::min(b0 + tileb, n[b]);
+        for(size_t i = b0; i < b1; i++)
+        {
+            const T * src = in + io + i * is[b];
+            auto * dst = out + oo + i * os[b];
+            for(size_t j = a0; j < a1; j++)
+                dst[j * os[a]] = src[j * is[a]];
+        }
+    }, 1);
+}
+
+/*! \brief Returns a copy of a tensor with its indices permuted
+ *
+ * Dimension d of the result is dimension Perm[d] of \p A.  See the
+ * view version for details.
+ */
+template<typename T>
+SimpleTensor<T> Permute(const SimpleTensor<T> & A, const std::vector<size_t> & Perm)
+{
+    if(Perm.size() != A.Rank())
+        throw MathException("Permutation has the wrong rank", "rank", A.Rank(),
+                            "nperm", Perm.size());
+    std::vector<size_t> shape(Perm.size());
+    for(size_t d = 0; d < Perm.size(); d++)
+    {
+        if(Perm[d] >= A.Rank())
+            throw MathException("Not a permutation", "dim", d, "perm", Perm[d]);
+        shape[d] = A.Shape()[Perm[d]];
+    }
+    SimpleTensor<T> B(shape);
+    Permute(A.View(), Perm, B.View());
+    return B;
+}
+
+
+namespace detail{
+
+///Where each index of \p To is in \p From
+inline std::vector<size_t> IndexPermutation(const std::string & From,
+                                            const std::string & To)
+{
+    std::vector<size_t> perm(To.size());
+    for(size_t d = 0; d < To.size(); d++)
+        perm[d] = From.find(To[d]);
+    return perm;
+}
+
+///Checks the index string of a tensor and records the extents
+inline void AddIndices(const std::string & Idx, const std::vector<size_t> & Shape,
+                       std::map<char, size_t> & Extents)
+{
+    if(Idx.size() != Shape.size())
+        throw MathException("Number of indices doesn't match the rank",
+                            "indices", Idx, "rank", Shape.size());
+    for(size_t d = 0; d < Idx.size(); d++)
+    {
+        if(Idx.find(Idx[d], d+1) != std::string::npos)
+            throw MathException("Repeated index within a tensor", "indices", Idx);
+        auto it = Extents.emplace(Idx[d], Shape[d]).first;
+        if(it->second != Shape[d])
+            throw MathException("Index has different extents", "index", std::string(1, Idx[d]),
+                                "extent", it->second, "other", Shape[d]);
+    }
+}
+
+} // close namespace detail
+
+
+/*! \brief \f$C\leftarrow\alpha AB+\beta C\f$ for tensors, summing over
+ *         the indices \p A and \p B have in common
+ *
+ * Indices are single characters, e.g. Contract(1.0, A, "ijk", B, "klj",
+ * 0.0, C, "il") is \f$C_{il}=\sum_{jk}A_{ijk}B_{klj}\f$.  Each index of
+ * \p C must come from exactly one of \p A and \p B, and the rest of the
+ * indices must appear in both.
+ *
+ * This is done as one GEMM: \p A and \p B are permuted, if need be, so
+ * that their free and summed indices are grouped (a tensor already in
+ * either grouping isn't copied, the GEMM transposes it instead), and the
+ * result is permuted into \p C's order if that isn't already the order of
+ * the free indices.
+ *
+ * \throw pulsar::MathException if the indices don't form a contraction
+ *        or the extents don't match
+ */
+inline void Contract(double alpha,
+                     const SimpleTensorD & A, const std::string & AIdx,
+                     const SimpleTensorD & B, const std::string & BIdx,
+                     double beta,
+                     SimpleTensorD & C, const std::string & CIdx)
+{
+    std::map<char, size_t> extents;
+    detail::AddIndices(AIdx, A.Shape(), extents);
+    detail::AddIndices(BIdx, B.Shape(), extents);
+    detail::AddIndices(CIdx, C.Shape(), extents);
+
+    std::string freea, freeb, summed;
+    for(char c : CIdx)
+    {
+        const bool ina = AIdx.find(c) != std::string::npos;
+        const bool inb = BIdx.find(c) != std::string::npos;
+        if(ina == inb)
+            throw MathException("Index of the result must be in exactly one input",
+                                "index", std::string(1, c));
+        (ina ? freea : freeb) += c;
+    }
+    for(char c : AIdx)
+        if(CIdx.find(c) == std::string::npos)
+        {
+            if(BIdx.find(c) == std::string::npos)
+                throw MathException("Index appears in only one tensor",
+                                    "index", std::string(1, c));
+            summed += c;
+        }
+    for(char c : BIdx)
+        if(CIdx.find(c) == std::string::npos && AIdx.find(c) == std::string::npos)
+            throw MathException("Index appears in only one tensor",
+                                "index", std::string(1, c));
+
+    size_t m = 1, n = 1, k = 1;
+    for(char c : freea) m *= extents[c];
+    for(char c : freeb) n *= extents[c];
+    for(char c : summed) k *= extents[c];
+
+    //Use A as is if it's M by K or K by M
+    const double * pa = A.Data();
+    bool transa = false;
+    SimpleTensorD Ap;
+    if(AIdx == summed + freea)
+        transa = true;
+    else if(AIdx != freea + summed)
+    {
+        Ap = Permute(A, detail::IndexPermutation(AIdx, freea + summed));
+        pa = Ap.Data();
+    }
+
+    const double * pb = B.Data();
+    bool transb = false;
+    SimpleTensorD Bp;
+    if(BIdx == freeb + summed)
+        transb = true;
+    else if(BIdx != summed + freeb)
+    {
+        Bp = Permute(B, detail::IndexPermutation(BIdx, summed + freeb));
+        pb = Bp.Data();
+    }
+
+    const int lda = transa ? m : k;
+    const int ldb = transb ? k : n;
+    if(CIdx == freea + freeb)
+    {
+        if(k == 0)
+        {
+            for(size_t i = 0; i < C.Size(); i++)
+                C.Data()[i] = (beta == 0.0 ? 0.0 : beta * C.Data()[i]);
+            return;
+        }
+        Gemm(transa, transb, m, n, k, alpha, pa, lda, pb, ldb, beta, C.Data(), n);
+        return;
+    }
+
+    std::vector<size_t> tmpshape;
+    for(char c : freea + freeb)
+        tmpshape.push_back(extents[c]);
+    SimpleTensorD Tmp(tmpshape);
+    Tmp.Zero();
+    if(k > 0)
+        Gemm(transa, transb, m, n, k, alpha, pa, lda, pb, ldb, 0.0, Tmp.Data(), n);
+
+    const std::vector<size_t> perm = detail::IndexPermutation(freea + freeb, CIdx);
+    if(beta == 0.0)
+    {
+        Permute(Tmp.View(), perm, C.View());
+        return;
+    }
+    SimpleTensorD Cp = Permute(Tmp, perm);
+    for(size_t i = 0; i < C.Size(); i++)
+        C.Data()[i] = beta * C.Data()[i] + Cp.Data()[i];
+}
+
+/*! \brief Returns \f$AB\f$ summed over common indices, with the indices
+ *         of the result in the order \p CIdx
+ *
+ * See the other overload for details.
+ */
+inline SimpleTensorD Contract(const SimpleTensorD & A, const std::string & AIdx,
+                              const SimpleTensorD & B, const std::string & BIdx,
+                              const std::string & CIdx)
+{
+    std::map<char, size_t> extents;
+    detail::AddIndices(AIdx, A.Shape(), extents);
+    detail::AddIndices(BIdx, B.Shape(), extents);
+    std::vector<size_t> shape;
+    for(char c : CIdx)
+    {
+        auto it = extents.find(c);
+        if(it == extents.end())
+            throw MathException("Index of the result is in neither input",
+                                "index", std::string(1, c));
+        shape.push_back(it->second);
+    }
+    SimpleTensorD C(shape);
+    Contract(1.0, A, AIdx, B, BIdx, 0.0, C, CIdx);
+    return C;
+}
+
+} // close namespace math
+} // close namespace pulsar
+
+#endif
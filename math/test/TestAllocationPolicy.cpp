@@ -0,0 +1,112 @@
+/*! \file
+ *
+ * \brief Tests of matrices allocated under each AllocationPolicy
+ */
+
+#include <cstdint>
+#include <random>
+
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/math/AllocationPolicy.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Sets the policy with a small threshold so the test matrices are placed
+void Set(PagePlacement Where, bool Huge)
+{
+    AllocationPolicy Policy;
+    Policy.Placement = Where;
+    Policy.HugePages = Huge;
+    Policy.MinBytes = 1 << 16;
+    SetAllocationPolicy(Policy);
+}
+
+///True if the storage came from mmap rather than new[]
+template<typename T>
+bool IsPlaced(SimpleMatrix<T> M)
+{
+    return M.Release().get_deleter().Bytes != 0;
+}
+
+bool IsZero(const SimpleMatrixD & M)
+{
+    for(size_t i = 0; i < M.Size(); i++)
+        if(M.Data()[i] != 0.0)
+            return false;
+    return true;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Allocation policy");
+
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<double> Src(300 * 211);
+    for(double & x : Src)
+        x = dist(gen);
+
+    const AllocationPolicy Old = GetAllocationPolicy();
+    Tester.Test("Defaults", Old.Placement == PagePlacement::Default && !Old.HugePages);
+    Tester.Test("Default leaves new[] in charge", !IsPlaced(SimpleMatrixD(300, 211)));
+
+    //Every placement gives the same values, only where the pages are differs
+    struct Case { const char * Name; PagePlacement Where; bool Huge; };
+    for(const Case & c : {Case{"Huge pages", PagePlacement::Default, true},
+                          Case{"First touch", PagePlacement::FirstTouch, false},
+                          Case{"Interleave", PagePlacement::Interleave, true}})
+    {
+        const std::string Name(c.Name);
+        Set(c.Where, c.Huge);
+        const AllocationPolicy Got = GetAllocationPolicy();
+        Tester.Test(Name + ": policy is kept", Got.Placement == c.Where && Got.HugePages == c.Huge
+                                               && Got.MinBytes == (1 << 16));
+
+        const SimpleMatrixD Z(300, 211), A(300, 211, Src);
+        Tester.Test(Name + ": new matrix is placed", IsPlaced(Z));
+        Tester.Test(Name + ": storage is page-aligned",
+                    reinterpret_cast<std::uintptr_t>(Z.Data()) % 4096 == 0);
+        Tester.Test(Name + ": new matrix is zero", IsZero(Z));
+        Tester.Test(Name + ": copy of a buffer", std::equal(Src.begin(), Src.end(), A.Data()));
+        const SimpleMatrixD B(A);
+        Tester.Test(Name + ": copy of a matrix", B == A && IsPlaced(B));
+
+        //Fewer rows than threads are split on pages instead
+        const SimpleVector<double> V(Src.size(), Src.data());
+        Tester.Test(Name + ": long vector", std::equal(Src.begin(), Src.end(), V.Data()));
+
+        Tester.Test(Name + ": small matrix isn't placed", !IsPlaced(SimpleMatrixD(10, 10)));
+        Tester.Test(Name + ": nor a non-trivial type", !IsPlaced(SimpleMatrixCD(300, 211)));
+
+        //Placed storage survives being handed around
+        SimpleMatrixD C(A), D;
+        D.Take(300, 211, C.Release());
+        Tester.Test(Name + ": release and take", D == A && C.Size() == 0);
+        SimpleMatrixD E(std::move(D));
+        Tester.Test(Name + ": move", E == A);
+        E = SimpleMatrixD(2, 3, std::vector<double>(6, 1.0));
+        Tester.Test(Name + ": replaced", E(1, 2) == 1.0);
+    }
+
+    //Plain new[] arrays still go in
+    Set(PagePlacement::FirstTouch, false);
+    std::unique_ptr<double[]> Raw(new double[6]());
+    Raw[4] = 2.0;
+    SimpleMatrixD R(2, 3, std::move(Raw));
+    Tester.Test("Matrix from a unique_ptr", R(1, 1) == 2.0 && !IsPlaced(R));
+    SimpleVector<double> RV;
+    RV.Take(3, std::unique_ptr<double[]>(new double[3]()));
+    Tester.Test("Vector takes a unique_ptr", RV.Size() == 3 && RV(2) == 0.0);
+
+    SetAllocationPolicy(Old);
+    Tester.Test("Back to the default", !IsPlaced(SimpleMatrixD(300, 211)));
+
+    return Tester.Result();
+}
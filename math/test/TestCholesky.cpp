@@ -0,0 +1,136 @@
+/*! \file
+ *
+ * \brief Tests of the pivoted Cholesky decomposition
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "pulsar/math/Cholesky.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///A = X X^T for a random n by r matrix X, i.e. PSD with rank r
+SimpleMatrixD LowRank(size_t n, size_t r)
+{
+    std::mt19937 gen(1);
+    std::normal_distribution<double> dist;
+    std::vector<double> X(n * r);
+    for(double & x : X)
+        x = dist(gen);
+    SimpleMatrixD A(n, n);
+    for(size_t i = 0; i < n; i++)
+        for(size_t j = 0; j < n; j++)
+        {
+            double s = 0.0;
+            for(size_t k = 0; k < r; k++)
+                s += X[i * r + k] * X[j * r + k];
+            A(i, j) = s;
+        }
+    return A;
+}
+
+///Largest element of |A - L^T L|
+double Residual(const SimpleMatrixD & A, const SimpleMatrixD & L)
+{
+    double err = 0.0;
+    for(size_t i = 0; i < A.NRows(); i++)
+        for(size_t j = 0; j < A.NCols(); j++)
+        {
+            double s = 0.0;
+            for(size_t k = 0; k < L.NRows(); k++)
+                s += L(k, i) * L(k, j);
+            err = std::max(err, std::fabs(s - A(i, j)));
+        }
+    return err;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Pivoted Cholesky");
+    const size_t n = 200, r = 37;
+    const SimpleMatrixD A = LowRank(n, r);
+
+    //A rank r matrix needs exactly r vectors, and they reproduce it
+    const auto Dense = PivotedCholesky(A, 1e-10, 0, 8);
+    const SimpleMatrixD & L = std::get<0>(Dense);
+    const std::vector<size_t> & Piv = std::get<1>(Dense);
+    Tester.Test("Rank of a rank-37 matrix", L.NRows() == r && L.NCols() == n);
+    Tester.Test("One pivot per vector", Piv.size() == r);
+    Tester.TestClose("Reconstruction error", Residual(A, L), 0.0, 1e-8);
+
+    //Pivots are distinct, and each vector vanishes on the earlier pivots
+    bool Triangular = true, Distinct = true;
+    for(size_t k = 0; k < Piv.size(); k++)
+        for(size_t l = 0; l < k; l++)
+        {
+            Distinct = Distinct && Piv[k] != Piv[l];
+            Triangular = Triangular && std::fabs(L(k, Piv[l])) < 1e-10;
+        }
+    Tester.Test("Pivots are distinct", Distinct);
+    Tester.Test("Factor is triangular in pivot order", Triangular);
+
+    //The column generator sees only requested columns, and gives the same
+    //factor as the dense version
+    size_t NCalls = 0;
+    bool InRange = true;
+    std::vector<double> Diag(n);
+    for(size_t i = 0; i < n; i++)
+        Diag[i] = A(i, i);
+    auto Gen = [&](const std::vector<size_t> & Cols, SimpleMatrixD & Out){
+        NCalls++;
+        InRange = InRange && Cols.size() <= 8 && Out.NRows() == Cols.size()
+                  && Out.NCols() == n;
+        for(size_t c = 0; c < Cols.size(); c++)
+            for(size_t i = 0; i < n; i++)
+                Out(c, i) = A(Cols[c], i);
+    };
+    const auto FromGen = PivotedCholesky(Diag, Gen, 1e-10, 0, 8);
+    Tester.Test("Batches respect BlockSize", InRange);
+    Tester.Test("Columns are requested in batches", NCalls < r);
+    Tester.Test("Generator gives the same pivots", std::get<1>(FromGen) == Piv);
+    Tester.TestClose("Generator gives the same factor",
+                     Residual(A, std::get<0>(FromGen)), 0.0, 1e-8);
+
+    //One column at a time is plain pivoted Cholesky
+    const auto Single = PivotedCholesky(A, 1e-10, 0, 1);
+    Tester.Test("BlockSize 1 rank", std::get<0>(Single).NRows() == r);
+    Tester.TestClose("BlockSize 1 reconstruction error",
+                     Residual(A, std::get<0>(Single)), 0.0, 1e-8);
+
+    //A truncated factor honours MaxRank, and its error is bounded by the
+    //largest residual diagonal element
+    const auto Short = PivotedCholesky(A, 1e-10, 10, 8);
+    const SimpleMatrixD & LShort = std::get<0>(Short);
+    double MaxResDiag = 0.0;
+    for(size_t i = 0; i < n; i++)
+    {
+        double s = 0.0;
+        for(size_t k = 0; k < LShort.NRows(); k++)
+            s += LShort(k, i) * LShort(k, i);
+        MaxResDiag = std::max(MaxResDiag, A(i, i) - s);
+    }
+    Tester.Test("MaxRank caps the rank", LShort.NRows() == 10);
+    Tester.Test("Residual diagonal bounds the error",
+                Residual(A, LShort) <= MaxResDiag * (1.0 + 1e-10));
+
+    //A loose tolerance stops early
+    const auto Loose = PivotedCholesky(A, 1e3, 0, 8);
+    Tester.Test("Tolerance stops early", std::get<0>(Loose).NRows() < r);
+
+    //Bad input
+    SimpleMatrixD Rect(2, 3);
+    Tester.TestThrows("Non-square matrix", [&] { PivotedCholesky(Rect); });
+    Tester.TestThrows("BatchQuality above 1", [&] { PivotedCholesky(A, 1e-10, 0, 8, 2.0); });
+    Tester.TestThrows("BatchQuality of 0", [&] { PivotedCholesky(A, 1e-10, 0, 8, 0.0); });
+
+    return Tester.Result();
+}
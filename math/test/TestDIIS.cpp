@@ -0,0 +1,205 @@
+/*! \file
+ *
+ * \brief Tests of the DIIS extrapolator
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "pulsar/math/DIIS.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+const size_t n = 6;
+
+///The fixed point iteration x <- Mx + b, contracting but slowly
+double M(size_t i, size_t j)
+{
+    return (i == j ? 0.95 - 0.1 * i : 0.0) + 0.05 / (1.0 + i + j);
+}
+
+double b(size_t i)
+{
+    return 1.0 + i;
+}
+
+///Solves the m by m system A y = x by Gaussian elimination with pivoting
+std::vector<double> Solve(std::vector<double> A, std::vector<double> x)
+{
+    const size_t m = x.size();
+    for(size_t k = 0; k < m; k++)
+    {
+        size_t p = k;
+        for(size_t i = k + 1; i < m; i++)
+            if(std::fabs(A[i * m + k]) > std::fabs(A[p * m + k]))
+                p = i;
+        for(size_t j = 0; j < m; j++)
+            std::swap(A[k * m + j], A[p * m + j]);
+        std::swap(x[k], x[p]);
+        for(size_t i = k + 1; i < m; i++)
+        {
+            const double f = A[i * m + k] / A[k * m + k];
+            for(size_t j = k; j < m; j++)
+                A[i * m + j] -= f * A[k * m + j];
+            x[i] -= f * x[k];
+        }
+    }
+    for(size_t k = m; k-- > 0;)
+    {
+        for(size_t j = k + 1; j < m; j++)
+            x[k] -= A[k * m + j] * x[j];
+        x[k] /= A[k * m + k];
+    }
+    return x;
+}
+
+///The fixed point, (1-M)x = b
+std::vector<double> FixedPoint(void)
+{
+    std::vector<double> A(n * n), x(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        for(size_t j = 0; j < n; j++)
+            A[i * n + j] = (i == j ? 1.0 : 0.0) - M(i, j);
+        x[i] = b(i);
+    }
+    return Solve(A, x);
+}
+
+///Textbook DIIS over the last \p Depth vectors, solving the bordered
+///equations directly
+std::vector<double> Reference(const std::vector<std::vector<double>> & P,
+                              const std::vector<std::vector<double>> & E,
+                              size_t Depth)
+{
+    const size_t first = P.size() > Depth ? P.size() - Depth : 0;
+    const size_t m = P.size() - first, N = m + 1;
+    std::vector<double> A(N * N, 0.0), rhs(N, 0.0);
+    for(size_t i = 0; i < m; i++)
+    {
+        for(size_t j = 0; j < m; j++)
+            for(size_t k = 0; k < n; k++)
+                A[i * N + j] += E[first + i][k] * E[first + j][k];
+        A[i * N + m] = A[m * N + i] = -1.0;
+    }
+    rhs[m] = -1.0;
+    const std::vector<double> c = Solve(A, rhs);
+    std::vector<double> x(n, 0.0);
+    for(size_t i = 0; i < m; i++)
+        for(size_t k = 0; k < n; k++)
+            x[k] += c[i] * P[first + i][k];
+    return x;
+}
+
+///One step: Params <- g(x), Error <- g(x) - x
+void Step(const std::vector<double> & x, std::vector<double> & g, std::vector<double> & e)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        g[i] = b(i);
+        for(size_t j = 0; j < n; j++)
+            g[i] += M(i, j) * x[j];
+        e[i] = g[i] - x[i];
+    }
+}
+
+double MaxDiff(const std::vector<double> & x, const std::vector<double> & y)
+{
+    double d = 0.0;
+    for(size_t i = 0; i < x.size(); i++)
+        d = std::max(d, std::fabs(x[i] - y[i]));
+    return d;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("DIIS");
+    const std::vector<double> exact = FixedPoint();
+
+    //Plain iteration is slow, DIIS on a linear problem is exact once the
+    //subspace spans it (like GMRES)
+    std::vector<double> x(n, 0.0), g(n), e(n);
+    DIIS<SimpleMatrixD> Diis(n + 2);
+    double coefsum = 0.0;
+    for(size_t it = 0; it < n + 3; it++)
+    {
+        Step(x, g, e);
+        SimpleMatrixD P(1, n, g), E(1, n, e);
+        const std::vector<double> c = Diis.Extrapolate(P, E);
+        coefsum = 0.0;
+        for(double ci : c)
+            coefsum += ci;
+        x.assign(P.Data(), P.Data() + n);
+    }
+    Tester.TestClose("Coefficients sum to one", coefsum, 1.0, 1e-10);
+    Tester.TestClose("DIIS finds the fixed point", MaxDiff(x, exact), 0.0, 1e-8);
+    Tester.Test("Subspace size", Diis.NVecs() == n + 2);
+
+    Diis.Reset();
+    Tester.Test("Reset empties the subspace", Diis.NVecs() == 0);
+
+    //The ring buffer keeps exactly the last MaxVecs vectors: every step
+    //matches DIIS done from scratch on those
+    std::vector<double> y(n, 0.0);
+    std::vector<std::vector<double>> AllP, AllE;
+    DIIS<SimpleMatrixD> Small(3);
+    double worst = 0.0;
+    for(size_t it = 0; it < 20; it++)
+    {
+        Step(y, g, e);
+        AllP.push_back(g);
+        AllE.push_back(e);
+        SimpleMatrixD P(1, n, g), E(1, n, e);
+        Small.Extrapolate(P, E);
+        y.assign(P.Data(), P.Data() + n);
+        worst = std::max(worst, MaxDiff(y, Reference(AllP, AllE, 3)));
+    }
+    Tester.Test("Ring buffer is capped", Small.NVecs() == 3 && Small.MaxVecs() == 3);
+    Tester.TestClose("Ring buffer matches the reference", worst, 0.0, 1e-9);
+
+    //The same problem split over two irrep blocks gives the same answer
+    std::vector<double> z(n, 0.0);
+    DIIS<IrrepSpinMatrixD> Blocked(n + 2);
+    for(size_t it = 0; it < n + 3; it++)
+    {
+        Step(z, g, e);
+        IrrepSpinMatrixD P, E;
+        P.Set(Irrep::A1, 1, SimpleMatrixD(1, 2, g.data()));
+        P.Set(Irrep::B2, 1, SimpleMatrixD(1, n - 2, g.data() + 2));
+        E.Set(Irrep::A1, 1, SimpleMatrixD(1, 2, e.data()));
+        E.Set(Irrep::B2, 1, SimpleMatrixD(1, n - 2, e.data() + 2));
+        Blocked.Extrapolate(P, E);
+        const SimpleMatrixD & a = P.Get(Irrep::A1, 1), & b2 = P.Get(Irrep::B2, 1);
+        std::copy(a.Data(), a.Data() + 2, z.begin());
+        std::copy(b2.Data(), b2.Data() + n - 2, z.begin() + 2);
+    }
+    Tester.TestClose("Blocked DIIS matches", MaxDiff(z, x), 0.0, 1e-10);
+
+    //Shape mismatches are caught when storing, and nothing is stored
+    Tester.TestThrows("No room for vectors", [] { DIIS<SimpleMatrixD> D(0); });
+    DIIS<SimpleMatrixD> Check(4);
+    SimpleMatrixD P(2, 3), E(2, 3), Wrong(3, 2);
+    Tester.TestThrows("Error shape differs", [&] { Check.Extrapolate(P, Wrong); });
+    Tester.Test("Nothing stored", Check.NVecs() == 0);
+    Check.Extrapolate(P, E);
+    Tester.TestThrows("Later vector shape differs", [&] { Check.Extrapolate(Wrong, Wrong); });
+    Tester.Test("Only the good vector stored", Check.NVecs() == 1);
+
+    DIIS<IrrepSpinMatrixD> CheckBlocks(4);
+    IrrepSpinMatrixD A, B;
+    A.Set(Irrep::A1, 1, SimpleMatrixD(2, 2));
+    B.Set(Irrep::B1, 1, SimpleMatrixD(2, 2));
+    CheckBlocks.Extrapolate(A, A);
+    Tester.TestThrows("Irrep blocks differ", [&] { CheckBlocks.Extrapolate(B, B); });
+    B.Set(Irrep::A1, 1, SimpleMatrixD(2, 2));
+    Tester.TestThrows("Number of blocks differs", [&] { CheckBlocks.Extrapolate(B, B); });
+
+    return Tester.Result();
+}
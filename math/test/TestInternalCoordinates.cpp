@@ -0,0 +1,138 @@
+/*! \file
+ *
+ * \brief Tests of the primitive internal coordinates and the B matrix
+ */
+
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "pulsar/math/InternalCoordinates.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///The least a bond graph has to provide
+struct Bonds{
+    std::vector<std::vector<size_t>> Conns;
+    std::vector<size_t> ConNodes(size_t i)const{return Conns[i];}
+};
+
+double MaxAbs(const std::vector<double>& v){
+    double m=0.0;
+    for(double x:v)m=std::max(m,std::fabs(x));
+    return m;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+    UnitTest Tester("Internal coordinates");
+
+    //A bent, twisted 5-atom chain, with the bonds given in one direction
+    //only: 4 bonds, 3 angles, 2 dihedrals
+    const Bonds Chain{{{1},{2},{3},{4},{}}};
+    std::vector<double> X={0,0,0, 1.5,0,0, 2,1.4,0, 3.5,1.5,0.3, 4,2.9,0.8};
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-0.1,0.1);
+    for(double& x:X)x+=dist(gen);
+    const InternalCoordinates IC(Chain,5);
+    Tester.Test("Number of primitives",IC.NPrimitives()==9 && IC.NAtoms()==5);
+    bool Grouped=true;
+    for(size_t p=1;p<IC.NPrimitives();++p)
+        Grouped=Grouped && IC.Primitives()[p-1].Type<=IC.Primitives()[p].Type;
+    Tester.Test("Primitives are grouped by type",Grouped &&
+                IC.Primitives()[0].Type==InternalType::Bond &&
+                IC.Primitives()[8].Type==InternalType::Dihedral);
+
+    //Values against direct formulas
+    std::vector<double> q;
+    CSRMatrix<double> B;
+    IC.Evaluate(X,q,B);
+    auto Vec=[&](size_t a,size_t b){
+        return std::array<double,3>{X[3*a]-X[3*b],X[3*a+1]-X[3*b+1],X[3*a+2]-X[3*b+2]};
+    };
+    auto Length=[](const std::array<double,3>& v){return std::sqrt(Dot(v,v));};
+    const auto u=Vec(0,1),v=Vec(2,1);
+    Tester.TestClose("Bond length",q[0],Length(u),1e-14);
+    Tester.TestClose("Angle",q[4],std::acos(Dot(u,v)/(Length(u)*Length(v))),1e-14);
+    const auto n1=Cross(Vec(1,0),Vec(2,1)),n2=Cross(Vec(2,1),Vec(3,2));
+    const double phi=std::atan2(Dot(Cross(n1,n2),Vec(2,1))/Length(Vec(2,1)),Dot(n1,n2));
+    Tester.TestClose("Dihedral",std::fabs(q[7]),std::fabs(phi),1e-12);
+
+    //B against central differences
+    const SimpleMatrixD D=B.ToDense();
+    Tester.Test("B shape",D.NRows()==9 && D.NCols()==15);
+    double err=0.0;
+    const double h=1e-6;
+    for(size_t c=0;c<15;++c){
+        std::vector<double> Xp(X),Xm(X);
+        Xp[c]+=h;
+        Xm[c]-=h;
+        const auto d=IC.Difference(IC.Values(Xp),IC.Values(Xm));
+        for(size_t p=0;p<q.size();++p)
+            err=std::max(err,std::fabs(d[p]/(2*h)-D(p,c)));
+    }
+    Tester.TestClose("B matches finite differences",err,0.0,1e-8);
+    Tester.Test("B stores 4*6+3*9+2*12 elements",B.NNZ()==75);
+
+    //Dihedral differences wrap around
+    std::vector<double> a(9,0.0),b(9,0.0);
+    a[8]=PI-0.1;
+    b[8]=-PI+0.1;
+    a[0]=2.0*PI;
+    Tester.TestClose("Dihedral difference wraps",IC.Difference(a,b)[8],-0.2,1e-14);
+    Tester.TestClose("Bond difference doesn't",IC.Difference(a,b)[0],2.0*PI,1e-14);
+
+    //A step made from a real displacement is recovered exactly
+    std::vector<double> Y(X);
+    for(double& y:Y)y+=dist(gen);
+    const auto dq=IC.Difference(IC.Values(Y),q);
+    const auto Z=IC.ToCartesian(X,dq);
+    Tester.TestClose("Back-transformation",MaxAbs(IC.Difference(IC.Values(Z),IC.Values(Y))),0.0,1e-8);
+    Tester.Test("Cached pseudo-inverse gives the same step",IC.ToCartesian(X,dq)==Z);
+
+    //Concurrent back-transformations from different geometries, so the
+    //cache keeps being replaced under the other threads
+    std::vector<std::vector<double>> Starts(4,X),Results(4);
+    for(size_t t=0;t<4;++t)
+        for(double& x:Starts[t])x+=0.01*t;
+    std::vector<std::thread> Threads;
+    for(size_t t=0;t<4;++t)
+        Threads.emplace_back([&,t](){
+            for(size_t rep=0;rep<5;++rep)
+                Results[t]=IC.ToCartesian(Starts[t],dq);
+        });
+    for(auto& t:Threads)t.join();
+    bool Consistent=true;
+    for(size_t t=0;t<4;++t)
+        Consistent=Consistent && Results[t]==IC.ToCartesian(Starts[t],dq);
+    Tester.Test("Concurrent back-transformations",Consistent);
+
+    //Copies work the same
+    InternalCoordinates Copy(IC);
+    Tester.Test("Copy",Copy.NPrimitives()==9 && Copy.ToCartesian(X,dq)==Z);
+    InternalCoordinates Assigned({{InternalType::Bond,{0,1,0,0}}},2);
+    Assigned=IC;
+    Tester.Test("Assignment",Assigned.NAtoms()==5 && Assigned.Values(X)==q);
+
+    //Explicit primitives are sorted into groups too
+    const InternalCoordinates Mixed({{InternalType::Dihedral,{0,1,2,3}},
+                                     {InternalType::Bond,{1,2,0,0}},
+                                     {InternalType::Angle,{0,1,2,0}}},5);
+    const auto qm=Mixed.Values(X);
+    Tester.Test("Explicit primitives",Mixed.Primitives()[0].Type==InternalType::Bond
+                && qm[0]==q[1] && qm[1]==q[4] && std::fabs(qm[2])==std::fabs(q[7]));
+
+    Tester.TestThrows("Geometry of the wrong length",[&]{IC.Values(std::vector<double>(14));});
+    Tester.TestThrows("Step of the wrong length",[&]{IC.ToCartesian(X,std::vector<double>(8));});
+    Tester.TestThrows("Primitive atom out of range",[]{
+        InternalCoordinates({{InternalType::Bond,{0,5,0,0}}},5);});
+    Tester.TestThrows("Bonded atom out of range",[]{InternalCoordinates(Bonds{{{7},{}}},2);});
+
+    return Tester.Result();
+}
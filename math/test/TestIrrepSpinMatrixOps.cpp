@@ -0,0 +1,106 @@
+/*! \file
+ *
+ * \brief Tests of the reductions and elementwise operations over
+ *        irrep/spin blocks
+ */
+
+#include <cmath>
+#include <complex>
+
+#include "pulsar/math/IrrepSpinMatrixOps.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Small integers, so every reference sum below is exact
+IrrepSpinMatrixD Make(double Offset)
+{
+    IrrepSpinMatrixD M;
+    M.Set(Irrep::A1, 1, SimpleMatrixD(300, 300));  //several chunks
+    M.Set(Irrep::A1, -1, SimpleMatrixD(5, 5));
+    M.Set(Irrep::B2, 1, SimpleMatrixD(2, 2));
+    for(auto & it : M)
+        for(size_t i = 0; i < it.second.Size(); i++)
+            it.second.Data()[i] = static_cast<double>(i % 7) - 3.0 + Offset;
+    return M;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Irrep/spin matrix operations");
+
+    const IrrepSpinMatrixD A = Make(0.0), B = Make(1.0);
+    double Tr = 0.0, AB = 0.0, AA = 0.0, Max = 0.0;
+    for(const auto & it : A)
+    {
+        const SimpleMatrixD & a = it.second, & b = B.Get(it.first.first, it.first.second);
+        for(size_t i = 0; i < a.NRows(); i++)
+            Tr += a(i, i);
+        for(size_t i = 0; i < a.Size(); i++)
+        {
+            AB += a.Data()[i] * b.Data()[i];
+            AA += a.Data()[i] * a.Data()[i];
+            Max = std::max(Max, std::fabs(b.Data()[i]));
+        }
+    }
+    Tester.TestClose("Trace", Trace(A), Tr, 0.0);
+    Tester.TestClose("Dot", Dot(A, B), AB, 0.0);
+    Tester.TestClose("Norm", Norm(A), std::sqrt(AA), 1e-12 * std::sqrt(AA));
+    Tester.TestClose("MaxAbs", MaxAbs(B), Max, 0.0);
+    Tester.TestClose("MaxAbs of nothing", MaxAbs(IrrepSpinMatrixD()), 0.0, 0.0);
+
+    //2B - A - B = B - A, which is all ones
+    IrrepSpinMatrixD C(B);
+    Scale(2.0, C);
+    Axpy(-1.0, A, C);
+    Axpy(-1.0, B, C);
+    bool Ones = true;
+    for(const auto & it : C)
+        for(size_t i = 0; i < it.second.Size(); i++)
+            Ones = Ones && it.second.Data()[i] == 1.0;
+    Tester.Test("Scale and Axpy", Ones);
+
+    //Compensated summation keeps what naive summation drops
+    IrrepSpinMatrixD Big;
+    Big.Set(Irrep::A1, 1, SimpleMatrixD(1, 3));
+    Big.Set(Irrep::B1, 1, SimpleMatrixD(1, 1));
+    SimpleMatrixD & b = Big.Get(Irrep::A1, 1);
+    b(0, 0) = 1e16;
+    b(0, 1) = 1.0;
+    b(0, 2) = -1e16;
+    Big.Get(Irrep::B1, 1)(0, 0) = 1.0;
+    IrrepSpinMatrixD Ones4(Big);
+    for(auto & it : Ones4)
+        it.second.Data()[0] = it.second.Data()[it.second.Size() - 1] = 1.0;
+    Ones4.Get(Irrep::A1, 1)(0, 1) = 1.0;
+    Tester.TestClose("Compensated dot", Dot(Big, Ones4), 2.0, 0.0);
+
+    //Complex: the dot product conjugates the left argument
+    IrrepSpinMatrixCD Z;
+    Z.Set(Irrep::A, 0, SimpleMatrixCD(2, 2));
+    for(size_t i = 0; i < 4; i++)
+        Z.Get(Irrep::A, 0).Data()[i] = std::complex<double>(1.0 * i, 1.0);
+    const std::complex<double> ZZ = Dot(Z, Z);
+    Tester.TestClose("Complex dot is real", ZZ.imag(), 0.0, 0.0);
+    Tester.TestClose("Complex dot", ZZ.real(), 0.0 + 1 + 4 + 9 + 4, 0.0);
+    Tester.TestClose("Complex norm", Norm(Z), std::sqrt(18.0), 1e-14);
+    Tester.TestClose("Complex MaxAbs", MaxAbs(Z), std::sqrt(10.0), 1e-14);
+
+    //Shape checks
+    IrrepSpinMatrixD Other(A);
+    Other.Set(Irrep::B2, 1, SimpleMatrixD(2, 3));
+    Tester.TestThrows("Dot of different shapes", [&] { Dot(A, Other); });
+    Tester.TestThrows("Axpy into different shapes", [&] { Axpy(1.0, A, Other); });
+    IrrepSpinMatrixD Missing(A);
+    Missing.Set(Irrep::A2, 1, SimpleMatrixD(2, 2));
+    Tester.TestThrows("Dot with an extra block", [&] { Dot(A, Missing); });
+    Tester.TestThrows("Trace of a non-square block", [&] { Trace(Other); });
+
+    return Tester.Result();
+}
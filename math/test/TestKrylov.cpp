@@ -0,0 +1,137 @@
+/*! \file
+ *
+ * \brief Tests of the batched Krylov solvers against direct solves
+ */
+
+#include <cmath>
+#include <random>
+
+#include "pulsar/math/Krylov.hpp"
+#include "pulsar/math/LinearSolver.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///The operator for a dense matrix, applied row by row
+KrylovOperator_t Dense(const SimpleMatrixD& M){
+    return [M](const std::vector<size_t>&,const SimpleMatrixD& X,SimpleMatrixD& AX){
+        const size_t n=M.NRows();
+        for(size_t r=0;r<X.NRows();++r)
+            for(size_t i=0;i<n;++i){
+                double s=0.0;
+                for(size_t j=0;j<n;++j)s+=M(i,j)*X(r,j);
+                AX(r,i)=s;
+            }
+    };
+}
+
+///Largest difference between X and the LU solution of (M-w_k) x_k = b_k
+double Error(const SimpleMatrixD& M,const SimpleMatrixD& B,const SimpleMatrixD& X,
+             const std::vector<double>& Shifts){
+    double e=0.0;
+    for(size_t k=0;k<B.NRows();++k){
+        SimpleMatrixD Mk(M);
+        for(size_t i=0;i<M.NRows();++i)Mk(i,i)-=Shifts[k];
+        std::vector<double> x(B.Data()+k*B.NCols(),B.Data()+(k+1)*B.NCols());
+        LUSolver(Mk).Solve(x);
+        for(size_t i=0;i<x.size();++i)e=std::max(e,std::fabs(x[i]-X(k,i)));
+    }
+    return e;
+}
+
+bool AllConverged(const KrylovResult& R){
+    for(bool c:R.Converged)if(!c)return false;
+    return true;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+    UnitTest Tester("Krylov solvers");
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1.0,1.0);
+    const size_t n=80,nsys=6;
+
+    //A symmetric, diagonally dominant A with eigenvalues spread over about
+    //[1,9], and a nonsymmetric N
+    SimpleMatrixD A(n,n),N(n,n),B(nsys,n);
+    A.Zero();
+    for(size_t i=0;i<n;++i){
+        A(i,i)=1.0+0.1*i;
+        for(size_t j=0;j<i;++j)A(i,j)=A(j,i)=0.05*dist(gen);
+        for(size_t j=0;j<n;++j)N(i,j)=i==j?2.0+0.05*i:0.1*dist(gen);
+    }
+    for(size_t i=0;i<B.Size();++i)B.Data()[i]=dist(gen);
+    const KrylovOperator_t Jacobi=[&](const std::vector<size_t>&,const SimpleMatrixD& X,
+                                      SimpleMatrixD& AX){
+        for(size_t r=0;r<X.NRows();++r)
+            for(size_t i=0;i<n;++i)AX(r,i)=X(r,i)/A(i,i);
+    };
+    const std::vector<double> NoShift(nsys,0.0);
+    const KrylovOptions Tight{1e-11,500,30};
+
+    SimpleMatrixD X(nsys,n);
+    X.Zero();
+    KrylovResult R=ConjugateGradient(Dense(A),B,X,nullptr,Tight);
+    Tester.Test("CG converges",AllConverged(R) && R.Iterations.size()==nsys);
+    Tester.TestClose("CG",Error(A,B,X,NoShift),0.0,1e-9);
+    const size_t Plain=R.NBatches;
+
+    X.Zero();
+    R=ConjugateGradient(Dense(A),B,X,Jacobi,Tight);
+    Tester.TestClose("Preconditioned CG",Error(A,B,X,NoShift),0.0,1e-9);
+    Tester.Test("Preconditioning saves iterations",R.NBatches<Plain);
+
+    //Starting from the answer needs no iterations
+    R=ConjugateGradient(Dense(A),B,X,Jacobi,KrylovOptions{1e-6,500,30});
+    Tester.Test("Converged guess",AllConverged(R) && R.Iterations[0]==0);
+
+    //Shifts inside the spectrum make half the systems indefinite, which
+    //MINRES handles and CG does not
+    const std::vector<double> Shifts{0.0,0.0,0.0,3.05,3.05,3.05};
+    const KrylovOperator_t Shifted=ShiftedOperator(Dense(A),nullptr,Shifts);
+    X.Zero();
+    R=MINRES(Shifted,B,X,nullptr,Tight);
+    Tester.Test("MINRES converges",AllConverged(R));
+    Tester.TestClose("MINRES, shifted",Error(A,B,X,Shifts),0.0,1e-8);
+    X.Zero();
+    R=MINRES(Dense(A),B,X,Jacobi,Tight);
+    Tester.TestClose("Preconditioned MINRES",Error(A,B,X,NoShift),0.0,1e-9);
+
+    X.Zero();
+    R=GMRES(Shifted,B,X,nullptr,KrylovOptions{1e-11,500,100});
+    Tester.Test("GMRES converges",AllConverged(R));
+    Tester.TestClose("GMRES, shifted",Error(A,B,X,Shifts),0.0,1e-8);
+    X.Zero();
+    R=GMRES(Dense(N),B,X,nullptr,KrylovOptions{1e-11,500,10});
+    Tester.Test("GMRES with restarts converges",AllConverged(R));
+    Tester.TestClose("GMRES, nonsymmetric",Error(N,B,X,NoShift),0.0,1e-9);
+
+    //Running out of iterations is reported rather than thrown
+    X.Zero();
+    R=GMRES(Dense(N),B,X,nullptr,KrylovOptions{1e-14,3,3});
+    Tester.Test("Iteration limit",!R.Converged[0] && R.Iterations[0]<=3 && R.Residual[0]>1e-14);
+
+    //Zero right-hand sides go to the zero solution, with the residual
+    //taken as absolute
+    SimpleMatrixD Zero(2,n),XZ(2,n);
+    Zero.Zero();
+    for(size_t i=0;i<XZ.Size();++i)XZ.Data()[i]=1.0;
+    R=ConjugateGradient(Dense(A),Zero,XZ);
+    Tester.Test("Zero right-hand side",AllConverged(R) && std::fabs(XZ(1,5))<1e-7);
+
+    SimpleMatrixD Wrong(nsys,n+1);
+    Tester.TestThrows("Guess of the wrong shape",[&]{ConjugateGradient(Dense(A),B,Wrong);});
+    const KrylovOperator_t Negative=[](const std::vector<size_t>&,const SimpleMatrixD& X,
+                                       SimpleMatrixD& AX){
+        for(size_t i=0;i<X.Size();++i)AX.Data()[i]=-X.Data()[i];
+    };
+    X.Zero();
+    Tester.TestThrows("Indefinite MINRES preconditioner",[&]{MINRES(Dense(A),B,X,Negative);});
+
+    return Tester.Result();
+}
@@ -0,0 +1,97 @@
+/*! \file
+ *
+ * \brief Tests of the LU and Cholesky solvers
+ */
+
+#include <cmath>
+#include <random>
+
+#include "pulsar/math/LinearSolver.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Largest element of |A x_r - b_r| over the rows r of X and B
+double Residual(const SimpleMatrixD& A,const SimpleMatrixD& X,const SimpleMatrixD& B){
+    const size_t n=A.NRows();
+    double e=0.0;
+    for(size_t r=0;r<B.NRows();++r)
+        for(size_t i=0;i<n;++i){
+            double s=0.0;
+            for(size_t j=0;j<n;++j)s+=A(i,j)*X(r,j);
+            e=std::max(e,std::fabs(s-B(r,i)));
+        }
+    return e;
+}
+
+}//End anonymous namespace
+
+
+int main(){
+    UnitTest Tester("Linear solvers");
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> dist(-1.0,1.0);
+    const size_t n=50,m=130;
+    SimpleMatrixD A(n,n),S(n,n),B(m,n);
+    for(size_t i=0;i<A.Size();++i)A.Data()[i]=dist(gen);
+    for(size_t i=0;i<B.Size();++i)B.Data()[i]=dist(gen);
+    //S = A A^T + 1 is positive definite
+    S.Zero();
+    for(size_t i=0;i<n;++i)
+        for(size_t j=0;j<n;++j){
+            for(size_t k=0;k<n;++k)S(i,j)+=A(i,k)*A(j,k);
+            if(i==j)S(i,j)+=1.0;
+        }
+
+    LUSolver LU(A);
+    CholeskySolver Chol(S);
+    Tester.Test("Factored on construction",LU.IsFactored() && Chol.IsFactored() &&
+                                           LU.Dim()==n && Chol.Dim()==n);
+
+    //Several blockings of the right-hand sides, including uneven ones and
+    //all at once
+    for(size_t Block:{16,64,0,1000}){
+        const std::string Desc=" with blocks of "+std::to_string(Block);
+        Tester.TestClose("LU"+Desc,Residual(A,LU.Solution(B,Block),B),0.0,1e-10);
+        Tester.TestClose("Cholesky"+Desc,Residual(S,Chol.Solution(B,Block),B),0.0,1e-10);
+    }
+
+    //A single vector gives the same as the first row of the blocked solve
+    std::vector<double> b(B.Data(),B.Data()+n);
+    LU.Solve(b);
+    const SimpleMatrixD X=LU.Solution(B);
+    double d=0.0;
+    for(size_t i=0;i<n;++i)d=std::max(d,std::fabs(b[i]-X(0,i)));
+    Tester.TestClose("Single right-hand side",d,0.0,1e-13);
+
+    //The factorization is reused for the same matrix only
+    Tester.Test("Same matrix isn't refactored",!LU.Factor(A) && !Chol.Factor(S));
+    SimpleMatrixD A2(A);
+    A2(3,4)+=1.0;
+    Tester.Test("Changed matrix is refactored",LU.Factor(A2));
+    Tester.TestClose("Solves with the new matrix",Residual(A2,LU.Solution(B),B),0.0,1e-10);
+
+    //Errors, none of which leave a bad factorization behind
+    CholeskySolver Bad;
+    Tester.Test("Default has nothing factored",!Bad.IsFactored());
+    Tester.TestThrows("Solve before factoring",[&]{Bad.Solution(B);});
+    Tester.TestThrows("Not positive definite",[&]{Bad.Factor(A);});
+    Tester.Test("Failed factorization isn't kept",!Bad.IsFactored());
+    SimpleMatrixD Singular(A);
+    for(size_t j=0;j<n;++j)Singular(7,j)=0.0;
+    LUSolver Sing;
+    Tester.TestThrows("Singular matrix",[&]{Sing.Factor(Singular);});
+    Tester.TestThrows("Non-square matrix",[&]{LUSolver(SimpleMatrixD(3,4));});
+    Tester.TestThrows("Right-hand side of the wrong length",[&]{LU.Solution(SimpleMatrixD(2,n+1));});
+    std::vector<double> Short(n-1);
+    Tester.TestThrows("Vector of the wrong length",[&]{LU.Solve(Short);});
+
+    SimpleMatrixD None(0,n);
+    LU.Solve(None);
+    Tester.Test("No right-hand sides",None.NRows()==0);
+
+    return Tester.Result();
+}
@@ -0,0 +1,140 @@
+/*! \file
+ *
+ * \brief Tests of the QR decompositions and block Gram-Schmidt
+ */
+
+#include <cmath>
+#include <random>
+
+#include "pulsar/math/Orthogonalize.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Largest element of |Q^T Q - 1|
+double Orthonormality(const SimpleMatrixD & Q)
+{
+    double e = 0.0;
+    for(size_t a = 0; a < Q.NCols(); a++)
+        for(size_t b = 0; b < Q.NCols(); b++)
+        {
+            double s = 0.0;
+            for(size_t i = 0; i < Q.NRows(); i++)
+                s += Q(i, a) * Q(i, b);
+            e = std::max(e, std::fabs(s - (a == b ? 1.0 : 0.0)));
+        }
+    return e;
+}
+
+///Largest element of |A - QR|
+double Reconstruction(const SimpleMatrixD & A, const QRReturn_t & QR)
+{
+    const SimpleMatrixD & Q = std::get<0>(QR), & R = std::get<1>(QR);
+    double e = 0.0;
+    for(size_t i = 0; i < A.NRows(); i++)
+        for(size_t j = 0; j < A.NCols(); j++)
+        {
+            double s = 0.0;
+            for(size_t k = 0; k < Q.NCols(); k++)
+                s += Q(i, k) * R(k, j);
+            e = std::max(e, std::fabs(s - A(i, j)));
+        }
+    return e;
+}
+
+bool UpperTriangular(const SimpleMatrixD & R)
+{
+    for(size_t i = 0; i < R.NRows(); i++)
+        for(size_t j = 0; j < std::min(i, R.NCols()); j++)
+            if(R(i, j) != 0.0)
+                return false;
+    return true;
+}
+
+///Largest element of |V^T W|
+double Overlap(const SimpleMatrixD & V, const SimpleMatrixD & W)
+{
+    double e = 0.0;
+    for(size_t a = 0; a < V.NCols(); a++)
+        for(size_t b = 0; b < W.NCols(); b++)
+        {
+            double s = 0.0;
+            for(size_t i = 0; i < V.NRows(); i++)
+                s += V(i, a) * W(i, b);
+            e = std::max(e, std::fabs(s));
+        }
+    return e;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Orthogonalization");
+    std::mt19937 gen(3);
+    std::normal_distribution<double> dist;
+    const size_t m = 1000, n = 7;
+    SimpleMatrixD A(m, n);
+    for(size_t i = 0; i < A.Size(); i++)
+        A.Data()[i] = dist(gen);
+
+    const QRReturn_t H = HouseholderQR(A);
+    Tester.Test("Householder shapes", std::get<0>(H).NRows() == m && std::get<0>(H).NCols() == n
+                                      && std::get<1>(H).NRows() == n && std::get<1>(H).NCols() == n);
+    Tester.TestClose("Householder Q is orthonormal", Orthonormality(std::get<0>(H)), 0.0, 1e-12);
+    Tester.TestClose("Householder A = QR", Reconstruction(A, H), 0.0, 1e-12);
+    Tester.Test("Householder R is upper triangular", UpperTriangular(std::get<1>(H)));
+
+    //Wide matrices give the k = m thin factorization
+    SimpleMatrixD Wide(3, 5);
+    for(size_t i = 0; i < Wide.Size(); i++)
+        Wide.Data()[i] = dist(gen);
+    const QRReturn_t HW = HouseholderQR(Wide);
+    Tester.Test("Wide shapes", std::get<0>(HW).NCols() == 3 && std::get<1>(HW).NRows() == 3);
+    Tester.TestClose("Wide A = QR", Reconstruction(Wide, HW), 0.0, 1e-13);
+
+    //TSQR with uneven blocks, the default blocking, and too many blocks
+    for(size_t NBlocks : {9, 0, 500})
+    {
+        const std::string Desc = "TSQR with " + std::to_string(NBlocks) + " blocks";
+        const QRReturn_t T = TSQR(A, NBlocks);
+        Tester.TestClose(Desc + ", Q is orthonormal", Orthonormality(std::get<0>(T)), 0.0, 1e-12);
+        Tester.TestClose(Desc + ", A = QR", Reconstruction(A, T), 0.0, 1e-12);
+        Tester.Test(Desc + ", R is upper triangular", UpperTriangular(std::get<1>(T)));
+
+        //R is unique up to the signs of its rows
+        double d = 0.0;
+        for(size_t i = 0; i < n; i++)
+            for(size_t j = 0; j < n; j++)
+                d = std::max(d, std::fabs(std::fabs(std::get<1>(T)(i, j))
+                                          - std::fabs(std::get<1>(H)(i, j))));
+        Tester.TestClose(Desc + ", R matches Householder", d, 0.0, 1e-10);
+    }
+
+    //New vectors against the Householder basis, with one of them in the
+    //span of the basis and another new vector
+    const SimpleMatrixD & V = std::get<0>(H);
+    SimpleMatrixD W(m, 4);
+    for(size_t i = 0; i < W.Size(); i++)
+        W.Data()[i] = dist(gen);
+    for(size_t i = 0; i < m; i++)
+        W(i, 2) = 2.0 * A(i, 1) + W(i, 0);
+    const SimpleMatrixD N = BlockGramSchmidt(V, W);
+    Tester.Test("Dependent vector is dropped", N.NCols() == 3 && N.NRows() == m);
+    Tester.TestClose("New vectors are orthonormal", Orthonormality(N), 0.0, 1e-12);
+    Tester.TestClose("New vectors are orthogonal to the basis", Overlap(V, N), 0.0, 1e-12);
+
+    //An empty basis just orthonormalizes
+    const SimpleMatrixD N0 = BlockGramSchmidt(SimpleMatrixD(0, 0), A);
+    Tester.Test("Empty basis keeps everything", N0.NCols() == n);
+    Tester.TestClose("Empty basis, orthonormal", Orthonormality(N0), 0.0, 1e-12);
+
+    Tester.TestThrows("Basis of the wrong length",
+                      [&] { BlockGramSchmidt(SimpleMatrixD(m + 1, 2), W); });
+
+    return Tester.Result();
+}
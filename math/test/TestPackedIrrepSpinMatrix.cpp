@@ -0,0 +1,108 @@
+/*! \file
+ *
+ * \brief Tests of the single-allocation irrep/spin matrix
+ */
+
+#include <cstdint>
+
+#include "pulsar/math/PackedIrrepSpinMatrix.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///A matrix whose elements encode where they came from
+SimpleMatrixD Numbered(size_t nrows, size_t ncols, double Base)
+{
+    SimpleMatrixD m(nrows, ncols);
+    for(size_t i = 0; i < nrows; i++)
+        for(size_t j = 0; j < ncols; j++)
+            m(i, j) = Base + 10.0 * i + j;
+    return m;
+}
+
+bool Same(const SimpleMatrixD & A, const SimpleMatrixD & B)
+{
+    return A.NRows() == B.NRows() && A.NCols() == B.NCols() &&
+           std::equal(A.Data(), A.Data() + A.Size(), B.Data());
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Packed irrep/spin matrix");
+
+    //Block sizes that aren't multiples of the alignment, and an empty one
+    IrrepSpinMatrixD M;
+    M.Set(Irrep::A1, 1, Numbered(3, 5, 1000.0));
+    M.Set(Irrep::A1, -1, Numbered(3, 5, 2000.0));
+    M.Set(Irrep::B2, 1, Numbered(7, 1, 3000.0));
+    M.Set(Irrep::B1, 1, SimpleMatrixD(0, 4));
+
+    const PackedIrrepSpinMatrixD P(M);
+    Tester.Test("Number of blocks", P.NBlocks() == 4);
+    Tester.Test("Has", P.Has(Irrep::A1, -1) && P.Has(Irrep::B1, 1) && !P.Has(Irrep::A2, 1));
+    Tester.Test("Block dimensions", P.NRows(Irrep::B2, 1) == 7 && P.NCols(Irrep::B2, 1) == 1
+                                    && P.NRows(Irrep::B1, 1) == 0);
+    Tester.Test("Element access", P.At(Irrep::A1, 1, 2, 4) == 1024.0
+                                  && P.At(Irrep::B2, 1, 6, 0) == 3060.0);
+    Tester.Test("Block pointer", P.Block(Irrep::A1, -1)[5] == 2010.0);
+
+    //Every block starts on an aligned address and the padding is zero
+    bool Aligned = true;
+    for(const auto & it : M)
+    {
+        const auto Addr = reinterpret_cast<std::uintptr_t>(P.Block(it.first.first, it.first.second));
+        Aligned = Aligned && Addr % PackedIrrepSpinMatrixD::Alignment == 0;
+    }
+    Tester.Test("Blocks are aligned", Aligned);
+    double Total = 0.0, Expected = 0.0;
+    for(size_t i = 0; i < P.Size(); i++)
+        Total += P.Data()[i];
+    for(const auto & it : M)
+        for(size_t i = 0; i < it.second.Size(); i++)
+            Expected += it.second.Data()[i];
+    Tester.TestClose("Padding is zero", Total, Expected, 0.0);
+
+    //Back out again
+    const IrrepSpinMatrixD U = P.Unpack();
+    bool RoundTrip = U.Size() == M.Size();
+    for(const auto & it : M)
+        RoundTrip = RoundTrip && U.Has(it.first.first, it.first.second)
+                    && Same(U.Get(it.first.first, it.first.second), it.second);
+    Tester.Test("Unpack round trip", RoundTrip);
+
+    //Copies are deep, moves take the arena
+    PackedIrrepSpinMatrixD Copy(P);
+    Tester.Test("Copy compares equal", Copy == P);
+    Copy.At(Irrep::B2, 1, 0, 0) = -1.0;
+    Tester.Test("Copy is deep", Copy != P && P.At(Irrep::B2, 1, 0, 0) == 3000.0);
+    PackedIrrepSpinMatrixD Assigned;
+    Assigned = P;
+    Tester.Test("Copy assignment", Assigned == P);
+    const double * Arena = Copy.Data();
+    PackedIrrepSpinMatrixD Moved(std::move(Copy));
+    Tester.Test("Move takes the arena", Moved.Data() == Arena && Copy.Size() == 0);
+
+    //Zeroed blocks of the same shape
+    PackedIrrepSpinMatrixD Z = PackedIrrepSpinMatrixD::SameLayout(M);
+    bool AllZero = Z.Size() == P.Size();
+    for(size_t i = 0; i < Z.Size(); i++)
+        AllZero = AllZero && Z.Data()[i] == 0.0;
+    Tester.Test("SameLayout is zeroed with the same layout", AllZero && Z.NBlocks() == 4);
+    Moved.Zero();
+    Tester.Test("Zero", Moved == Z);
+
+    Tester.TestThrows("Missing block", [&] { P.NRows(Irrep::A2, 1); });
+    Tester.TestThrows("Row out of range", [&] { P.At(Irrep::B2, 1, 7, 0); });
+    Tester.TestThrows("Column out of range", [&] { P.At(Irrep::A1, 1, 0, 5); });
+
+    const PackedIrrepSpinMatrixD Empty;
+    Tester.Test("Empty matrix", Empty.NBlocks() == 0 && Empty.Size() == 0);
+
+    return Tester.Result();
+}
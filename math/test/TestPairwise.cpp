@@ -0,0 +1,131 @@
+/*! \file
+ *
+ * \brief Tests of the pair kernels against plain double loops
+ */
+
+#include <cmath>
+#include <random>
+
+#include "pulsar/math/Pairwise.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+typedef std::vector<std::array<double,3>> Points_t;
+
+double Distance(const std::array<double,3> & a, const std::array<double,3> & b)
+{
+    const double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+///Random points in a box, and charges
+void Random(std::mt19937 & gen, Points_t & Pts, std::vector<double> & Q)
+{
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+    for(auto & p : Pts)
+        p = {dist(gen), dist(gen), dist(gen)};
+    for(double & q : Q)
+        q = dist(gen) / 10.0;
+}
+
+///Largest relative difference between a gradient and central differences
+///of the energy, for a few of the coordinates
+template<typename Energy_t>
+double CheckGradient(CoordinatesSoA P, const std::vector<double> & Grad, Energy_t Energy)
+{
+    const double h = 1e-5;
+    double err = 0.0;
+    for(size_t i : {0, 5, 17})
+        for(size_t c = 0; c < 3; c++)
+        {
+            std::vector<double> & x = c == 0 ? P.x : (c == 1 ? P.y : P.z);
+            const double x0 = x[i];
+            x[i] = x0 + h;
+            const double Ep = Energy(P);
+            x[i] = x0 - h;
+            const double Em = Energy(P);
+            x[i] = x0;
+            const double fd = (Ep - Em) / (2.0 * h);
+            err = std::max(err, std::fabs(fd - Grad[3 * i + c]) / (1.0 + std::fabs(fd)));
+        }
+    return err;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Pair kernels");
+    std::mt19937 gen(1);
+    const size_t na = 700, nb = 300;
+    Points_t PA(na), PB(nb);
+    std::vector<double> QA(na), QB(nb);
+    Random(gen, PA, QA);
+    Random(gen, PB, QB);
+    const CoordinatesSoA A(PA), B(PB);
+    Tester.Test("SoA conversion", A.Size() == na && A.y[3] == PA[3][1]);
+
+    //Tiles that don't divide the number of points
+    const SimpleMatrixD D = DistanceMatrix(A, 50), I = InverseDistanceMatrix(A, 33);
+    double DErr = 0.0, IErr = 0.0, Diag = 0.0, Ref = 0.0, RefAB = 0.0;
+    for(size_t i = 0; i < na; i++)
+        for(size_t j = 0; j < na; j++)
+        {
+            const double r = Distance(PA[i], PA[j]);
+            DErr = std::max(DErr, std::fabs(D(i, j) - r));
+            if(i == j)
+                Diag = std::max(Diag, std::fabs(I(i, i)));
+            else
+                IErr = std::max(IErr, std::fabs(I(i, j) - 1.0 / r) * r);
+            if(j > i)
+                Ref += QA[i] * QA[j] / r;
+        }
+    for(size_t i = 0; i < na; i++)
+        for(size_t j = 0; j < nb; j++)
+            RefAB += QA[i] * QB[j] / Distance(PA[i], PB[j]);
+    Tester.TestClose("Distance matrix", DErr, 0.0, 1e-13);
+    Tester.TestClose("Inverse distance matrix", IErr, 0.0, 1e-14);
+    Tester.TestClose("Inverse distance diagonal is zero", Diag, 0.0, 0.0);
+    Tester.Test("Distance matrix is symmetric", D(3, 600) == D(600, 3));
+
+    //Energies, for several tilings, and the gradients against finite
+    //differences
+    const double Tol = 1e-12 * std::fabs(Ref);
+    Tester.TestClose("Coulomb energy", CoulombEnergy(A, QA), Ref, Tol);
+    Tester.TestClose("Coulomb energy, small tiles", CoulombEnergy(A, QA, 64), Ref, Tol);
+    Tester.TestClose("Coulomb energy, one tile", CoulombEnergy(A, QA, 1000), Ref, Tol);
+    std::vector<double> G;
+    Tester.TestClose("Coulomb gradient energy", CoulombGradient(A, QA, G), Ref, Tol);
+    Tester.Test("Gradient length", G.size() == 3 * na);
+    Tester.TestClose("Coulomb gradient", CheckGradient(A, G, [&](const CoordinatesSoA & P){
+        return CoulombEnergy(P, QA);
+    }), 0.0, 1e-6);
+
+    const double TolAB = 1e-12 * std::fabs(RefAB);
+    Tester.TestClose("Two-set energy", CoulombEnergy(A, QA, B, QB), RefAB, TolAB);
+    Tester.TestClose("Two-set energy, small tiles", CoulombEnergy(A, QA, B, QB, 100), RefAB, TolAB);
+    std::vector<double> GA, GB;
+    Tester.TestClose("Two-set gradient energy", CoulombGradient(A, QA, B, QB, GA, GB), RefAB, TolAB);
+    Tester.Test("Two-set gradient lengths", GA.size() == 3 * na && GB.size() == 3 * nb);
+    Tester.TestClose("Two-set gradient, first set", CheckGradient(A, GA, [&](const CoordinatesSoA & P){
+        return CoulombEnergy(P, QA, B, QB);
+    }), 0.0, 1e-6);
+    Tester.TestClose("Two-set gradient, second set", CheckGradient(B, GB, [&](const CoordinatesSoA & P){
+        return CoulombEnergy(A, QA, P, QB);
+    }), 0.0, 1e-6);
+
+    //Degenerate input
+    Tester.TestClose("No points", CoulombEnergy(CoordinatesSoA(), {}), 0.0, 0.0);
+    Tester.Test("Empty distance matrix", DistanceMatrix(CoordinatesSoA()).Size() == 0);
+    Tester.TestThrows("Charges and points differ", [&] { CoulombEnergy(A, QB); });
+    Tester.TestThrows("Two-set charges and points differ", [&] { CoulombEnergy(A, QA, B, QA); });
+    Tester.TestThrows("Gradient charges and points differ", [&] { CoulombGradient(A, QB, G); });
+    Tester.TestThrows("Zero tile", [&] { DistanceMatrix(A, 0); });
+
+    return Tester.Result();
+}
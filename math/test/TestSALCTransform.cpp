@@ -0,0 +1,123 @@
+/*! \file
+ *
+ * \brief Tests of the sparse AO to SALC transformation
+ */
+
+#include <cmath>
+#include <map>
+#include <random>
+
+#include "pulsar/math/SALCTransform.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///C^T F C, done densely
+SimpleMatrixD Dense(const SimpleMatrixD & C, const SimpleMatrixD & F)
+{
+    const size_t n = C.NRows(), nh = C.NCols();
+    SimpleMatrixD Out(nh, nh);
+    Out.Zero();
+    for(size_t i = 0; i < nh; i++)
+        for(size_t j = 0; j < nh; j++)
+            for(size_t mu = 0; mu < n; mu++)
+                for(size_t nu = 0; nu < n; nu++)
+                    Out(i, j) += C(mu, i) * F(mu, nu) * C(nu, j);
+    return Out;
+}
+
+double MaxDiff(const SimpleMatrixD & A, const SimpleMatrixD & B)
+{
+    if(A.NRows() != B.NRows() || A.NCols() != B.NCols())
+        return HUGE_VAL;
+    double d = 0.0;
+    for(size_t i = 0; i < A.Size(); i++)
+        d = std::max(d, std::fabs(A.Data()[i] - B.Data()[i]));
+    return d;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("SALC transform");
+
+    //A C2 molecule's worth of AOs: AO i and AO i+p are swapped by the
+    //rotation, giving (i +/- (i+p))/sqrt(2) SALCs, and the last q AOs sit on
+    //the axis and are their own A SALCs
+    const size_t p = 6, q = 3, n = 2 * p + q;
+    const double r = 1.0 / std::sqrt(2.0);
+    SimpleMatrixD CA(n, p + q), CB(n, p);
+    CA.Zero();
+    CB.Zero();
+    for(size_t i = 0; i < p; i++)
+    {
+        CA(i, i) = CA(i + p, i) = r;
+        CB(i, i) = r;
+        CB(i + p, i) = -r;
+    }
+    for(size_t i = 0; i < q; i++)
+        CA(2 * p + i, p + i) = 1.0;
+    const std::map<Irrep, SimpleMatrixD> Coefs{{Irrep::A, CA}, {Irrep::B, CB}};
+    const SALCTransform X(Coefs);
+    Tester.Test("Number of AOs", X.NAO() == n);
+    Tester.Test("Only nonzeros are stored", X.NNZ() == 4 * p + q);
+
+    //A random symmetric matrix with the C2 symmetry
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    auto Swap = [&](size_t mu){ return mu < p ? mu + p : (mu < 2 * p ? mu - p : mu); };
+    SimpleMatrixD F(n, n);
+    F.Zero();
+    for(size_t mu = 0; mu < n; mu++)
+        for(size_t nu = 0; nu <= mu; nu++)
+        {
+            const double v = dist(gen);
+            F(mu, nu) += v;
+            F(Swap(mu), Swap(nu)) += v;
+            if(mu != nu)
+            {
+                F(nu, mu) += v;
+                F(Swap(nu), Swap(mu)) += v;
+            }
+        }
+
+    IrrepSpinMatrixD Blocks = X.ToIrreps(F, 1);
+    Tester.Test("One block per irrep", Blocks.Size() == 2 && Blocks.Has(Irrep::A, 1)
+                                       && Blocks.Has(Irrep::B, 1));
+    Tester.TestClose("A block matches dense", MaxDiff(Blocks.Get(Irrep::A, 1), Dense(CA, F)), 0.0, 1e-13);
+    Tester.TestClose("B block matches dense", MaxDiff(Blocks.Get(Irrep::B, 1), Dense(CB, F)), 0.0, 1e-13);
+
+    //The SALCs are a complete orthonormal basis, so back is the inverse
+    const SimpleMatrixD Back = X.FromIrreps(Blocks, 1);
+    Tester.TestClose("Round trip", MaxDiff(Back, F), 0.0, 1e-13);
+
+    //Existing blocks of the right shape are reused, and so is the AO matrix
+    const double * APtr = Blocks.Get(Irrep::A, 1).Data();
+    Blocks.Get(Irrep::B, 1).Zero();
+    X.ToIrreps(F, 1, Blocks);
+    Tester.Test("Blocks are reused", Blocks.Get(Irrep::A, 1).Data() == APtr);
+    Tester.TestClose("Reused blocks are overwritten",
+                     MaxDiff(Blocks.Get(Irrep::B, 1), Dense(CB, F)), 0.0, 1e-13);
+    SimpleMatrixD Full(n, n);
+    const double * FPtr = Full.Data();
+    X.FromIrreps(Blocks, 1, Full);
+    Tester.Test("AO matrix is reused", Full.Data() == FPtr);
+    Tester.TestClose("Reused AO matrix is overwritten", MaxDiff(Full, F), 0.0, 1e-13);
+
+    //Wrong shapes
+    Tester.TestThrows("AO matrix of the wrong size", [&] { X.ToIrreps(SimpleMatrixD(n + 1, n + 1), 1); });
+    IrrepSpinMatrixD Bad(Blocks);
+    Bad.Set(Irrep::B, 1, SimpleMatrixD(p + 1, p + 1));
+    Tester.TestThrows("Irrep block of the wrong size", [&] { X.FromIrreps(Bad, 1); });
+    Tester.TestThrows("Missing spin", [&] { X.FromIrreps(Blocks, -1); });
+    Tester.TestThrows("SALCs of different lengths", [&] {
+        SALCTransform(std::map<Irrep, SimpleMatrixD>{{Irrep::A, CA}, {Irrep::B, SimpleMatrixD(n + 1, 1)}});
+    });
+
+    return Tester.Result();
+}
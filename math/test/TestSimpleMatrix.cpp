@@ -0,0 +1,126 @@
+/*! \file
+ *
+ * \brief Tests of SimpleMatrix, mostly its tolerant comparisons
+ */
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "pulsar/math/SimpleMatrix.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Random matrix scaled by s
+SimpleMatrixD Random(std::mt19937 & gen, size_t nrows, size_t ncols, double s = 1.0)
+{
+    std::uniform_real_distribution<double> dist(-s, s);
+    SimpleMatrixD M(nrows, ncols);
+    for(size_t i = 0; i < M.Size(); i++)
+        M.Data()[i] = dist(gen);
+    return M;
+}
+
+///A with every element multiplied by (1+e)
+SimpleMatrixD Perturb(const SimpleMatrixD & A, double e)
+{
+    SimpleMatrixD B(A);
+    for(size_t i = 0; i < B.Size(); i++)
+        B.Data()[i] *= 1.0 + e;
+    return B;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Simple matrices");
+    std::mt19937 gen(4);
+
+    //Construction, copies and element access
+    const SimpleMatrixD A = Random(gen, 7, 5);
+    Tester.Test("Shape", A.NRows() == 7 && A.NCols() == 5 && A.Size() == 35);
+    Tester.Test("Row-major", A(2, 3) == A.Data()[2 * 5 + 3]);
+    Tester.TestThrows("Row out of range", [&] { A.At(7, 0); });
+    Tester.TestThrows("Column out of range", [&] { A.At(0, 5); });
+    const std::vector<double> v(A.Data(), A.Data() + A.Size());
+    Tester.Test("From a vector", SimpleMatrixD(7, 5, v) == A);
+    Tester.TestThrows("Vector of the wrong length", [&] { SimpleMatrixD(6, 5, v); });
+    SimpleMatrixD C(A);
+    C(0, 0) += 1.0;
+    Tester.Test("Copy is deep", C != A && C(0, 1) == A(0, 1));
+    Tester.Test("Exact hash tells them apart", C.MyHash() != A.MyHash());
+
+    //Roundoff-level changes keep the quantized hash in nearly every case
+    //and always pass AlmostEqual
+    size_t Same = 0;
+    bool Close = true;
+    for(size_t t = 0; t < 100; t++)
+    {
+        const SimpleMatrixD M = Random(gen, 10, 10);
+        const SimpleMatrixD N = Perturb(M, 1e-13);
+        Same += M.QuantizedHash(1e-8) == N.QuantizedHash(1e-8);
+        Close = Close && M.AlmostEqual(N, 1e-10);
+    }
+    Tester.Test("Roundoff usually keeps the quantized hash", Same >= 95);
+    Tester.Test("Roundoff passes AlmostEqual", Close);
+    Tester.Test("Exact hash changes with roundoff", A.MyHash() != Perturb(A, 1e-13).MyHash());
+
+    //Real changes don't
+    Tester.Test("Changes above the tolerance change the quantized hash",
+                A.QuantizedHash(1e-8) != Perturb(A, 1e-3).QuantizedHash(1e-8));
+    Tester.Test("Changes above the tolerance fail AlmostEqual", !A.AlmostEqual(Perturb(A, 1e-3), 1e-10));
+    Tester.Test("Tolerances between one power of two hash alike",
+                A.QuantizedHash(0.3) == A.QuantizedHash(0.26));
+    const SimpleMatrixD Wide(5, 7, v);
+    Tester.Test("Same data, other shape, other quantized hash",
+                Wide.QuantizedHash(1e-8) != A.QuantizedHash(1e-8));
+    Tester.Test("Other shape fails AlmostEqual", !Wide.AlmostEqual(A, 1.0));
+
+    //Values beyond the rounding range, infinities and NaN
+    SimpleMatrixD Big(1, 5);
+    const double Huge = std::ldexp(1.0, 70);
+    Big(0, 0) = Huge;
+    Big(0, 1) = -1e300;
+    Big(0, 2) = std::numeric_limits<double>::infinity();
+    Big(0, 3) = -std::numeric_limits<double>::infinity();
+    Big(0, 4) = std::numeric_limits<double>::quiet_NaN();
+    const SimpleMatrixD Big2(Big);
+    Tester.Test("Huge values, infinities and NaN hash", Big.QuantizedHash(1e-8) == Big2.QuantizedHash(1e-8));
+    SimpleMatrixD Flipped(Big);
+    std::swap(Flipped(0, 2), Flipped(0, 3));
+    Tester.Test("Infinities of each sign hash apart", Flipped.QuantizedHash(1e-8) != Big.QuantizedHash(1e-8));
+    SimpleMatrixD Next(Big);
+    Next(0, 0) = Huge * (1.0 + std::ldexp(1.0, -52));
+    Tester.Test("Huge values are hashed as they are", Next.QuantizedHash(1e-8) != Big.QuantizedHash(1e-8));
+    SimpleMatrixD Limit(1, 2);
+    Limit(0, 0) = std::ldexp(1.0, 62) * 1e-8;
+    Limit(0, 1) = -std::ldexp(1.0, 63) * 1e-8;
+    Tester.Test("Values at the rounding limit", Limit.QuantizedHash(1e-8) == SimpleMatrixD(Limit).QuantizedHash(1e-8));
+    Tester.Test("NaN fails AlmostEqual", !Big.AlmostEqual(Big2, 1.0));
+
+    Tester.TestThrows("Zero tolerance", [&] { A.QuantizedHash(0.0); });
+    Tester.TestThrows("Negative tolerance", [&] { A.QuantizedHash(-1e-8); });
+    Tester.TestThrows("Infinite tolerance", [&] { A.QuantizedHash(std::numeric_limits<double>::infinity()); });
+    Tester.TestThrows("NaN tolerance", [&] { A.QuantizedHash(std::numeric_limits<double>::quiet_NaN()); });
+
+    //Complex elements round each part
+    SimpleMatrixCD Z(2, 2), Z2(2, 2);
+    for(size_t i = 0; i < 4; i++)
+    {
+        Z.Data()[i] = {0.3 * i + 0.1, -0.7 * i};
+        Z2.Data()[i] = Z.Data()[i] * (1.0 + 1e-14);
+    }
+    Tester.Test("Complex quantized hash", Z.QuantizedHash(1e-8) == Z2.QuantizedHash(1e-8));
+    SimpleMatrixCD Z3(Z);
+    Z3(1, 1) += std::complex<double>(0.0, 1e-3);
+    Tester.Test("Complex AlmostEqual", Z.AlmostEqual(Z2, 1e-12) && !Z.AlmostEqual(Z3, 1e-12));
+    Tester.Test("Imaginary parts are hashed", Z.QuantizedHash(1e-8) != Z3.QuantizedHash(1e-8));
+
+    return Tester.Result();
+}
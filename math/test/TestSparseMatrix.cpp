@@ -0,0 +1,124 @@
+/*! \file
+ *
+ * \brief Tests of the CSR and BSR matrices and their products
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "pulsar/math/SparseMatrix.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+///Dense product, the reference for the sparse ones
+SimpleMatrixD Multiply(const SimpleMatrixD & L, const SimpleMatrixD & R)
+{
+    SimpleMatrixD Out(L.NRows(), R.NCols());
+    Out.Zero();
+    for(size_t i = 0; i < L.NRows(); i++)
+        for(size_t j = 0; j < R.NCols(); j++)
+            for(size_t l = 0; l < L.NCols(); l++)
+                Out(i, j) += L(i, l) * R(l, j);
+    return Out;
+}
+
+double MaxDiff(const SimpleMatrixD & A, const SimpleMatrixD & B)
+{
+    if(A.NRows() != B.NRows() || A.NCols() != B.NCols())
+        return HUGE_VAL;
+    double d = 0.0;
+    for(size_t i = 0; i < A.Size(); i++)
+        d = std::max(d, std::fabs(A.Data()[i] - B.Data()[i]));
+    return d;
+}
+
+double MaxDiff(const SimpleVectorD & x, const SimpleMatrixD & B)
+{
+    return MaxDiff(SimpleMatrixD(x.Size(), 1, x.Data()), B);
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Sparse matrices");
+
+    //About 70% zeros, with dimensions that aren't multiples of the blocks
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    const size_t m = 37, n = 23, k = 5;
+    SimpleMatrixD A(m, n), B(n, k), D(k, m);
+    size_t nnz = 0;
+    for(size_t i = 0; i < A.Size(); i++)
+    {
+        const double v = dist(gen);
+        A.Data()[i] = std::fabs(v) < 0.7 ? 0.0 : v;
+        nnz += A.Data()[i] != 0.0;
+    }
+    for(size_t i = 0; i < B.Size(); i++)
+        B.Data()[i] = dist(gen);
+    for(size_t i = 0; i < D.Size(); i++)
+        D.Data()[i] = dist(gen);
+    SimpleVectorD x(n);
+    for(size_t i = 0; i < n; i++)
+        x(i) = dist(gen);
+    const SimpleMatrixD xm(n, 1, x.Data());
+
+    //CSR
+    const CSRMatrixD C(A);
+    Tester.Test("CSR stores the nonzeros", C.NNZ() == nnz);
+    Tester.TestClose("CSR round trip", MaxDiff(C.ToDense(), A), 0.0, 0.0);
+    bool AtMatches = true;
+    for(size_t i = 0; i < m; i++)
+        for(size_t j = 0; j < n; j++)
+            AtMatches = AtMatches && C.At(i, j) == A(i, j);
+    Tester.Test("CSR At", AtMatches);
+    Tester.TestThrows("CSR At out of range", [&] { C.At(m, 0); });
+    Tester.TestClose("CSR times dense", MaxDiff(SparseMultiply(C, B), Multiply(A, B)), 0.0, 1e-13);
+    Tester.TestClose("Dense times CSR", MaxDiff(SparseMultiply(D, C), Multiply(D, A)), 0.0, 1e-13);
+    Tester.TestClose("CSR times vector", MaxDiff(SparseMultiply(C, x), Multiply(A, xm)), 0.0, 1e-13);
+    Tester.TestThrows("CSR product dimensions", [&] { SparseMultiply(C, D); });
+    Tester.Test("CSR drop tolerance", CSRMatrixD(A, 0.9).NNZ() < nnz);
+
+    //BSR, with several block shapes
+    for(size_t bs : {1, 3, 4})
+    {
+        const BSRMatrixD S(A, bs, bs + 1);
+        const std::string Desc = "BSR " + std::to_string(bs) + "x" + std::to_string(bs + 1);
+        Tester.TestClose(Desc + " round trip", MaxDiff(S.ToDense(), A), 0.0, 0.0);
+        Tester.TestClose(Desc + " times dense",
+                         MaxDiff(SparseMultiply(S, B), Multiply(A, B)), 0.0, 1e-13);
+        Tester.TestClose(Desc + " times vector",
+                         MaxDiff(SparseMultiply(S, x), Multiply(A, xm)), 0.0, 1e-13);
+    }
+    Tester.TestThrows("BSR zero block size", [] { BSRMatrixD S(4, 4, 0, 2); });
+
+    //Construction from raw arrays: [[1 0 2] [0 0 0] [0 3 0]]
+    const CSRMatrixD Raw(3, 3, {0, 2, 2, 3}, {0, 2, 1}, {1.0, 2.0, 3.0});
+    Tester.Test("CSR from arrays", Raw.At(0, 2) == 2.0 && Raw.At(2, 1) == 3.0
+                                   && Raw.At(1, 1) == 0.0 && Raw.NNZ() == 3);
+    Tester.TestThrows("Row pointer too short",
+        [] { CSRMatrixD(3, 3, {0, 2, 3}, {0, 2, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Row pointer doesn't start at zero",
+        [] { CSRMatrixD(3, 3, {1, 2, 2, 3}, {0, 2, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Row pointer doesn't end at nnz",
+        [] { CSRMatrixD(3, 3, {0, 2, 2, 2}, {0, 2, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Row pointer decreases",
+        [] { CSRMatrixD(3, 3, {0, 2, 1, 3}, {0, 2, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Column out of range",
+        [] { CSRMatrixD(3, 3, {0, 2, 2, 3}, {0, 3, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Unsorted columns",
+        [] { CSRMatrixD(3, 3, {0, 2, 2, 3}, {2, 0, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Duplicate columns",
+        [] { CSRMatrixD(3, 3, {0, 2, 2, 3}, {1, 1, 1}, {1.0, 2.0, 3.0}); });
+    Tester.TestThrows("Values and columns differ in length",
+        [] { CSRMatrixD(3, 3, {0, 2, 2, 3}, {0, 2, 1}, {1.0, 2.0}); });
+
+    return Tester.Result();
+}
@@ -0,0 +1,116 @@
+/*! \file
+ *
+ * \brief Tests of the atom permutations and orbits under symmetry operations
+ */
+
+#include <cmath>
+
+#include "pulsar/math/SymmetryOrbits.hpp"
+#include "pulsar/math/Geometry.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+const Point_t X{1.0, 0.0, 0.0}, Y{0.0, 1.0, 0.0}, Z{0.0, 0.0, 1.0};
+
+///Water in the yz plane, C2 axis along z
+std::vector<Point_t> Water(void)
+{
+    return {{0.0, 0.0, 0.1}, {0.0, 0.75, -0.5}, {0.0, -0.75, -0.5}};
+}
+
+///True if every row of Perm is a permutation of 0..n-1
+bool IsPermutation(const std::vector<size_t> & Perm)
+{
+    std::vector<bool> Hit(Perm.size(), false);
+    for(size_t k : Perm)
+    {
+        if(k >= Perm.size() || Hit[k])
+            return false;
+        Hit[k] = true;
+    }
+    return true;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Symmetry orbits");
+
+    //Water under all of C2v: O alone, the hydrogens swapped by C2 and the
+    //xz mirror, left alone by E and the yz mirror
+    const std::vector<int> WaterZ{8, 1, 1};
+    const std::vector<SymmetryOp_t> C2v{rotation(Z, 0.0), rotation(Z, 180.0),
+                                        reflection(Y), reflection(X)};
+    const SymmetryOrbits W = MakeSymmetryOrbits(Water(), WaterZ, C2v);
+    Tester.Test("Water sizes", W.NAtoms() == 3 && W.NOps() == 4);
+    Tester.Test("Water unique atoms", W.UniqueAtoms == std::vector<size_t>({0, 1}));
+    Tester.Test("Water orbits", W.Orbits.size() == 2
+                                && W.Orbits[0] == std::vector<size_t>({0})
+                                && W.Orbits[1] == std::vector<size_t>({1, 2}));
+    Tester.Test("Water OrbitOf", W.OrbitOf == std::vector<size_t>({0, 1, 1}));
+    Tester.Test("C2 swaps the hydrogens", W.Perm[1] == std::vector<size_t>({0, 2, 1}));
+    Tester.Test("yz mirror fixes everything", W.Perm[3] == std::vector<size_t>({0, 1, 2}));
+    Tester.Test("Oxygen stabilizer", W.Stabilizer[0].size() == 4);
+    Tester.Test("Hydrogen stabilizer", W.Stabilizer[1] == std::vector<size_t>({0, 3}));
+
+    //A hexagon of carbons plus one off-axis hydrogen pair, with only the
+    //C6 generator given: the orbits must still be closed
+    std::vector<Point_t> Ring;
+    std::vector<int> RingZ;
+    for(size_t i = 0; i < 6; i++)
+    {
+        const double a = i * 60.0 * PI / 180.0;
+        Ring.push_back({1.4 * std::cos(a), 1.4 * std::sin(a), 0.0});
+        RingZ.push_back(6);
+    }
+    for(size_t i = 0; i < 6; i++)
+    {
+        const double a = i * 60.0 * PI / 180.0;
+        Ring.push_back({2.5 * std::cos(a), 2.5 * std::sin(a), 0.0});
+        RingZ.push_back(1);
+    }
+    const SymmetryOrbits R = MakeSymmetryOrbits(Ring, RingZ, {rotation(Z, 60.0)});
+    Tester.Test("Generator gives the whole orbit",
+                R.Orbits.size() == 2 && R.Orbits[0].size() == 6 && R.Orbits[1].size() == 6
+                && R.UniqueAtoms == std::vector<size_t>({0, 6}));
+    Tester.Test("C6 is a permutation", IsPermutation(R.Perm[0]));
+    Tester.Test("C6 moves carbon 0 to carbon 1", R.Perm[0][0] == 1 && R.Perm[0][5] == 0);
+
+    //Labels keep otherwise equivalent atoms apart
+    const SymmetryOrbits D = MakeSymmetryOrbits(Water(), {8, 1, 2}, {rotation(Z, 0.0)});
+    Tester.Test("Different labels, different orbits", D.Orbits.size() == 3);
+    Tester.TestThrows("Isotope breaks the symmetry",
+                      [&] { MakeSymmetryOrbits(Water(), {8, 1, 2}, C2v); });
+
+    //Bad input
+    std::vector<Point_t> Bent = Water();
+    Bent[1][1] = 0.7;
+    Tester.TestThrows("Asymmetric geometry", [&] { MakeSymmetryOrbits(Bent, WaterZ, C2v); });
+    Tester.TestThrows("Labels and atoms differ", [&] { MakeSymmetryOrbits(Water(), {8, 1}, C2v); });
+    const std::vector<Point_t> Close{{1.0, 0.0, 0.0}, {1.0, 0.0, 1e-7}};
+    Tester.TestThrows("Atoms closer than the tolerance",
+                      [&] { MakeSymmetryOrbits(Close, {1, 1}, {rotation(Z, 0.0)}); });
+
+    //The cache hands out the same table for the same question
+    ClearSymmetryOrbitCache();
+    auto T1 = GetSymmetryOrbits(Water(), WaterZ, C2v);
+    auto T2 = GetSymmetryOrbits(Water(), WaterZ, C2v);
+    Tester.Test("Cached table is shared", T1 == T2);
+    Tester.Test("Cached table is right", T1->Orbits == W.Orbits && T1->Perm == W.Perm);
+    auto T3 = GetSymmetryOrbits(Water(), WaterZ, C2v, 1e-5);
+    Tester.Test("Different tolerance, different table", T3 != T1);
+    SetSymmetryOrbitCacheSize(1);
+    Tester.Test("Old tables stay valid", T1->NAtoms() == 3);
+    Tester.Test("Evicted table is rebuilt", GetSymmetryOrbits(Water(), WaterZ, C2v) != T1);
+    ClearSymmetryOrbitCache();
+    SetSymmetryOrbitCacheSize(64);
+    Tester.TestThrows("Cache passes on errors", [&] { GetSymmetryOrbits(Bent, WaterZ, C2v); });
+
+    return Tester.Result();
+}
@@ -0,0 +1,179 @@
+/*! \file
+ *
+ * \brief Tests of SimpleTensor, its views, and the permutations and
+ *        contractions built on them
+ */
+
+#include <cmath>
+#include <map>
+#include <random>
+
+#include "pulsar/math/TensorOps.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::math;
+
+namespace {
+
+std::mt19937 Gen(2);
+
+SimpleTensorD Random(std::vector<size_t> Shape)
+{
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    SimpleTensorD T(std::move(Shape));
+    for(size_t i = 0; i < T.Size(); i++)
+        T.Data()[i] = dist(Gen);
+    return T;
+}
+
+///Steps a multi-index through a shape, false once it wraps around
+bool Next(std::vector<size_t> & Idx, const std::vector<size_t> & Shape)
+{
+    for(size_t d = Idx.size(); d > 0; d--)
+    {
+        if(++Idx[d-1] < Shape[d-1])
+            return true;
+        Idx[d-1] = 0;
+    }
+    return false;
+}
+
+///C = sum A B over the summed indices, by looping over every index
+SimpleTensorD Reference(const SimpleTensorD & A, const std::string & AIdx,
+                        const SimpleTensorD & B, const std::string & BIdx,
+                        const std::string & CIdx)
+{
+    std::map<char, size_t> Extent;
+    for(size_t d = 0; d < AIdx.size(); d++)
+        Extent[AIdx[d]] = A.Shape()[d];
+    for(size_t d = 0; d < BIdx.size(); d++)
+        Extent[BIdx[d]] = B.Shape()[d];
+    std::string All;
+    std::vector<size_t> Shape, CShape;
+    for(const auto & e : Extent)
+    {
+        All += e.first;
+        Shape.push_back(e.second);
+    }
+    for(char c : CIdx)
+        CShape.push_back(Extent[c]);
+    SimpleTensorD C(CShape);
+    C.Zero();
+
+    auto Pick = [&](const std::string & Idx, const std::vector<size_t> & Val){
+        std::vector<size_t> r;
+        for(char c : Idx)
+            r.push_back(Val[All.find(c)]);
+        return r;
+    };
+    std::vector<size_t> Val(All.size(), 0);
+    do
+        C.At(Pick(CIdx, Val)) += A.At(Pick(AIdx, Val)) * B.At(Pick(BIdx, Val));
+    while(Next(Val, Shape));
+    return C;
+}
+
+double MaxDiff(const SimpleTensorD & A, const SimpleTensorD & B)
+{
+    if(A.Shape() != B.Shape())
+        return HUGE_VAL;
+    double d = 0.0;
+    for(size_t i = 0; i < A.Size(); i++)
+        d = std::max(d, std::fabs(A.Data()[i] - B.Data()[i]));
+    return d;
+}
+
+} // close anonymous namespace
+
+
+int main()
+{
+    UnitTest Tester("Tensors");
+
+    //Storage and element access
+    const SimpleTensorD A = Random({7, 40, 33, 5});
+    Tester.Test("Rank and size", A.Rank() == 4 && A.Size() == 7 * 40 * 33 * 5);
+    Tester.Test("Row-major strides", A.Strides() == std::vector<size_t>({40 * 33 * 5, 33 * 5, 5, 1}));
+    Tester.Test("At matches operator()", A.At({3, 2, 1, 4}) == A(3, 2, 1, 4)
+                && A(3, 2, 1, 4) == A.Data()[((3 * 40 + 2) * 33 + 1) * 5 + 4]);
+    Tester.TestThrows("At out of range", [&] { A.At({7, 0, 0, 0}); });
+    Tester.TestThrows("At with the wrong rank", [&] { A.At({0, 0, 0}); });
+
+    SimpleTensorD Copy(A);
+    Tester.Test("Copy compares equal", Copy == A);
+    Copy(0, 0, 0, 0) += 1.0;
+    Tester.Test("Copy is deep", Copy != A);
+    Copy.Reshape({7 * 40, 33 * 5});
+    Tester.Test("Reshape", Copy.Rank() == 2 && Copy(1, 0) == A(0, 1, 0, 0));
+    Tester.TestThrows("Reshape changing the size", [&] { Copy.Reshape({3}); });
+    const SimpleMatrixD M = A.ToMatrix(2);
+    Tester.Test("ToMatrix", M.NRows() == 280 && M.NCols() == 165 && M(41, 6) == A(1, 1, 1, 1));
+
+    //Views: slice then fix is the strided sub-block
+    const auto V = A.View().Slice(1, 3, 10).Fix(3, 2);
+    Tester.Test("View shape", V.Shape() == std::vector<size_t>({7, 7, 33}) && !V.IsContiguous());
+    const SimpleTensorD S(V);
+    bool ViewOk = true;
+    for(size_t i = 0; i < 7; i++)
+        for(size_t j = 0; j < 7; j++)
+            for(size_t k = 0; k < 33; k++)
+                ViewOk = ViewOk && S(i, j, k) == A(i, j + 3, k, 2) && V(i, j, k) == S(i, j, k);
+    Tester.Test("Copy of a strided view", ViewOk);
+    Tester.TestThrows("Slice out of range", [&] { A.View().Slice(1, 3, 41); });
+    Tester.TestThrows("Fix out of range", [&] { A.View().Fix(3, 5); });
+
+    //Permutations, including ones that keep the last index in place
+    bool PermOk = true;
+    for(const std::vector<size_t> & Perm : std::vector<std::vector<size_t>>{
+            {2, 0, 3, 1}, {0, 1, 3, 2}, {1, 0, 2, 3}, {3, 2, 1, 0}, {0, 1, 2, 3}})
+    {
+        const SimpleTensorD P = Permute(A, Perm);
+        std::vector<size_t> Idx(4, 0), PIdx(4);
+        do
+        {
+            for(size_t d = 0; d < 4; d++)
+                PIdx[d] = Idx[Perm[d]];
+            PermOk = PermOk && P.At(PIdx) == A.At(Idx);
+        }
+        while(Next(Idx, A.Shape()));
+    }
+    Tester.Test("Permute", PermOk);
+    SimpleTensorD Into(std::vector<size_t>{33, 7, 7});
+    Permute(V, {2, 0, 1}, Into.View());
+    Tester.Test("Permute a view into a view", Into(32, 6, 4) == A(6, 7, 32, 2) && Into(2, 0, 1) == A(0, 4, 2, 2));
+    Tester.TestThrows("Not a permutation", [&] { Permute(A, {0, 0, 1, 2}); });
+    Tester.TestThrows("Permutation of the wrong rank", [&] { Permute(A, {0, 1, 2}); });
+
+    //Contractions against the brute-force sum, with the result in every
+    //order so that both transposed and permuted GEMMs are used
+    const SimpleTensorD a = Random({4, 6, 5, 3}), b = Random({5, 2, 6});
+    for(std::string CIdx : {"ilm", "mil", "lim", "iml"})
+        Tester.TestClose("Contract ijkl,kmj->" + CIdx,
+                         MaxDiff(Contract(a, "ijkl", b, "kmj", CIdx), Reference(a, "ijkl", b, "kmj", CIdx)),
+                         0.0, 1e-13);
+    const SimpleTensorD X = Random({4, 3}), Y = Random({3, 4});
+    Tester.TestClose("Full contraction", Contract(X, "ij", Y, "ji", "").Data()[0],
+                     Reference(X, "ij", Y, "ji", "").Data()[0], 1e-14);
+    Tester.TestClose("Matrix product, B transposed", MaxDiff(Contract(X, "ij", Y, "jk", "ik"),
+                     Contract(X, "ij", Permute(Y, {1, 0}), "kj", "ik")), 0.0, 1e-14);
+    Tester.TestClose("Outer product", MaxDiff(Contract(X, "ij", Y, "kl", "kijl"),
+                     Reference(X, "ij", Y, "kl", "kijl")), 0.0, 1e-15);
+
+    //alpha and beta
+    SimpleTensorD C = Random({4, 2, 3});
+    const SimpleTensorD C0(C), AB = Reference(a, "ijkl", b, "kmj", "iml");
+    Contract(2.0, a, "ijkl", b, "kmj", -0.5, C, "iml");
+    double d = 0.0;
+    for(size_t i = 0; i < C.Size(); i++)
+        d = std::max(d, std::fabs(C.Data()[i] - (2.0 * AB.Data()[i] - 0.5 * C0.Data()[i])));
+    Tester.TestClose("alpha A B + beta C", d, 0.0, 1e-13);
+
+    Tester.TestThrows("Mismatched extents", [&] { Contract(a, "ijkl", b, "kmi", "jlm"); });
+    Tester.TestThrows("Result index in both inputs", [&] { Contract(a, "ijkl", b, "kmj", "ijlm"); });
+    Tester.TestThrows("Index in only one tensor", [&] { Contract(a, "ijkl", b, "kmj", "im"); });
+    Tester.TestThrows("Repeated index", [&] { Contract(a, "iikl", b, "kmj", "lm"); });
+    Tester.TestThrows("Result index in neither input", [&] { Contract(a, "ijkl", b, "kmj", "ilmz"); });
+
+    return Tester.Result();
+}
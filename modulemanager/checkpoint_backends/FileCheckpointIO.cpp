@@ -0,0 +1,382 @@
+/*! \file
+ *
+ * \brief File checkpointing backend
+ * \author Benjamin Pritchard (ben@bennyp.org)
+ */
+
+
+#include "pulsar/modulemanager/checkpoint_backends/FileCheckpointIO.hpp"
+#include "pulsar/util/Serialization.hpp"
+#include "pulsar/exception/Exceptions.hpp"
+#include "pulsar/output/GlobalOutput.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace pulsar::exception;
+
+namespace {
+
+/*! \brief Key under which the learned read order is stored in the file
+ *
+ * This entry is written like any other, so it shows up in the TOC, but it
+ * is hidden from size() and all_keys().
+ */
+const std::string read_order_key = "__pulsar_read_order__";
+
+}
+
+
+
+namespace pulsar {
+namespace modulemanager {
+
+namespace {
+
+/*! \brief Packs a list of keys as a count, then each key's length and bytes
+ *
+ * Unlike the serializer, this tells us how many bytes were used, so the
+ * record can be padded and overwritten in place later.
+ */
+ByteArray pack_keys(const std::vector<std::string> & keys)
+{
+    ByteArray bytes;
+    auto put = [&bytes](const void * p, size_t n)
+    {
+        const char * c = static_cast<const char *>(p);
+        bytes.insert(bytes.end(), c, c + n);
+    };
+
+    const uint64_t nkeys = keys.size();
+    put(&nkeys, sizeof(nkeys));
+    for(const auto & key : keys)
+    {
+        const uint64_t len = key.size();
+        put(&len, sizeof(len));
+        put(key.data(), key.size());
+    }
+    return bytes;
+}
+
+
+//! Reverses pack_keys, ignoring any padding after the keys
+std::vector<std::string> unpack_keys(const ByteArray & bytes)
+{
+    std::vector<std::string> keys;
+    size_t at = 0;
+    auto get = [&bytes, &at](void * p, size_t n)
+    {
+        if(at + n > bytes.size())
+            return false;
+        std::copy(bytes.begin() + at, bytes.begin() + at + n, static_cast<char *>(p));
+        at += n;
+        return true;
+    };
+
+    uint64_t nkeys = 0;
+    if(!get(&nkeys, sizeof(nkeys)))
+        return keys;
+    for(uint64_t i = 0; i < nkeys; i++)
+    {
+        uint64_t len = 0;
+        if(!get(&len, sizeof(len)) || at + len > bytes.size())
+            break;
+        keys.emplace_back(bytes.begin() + at, bytes.begin() + at + len);
+        at += len;
+    }
+    return keys;
+}
+
+} // close anonymous namespace
+
+
+FileCheckpointIO::FileCheckpointIO(const std::string & path, bool truncate)
+    : path_(path)
+{
+    using pulsar::util::from_byte_array;
+
+    bool newfile = truncate;
+
+    // does the file exist?
+    auto flags = std::fstream::in | std::fstream::out | std::fstream::binary;
+    if(truncate)
+        flags |= std::fstream::trunc;
+
+    file_.open(path.c_str(), flags);
+
+    if(!file_.is_open() && !truncate)
+    {
+        // file (probably) doesn't exist. So try again with fstream::trunc
+        // which is ok on an empty file
+        file_.open(path.c_str(), flags | std::fstream::trunc);
+        newfile = true;
+    }
+
+    if(!file_.is_open())
+        throw GeneralException("File could not be opened for reading and writing", "path", path);
+
+
+
+
+    if(!newfile)
+    {
+        // read existing data
+        file_.seekg(0, std::fstream::beg);
+
+        // read in the size of each toc entry, until there are no more
+        size_t toc_size;
+        while(file_.read(reinterpret_cast<char *>(&toc_size), sizeof(size_t)))
+        {
+            // read in the byte array for the toc entry
+            ByteArray toc_bytes(toc_size);
+            file_.read(toc_bytes.data(), toc_size);
+
+            // unserialize the TOC entry
+            FileTOCEntry toc_entry = from_byte_array<FileTOCEntry>(toc_bytes);
+
+            // skip ahead
+            file_.seekg(toc_entry.metadata_size + toc_entry.data_size, std::fstream::cur);
+
+            // place in my toc. A key written more than once is found again
+            // further on, and the later entry is the current one
+            toc_[toc_entry.key] = toc_entry;
+            output::print_global_warning("Read entry %?\n", toc_entry.key);
+        }
+
+        // clear the eof flag
+        file_.clear();
+
+        output::print_global_warning("Read %? entries from 5%?\n", size(), path);
+
+        // if a previous run recorded the order in which it read entries,
+        // start pulling them into the page cache now
+        if(toc_.count(read_order_key))
+            prefetch(unpack_keys(read_entry_(read_order_key).second));
+    }
+
+
+    // the file will throw exceptions if there is a problem
+    file_.exceptions(std::fstream::failbit | std::fstream::badbit);
+}
+
+
+size_t FileCheckpointIO::size(void) const
+{
+    return toc_.size() - toc_.count(read_order_key);
+}
+
+
+size_t FileCheckpointIO::count(const std::string & key) const
+{
+    return key == read_order_key ? 0 : toc_.count(key);
+}
+
+std::set<std::string> FileCheckpointIO::all_keys(void) const
+{
+    std::set<std::string> keys;
+    for(const auto & it : toc_)
+        if(it.first != read_order_key)
+            keys.insert(it.first);
+    return keys;
+}
+
+void FileCheckpointIO::write(const std::string & key,
+                             const ByteArray & metadata,
+                             const ByteArray & data)
+{
+    if(key == read_order_key)
+        throw GeneralException("Key is reserved by the checkpoint file", "key", key);
+    write_entry_(key, metadata, data);
+}
+
+const FileCheckpointIO::FileTOCEntry &
+FileCheckpointIO::find_entry_(const std::string & key) const
+{
+    auto it = toc_.find(key);
+    if(it == toc_.end() || key == read_order_key)
+        throw GeneralException("Cannot read from checkpoint file - key doesn't exist",
+                               "key", key);
+    return it->second;
+}
+
+void FileCheckpointIO::write_entry_(const std::string & key,
+                                    const ByteArray & metadata,
+                                    const ByteArray & data)
+{
+    using pulsar::util::to_byte_array;
+
+    // seek to the end of the file
+    file_.seekp(0, std::fstream::end);
+
+    std::streampos curpos = file_.tellp();
+
+    // make a TOC entry & serialize it
+    FileTOCEntry toc_entry{key, metadata.size(), data.size(), curpos};
+    ByteArray toc_entry_bytes = to_byte_array(toc_entry);
+    size_t toc_entry_size = toc_entry_bytes.size();
+
+    output::print_global_warning("toc entry size: %?\n", toc_entry_size);
+    file_.write(reinterpret_cast<const char *>(&toc_entry_size), sizeof(toc_entry_size));
+    file_.write(toc_entry_bytes.data(), toc_entry_size);
+
+
+    // write the actual data
+    file_.write(metadata.data(), metadata.size());
+    file_.write(data.data(), data.size());
+
+    // place in my toc, replacing any earlier entry for this key
+    toc_[toc_entry.key] = toc_entry;
+}
+
+std::pair<ByteArray, ByteArray> FileCheckpointIO::read(const std::string & key) const
+{
+    find_entry_(key);
+
+    // remember the order of first reads so the next restart can prefetch
+    if(read_seen_.insert(key).second)
+        read_order_.push_back(key);
+
+    return read_entry_(key);
+}
+
+std::pair<ByteArray, ByteArray> FileCheckpointIO::read_entry_(const std::string & key) const
+{
+    const auto & toc_entry = toc_.at(key);
+
+    // seek to where the data is
+    file_.seekg(toc_entry.pos, std::fstream::beg);
+
+    // read the size of the toc entry and skip ahead, since we already have it
+    size_t toc_size;
+    file_.read(reinterpret_cast<char *>(&toc_size), sizeof(size_t));
+    file_.seekg(toc_size, std::fstream::cur);
+
+    std::pair<ByteArray, ByteArray> alldata_bytes;
+    alldata_bytes.first.resize(toc_entry.metadata_size);
+    alldata_bytes.second.resize(toc_entry.data_size);
+
+    file_.read(alldata_bytes.first.data(), toc_entry.metadata_size);
+    file_.read(alldata_bytes.second.data(), toc_entry.data_size);
+    return alldata_bytes;
+}
+
+ByteArray FileCheckpointIO::read_metadata(const std::string & key) const
+{
+    const auto & toc_entry = find_entry_(key);
+
+    // seek to where the data is
+    file_.seekg(toc_entry.pos, std::fstream::beg);
+
+    // read the size of the toc entry and skip ahead, since we already have it
+    size_t toc_size;
+    file_.read(reinterpret_cast<char *>(&toc_size), sizeof(size_t));
+    file_.seekg(toc_size, std::fstream::cur);
+
+    ByteArray metadata_bytes(toc_entry.metadata_size);
+    file_.read(metadata_bytes.data(), toc_entry.metadata_size);
+    return metadata_bytes;
+}
+
+void FileCheckpointIO::prefetch(const std::vector<std::string> & keys) const
+{
+    // Each entry runs from its position to the start of the next entry
+    // (the serialized TOC entry has no fixed size), so get all the
+    // starting positions in file order
+    std::vector<std::streampos> starts;
+    for(const auto & it : toc_)
+        starts.push_back(it.second.pos);
+    std::sort(starts.begin(), starts.end());
+
+    // byte ranges [begin, end) of the requested entries. An end of
+    // zero means "to the end of the file"
+    std::vector<std::pair<off_t, off_t>> ranges;
+    for(const auto & key : keys)
+    {
+        auto it = toc_.find(key);
+        if(it == toc_.end())
+            continue;
+
+        const std::streampos pos = it->second.pos;
+        auto next = std::upper_bound(starts.begin(), starts.end(), pos);
+        ranges.emplace_back(static_cast<off_t>(pos),
+                            next == starts.end() ? 0 : static_cast<off_t>(*next));
+    }
+
+    if(ranges.empty())
+        return;
+
+    // merge adjacent entries so the kernel sees long sequential runs
+    // rather than one small request per key
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<off_t, off_t>> merged{ranges.front()};
+    for(size_t i = 1; i < ranges.size(); i++)
+    {
+        auto & last = merged.back();
+        if(last.second != 0 && ranges[i].first <= last.second)
+            last.second = (ranges[i].second == 0 ? 0 : std::max(last.second, ranges[i].second));
+        else
+            merged.push_back(ranges[i]);
+    }
+
+    // The fstream doesn't expose its descriptor, so open our own. The
+    // readahead started by POSIX_FADV_WILLNEED is asynchronous and fills
+    // the page cache, which outlives this descriptor
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if(fd < 0)
+        return; // prefetching is only a hint
+
+    for(const auto & r : merged)
+        posix_fadvise(fd, r.first, r.second == 0 ? 0 : r.second - r.first,
+                      POSIX_FADV_WILLNEED);
+    ::close(fd);
+}
+
+
+void FileCheckpointIO::save_read_order(void)
+{
+    if(read_order_.empty())
+        return;
+
+    ByteArray order = pack_keys(read_order_);
+
+    // Overwrite the old record if the new order fits, padding with zeros
+    // (unpack_keys stops after the last key).  The TOC entry, and hence
+    // the layout of the file, stays the same
+    auto it = toc_.find(read_order_key);
+    if(it != toc_.end() && it->second.data_size >= order.size())
+    {
+        const FileTOCEntry & toc_entry = it->second;
+        order.resize(toc_entry.data_size, 0);
+
+        file_.seekg(toc_entry.pos, std::fstream::beg);
+        size_t toc_size;
+        file_.read(reinterpret_cast<char *>(&toc_size), sizeof(size_t));
+
+        file_.seekp(static_cast<std::streamoff>(toc_entry.pos) + sizeof(size_t)
+                    + toc_size + toc_entry.metadata_size, std::fstream::beg);
+        file_.write(order.data(), order.size());
+        file_.flush();
+        return;
+    }
+
+    // Otherwise append a new record with room to grow, so the file only
+    // gains a record when the order has doubled in size
+    order.resize(2 * order.size(), 0);
+    write_entry_(read_order_key, ByteArray(), order);
+}
+
+
+void FileCheckpointIO::erase(const std::string & key)
+{
+}
+
+void FileCheckpointIO::clear(void)
+{
+}
+
+
+} // close namespace modulemanager
+} // close namespace pulsar
+
@@ -0,0 +1,151 @@
+/*! \file
+ *
+ * \brief File checkpointing backend (header)
+ * \author Benjamin Pritchard (ben@bennyp.org)
+ */
+
+
+#ifndef PULSAR_GUARD_MODULEMANAGER__FILECHECKPOINTIO_HPP_
+#define PULSAR_GUARD_MODULEMANAGER__FILECHECKPOINTIO_HPP_
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "pulsar/modulemanager/CheckpointIO.hpp"
+#include "pulsar/util/Serialization.hpp"
+
+namespace pulsar {
+namespace modulemanager {
+
+
+/*! \brief Checkpoint backend that stores everything in a single file
+ *
+ * Each entry is appended to the file as its serialized TOC entry (preceded
+ * by the TOC entry's size), then its metadata, then its data.  The TOC is
+ * rebuilt on opening by walking the file.  Writing a key that is already
+ * there appends a new entry that replaces the old one, both now and when
+ * the file is opened again (the last occurrence in the file wins).  The
+ * old entry's bytes stay in the file.
+ *
+ * The order in which a run first reads each key can be saved with
+ * save_read_order().  When the file is opened again, those entries are
+ * prefetched into the page cache so a restart doesn't wait on the disk
+ * one entry at a time.  That order is stored under a reserved key, which
+ * size(), count(), all_keys(), read(), and read_metadata() all treat as
+ * not being there, and which write() refuses.
+ */
+class FileCheckpointIO : public CheckpointIO
+{
+    public:
+        /*! \brief Opens (or creates) the checkpoint file at \p path
+         *
+         * \param [in] path Where the file is
+         * \param [in] truncate Start with an empty file even if it exists
+         */
+        FileCheckpointIO(const std::string & path, bool truncate);
+
+        FileCheckpointIO(const FileCheckpointIO &) = delete;
+        FileCheckpointIO & operator=(const FileCheckpointIO &) = delete;
+
+        virtual size_t size(void) const override;
+
+        virtual size_t count(const std::string & key) const override;
+
+        virtual std::set<std::string> all_keys(void) const override;
+
+        /*! \brief Appends an entry, replacing any earlier one for \p key
+         *
+         * \throw pulsar::GeneralException if \p key is the reserved key
+         */
+        virtual void write(const std::string & key,
+                           const ByteArray & metadata,
+                           const ByteArray & data) override;
+
+        virtual std::pair<ByteArray, ByteArray> read(const std::string & key) const override;
+
+        virtual ByteArray read_metadata(const std::string & key) const override;
+
+        virtual void erase(const std::string & key) override;
+
+        virtual void clear(void) override;
+
+
+        /*! \brief Asks the kernel to start reading the given entries
+         *
+         * Neighbouring entries are merged into one request.  This is only a
+         * hint: unknown keys are ignored and nothing is read here.
+         */
+        void prefetch(const std::vector<std::string> & keys) const;
+
+
+        /*! \brief Stores the order in which keys were first read
+         *
+         * The order is kept in a reserved entry, which is overwritten in
+         * place when the new order fits in the space of the old one, so
+         * saving repeatedly does not keep growing the file.
+         */
+        void save_read_order(void);
+
+
+    private:
+        //! What the file holds about each entry
+        struct FileTOCEntry
+        {
+            std::string key;
+            size_t metadata_size;
+            size_t data_size;
+            std::streampos pos;
+
+            template<class Archive>
+            void save(Archive & ar) const
+            {
+                ar(key, metadata_size, data_size, static_cast<long long>(pos));
+            }
+
+            template<class Archive>
+            void load(Archive & ar)
+            {
+                long long p;
+                ar(key, metadata_size, data_size, p);
+                pos = p;
+            }
+        };
+
+        //! Appends an entry; write() minus the check of the key
+        void write_entry_(const std::string & key,
+                          const ByteArray & metadata,
+                          const ByteArray & data);
+
+        //! Reads an entry; read() minus the check of the key and the
+        //! recording of the read order
+        std::pair<ByteArray, ByteArray> read_entry_(const std::string & key) const;
+
+        //! The TOC entry of a key the user may see, or throws
+        const FileTOCEntry & find_entry_(const std::string & key) const;
+
+        //! Path to the file
+        std::string path_;
+
+        //! The open file (reading moves the file pointer)
+        mutable std::fstream file_;
+
+        //! Where each entry is
+        std::map<std::string, FileTOCEntry> toc_;
+
+        //! Keys in the order they were first read
+        mutable std::vector<std::string> read_order_;
+
+        //! Keys already in read_order_
+        mutable std::unordered_set<std::string> read_seen_;
+};
+
+
+} // close namespace modulemanager
+} // close namespace pulsar
+
+
+#endif
@@ -0,0 +1,319 @@
+/*! \file
+ *
+ * \brief The work-stealing thread pool shared by the parallel kernels
+ */
+
+#include <cstdlib>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef PULSAR_HAVE_MADNESS
+#include <madness/world/thread.h>
+#endif
+
+#include "pulsar/parallel/ThreadPool.hpp"
+
+namespace pulsar{
+namespace parallel{
+
+namespace {
+
+/// The pool the current thread is a worker of, if any, and its index
+thread_local const ThreadPool * tl_pool = nullptr;
+thread_local size_t tl_index = 0;
+
+std::mutex hook_mutex;
+std::function<int(int)> blas_hook;
+
+std::function<int(int)> BLASHook(void)
+{
+    std::lock_guard<std::mutex> l(hook_mutex);
+    return blas_hook;
+}
+
+std::mutex default_mutex;
+std::unique_ptr<ThreadPool> default_pool;
+
+} // close anonymous namespace
+
+
+/////////////////////////////////////////////////////////////////////////
+// ThreadPool
+/////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(size_t NThreads)
+    : pending_(0), stop_(false)
+{
+    if(NThreads == 0)
+        NThreads = DefaultNumThreads();
+    for(size_t i = 0; i < NThreads; i++)
+        queues_.emplace_back(new Queue_);
+    threads_.reserve(NThreads - 1);
+    for(size_t i = 0; i + 1 < NThreads; i++)
+        threads_.emplace_back(&ThreadPool::WorkerLoop_, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> l(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for(auto & t : threads_)
+        t.join();
+
+    //Only possible if there were no workers
+    std::function<void()> task;
+    while(Take_(task))
+        task();
+}
+
+bool ThreadPool::IsWorker(void) const noexcept
+{
+    return tl_pool == this;
+}
+
+void ThreadPool::Submit(std::function<void()> Task)
+{
+    Queue_ & q = *queues_[IsWorker() ? tl_index : threads_.size()];
+    {
+        std::lock_guard<std::mutex> l(q.mutex);
+        q.tasks.push_back(std::move(Task));
+    }
+    pending_++;
+
+    //Taking the lock means a worker can't be between checking pending_
+    //and going to sleep, so the notification isn't lost
+    {
+        std::lock_guard<std::mutex> l(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+void ThreadPool::WakeAll_(void)
+{
+    //As in Submit(), so a thread can't miss this between checking and sleeping
+    {
+        std::lock_guard<std::mutex> l(sleep_mutex_);
+    }
+    sleep_cv_.notify_all();
+}
+
+bool ThreadPool::Take_(std::function<void()> & Task)
+{
+    if(pending_ == 0)
+        return false;
+
+    const size_t nq = queues_.size();
+    size_t start = nq - 1;
+    if(IsWorker())
+    {
+        Queue_ & q = *queues_[tl_index];
+        std::lock_guard<std::mutex> l(q.mutex);
+        if(!q.tasks.empty())
+        {
+            Task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            pending_--;
+            return true;
+        }
+        start = tl_index + 1;
+    }
+
+    for(size_t k = 0; k < nq; k++)
+    {
+        Queue_ & q = *queues_[(start + k) % nq];
+        std::lock_guard<std::mutex> l(q.mutex);
+        if(!q.tasks.empty())
+        {
+            Task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            pending_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::RunPending(void)
+{
+    std::function<void()> task;
+    if(!Take_(task))
+        return false;
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop_(size_t Me)
+{
+    tl_pool = this;
+    tl_index = Me;
+
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+    auto hook = BLASHook();
+    if(hook)
+        hook(1);
+
+    while(true)
+    {
+        if(RunPending())
+            continue;
+        std::unique_lock<std::mutex> l(sleep_mutex_);
+        sleep_cv_.wait(l, [this]{ return stop_ || pending_ > 0; });
+        if(stop_ && pending_ == 0)
+            return;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////
+// TaskGroup
+/////////////////////////////////////////////////////////////////////////
+
+TaskGroup::TaskGroup(void)
+    : TaskGroup(DefaultPool())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        Wait();
+    }
+    catch(...)
+    {
+    }
+}
+
+void TaskGroup::Run(std::function<void()> Task)
+{
+    count_++;
+    ThreadPool & pool = pool_;
+    pool_.Submit([this, &pool, Task]()
+    {
+        try
+        {
+            Task();
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> l(mutex_);
+            if(!error_)
+                error_ = std::current_exception();
+        }
+        //Nothing of this group may be touched after this, but the pool
+        //outlives it
+        if(--count_ == 0)
+            pool.WakeAll_();
+    });
+}
+
+void TaskGroup::Wait(void)
+{
+    while(count_ != 0)
+        if(!pool_.RunPending())
+            pool_.Sleep_([this]{ return count_ == 0; });
+
+    //A Submit() may have woken this thread rather than a worker
+    if(pool_.pending_ > 0)
+        pool_.sleep_cv_.notify_one();
+
+    std::exception_ptr e;
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        std::swap(e, error_);
+    }
+    if(e)
+        std::rethrow_exception(e);
+}
+
+
+/////////////////////////////////////////////////////////////////////////
+// SerialBLASScope
+/////////////////////////////////////////////////////////////////////////
+
+SerialBLASScope::SerialBLASScope(void)
+    : omp_(0), blas_(0)
+{
+#ifdef _OPENMP
+    omp_ = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    auto hook = BLASHook();
+    if(hook)
+        blas_ = hook(1);
+}
+
+SerialBLASScope::~SerialBLASScope()
+{
+#ifdef _OPENMP
+    if(omp_ > 0)
+        omp_set_num_threads(omp_);
+#endif
+    auto hook = BLASHook();
+    if(hook && blas_ > 0)
+        hook(blas_);
+}
+
+
+/////////////////////////////////////////////////////////////////////////
+// Free functions
+/////////////////////////////////////////////////////////////////////////
+
+ThreadPool & DefaultPool(void)
+{
+    std::lock_guard<std::mutex> l(default_mutex);
+    if(!default_pool)
+        default_pool.reset(new ThreadPool(DefaultNumThreads()));
+    return *default_pool;
+}
+
+void SetNumThreads(size_t N)
+{
+    std::unique_ptr<ThreadPool> old;
+    {
+        std::lock_guard<std::mutex> l(default_mutex);
+        old = std::move(default_pool);
+        default_pool.reset(new ThreadPool(N ? N : DefaultNumThreads()));
+    }
+    //old is joined here, outside of the lock
+}
+
+size_t NumThreads(void)
+{
+    return DefaultPool().NThreads();
+}
+
+size_t DefaultNumThreads(void)
+{
+    const char * env = std::getenv("PULSAR_NUM_THREADS");
+    if(env)
+    {
+        const long n = std::strtol(env, nullptr, 10);
+        if(n > 0)
+            return static_cast<size_t>(n);
+    }
+
+    size_t n = std::max<size_t>(1, std::thread::hardware_concurrency());
+#ifdef PULSAR_HAVE_MADNESS
+    const size_t taken = madness::ThreadPool::size();
+    n = (taken < n) ? n - taken : 1;
+#endif
+    return n;
+}
+
+void SetBLASThreadHook(std::function<int(int)> Hook)
+{
+    std::lock_guard<std::mutex> l(hook_mutex);
+    blas_hook = std::move(Hook);
+}
+
+} // close namespace parallel
+} // close namespace pulsar
@@ -0,0 +1,350 @@
+/*! \file
+ *
+ * \brief The work-stealing thread pool shared by the parallel kernels
+ */
+
+#ifndef PULSAR_GUARD_PARALLEL__THREADPOOL_HPP_
+#define PULSAR_GUARD_PARALLEL__THREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace pulsar{
+namespace parallel{
+
+/*! \brief A fixed set of threads that run tasks, stealing from each other
+ *
+ * Each worker has its own deque of tasks.  A worker pushes the tasks it
+ * creates onto the back of its deque and takes work from the back as well,
+ * so nested parallelism runs depth first on the cores that created it and
+ * the data it touches is likely still in cache.  A worker with nothing to
+ * do steals from the front of the other deques, which is where the oldest
+ * (and usually largest) pieces of work are.  Threads that aren't workers
+ * submit to a separate queue that the workers also steal from.
+ *
+ * A thread waiting on tasks (see TaskGroup::Wait()) runs queued tasks
+ * rather than blocking, and sleeps only once every queue is empty, so
+ * nested calls never create more threads than the pool has: a
+ * ParallelFor inside a ParallelFor just adds tasks to the deque of the
+ * thread that made it.
+ *
+ * Counting the thread that submits and then waits, a pool of NThreads()
+ * threads starts NThreads()-1 workers.  The workers set OpenMP to one
+ * thread and call the BLAS hook (see SetBLASThreadHook()) with 1, so
+ * BLAS calls made from tasks don't each start a full set of BLAS threads.
+ *
+ * Most code should use DefaultPool() (or the free ParallelFor() and
+ * ParallelReduce()) rather than making its own pool, so that all parallel
+ * kernels share the same cores.
+ */
+class ThreadPool
+{
+    public:
+        /*! \brief Starts the worker threads
+         *
+         * \param[in] NThreads Total number of threads, including the one
+         *            that waits on the work.  Zero means DefaultNumThreads().
+         */
+        explicit ThreadPool(size_t NThreads = 0);
+
+        /// Runs whatever is still queued, then joins the workers
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        /// Number of threads work is spread over, including the caller
+        size_t NThreads(void) const noexcept { return threads_.size() + 1; }
+
+        /// True if the calling thread is one of this pool's workers
+        bool IsWorker(void) const noexcept;
+
+        /*! \brief Queues a task
+         *
+         * On a worker the task goes onto the back of that worker's deque,
+         * otherwise onto the shared queue.  Exceptions must not escape
+         * \p Task; use TaskGroup, which catches them.
+         */
+        void Submit(std::function<void()> Task);
+
+        /*! \brief Runs one queued task on the calling thread, if there is one
+         *
+         * The caller's own deque is tried first (from the back), then the
+         * other queues are stolen from (from the front).
+         *
+         * \return True if a task was run
+         */
+        bool RunPending(void);
+
+        /*! \brief Calls Body(i) for each i in [Begin, End)
+         *
+         * The range is cut into chunks of \p Grain indices, which are
+         * handed out dynamically to at most NThreads() runners.  If
+         * there is only one chunk the loop runs on the calling thread with
+         * no change to the OpenMP/BLAS settings.  The first exception
+         * thrown by \p Body stops the remaining chunks and is rethrown.
+         *
+         * \param[in] Grain Indices per chunk.  Zero picks about eight
+         *            chunks per thread.
+         */
+        template<typename Body_t>
+        void ParallelFor(size_t Begin, size_t End, Body_t && Body, size_t Grain = 0);
+
+        /*! \brief Reduces Body over [Begin, End)
+         *
+         * Each chunk starts from \p Identity and calls Body(i, Acc) for its
+         * indices.  The chunk results are then combined in order with
+         * Combine(Result, Chunk), so for a given \p Grain the result doesn't
+         * depend on how the chunks were scheduled.
+         */
+        template<typename T, typename Body_t, typename Combine_t>
+        T ParallelReduce(size_t Begin, size_t End, T Identity,
+                         Body_t && Body, Combine_t && Combine, size_t Grain = 0);
+
+    private:
+        /// A deque of tasks and the lock protecting it
+        struct Queue_
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue_>> queues_;  //!< One per worker, then the shared one
+        std::vector<std::thread> threads_;             //!< The workers
+        std::atomic<size_t> pending_;                  //!< Number of queued tasks
+        bool stop_;                                    //!< Set when shutting down
+        std::mutex sleep_mutex_;                       //!< For idle workers and waiters
+        std::condition_variable sleep_cv_;             //!< Idle workers and waiters wait on this
+
+        friend class TaskGroup;
+
+        /// Main loop of worker \p Me
+        void WorkerLoop_(size_t Me);
+
+        /// Takes a task, own deque first; false if all queues are empty
+        bool Take_(std::function<void()> & Task);
+
+        /// Sleeps until \p Done() is true or a task is queued
+        template<typename Done_t>
+        void Sleep_(Done_t && Done)
+        {
+            std::unique_lock<std::mutex> l(sleep_mutex_);
+            sleep_cv_.wait(l, [&]{ return Done() || pending_ > 0; });
+        }
+
+        /// Wakes every sleeping thread so it rechecks what it waits for
+        void WakeAll_(void);
+
+        /// Chunk size ParallelFor uses for \p N indices
+        size_t Grain_(size_t N, size_t Grain) const noexcept
+        {
+            return Grain ? Grain : std::max<size_t>(1, N / (8 * NThreads()));
+        }
+};
+
+
+/*! \brief A set of tasks that can be waited on together
+ *
+ * \code
+ * TaskGroup Group;
+ * Group.Run([&]{ Left = Solve(A); });
+ * Group.Run([&]{ Right = Solve(B); });
+ * Group.Wait();   // Runs queued tasks while waiting; rethrows
+ * \endcode
+ *
+ * The destructor waits as well (swallowing exceptions), so tasks can't
+ * outlive the locals they capture by reference.
+ */
+class TaskGroup
+{
+    public:
+        /// A group whose tasks run on \p Pool (DefaultPool() if not given)
+        TaskGroup(void);
+        explicit TaskGroup(ThreadPool & Pool) : pool_(Pool), count_(0) { }
+
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup &) = delete;
+        TaskGroup & operator=(const TaskGroup &) = delete;
+
+        /// Queues \p Task on the pool
+        void Run(std::function<void()> Task);
+
+        /*! \brief Runs queued tasks until all of this group's are done
+         *
+         * Once the queues are empty the remaining tasks are running on
+         * other threads, and the caller sleeps until they finish or more
+         * tasks are queued.
+         *
+         * \throw The first exception thrown by one of the tasks
+         */
+        void Wait(void);
+
+    private:
+        ThreadPool & pool_;             //!< Where the tasks run
+        std::atomic<size_t> count_;     //!< Tasks not finished yet
+        std::mutex mutex_;              //!< Protects error_
+        std::exception_ptr error_;      //!< First exception from a task
+};
+
+
+/*! \brief Limits OpenMP and BLAS to one thread on the calling thread
+ *
+ * The previous settings are restored on destruction.  ParallelFor holds
+ * one of these while the caller runs chunks, so kernels can call BLAS
+ * from inside a parallel loop without oversubscribing the cores.
+ */
+class SerialBLASScope
+{
+    public:
+        SerialBLASScope(void);
+        ~SerialBLASScope();
+
+        SerialBLASScope(const SerialBLASScope &) = delete;
+        SerialBLASScope & operator=(const SerialBLASScope &) = delete;
+
+    private:
+        int omp_;   //!< OpenMP threads before, 0 if not changed
+        int blas_;  //!< What the BLAS hook returned, 0 if not called
+};
+
+
+/*! \brief The pool the library's parallel kernels run on
+ *
+ * Created on first use with DefaultNumThreads() threads.
+ */
+ThreadPool & DefaultPool(void);
+
+/*! \brief Replaces the default pool with one of \p N threads
+ *
+ * Zero means DefaultNumThreads().  References to the old pool become
+ * invalid, so this must not be called while parallel work is running.
+ */
+void SetNumThreads(size_t N);
+
+/// Number of threads of the default pool
+size_t NumThreads(void);
+
+/*! \brief The number of threads a pool gets by default
+ *
+ * The environment variable PULSAR_NUM_THREADS if it is set, otherwise the
+ * number of hardware threads.  When built with MADNESS
+ * (PULSAR_HAVE_MADNESS), the threads of MADNESS's pool are subtracted so
+ * the two pools together fill the node rather than each trying to.
+ */
+size_t DefaultNumThreads(void);
+
+/*! \brief Sets how the BLAS library's thread count is changed
+ *
+ * \p Hook is called with the number of threads BLAS should use on the
+ * calling thread and returns the previous number, e.g.
+ * \code
+ * SetBLASThreadHook([](int n){ return mkl_set_num_threads_local(n); });
+ * \endcode
+ * Without a hook only OpenMP's setting is changed, which covers
+ * OpenMP-threaded BLAS libraries.  Set this before the default pool
+ * is first used; workers call it once when they start.
+ */
+void SetBLASThreadHook(std::function<int(int)> Hook);
+
+
+/////////////////////////////////////////////////////////////////////////
+// Template definitions
+/////////////////////////////////////////////////////////////////////////
+
+template<typename Body_t>
+void ThreadPool::ParallelFor(size_t Begin, size_t End, Body_t && Body, size_t Grain)
+{
+    if(End <= Begin)
+        return;
+    const size_t n = End - Begin;
+    Grain = Grain_(n, Grain);
+    const size_t nchunks = (n + Grain - 1) / Grain;
+    if(nchunks == 1 || NThreads() == 1)
+    {
+        for(size_t i = Begin; i < End; i++)
+            Body(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto Runner = [&]()
+    {
+        for(size_t c = next++; c < nchunks; c = next++)
+        {
+            const size_t b = Begin + c * Grain, e = std::min(b + Grain, End);
+            try
+            {
+                for(size_t i = b; i < e; i++)
+                    Body(i);
+            }
+            catch(...)
+            {
+                next = nchunks;
+                throw;
+            }
+        }
+    };
+
+    SerialBLASScope Serial;
+    TaskGroup Group(*this);
+    const size_t nrunners = std::min(nchunks, NThreads());
+    for(size_t r = 1; r < nrunners; r++)
+        Group.Run(Runner);
+    Runner();
+    Group.Wait();
+}
+
+template<typename T, typename Body_t, typename Combine_t>
+T ThreadPool::ParallelReduce(size_t Begin, size_t End, T Identity,
+                             Body_t && Body, Combine_t && Combine, size_t Grain)
+{
+    if(End <= Begin)
+        return Identity;
+    const size_t n = End - Begin;
+    Grain = Grain_(n, Grain);
+    const size_t nchunks = (n + Grain - 1) / Grain;
+
+    std::vector<T> partial(nchunks, Identity);
+    ParallelFor(0, nchunks, [&](size_t c)
+    {
+        const size_t b = Begin + c * Grain, e = std::min(b + Grain, End);
+        for(size_t i = b; i < e; i++)
+            Body(i, partial[c]);
+    }, 1);
+
+    T result = Identity;
+    for(const T & p : partial)
+        result = Combine(result, p);
+    return result;
+}
+
+/// ThreadPool::ParallelFor() on the default pool
+template<typename Body_t>
+void ParallelFor(size_t Begin, size_t End, Body_t && Body, size_t Grain = 0)
+{
+    DefaultPool().ParallelFor(Begin, End, std::forward<Body_t>(Body), Grain);
+}
+
+/// ThreadPool::ParallelReduce() on the default pool
+template<typename T, typename Body_t, typename Combine_t>
+T ParallelReduce(size_t Begin, size_t End, T Identity,
+                 Body_t && Body, Combine_t && Combine, size_t Grain = 0)
+{
+    return DefaultPool().ParallelReduce(Begin, End, std::move(Identity),
+                                        std::forward<Body_t>(Body),
+                                        std::forward<Combine_t>(Combine), Grain);
+}
+
+} // close namespace parallel
+} // close namespace pulsar
+
+#endif
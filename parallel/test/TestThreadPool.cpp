@@ -0,0 +1,110 @@
+/*! \file
+ *
+ * \brief Tests of the work-stealing thread pool
+ */
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pulsar/parallel/ThreadPool.hpp"
+#include "pulsar/testing/UnitTest.hpp"
+
+using namespace pulsar;
+using namespace pulsar::parallel;
+
+int main()
+{
+    UnitTest Tester("ThreadPool");
+
+    const size_t n = 100003;
+    double reference = 0.0;
+    for(size_t i = 0; i < n; i++)
+        reference += 1.0 / (1.0 + i);
+
+    for(size_t nthreads : {1, 2, 4, 7})
+    {
+        SetNumThreads(nthreads);
+        const std::string t = " (" + std::to_string(nthreads) + " threads)";
+        Tester.Test("NumThreads" + t, NumThreads() == nthreads);
+
+        //Every index exactly once, for several grains
+        for(size_t grain : {0, 1, 7, 1000, 200000})
+        {
+            std::vector<std::atomic<int>> hits(n);
+            for(auto & h : hits)
+                h = 0;
+            ParallelFor(0, n, [&](size_t i) { hits[i]++; }, grain);
+            bool once = true;
+            for(auto & h : hits)
+                once = once && h == 1;
+            Tester.Test("ParallelFor, grain " + std::to_string(grain) + t, once);
+        }
+        ParallelFor(5, 5, [&](size_t) { Tester.Test("Empty range runs nothing", false); });
+
+        //Chunks are combined in order, so the result doesn't depend on
+        //the number of threads
+        const double sum = ParallelReduce(0, n, 0.0,
+                                          [](size_t i, double & acc) { acc += 1.0 / (1.0 + i); },
+                                          [](double a, double b) { return a + b; }, 1000);
+        static double first = sum;
+        Tester.TestClose("ParallelReduce" + t, sum, reference, 1e-10);
+        Tester.Test("ParallelReduce is reproducible" + t, sum == first);
+
+        //Nested loops don't deadlock and run everything
+        std::atomic<size_t> count(0);
+        ParallelFor(0, 32, [&](size_t)
+        {
+            ParallelFor(0, 16, [&](size_t)
+            {
+                ParallelFor(0, 8, [&](size_t) { count++; }, 1);
+            }, 1);
+        }, 1);
+        Tester.Test("Nested ParallelFor" + t, count == 32 * 16 * 8);
+
+        Tester.TestThrows("ParallelFor rethrows" + t, [&]
+        {
+            ParallelFor(0, 1000, [](size_t i)
+            {
+                if(i == 500)
+                    throw std::runtime_error("Task failed");
+            }, 1);
+        });
+
+        TaskGroup group;
+        int a = 0, b = 0;
+        group.Run([&] { a = 1; });
+        group.Run([&] { b = 2; });
+        group.Wait();
+        Tester.Test("TaskGroup runs its tasks" + t, a == 1 && b == 2);
+
+        group.Run([] { throw std::runtime_error("Task failed"); });
+        group.Run([&] { a = 3; });
+        Tester.TestThrows("TaskGroup::Wait rethrows" + t, [&] { group.Wait(); });
+        Tester.Test("Other tasks still run" + t, a == 3);
+        group.Run([&] { b = 4; });
+        group.Wait();
+        Tester.Test("TaskGroup is reusable after an error" + t, b == 4);
+    }
+
+    //Waiting on a task that is running elsewhere sleeps rather than spins
+    SetNumThreads(2);
+    const std::clock_t cpu0 = std::clock();
+    const auto wall0 = std::chrono::steady_clock::now();
+    {
+        TaskGroup group;
+        group.Run([] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); });
+        //Make sure the worker has taken the task before waiting on it
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        group.Wait();
+    }
+    const double cpu = double(std::clock() - cpu0) / CLOCKS_PER_SEC;
+    const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall0;
+    Tester.Test("TaskGroup::Wait sleeps", wall.count() >= 0.2 && cpu < 0.5 * wall.count());
+
+    return Tester.Result();
+}